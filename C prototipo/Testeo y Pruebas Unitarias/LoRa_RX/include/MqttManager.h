@@ -8,9 +8,12 @@
 class MqttManager {
 public:
   MqttManager(Almacenamiento& cfg, WiFiManager& wifi)
-    : _cfg(cfg), _wifi(wifi), _lastPublish(0) {}
+    : _cfg(cfg), _wifi(wifi), _lastPublish(0), _intervalS(3) {}
 
   void begin(const char* host, uint16_t port) {
+    // Se lee una vez; loop() usa la copia en RAM
+    _intervalS = _cfg.getInt("interval_s", 3);
+
     _mqtt.onConnect([this](bool sessionPresent) {
       Serial.println("[MQTT] Connected to broker");
       _mqtt.subscribe("config/prueba/vitto2", 0);
@@ -22,8 +25,11 @@ public:
       if (deserializeJson(doc, payload, len) == DeserializationError::Ok) {
         if (doc.containsKey("interval")) {
           int secs = doc["interval"].as<int>();
-          _cfg.putInt("interval_s", secs);
-          Serial.printf("[Config] interval_s updated to %d s\n", secs);
+          if (secs != _intervalS) {
+            _intervalS = secs;
+            _cfg.putInt("interval_s", secs);   // sólo si cambió: cada put es una escritura en flash
+            Serial.printf("[Config] interval_s updated to %d s\n", secs);
+          }
         }
       } else {
         Serial.println("[MQTT] JSON parse error");
@@ -41,7 +47,7 @@ public:
     if (!_wifi.isConnected() || !_mqtt.connected()) return;
 
     unsigned long now = millis();
-    int interval = _cfg.getInt("interval_s", 3);
+    int interval = _intervalS;
     if (now - _lastPublish >= (unsigned long)interval * 1000UL) {
       const char* msg = "hola";
       _mqtt.publish("prueba/vitto", 0, false, msg);
@@ -55,4 +61,5 @@ private:
   WiFiManager& _wifi;
   AsyncMqttClient _mqtt;
   unsigned long _lastPublish;
+  volatile int _intervalS;   // lo escribe el callback de AsyncMqttClient
 };
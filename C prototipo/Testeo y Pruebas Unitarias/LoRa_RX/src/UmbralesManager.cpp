@@ -16,11 +16,20 @@ void UmbralesManager::save() const {
     prefs.putInt(KEY_HIST, umbrales.histeresis);
 }
 
+// Escribe sólo la clave que cambió: un JSON con un campo, o con los mismos
+// valores, no reescribe las tres
+static void actualizar(Preferences& prefs, const JsonDocument& doc, const char* campo, const char* clave, int& valor) {
+    if (!doc.containsKey(campo)) return;
+    int nuevo = doc[campo];
+    if (nuevo == valor) return;
+    valor = nuevo;
+    prefs.putInt(clave, valor);
+}
+
 void UmbralesManager::updateFromJson(const JsonDocument& doc) {
-    if (doc.containsKey("minvelocidad"))   umbrales.minvelocidad   = doc["minvelocidad"];
-    if (doc.containsKey("maxvelocidad"))   umbrales.maxvelocidad   = doc["maxvelocidad"];
-    if (doc.containsKey("histeresis"))     umbrales.histeresis     = doc["histeresis"];
-    save();  // persisto cambios automáticamente
+    actualizar(prefs, doc, "minvelocidad", KEY_MIN,  umbrales.minvelocidad);
+    actualizar(prefs, doc, "maxvelocidad", KEY_MAX,  umbrales.maxvelocidad);
+    actualizar(prefs, doc, "histeresis",   KEY_HIST, umbrales.histeresis);
 }
 
 Umbrales UmbralesManager::get() const {
@@ -1,8 +1,27 @@
 #include "SensorCO2.h"
 
+#define HOUR_MS 3600000UL
+
+// Registro guardado en NVS: Ro, antigüedad en horas de uso y CRC-16
+struct CalibracionGuardada {
+    float ro;
+    uint32_t ageHours;
+    uint16_t crc;
+};
+
+static uint16_t crc16(const uint8_t* datos, size_t largo) {    // CRC-16/CCITT-FALSE
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < largo; i++) {
+        crc ^= (uint16_t)datos[i] << 8;
+        for (uint8_t b = 0; b < 8; b++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
 
 SensorCO2::SensorCO2(int pin)                                   // Inicializa el sensor mq, usando la funcion mq de la libreria MQUnifiedsensor
   : sensorPin(pin)
+  , Ro(0), calibSum(0), calibNext(0), calibTaken(0), calibrating(false)
+  , preheatCount(0), preheatIdx(0), preheatStart(0), preheatNext(0), warm(false), ageHours(0), ageNext(0)
   , mq(BOARD, VCC, ADC_RES, sensorPin, F("MQ-2")){}             // placa, voltaje, resolución ADC, pin, tipo de sensor    
 //, mq(BOARD, VCC, ADC_RES, sensorPin, F("MQ-135")) {} 
         
@@ -11,22 +30,132 @@ SensorCO2::SensorCO2(int pin)                                   // Inicializa el
 //=============================================
 
 void SensorCO2::begin() {
-    Serial.println("Inicializando mq y calibrando Ro...");
+    Serial.println("Inicializando mq...");
     mq.setRegressionMethod(1);                                 // regresión exponencial (curva log-log)
     mq.setRL(RL_KOHM);                                 
     mq.init();                                                 // inicializa ADC interno del sensor
     mq.update();                                               // Actualiza medición interna
-    delay(CALIB_DELAY_MS);                                                 
-    Ro = mq.calibrate(RATIO_CLEAN_AIR);                    // Calibración usando el valor de Rs/Ro en aire limpio
-    Serial.print("Calibración completa. Ro = ");
-    Serial.print(Ro, 2);
-    Serial.println(" kΩ\n");
+    if (loadCalibration()) {                                   // Arranque en caliente: Ro de NVS
+        Serial.print("Ro guardado = ");
+        Serial.print(Ro, 2);
+        Serial.println(" kΩ");
+    } else {
+        Serial.println("Sin Ro guardado: se calibra al terminar el precalentamiento");
+    }
+    preheatCount = preheatIdx = 0;                             // No bloquea: lo completa update()
+    preheatStart = preheatNext = millis();
+    warm = false;
+}
+
+void SensorCO2::startCalibration() {
+    calibSum = 0;
+    calibTaken = 0;
+    calibNext = millis();
+    calibrating = true;
+}
+
+bool SensorCO2::isCalibrated() const {
+    return Ro > 0;
+}
+
+bool SensorCO2::isWarm() const {
+    return warm;
+}
+
+bool SensorCO2::isReady() const {
+    return warm && isCalibrated();
+}
+
+uint8_t SensorCO2::calibrationProgress() const {
+    return calibrating ? (uint8_t)(calibTaken * 100 / CALIB_SAMPLES) : 100;
 }
 
 //=============================================
 // Funciones de la clase para llamar en el LOOP
 //=============================================
 
+void SensorCO2::update() {
+    if (!warm) updatePreheat();
+    if (calibrating) updateCalibration();
+    if (isCalibrated() && (long)(millis() - ageNext) >= 0) {  // Antigüedad del Ro, guardada cada hora
+        ageHours++;
+        saveCalibration();
+    }
+}
+
+// El calentador está estable cuando la lectura deja de moverse: máximo y
+// mínimo de las últimas PREHEAT_WINDOW muestras a menos de PREHEAT_SPREAD.
+// Tras un corte breve el sensor sigue caliente y alcanza con llenar la ventana.
+void SensorCO2::updatePreheat() {
+    if ((long)(millis() - preheatNext) < 0) return;
+    preheatNext = millis() + PREHEAT_SAMPLE_MS;
+    preheatWindow[preheatIdx] = (uint16_t)analogRead(sensorPin);
+    preheatIdx = (preheatIdx + 1) % PREHEAT_WINDOW;
+    if (preheatCount < PREHEAT_WINDOW) preheatCount++;
+
+    bool stable = false;
+    if (preheatCount >= PREHEAT_WINDOW) {
+        uint16_t lo = preheatWindow[0], hi = preheatWindow[0];
+        for (uint8_t i = 1; i < PREHEAT_WINDOW; i++) {
+            if (preheatWindow[i] < lo) lo = preheatWindow[i];
+            if (preheatWindow[i] > hi) hi = preheatWindow[i];
+        }
+        stable = hi - lo <= PREHEAT_SPREAD;
+    }
+    if (!stable && millis() - preheatStart < PREHEAT_TIMEOUT_MS) return;
+
+    warm = true;
+    Serial.print("Sensor estable en ");
+    Serial.print(millis() - preheatStart);
+    Serial.println(" ms");
+    if (!isCalibrated() && !calibrating) startCalibration();
+}
+
+void SensorCO2::updateCalibration() {
+    if ((long)(millis() - calibNext) < 0) return;
+
+    mq.update();
+    calibSum += mq.calibrate(RATIO_CLEAN_AIR);                 // Ro de esta muestra, según Rs/Ro en aire limpio
+    calibNext = millis() + CALIB_SAMPLE_MS;
+    if (++calibTaken < CALIB_SAMPLES) return;
+
+    calibrating = false;
+    Ro = calibSum / CALIB_SAMPLES;
+    mq.setR0(Ro);                                              // readPPM() usa este Ro
+    ageHours = 0;
+    saveCalibration();
+    Serial.print("Calibración completa. Ro = ");
+    Serial.print(Ro, 2);
+    Serial.println(" kΩ\n");
+}
+
+bool SensorCO2::loadCalibration() {
+    CalibracionGuardada c;
+    prefs.begin("sensorco2", true);
+    size_t n = prefs.getBytes("calib", &c, sizeof(c));
+    prefs.end();
+    if (n != sizeof(c) || c.crc != crc16((const uint8_t*)&c, offsetof(CalibracionGuardada, crc))) return false;
+    if (!(c.ro > 0) || c.ageHours >= CALIB_MAX_AGE_H) return false;
+
+    Ro = c.ro;
+    ageHours = c.ageHours;
+    ageNext = millis() + HOUR_MS;
+    mq.setR0(Ro);
+    return true;
+}
+
+void SensorCO2::saveCalibration() {
+    CalibracionGuardada c;
+    memset(&c, 0, sizeof(c));                                  // Relleno determinista para el CRC
+    c.ro = Ro;
+    c.ageHours = ageHours;
+    c.crc = crc16((const uint8_t*)&c, offsetof(CalibracionGuardada, crc));
+    prefs.begin("sensorco2", false);
+    prefs.putBytes("calib", &c, sizeof(c));
+    prefs.end();
+    ageNext = millis() + HOUR_MS;
+}
+
 int SensorCO2::readRaw() {
     return analogRead(sensorPin);               // Lectura del valor analogico
 }
@@ -37,7 +166,7 @@ float SensorCO2::readResistance() {
     return rs;
 }
 float SensorCO2::readRatio() {                  // Calcula la relación Rs/Ro (res sensor/ res aire limpio)
-    return readResistance() / Ro;
+    return isCalibrated() ? readResistance() / Ro : 0;
 }
 float SensorCO2::readPPM() {
     mq.update();                               // refrescar medición
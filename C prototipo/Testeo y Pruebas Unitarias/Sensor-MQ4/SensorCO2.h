@@ -2,6 +2,7 @@
 #define SENSORCO2_H
 
 #include <Arduino.h>
+#include <Preferences.h>       // NVS del ESP32, guarda el Ro entre reinicios
 #include "MQUnifiedsensor.h"  // Librería para sensors MQ, nos simplifica la lectura y calibracion
 
 //=============================================
@@ -16,7 +17,13 @@
 #define RL_KOHM             10.0f       // Resistencia de carga en kilo-ohmios (kΩ)
 #define ADC_RES             12          // Resolución ADC del ESP32 (12 bits = 4095)
 #define RATIO_CLEAN_AIR     9.8f        // Rs/Ro en aire limpio según datasheet
-#define CALIB_DELAY_MS      2000          // Tiempo de espera para estabilizar el sensor (ms)
+#define CALIB_SAMPLES       10            // Muestras que se promedian para Ro
+#define CALIB_SAMPLE_MS     200           // Separación entre muestras de calibración (ms)
+#define CALIB_MAX_AGE_H     720           // Horas de uso tras las que el Ro guardado se descarta
+#define PREHEAT_SAMPLE_MS   200           // Período de muestreo durante el precalentamiento (ms)
+#define PREHEAT_WINDOW      8             // Muestras de la ventana de estabilidad
+#define PREHEAT_SPREAD      16            // Máx - mín del ADC (12 bits) para darlo por estable
+#define PREHEAT_TIMEOUT_MS  180000UL      // Tope del precalentamiento (ms)
 
 // Por suerte la configuracion para el MQ135 es simple, comentar y descomentar lo siguiente
 //#define RATIO_CLEAN_AIR     3.8f 
@@ -26,7 +33,13 @@ class SensorCO2 {
 public:
 
     explicit SensorCO2(int pin);        // PIN a definir segun la planilla de sensores
-    void begin();                       // Inicializa el sensor y la librería MQUnifiedsensor
+    void begin();                       // Inicializa el sensor, recupera el Ro guardado y arranca el precalentamiento
+    void update();                      // Avanza precalentamiento y calibración, llamar en cada vuelta del LOOP (no bloquea)
+    void startCalibration();            // Recalibra en segundo plano (aire limpio)
+    bool isCalibrated() const;          // true cuando ya hay un Ro
+    bool isWarm() const;                // true cuando la lectura del calentador se estabilizó
+    bool isReady() const;               // Calibrado y caliente: el PPM es confiable
+    uint8_t calibrationProgress() const; // Avance de la calibración en curso (0 a 100)
     int readRaw();                      // Lectura cruda del sensor (ADC)  
     float readResistance();             // Lectura de resistencia del sensor (Rs) en KOhms
     float readRatio();                  // Lectura de la relación Rs/Ro
@@ -34,8 +47,26 @@ public:
 
 private:
     int sensorPin;
-    float Ro;                           // Resistencia en aire limpio (kΩ)
+    float Ro;                           // Resistencia en aire limpio (kΩ), 0 hasta la primera calibración
+    float calibSum;                     // Suma de Ro de las muestras tomadas
+    unsigned long calibNext;            // millis() de la próxima muestra
+    uint8_t calibTaken;                 // Muestras tomadas
+    bool calibrating;
+    uint16_t preheatWindow[PREHEAT_WINDOW]; // Últimas lecturas del ADC durante el precalentamiento
+    uint8_t preheatCount;               // Muestras en la ventana (hasta PREHEAT_WINDOW)
+    uint8_t preheatIdx;                 // Próxima posición de la ventana circular
+    unsigned long preheatStart;
+    unsigned long preheatNext;
+    bool warm;
+    uint32_t ageHours;                  // Horas de uso desde la última calibración
+    unsigned long ageNext;              // millis() del próximo guardado de la antigüedad
+    Preferences prefs;
     MQUnifiedsensor mq;                // Objeto de la librería MQUnifiedsensor para el sensor MQ sea el 2, o el 135
+
+    void updatePreheat();
+    void updateCalibration();
+    bool loadCalibration();
+    void saveCalibration();
 };
 
 #endif 
\ No newline at end of file
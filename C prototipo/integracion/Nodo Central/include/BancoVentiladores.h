@@ -0,0 +1,134 @@
+#ifndef BANCO_VENTILADORES_H
+#define BANCO_VENTILADORES_H
+
+#include <Arduino.h>
+#include "ControlVentilador.h"
+
+#ifndef BANCO_VENTILADORES_MAX
+#define BANCO_VENTILADORES_MAX 32
+#endif
+
+// Varios extractores que ventilan el mismo espacio, manejados como uno.
+//
+// La demanda (0-100%) es del banco completo: se reparte en partes iguales
+// entre los extractores en marcha, y cuantos andan depende de ella. Entra
+// uno más cuando los que andan no alcanzan al 100%, y sale uno cuando los
+// restantes la cubren al 80% o menos (la histéresis evita que un extractor
+// arranque y pare con cada lectura).
+//
+// Arranques escalonados: un extractor parado no arranca hasta escalonMs
+// después del arranque anterior, para no sumar las corrientes de arranque.
+// Los que ya andan cambian de velocidad sin esperar.
+//
+// Desgaste parejo (lead/lag): entra el de menos tiempo de marcha y sale el
+// de más. Cada rotacionMs, si uno parado tiene menos marcha que uno en
+// marcha, lo releva: el que sale se detiene recién cuando el que entra
+// llegó a su velocidad.
+//
+// El estado es una tabla por campo (un arreglo por campo, no uno por
+// extractor) y actualizar() recorre sólo los extractores con rampa en
+// curso: el costo es O(N) sin memoria dinámica, y casi nulo sin rampas. La
+// rampa es la de ControlVentilador, por tiempo y por software
+// (analogWrite()); el ESP32 tiene 16 canales LEDC.
+class BancoVentiladores {
+public:
+  static const uint8_t MAX = BANCO_VENTILADORES_MAX;
+  static const uint8_t NINGUNO = 0xFF;
+
+  BancoVentiladores(const uint8_t* pines, uint8_t cantidad, int velocidadMin = 100);
+
+  // Métodos principales, como ControlVentilador
+  void inicializar();
+  void establecerVelocidad(int porcentaje);   // demanda del banco
+  void encender(int porcentaje = 50);
+  void apagar();
+  void actualizar();
+
+  // Configuración
+  void configurarPendiente(float porcentajePorSegundo, CurvaRampa forma = CURVA_LINEAL);
+  void configurarArranqueSuave(bool habilitado, int velocidadMin = 100);   // todos
+  void configurarArranqueSuave(uint8_t indice, bool habilitado, int velocidadMin);
+  void configurarEscalon(unsigned long ms);
+  void configurarRotacion(unsigned long ms);  // 0: sólo al arrancar y parar
+  // A igual tiempo de marcha entra primero este (p. ej. según el contador
+  // de arranques: el tiempo de marcha no sobrevive a un reinicio)
+  void empezarPor(uint8_t indice);
+
+  // Getters del banco, como ControlVentilador
+  int obtenerVelocidadActual();     // media de todos los extractores
+  int obtenerVelocidadObjetivo();   // demanda
+  bool estaEncendido();
+  bool estaEnTransicion();
+  int obtenerPin();                 // el primero en marcha, o el próximo en entrar
+  int obtenerPWM();                 // el mayor
+  float obtenerPendiente();
+
+  // Por extractor
+  uint8_t cantidad() { return n; }
+  uint8_t enMarcha();
+  uint8_t pinDe(uint8_t i) { return pin[i]; }
+  uint8_t pwmDe(uint8_t i) { return pwm[i]; }
+  uint32_t marchaDe(uint8_t i);     // segundos en marcha desde el arranque
+
+  // Alarma: los que andan van a 255 al instante; los parados arrancan ya
+  // (el primero, si no anda ninguno) o escalonados, sin rampa
+  void forzarMaximo();
+  void liberarAnulacion();
+  bool anulacionActiva();
+  void paradaEmergencia();
+
+  String obtenerEstadoCompleto();
+
+private:
+  // Bits de estado
+  static const uint8_t ACTIVO = 0x01;       // asignado a la demanda
+  static const uint8_t ESPERA = 0x02;       // parado, espera su turno de arranque
+  static const uint8_t SUAVE = 0x04;        // aplica velocidadMinima
+  static const uint8_t RELEVO = 0x08;       // sale cuando el que entra llegue
+
+  uint8_t pin[MAX];
+  uint8_t pwm[MAX];             // aplicado
+  uint8_t objetivo[MAX];
+  uint8_t desde[MAX];           // PWM al empezar la rampa
+  uint8_t minimo[MAX];
+  uint8_t estado[MAX];
+  uint32_t rampaInicio[MAX];
+  uint32_t rampaDuracion[MAX];
+  uint32_t marchaS[MAX];        // segundos acumulados hasta marchaDesde
+  uint32_t marchaDesde[MAX];    // millis() del arranque o del último acumulado
+
+  uint32_t enRampa;             // bit i: rampa en curso
+  uint32_t enEspera;            // bit i: ESPERA
+  uint8_t n;
+  uint8_t activos;
+  uint8_t primero;
+  uint8_t entrante;             // relevo en curso: el que entra, o NINGUNO
+  uint8_t saliente;
+  int demanda;                  // %
+  int pwmPorExtractor;
+  bool anulacion;
+  float pendiente;              // PWM por segundo
+  CurvaRampa curva;
+  unsigned long escalonMs;
+  unsigned long rotacionMs;
+  uint32_t proximoArranque;
+  uint32_t proximaRevision;
+  uint32_t proximaRotacion;
+
+  void repartir(uint32_t ahora);
+  void cancelarRelevo();
+  uint8_t elegirEntrante(uint32_t ahora);
+  uint8_t elegirSaliente(uint32_t ahora);
+  void arrancarPendientes(uint32_t ahora);
+  void fijar(uint8_t i, int valor, uint32_t ahora);
+  void iniciarRampa(uint8_t i, uint32_t ahora);
+  void escribir(uint8_t i, int valor, uint32_t ahora);
+  void revisar(uint32_t ahora);
+  uint32_t marcha(uint8_t i, uint32_t ahora);
+  uint8_t orden(uint8_t i) { return (uint8_t)((i + n - primero) % n); }
+  int valorRampa(uint8_t i, uint32_t transcurrido);
+};
+
+static_assert(BANCO_VENTILADORES_MAX <= 32, "las máscaras del banco son de 32 bits");
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef COLA_COMANDOS_H
+#define COLA_COMANDOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef COLA_COMANDOS_CAPACIDAD
+#define COLA_COMANDOS_CAPACIDAD 16
+#endif
+
+#define COMANDO_LARGO_MAX 26        // el nodo recibe hasta 32 bytes por trama
+
+// Comando MQTT -> LoRa esperando confirmación del nodo
+struct ComandoLoRa {
+  uint32_t encoladoMs;
+  uint32_t enviadoMs;       // último intento
+  uint32_t proximoMs;       // próximo intento, o fin de la espera del último
+  uint16_t seq;
+  uint8_t  nodo;
+  uint8_t  intentos;
+  uint8_t  largo;
+  char     texto[COMANDO_LARGO_MAX + 1];
+};
+
+// Cola acotada de comandos de bajada. Cada nodo tiene como mucho POR_NODO
+// comandos y se atienden en orden: el siguiente no sale hasta que el
+// primero se confirma o agota los intentos.
+//
+// El Nano escucha todo el tiempo salvo mientras transmite, así que el
+// momento seguro para hablarle es justo después de un uplink suyo: el primer
+// intento espera hasta ESPERA_UPLINK_MS a que el nodo transmita y sale
+// VENTANA_MS después. Sin respuesta se reintenta con espera exponencial
+// (TIMEOUT_MS, 2x, 4x... más hasta un 25% al azar); un uplink del nodo
+// mientras tanto adelanta el reintento a su ventana.
+class ColaComandos {
+public:
+  static const uint8_t  CAPACIDAD = COLA_COMANDOS_CAPACIDAD;
+  static const uint8_t  POR_NODO = 4;
+  static const uint8_t  MAX_INTENTOS = 4;
+  static const uint32_t ESPERA_UPLINK_MS = 2000;
+  static const uint32_t VENTANA_MS = 20;       // el nodo ya volvió a RX tras su TX
+  static const uint32_t TIMEOUT_MS = 1000;     // ida, respuesta y proceso en el nodo
+
+  ColaComandos();
+
+  // Las secuencias siguen desde seqInicial: con un valor distinto por
+  // arranque, el nodo no confunde un comando nuevo con un reintento
+  void begin(uint16_t seqInicial);
+
+  // Devuelve el comando encolado, o nullptr si no hay lugar
+  const ComandoLoRa* encolar(uint8_t nodo, const char* texto, size_t largo, uint32_t ahora);
+
+  void alRecibirUplink(uint8_t nodo, uint32_t ahora);
+
+  // Comando que toca transmitir ahora, o nullptr; marcarEnviado() tras el TX
+  ComandoLoRa* proximoEnvio(uint32_t ahora);
+  void marcarEnviado(ComandoLoRa* c, uint32_t ahora);
+
+  // Respuesta del nodo: saca el comando y lo copia en c
+  bool confirmar(uint8_t nodo, uint16_t seq, ComandoLoRa& c);
+
+  // Comando que agotó los intentos: lo saca y lo copia en c
+  bool vencido(uint32_t ahora, ComandoLoRa& c);
+
+  uint8_t pendientes() const { return cantidad; }
+
+private:
+  ComandoLoRa items[CAPACIDAD];   // en orden de llegada
+  uint8_t cantidad;
+  uint16_t proximoSeq;
+
+  bool esPrimero(uint8_t i) const;
+  void quitar(uint8_t i);
+  static bool llego(uint32_t ahora, uint32_t plazo) { return (int32_t)(ahora - plazo) >= 0; }
+};
+
+#endif
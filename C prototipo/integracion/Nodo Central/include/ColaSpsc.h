@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Cola circular sin locks para exactamente un productor y un consumidor
+// (por ejemplo, una tarea en cada núcleo). Cada índice lo escribe un solo
+// lado; acquire/release alcanza para que el consumidor vea el elemento
+// completo antes que el índice que lo publica. N debe ser potencia de 2.
+//
+// reservar()/publicar() y frente()/liberar() trabajan sobre el slot en su
+// lugar, sin copiar el elemento.
+template <class T, size_t N>
+class ColaSpsc {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N debe ser potencia de 2");
+
+public:
+  ColaSpsc() : _cabeza(0), _cola(0), _descartados(0), _maximo(0) {}
+
+  // ---- Productor ----
+  // Slot libre para escribir, o nullptr si la cola está llena (se cuenta)
+  T* reservar() {
+    uint32_t cabeza = _cabeza.load(std::memory_order_relaxed);
+    if (cabeza - _cola.load(std::memory_order_acquire) >= N) {
+      _descartados.store(_descartados.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    return &_slots[cabeza & (N - 1)];
+  }
+
+  void publicar() {
+    uint32_t cabeza = _cabeza.load(std::memory_order_relaxed) + 1;
+    _cabeza.store(cabeza, std::memory_order_release);
+    uint32_t ocupados = cabeza - _cola.load(std::memory_order_relaxed);
+    if (ocupados > _maximo.load(std::memory_order_relaxed)) _maximo.store(ocupados, std::memory_order_relaxed);
+  }
+
+  bool poner(const T& v) {
+    T* slot = reservar();
+    if (!slot) return false;
+    *slot = v;
+    publicar();
+    return true;
+  }
+
+  // ---- Consumidor ----
+  T* frente() {
+    uint32_t cola = _cola.load(std::memory_order_relaxed);
+    if (cola == _cabeza.load(std::memory_order_acquire)) return nullptr;
+    return &_slots[cola & (N - 1)];
+  }
+
+  void liberar() {
+    _cola.store(_cola.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  bool sacar(T& v) {
+    T* slot = frente();
+    if (!slot) return false;
+    v = *slot;
+    liberar();
+    return true;
+  }
+
+  // ---- Estadísticas (se pueden leer desde cualquier lado) ----
+  uint32_t ocupados() const {
+    return _cabeza.load(std::memory_order_acquire) - _cola.load(std::memory_order_acquire);
+  }
+  uint32_t descartados() const { return _descartados.load(std::memory_order_relaxed); }
+  uint32_t maximoOcupado() const { return _maximo.load(std::memory_order_relaxed); }
+  static constexpr size_t capacidad() { return N; }
+
+private:
+  T _slots[N];
+  std::atomic<uint32_t> _cabeza;        // próximo slot a escribir (productor)
+  std::atomic<uint32_t> _cola;          // próximo slot a leer (consumidor)
+  std::atomic<uint32_t> _descartados;   // sólo lo escribe el productor
+  std::atomic<uint32_t> _maximo;        // ocupación máxima observada
+};
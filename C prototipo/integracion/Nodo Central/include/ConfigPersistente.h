@@ -0,0 +1,104 @@
+#ifndef CONFIG_PERSISTENTE_H
+#define CONFIG_PERSISTENTE_H
+
+#include <Preferences.h>
+#include <TramaLoRa.h>
+#include <stddef.h>
+#include <string.h>
+
+// Copia en NVS de una configuración tipada, escrita en diferido.
+//
+// La configuración vive en RAM y se lee sin pasar por NVS. En flash va
+// como un solo blob con versión, largo y CRC-16. cargar() lo lee una vez
+// al arrancar; si está corrupto, es de otra versión o de otro tamaño,
+// devuelve false y quedan los valores por defecto.
+//
+// marcar() sólo anota que algo cambió. guardar() escribe recién cuando
+// pasaron quietudMs sin otro marcar(): una ráfaga de comandos termina en
+// una sola escritura. Si el valor a guardar es igual al de flash (un cambio
+// que se deshizo, un comando que no cambia nada) no escribe. Si la escritura
+// falla el cambio sigue pendiente y se reintenta tras otra quietud. T tiene que
+// ser trivialmente copiable y llegar con el relleno en cero: se compara y
+// se verifica byte a byte.
+template <class T>
+class ConfigPersistente {
+public:
+  ConfigPersistente(const char* espacio, const char* clave, uint8_t version, uint32_t quietudMs)
+    : _espacio(espacio), _clave(clave), _version(version), _quietudMs(quietudMs),
+      _sucio(false), _cambioMs(0), _escrituras(0) {
+    memset(&_guardado, 0, sizeof(_guardado));
+  }
+
+  bool cargar(T& valores) {
+    Blob b;
+    Preferences prefs;
+    if (!prefs.begin(_espacio, true)) return false;
+    size_t n = prefs.getBytesLength(_clave) == sizeof(b) ? prefs.getBytes(_clave, &b, sizeof(b)) : 0;
+    prefs.end();
+    if (n != sizeof(b) || b.version != _version || b.largo != sizeof(T)) return false;
+    if (b.crc != crc16Ccitt((const uint8_t*)&b, offsetof(Blob, crc))) return false;
+    _guardado = b;
+    memcpy(&valores, &b.datos, sizeof(T));
+    return true;
+  }
+
+  void marcar(uint32_t ahora) {
+    _sucio = true;
+    _cambioMs = ahora;
+  }
+
+  // Hay cambios y ya pasó la quietud: toca guardar()
+  bool vencida(uint32_t ahora) const { return _sucio && ahora - _cambioMs >= _quietudMs; }
+  bool pendiente() const { return _sucio; }
+
+  // true si escribió en flash
+  bool guardar(const T& valores, uint32_t ahora) {
+    Blob b;
+    memset(&b, 0, sizeof(b));
+    b.version = _version;
+    b.largo = sizeof(T);
+    memcpy(&b.datos, &valores, sizeof(T));
+    b.crc = crc16Ccitt((const uint8_t*)&b, offsetof(Blob, crc));
+    if (memcmp(&b, &_guardado, sizeof(b)) == 0) {
+      _sucio = false;
+      return false;
+    }
+
+    Preferences prefs;
+    bool ok = prefs.begin(_espacio, false);
+    if (ok) {
+      ok = prefs.putBytes(_clave, &b, sizeof(b)) == sizeof(b);
+      prefs.end();
+    }
+    if (!ok) {
+      _cambioMs = ahora;
+      return false;
+    }
+    _sucio = false;
+    _guardado = b;
+    _escrituras++;
+    return true;
+  }
+
+  uint32_t escrituras() const { return _escrituras; }
+
+private:
+  struct Blob {
+    uint8_t  version;
+    uint8_t  reservado;
+    uint16_t largo;
+    T        datos;
+    uint16_t crc;       // CRC-16 de los bytes anteriores
+  };
+
+  const char* _espacio;
+  const char* _clave;
+  uint8_t  _version;
+  uint32_t _quietudMs;
+  bool     _sucio;
+  uint32_t _cambioMs;
+  uint32_t _escrituras;
+  Blob     _guardado;   // lo que hay en flash
+};
+
+#endif
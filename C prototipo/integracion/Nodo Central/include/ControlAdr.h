@@ -0,0 +1,67 @@
+#ifndef CONTROL_ADR_H
+#define CONTROL_ADR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "EnlaceNodo.h"
+
+// Velocidad de datos adaptativa (ADR) decidida en el gateway.
+//
+// El SX1276 del gateway demodula un solo SF, así que todos los nodos
+// transmiten con el de la red y el ADR ajusta la potencia de cada uno. El
+// margen es el SNR promedio del nodo menos el mínimo del SF y menos
+// margenDb de reserva para desvanecimientos. Cada 3 dB de margen se baja
+// la potencia 3 dB; con margen negativo se sube. Tiene que haber
+// TRAMAS_MIN tramas desde el último ajuste para que el promedio refleje la
+// potencia nueva.
+//
+// El ajuste viaja como comando RADIO:<sf>:<dBm> por la bajada confirmada.
+// El nodo vuelve solo a la potencia máxima si pasa RADIO_ACK_LIMIT envíos
+// (24) sin ninguna bajada. Por eso a un nodo por debajo del máximo se le
+// reafirma el ajuste cada REFRESCO tramas sin bajada. Si el comando no se
+// entrega, la espera de TRAMAS_MIN se duplica (hasta 16 veces): un nodo
+// con firmware sin RADIO: no se lleva la bajada.
+class ControlAdr {
+public:
+  static const int8_t  POTENCIA_MAX = 20;   // dBm, la del nodo al arrancar
+  static const int8_t  POTENCIA_MIN = 2;
+  static const int8_t  PASO_DB = 3;
+  static const uint8_t TRAMAS_MIN = 8;
+  static const uint8_t REFRESCO = 12;
+
+  ControlAdr(uint8_t sf, float margen = 10.0f);
+
+  void habilitar(bool si) { habilitado = si; }
+  bool activo() const { return habilitado; }
+  uint8_t sf() const { return sfRed; }
+  int8_t potencia(uint8_t nodo) const { return ajustes[nodo].potencia; }
+
+  // Tras cada trama nueva del nodo. Devuelve true y el comando en texto si
+  // hay que mandarle un ajuste; después, enviado() o cancelado().
+  bool evaluar(uint8_t nodo, const EnlaceNodo& enlace, char* comando, size_t cap);
+  void cancelado(uint8_t nodo) { ajustes[nodo].pendiente = false; }
+
+  // Resultado del comando RADIO: al entregarse corre los promedios del
+  // enlace a la potencia nueva
+  void enviado(uint8_t nodo, bool entregado, EnlaceNodo& enlace);
+
+  void alRecibirBajada(uint8_t nodo) { ajustes[nodo].sinBajada = 0; }
+  void alReiniciarNodo(uint8_t nodo);      // arranca al máximo
+
+private:
+  struct Ajuste {
+    int8_t  potencia;
+    int8_t  objetivo;       // la del comando en curso
+    uint8_t tramas;         // desde el último ajuste
+    uint8_t sinBajada;      // tramas desde la última bajada entregada
+    uint8_t fallos;         // comandos seguidos sin entregar
+    bool    pendiente;
+  };
+
+  Ajuste ajustes[256];      // por id de nodo
+  uint8_t sfRed;
+  float margenDb;
+  bool habilitado;
+};
+
+#endif
@@ -3,45 +3,89 @@
 
 #include <Arduino.h>
 
+// Forma de la rampa entre la velocidad actual y el objetivo. LINEAL
+// mantiene la pendiente configurada; SUAVE (smoothstep) arranca y llega
+// despacio y la pendiente configurada es la media.
+enum CurvaRampa { CURVA_LINEAL, CURVA_SUAVE };
+
 class ControlVentilador {
 private:
   int pinPWM;
   int velocidadActual;        // Velocidad actual (0-255)
   int velocidadObjetivo;      // Velocidad objetivo (0-255)
-  int incrementoVelocidad;    // Incremento por step
-  unsigned long tiempoAnterior;
-  unsigned long intervaloTransicion; // Tiempo entre cambios graduales
   bool transicionActiva;
   bool ventiladorEncendido;
-  
+  bool anulacion;             // alarma: máximo fijo hasta liberarAnulacion()
+
+  // Rampa en curso: la posición sale del tiempo transcurrido, no de
+  // cuántas veces se llamó a actualizar()
+  float pendiente;            // PWM por segundo
+  CurvaRampa curva;
+  int rampaDesde;             // PWM al empezar la rampa
+  unsigned long rampaInicio;
+  unsigned long rampaDuracion;
+
+  // Fade por hardware (LEDC del ESP32)
+  int canalLedc;              // -1: rampa por software con analogWrite()
+  unsigned long tramoMs;      // duración máxima de cada fade
+  unsigned long finTramo;     // fin del fade en curso en el LEDC
+  int destinoTramo;
+  bool pinSuelto;             // el pin quedó en GPIO por una escritura inmediata
+
   // Variables para control de arranque suave
   bool arranqueSuave;
   int velocidadMinima;        // Velocidad mínima para arranque
-  
+
+  int valorRampa(unsigned long transcurrido);
+  void iniciarRampa();
+  bool avanzarFade(unsigned long transcurrido);
+  void escribirInmediato(int valor);
+
 public:
   // Constructor
   ControlVentilador(int pin, int velocidadMin = 100);
-  
+
   // Métodos principales
   void inicializar();
   void establecerVelocidad(int porcentaje);
   void encender(int porcentaje = 50);
   void apagar();
   void actualizar();
-  
+
   // Configuración
+  // Pendiente en % por segundo (0.5 a 1000) y forma de la rampa
+  void configurarPendiente(float porcentajePorSegundo, CurvaRampa forma = CURVA_LINEAL);
+  // Equivale a una pendiente de incremento PWM cada intervalo ms
   void configurarTransicion(int incremento, unsigned long intervalo);
   void configurarArranqueSuave(bool habilitado, int velocidadMin = 100);
-  
+
+  // La rampa la genera la unidad de fade del LEDC en tramos de hasta
+  // tramoMs cuyo extremo sigue la curva; loop() sólo encadena los tramos y
+  // un loop() bloqueado no detiene el tramo en curso. Un objetivo nuevo
+  // espera el fin del tramo (IDF 4.4 no interrumpe un fade); la alarma y
+  // la parada no. Llamar antes de inicializar(). Devuelve false si la
+  // plataforma no tiene LEDC: la rampa sigue por software.
+  bool usarFadeHardware(uint8_t canal, unsigned long tramoMs = 250);
+  bool fadeHardware();
+
   // Getters para monitoreo
   int obtenerVelocidadActual();
   int obtenerVelocidadObjetivo();
   bool estaEncendido();
   bool estaEnTransicion();
-  
-  // Parada de emergencia
+  int obtenerPin();
+  int obtenerPWM();           // Valor PWM aplicado (0-255)
+  float obtenerPendiente();   // % por segundo
+
+  // Parada de emergencia (también libera la anulación)
   void paradaEmergencia();
-  
+
+  // Alarma de gas: PWM máximo al instante, sin rampa. Mientras dure la
+  // anulación establecerVelocidad() no cambia el objetivo.
+  void forzarMaximo();
+  void liberarAnulacion();
+  bool anulacionActiva();
+
   // Obtener estado completo del ventilador
   String obtenerEstadoCompleto();
 };
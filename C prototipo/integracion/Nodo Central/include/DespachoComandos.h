@@ -0,0 +1,97 @@
+#ifndef DESPACHO_COMANDOS_H
+#define DESPACHO_COMANDOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LOTE_COMANDOS_MAX 8
+#define LOTE_ID_MAX 24
+
+// Opciones de cada comando
+#define COMANDO_EN_LOTE 0x01      // admitido en un lote JSON
+
+enum ResultadoComando : uint8_t {
+  COMANDO_OK,
+  COMANDO_DESCONOCIDO,
+  COMANDO_INVALIDO,         // argumento fuera de rango o mal formado
+  COMANDO_ALARMA_ACTIVA,    // la alarma tiene el extractor al máximo y no se aplica
+  COMANDO_FUERA_DE_LOTE,    // no admitido en un lote
+  COMANDO_LOTE_INVALIDO     // JSON mal formado, vacío o con más de LOTE_COMANDOS_MAX
+};
+
+const char* textoResultado(ResultadoComando r);
+
+// Atiende un comando. arg es lo que sigue al primer ':' ("" si no hay).
+// Con aplicar == false sólo valida, sin tocar nada: un lote se valida
+// entero antes de aplicar el primero. Lo que no sea COMANDO_OK rechaza
+// el comando o el lote entero.
+typedef ResultadoComando (*AtenderComando)(const char* arg, bool aplicar);
+
+// FNV-1a de 32 bits del nombre, al compilar
+constexpr uint32_t hashNombre(const char* s, uint32_t h = 2166136261u) {
+  return *s ? hashNombre(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+
+constexpr uint8_t largoNombre(const char* s) {
+  return *s ? 1 + largoNombre(s + 1) : 0;
+}
+
+// El mismo hash sobre los bytes del payload
+uint32_t hashComando(const char* s, size_t largo);
+
+struct ComandoMqtt {
+  uint32_t hash;
+  const char* nombre;
+  uint8_t largo;
+  uint8_t opciones;
+  AtenderComando atender;
+
+  constexpr ComandoMqtt(const char* n, uint8_t o, AtenderComando a)
+    : hash(hashNombre(n)), nombre(n), largo(largoNombre(n)), opciones(o), atender(a) {}
+};
+
+// Sin dos nombres con el mismo hash la búsqueda compara un entero por
+// entrada y confirma el nombre una sola vez. Va en un static_assert junto
+// a la tabla: un comando nuevo que choque no compila.
+constexpr bool hashRepetido(const ComandoMqtt* t, size_t n, size_t i, size_t j) {
+  return j < n && (t[i].hash == t[j].hash || hashRepetido(t, n, i, j + 1));
+}
+
+constexpr bool hashesUnicos(const ComandoMqtt* t, size_t n, size_t i = 0) {
+  return i >= n || (!hashRepetido(t, n, i, i + 1) && hashesUnicos(t, n, i + 1));
+}
+
+// {"id":"...","comandos":["set_umbral:600","set_pi:3:0.1"]}. Los textos
+// apuntan dentro del buffer del JSON.
+struct LoteComandos {
+  char id[LOTE_ID_MAX + 1];
+  uint8_t cantidad;
+  const char* textos[LOTE_COMANDOS_MAX];
+};
+
+// Lee el lote sobre buf, terminado en '\0' en buf[largo]. Las cadenas se
+// desescapan y terminan en su lugar, así que buf queda modificado. Otras
+// claves con valores simples se ignoran.
+bool leerLote(char* buf, size_t largo, LoteComandos& lote);
+
+// Despacho de los comandos de gas/control sobre una tabla fija
+class DespachoComandos {
+public:
+  DespachoComandos(const ComandoMqtt* t, size_t n) : tabla(t), cantidad(n) {}
+
+  // "nombre[:arg]" terminado en '\0'
+  ResultadoComando ejecutar(const char* texto) const;
+
+  // Valida todos los comandos y recién entonces los aplica. Si alguno falla
+  // no aplica ninguno y deja su índice en fallido.
+  ResultadoComando ejecutarLote(const LoteComandos& lote, uint8_t& fallido) const;
+
+  // nullptr si no está; arg apunta al argumento dentro de texto
+  const ComandoMqtt* buscar(const char* texto, const char*& arg) const;
+
+private:
+  const ComandoMqtt* tabla;
+  size_t cantidad;
+};
+
+#endif
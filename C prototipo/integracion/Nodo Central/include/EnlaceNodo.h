@@ -0,0 +1,54 @@
+#ifndef ENLACE_NODO_H
+#define ENLACE_NODO_H
+
+#include <stdint.h>
+
+// Qué era la trama según su número de secuencia
+enum ResultadoSecuencia : uint8_t {
+  SEQ_NUEVA,        // la más nueva hasta ahora
+  SEQ_ATRASADA,     // faltaba y llegó después de una más nueva
+  SEQ_DUPLICADA,    // ya recibida (repetición de alarma, eco de la radio)
+  SEQ_REINICIO      // el nodo volvió a empezar la secuencia
+};
+
+// Calidad del enlace de un nodo (20 bytes).
+//
+// Una ventana deslizante de VENTANA secuencias detecta duplicados y tramas
+// atrasadas sin guardar las tramas: el bit i indica si llegó ultimaSeq - i.
+// Un salto hacia adelante cuenta las que faltan como perdidas; si una de
+// ellas aparece después, deja de contarse. El nodo arranca la secuencia en
+// 0, así que un 0 (que no sea la vuelta desde 65535) o un salto hacia atrás
+// más largo que la ventana se toma como reinicio.
+//
+// RSSI y SNR son promedios móviles exponenciales (1/8 por trama) en
+// dieciseisavos. Los contadores son del período en curso y vuelven a cero
+// con cerrarPeriodo().
+struct EnlaceNodo {
+  static const uint8_t VENTANA = 32;
+
+  uint32_t ventana;
+  uint16_t ultimaSeq;
+  uint16_t recibidas;       // sin duplicadas
+  uint16_t perdidas;
+  uint16_t duplicadas;
+  uint16_t atrasadas;
+  uint16_t reinicios;
+  int16_t  rssi16;          // dBm x 16
+  int16_t  snr16;           // dB x 16
+
+  ResultadoSecuencia registrar(uint16_t seq, int rssi, float snr);
+  void registrarSinSecuencia(int rssi, float snr);   // formato ASCII heredado
+
+  float rssi() const { return rssi16 / 16.0f; }
+  float snr() const { return snr16 / 16.0f; }
+  float porcentajePerdidas() const;
+  bool huboTrafico() const { return recibidas || perdidas || duplicadas; }
+  void desplazar(int8_t db);   // el nodo cambió de potencia: corre los promedios
+  void cerrarPeriodo();
+
+private:
+  void medir(int rssi, float snr);
+  void empezar(uint16_t seq);
+};
+
+#endif
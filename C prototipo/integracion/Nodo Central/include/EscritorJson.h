@@ -0,0 +1,47 @@
+#ifndef ESCRITOR_JSON_H
+#define ESCRITOR_JSON_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Escritor JSON en streaming sobre un buffer fijo provisto por el llamador.
+// No usa heap: si el buffer se llena marca desborde y deja de escribir,
+// y el documento queda descartado (ok() == false).
+class EscritorJson {
+public:
+  EscritorJson(char* buffer, size_t capacidad);
+
+  // Objetos; la clave se omite para el objeto raíz
+  void abrirObjeto(const char* clave = nullptr);
+  void cerrarObjeto();
+
+  // Campos clave/valor
+  void texto(const char* clave, const char* valor);
+  void entero(const char* clave, long valor);
+  void natural(const char* clave, unsigned long valor);
+  void decimal(const char* clave, float valor, uint8_t decimales);
+  void booleano(const char* clave, bool valor);
+
+  // Resultado
+  bool ok() const { return !desborde && nivel == 0; }
+  size_t largo() const { return pos; }
+  const char* c_str() const { return buf; }
+
+private:
+  static const uint8_t NIVEL_MAX = 8;
+
+  char* buf;
+  size_t cap;
+  size_t pos;
+  bool desborde;
+  uint8_t nivel;
+  uint8_t hayCampos;          // bit n: el objeto de nivel n ya tiene campos
+
+  void ponerChar(char c);
+  void ponerCadena(const char* s);
+  void ponerCadenaEscapada(const char* s);
+  void ponerNatural(unsigned long v);
+  void clave(const char* k);
+};
+
+#endif
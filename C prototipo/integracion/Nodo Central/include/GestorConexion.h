@@ -0,0 +1,52 @@
+#pragma once
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include <functional>
+
+// Conectividad WiFi + MQTT como máquina de estados no bloqueante.
+// actualizar() se llama en cada loop() y hace como mucho un paso: consultar
+// el estado del WiFi o intentar un connect() al broker. Los reintentos usan
+// backoff exponencial con jitter, así una caída del AP o del broker no
+// detiene la recepción LoRa ni las rampas del extractor.
+class GestorConexion {
+public:
+  using EventCallback = std::function<void()>;
+
+  enum Estado {
+    SIN_WIFI,           // esperando asociación con el AP
+    SIN_BROKER,         // WiFi arriba, esperando el próximo intento MQTT
+    CONECTADO
+  };
+
+  explicit GestorConexion(PubSubClient& mqtt);
+
+  void begin(const char* ssid, const char* pass, const char* clienteId);
+  void actualizar();
+
+  bool conectado() const { return _estado == CONECTADO; }
+  Estado estado() const { return _estado; }
+  uint32_t intentosFallidos() const { return _fallidos; }
+
+  void onConnect(EventCallback cb) { _onConnect = cb; }
+
+  // Backoff entre intentos: de BACKOFF_MIN_MS a BACKOFF_MAX_MS, duplicando
+  static const uint32_t BACKOFF_MIN_MS = 1000;
+  static const uint32_t BACKOFF_MAX_MS = 60000;
+  static const uint32_t WIFI_REINTENTO_MS = 30000;   // forzar reconnect() del AP
+
+private:
+  PubSubClient& _mqtt;
+  const char* _ssid;
+  const char* _pass;
+  const char* _clienteId;
+
+  Estado _estado;
+  uint32_t _backoffMs;
+  unsigned long _proximoIntento;
+  unsigned long _desdeSinWifi;
+  uint32_t _fallidos;
+  EventCallback _onConnect;
+
+  void intentarBroker();
+  void programarReintento(unsigned long ahora);
+};
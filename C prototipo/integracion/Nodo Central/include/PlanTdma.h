@@ -0,0 +1,94 @@
+#ifndef PLAN_TDMA_H
+#define PLAN_TDMA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <TramaLoRa.h>
+
+#ifndef PLAN_TDMA_SLOTS
+#define PLAN_TDMA_SLOTS 128
+#endif
+
+// Acceso al canal por turnos (TDMA) anunciado con una baliza.
+//
+// Con acceso aleatorio (ALOHA) una trama choca con cualquier otra que
+// empiece dentro de su tiempo en el aire, antes o después: con decenas de
+// nodos las pérdidas crecen con el tráfico. Cada superciclo el gateway
+// transmite una baliza y cada nodo registrado transmite sus datos sólo en
+// su slot, del largo de una trama de datos más las guardas. La baliza
+// anuncia cuántos slots hay en uso; el resto del superciclo es la ventana
+// de contención, donde salen las bajadas y transmiten los nodos sin slot.
+//
+// El slot se asigna con la primera trama binaria del nodo y viaja como
+// comando SLOT:<n>:<época> por la bajada confirmada. La época (byte bajo
+// del contador de arranques) invalida los slots de un plan anterior: el
+// nodo que oye una baliza de otra época vuelve a acceso aleatorio hasta
+// recibir un slot nuevo. El slot de un nodo callado más de VIGENCIA_MS se
+// reasigna sólo cuando no quedan libres. Si el comando no se entrega, la
+// espera hasta el próximo intento se duplica (hasta 16 veces ESPERA_TRAMAS).
+class PlanTdma {
+public:
+  static const uint8_t  SIN_SLOT = 0xFF;
+  static const uint8_t  SLOTS_MAX = PLAN_TDMA_SLOTS;
+  static const uint16_t INICIO_MS = 50;             // el nodo procesa la baliza
+  static const uint16_t PERIODO_MIN_MS = 10000;
+  static const uint16_t CONTENCION_MIN_MS = 2000;
+  static const uint32_t MARGEN_BALIZA_MS = 100;     // sin bajadas justo antes de la baliza
+  static const uint32_t VIGENCIA_MS = 660000;
+  static const uint8_t  ESPERA_TRAMAS = 8;
+
+  // El slot cubre una trama de datos al SF de la red. Hasta SF9 entra en
+  // los 255 ms del campo de la baliza; con SF mayor el plan no se activa.
+  PlanTdma(uint8_t sf);
+
+  void begin(uint8_t epoca, uint32_t ahora);
+  void habilitar(bool si) { habilitado = si && valido; }
+  bool activo() const { return habilitado; }
+
+  // Baliza que toca transmitir ahora (largo escrito), o 0. Una baliza que
+  // no se pudo transmitir se pierde: el nodo tolera algunas.
+  size_t baliza(uint32_t ahora, uint8_t* buf, size_t cap);
+
+  // Una bajada de duracionMs puede salir ahora sin pisar slots ni la
+  // próxima baliza. Con el plan desactivado siempre puede.
+  bool enContencion(uint32_t ahora, uint32_t duracionMs) const;
+
+  // Tras cada trama binaria nueva del nodo. Devuelve true y el comando en
+  // texto si hay que mandarle su slot; después, enviado() o cancelado().
+  // Los ids 0 y 255 nunca reciben slot.
+  bool evaluar(uint8_t nodo, uint32_t ahora, char* comando, size_t cap);
+  void cancelado(uint8_t nodo) { nodos[nodo].pendiente = false; }
+  void enviado(uint8_t nodo, bool entregado);
+
+  // El nodo arrancó de nuevo y perdió el slot: se le vuelve a mandar el mismo
+  void alReiniciarNodo(uint8_t nodo) { nodos[nodo].confirmado = false; }
+
+  uint8_t slot(uint8_t nodo) const { return nodos[nodo].slot; }
+  uint8_t enUso() const { return usados; }
+  const BalizaTdma& parametros() const { return plan; }
+
+private:
+  struct Asignacion {
+    uint8_t slot;
+    uint8_t tramas;         // desde el último intento fallido
+    uint8_t fallos;         // comandos seguidos sin entregar
+    bool    confirmado;
+    bool    pendiente;
+  };
+
+  Asignacion nodos[256];          // por id de nodo
+  uint8_t nodoDeSlot[SLOTS_MAX];  // 0: libre (los ids válidos van de 1 a 254)
+  uint32_t vistoMs[SLOTS_MAX];    // última trama del dueño del slot
+  BalizaTdma plan;
+  uint32_t proximaMs;             // próxima baliza
+  uint32_t finBalizaMs;           // fin estimado de la última baliza
+  uint16_t duracionBalizaMs;
+  uint8_t usados;                 // último slot ocupado + 1
+  bool valido;
+  bool habilitado;
+
+  uint8_t asignar(uint8_t nodo, uint32_t ahora);
+  void recalcularUsados();
+};
+
+#endif
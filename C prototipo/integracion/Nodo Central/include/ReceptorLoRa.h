@@ -0,0 +1,88 @@
+#pragma once
+#include <Arduino.h>
+#include <TramaLoRa.h>
+#include "ColaSpsc.h"
+
+#ifndef COLA_TRAMAS_CAPACIDAD
+#define COLA_TRAMAS_CAPACIDAD 128   // ~10 KB: 5 s con el canal saturado (SF7, 41 ms por trama)
+#endif
+
+#ifndef COLA_ALARMAS_CAPACIDAD
+#define COLA_ALARMAS_CAPACIDAD 8    // cruces de umbral, con sus repeticiones
+#endif
+
+#ifndef COLA_SALIDA_CAPACIDAD
+#define COLA_SALIDA_CAPACIDAD 4     // comandos de bajada esperando la radio
+#endif
+
+// Paquete tal como salió de la FIFO de la radio
+struct TramaCruda {
+  uint32_t recibidaMs;
+  int16_t  rssi;
+  int8_t   snrCuartos;
+  uint8_t  largo;
+  uint8_t  datos[TRAMA_LARGO_MAX];
+
+  float snr() const { return snrCuartos / 4.0f; }
+};
+
+// Recepción LoRa desacoplada de loop(). La radio queda en RX continuo; la
+// interrupción de DIO0 (RX_DONE) despierta una tarea FreeRTOS fijada a un
+// núcleo, que copia el paquete de la FIFO a una ColaSpsc y vuelve a RX
+// continuo. loop() consume la cola en el otro núcleo, así un publish o un
+// connect() lento ya no hace perder paquetes.
+//
+// Las tramas TRAMA_TIPO_ALARMA van a una cola aparte que frente() atiende
+// primero: una alarma no espera detrás de la telemetría acumulada.
+//
+// La radio sólo la toca la tarea: nadie más debe llamar a LoRa.* una vez
+// hecho begin(). Para transmitir, loop() deja el paquete en la cola de
+// salida con transmitir() y la tarea lo manda entre dos recepciones.
+class ReceptorLoRa {
+public:
+  typedef ColaSpsc<TramaCruda, COLA_TRAMAS_CAPACIDAD> Cola;
+  typedef ColaSpsc<TramaCruda, COLA_ALARMAS_CAPACIDAD> ColaAlarmas;
+  typedef ColaSpsc<TramaCruda, COLA_SALIDA_CAPACIDAD> ColaSalida;
+
+  // Llamar después de LoRa.begin()
+  bool begin(uint8_t pinDio0, uint8_t nucleo = 0, uint8_t prioridad = 5);
+
+  // Consumidor: siguiente trama, alarmas primero, o nullptr. liberar() al
+  // terminar con ella.
+  TramaCruda* frente() {
+    TramaCruda* t = _alarmas.frente();
+    _frenteAlarma = t != nullptr;
+    return t ? t : _cola.frente();
+  }
+  void liberar() {
+    if (_frenteAlarma) _alarmas.liberar();
+    else _cola.liberar();
+  }
+
+  // Productor de la cola de salida (loop()). false si está llena.
+  bool transmitir(const uint8_t* datos, uint8_t largo);
+
+  // Contadores (los escribe la tarea, se leen desde loop())
+  uint32_t recibidas() const { return _recibidas; }
+  uint32_t transmitidas() const { return _transmitidas; }
+  uint32_t descartadasCola() const { return _cola.descartados() + _alarmas.descartados(); }
+  uint32_t descartadasLargo() const { return _descartadasLargo; }
+  uint32_t maximoEnCola() const { return _cola.maximoOcupado(); }
+
+private:
+  Cola _cola;
+  ColaAlarmas _alarmas;
+  bool _frenteAlarma = false;              // de qué cola salió frente() (consumidor)
+  ColaSalida _salida;
+  volatile uint32_t _recibidas = 0;
+  volatile uint32_t _descartadasLargo = 0;
+  volatile uint32_t _transmitidas = 0;
+  void* _tarea = nullptr;                  // TaskHandle_t
+  uint8_t _pinDio0 = 0;
+
+  void atender();
+  void recibir();
+  void guardar(int largo);
+  static void tarea(void* arg);
+  static void isrDio0();
+};
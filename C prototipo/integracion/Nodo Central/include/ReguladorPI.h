@@ -0,0 +1,59 @@
+#ifndef REGULADOR_PI_H
+#define REGULADOR_PI_H
+
+#include <stdint.h>
+
+// Regulador PI (PID con kd > 0) de la velocidad del extractor en modo
+// automático.
+//
+// El error es la ppm sobre la consigna, en % de la consigna: las ganancias
+// no dependen del umbral configurado. kp es % de velocidad por % de error,
+// ki % por segundo por % de error y kd % por %/s. La derivada se toma de
+// la medición, no del error, y pasa por un filtro de TAU_DERIVADA_S: un
+// cambio de consigna no produce un salto.
+//
+// Histéresis: se enciende cuando la ppm supera la consigna y arranca en la
+// velocidad mínima. Se apaga cuando la ppm baja de la consigna menos
+// histeresis % y la salida pide el mínimo o menos. Entre medio la salida
+// queda entre el mínimo y el máximo.
+//
+// Anti-windup: el integrador no acumula mientras la salida está saturada
+// en el sentido del error. seguir() lo alinea con una salida fijada desde
+// afuera (la alarma) para retomar sin salto.
+class ReguladorPI {
+public:
+  static constexpr float DT_MAX_S = 5.0f;           // sin lecturas no integra de golpe
+  static constexpr float TAU_DERIVADA_S = 5.0f;
+
+  ReguladorPI();
+
+  void configurarGanancias(float kp, float ki, float kd = 0.0f);
+  // Velocidades en %, histéresis en % de la consigna
+  void configurarLimites(float minimo, float maximo, float histeresis);
+
+  // Velocidad (%) a aplicar; 0 con el regulador apagado
+  float actualizar(float ppm, float consigna, uint32_t ahora);
+  void seguir(float salida, float ppm, float consigna, uint32_t ahora);
+  void reiniciar();
+
+  bool encendido() const { return activo; }
+  float salida() const { return activo ? ultimaSalida : 0.0f; }
+  float obtenerKp() const { return kp; }
+  float obtenerKi() const { return ki; }
+  float obtenerKd() const { return kd; }
+  float obtenerMinimo() const { return minimo; }
+  float obtenerMaximo() const { return maximo; }
+  float obtenerHisteresis() const { return histeresis; }
+
+private:
+  float kp, ki, kd;
+  float minimo, maximo, histeresis;
+  float integral;
+  float derivada;         // término D filtrado
+  float medidaAnterior;   // % de la consigna
+  float ultimaSalida;
+  uint32_t ultimoMs;
+  bool activo;
+};
+
+#endif
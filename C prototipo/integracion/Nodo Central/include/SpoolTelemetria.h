@@ -0,0 +1,111 @@
+#pragma once
+#include <FS.h>
+#include <stdint.h>
+
+#ifndef SPOOL_REGISTROS_POR_SEGMENTO
+#define SPOOL_REGISTROS_POR_SEGMENTO 128    // 128 x 32 bytes = un sector de 4 KB
+#endif
+#ifndef SPOOL_SEGMENTOS_MAX
+#define SPOOL_SEGMENTOS_MAX 64              // 256 KB: 8192 registros
+#endif
+#ifndef SPOOL_LOTE
+#define SPOOL_LOTE 16                       // registros en RAM antes de escribir
+#endif
+
+// Bits de RegistroTelemetria::estado
+enum : uint8_t {
+  REGISTRO_ALARMA     = 0x01,
+  REGISTRO_AUTOMATICO = 0x02,
+  REGISTRO_ENCENDIDO  = 0x04,
+  REGISTRO_TRANSICION = 0x08,
+  REGISTRO_ANTICIPANDO = 0x10     // el PI regula con la ppm proyectada
+};
+
+// Lectura de un nodo junto con el estado del extractor en el momento en que
+// llegó. Tamaño fijo para direccionar por índice dentro del segmento.
+struct RegistroTelemetria {
+  uint32_t tomadoMs;        // millis() de adquisición
+  float    ppm;
+  float    ratio;
+  float    umbral;
+  uint16_t raw;
+  uint16_t seq;
+  uint16_t arranque;        // contador de arranques: da sentido a tomadoMs tras un reinicio
+  int16_t  rssi;
+  int8_t   snrCuartos;
+  uint8_t  nodo;
+  uint8_t  flags;           // TRAMA_FLAG_*
+  uint8_t  estado;          // REGISTRO_*
+  uint8_t  velocidad;
+  uint8_t  objetivo;
+  uint16_t crc;             // CRC-16 de los bytes anteriores
+
+  float snr() const { return snrCuartos / 4.0f; }
+};
+
+static_assert(sizeof(RegistroTelemetria) == 32, "RegistroTelemetria debe ocupar 32 bytes");
+
+// Cola persistente de telemetría para cuando no hay broker.
+//
+// Los registros se acumulan en un lote en RAM y se escriben de a SPOOL_LOTE
+// al final del segmento abierto (sólo append). Cada segmento es un archivo
+// "<directorio>/<n>" de hasta SPOOL_REGISTROS_POR_SEGMENTO registros; al
+// drenarse por completo se borra entero, así cada bloque de flash se escribe
+// una vez por vuelta y LittleFS reparte el desgaste. Con el spool lleno se
+// descarta el segmento más viejo.
+//
+// La posición de lectura vive en RAM: tras un reinicio se reenvían los
+// registros ya publicados del segmento a medio drenar (entrega al menos una
+// vez; nodo + seq identifican duplicados).
+class SpoolTelemetria {
+public:
+  explicit SpoolTelemetria(fs::FS& fs, const char* directorio = "/spool",
+                           uint32_t segmentosMax = SPOOL_SEGMENTOS_MAX);
+
+  // Recupera los segmentos que quedaron en flash
+  bool begin();
+
+  bool agregar(const RegistroTelemetria& r, uint32_t ahora);
+  void actualizar(uint32_t ahora);    // vuelca el lote si lleva más de LOTE_MAX_MS
+  bool volcar();
+
+  // Lectura en orden de llegada: leer() no consume, confirmar(n) descarta los
+  // primeros n devueltos. No intercalar agregar() entre ambas.
+  size_t leer(RegistroTelemetria* destino, size_t max);
+  void confirmar(size_t n);
+
+  uint32_t pendientes() const { return _pendientesFlash + _enLote; }
+  uint32_t descartados() const { return _descartados; }
+  uint32_t corruptos() const { return _corruptos; }
+  uint32_t capacidad() const { return _segmentosMax * SPOOL_REGISTROS_POR_SEGMENTO; }
+
+  static const uint32_t LOTE_MAX_MS = 10000;   // pérdida máxima ante un corte de energía
+
+  static uint16_t calcularCrc(const RegistroTelemetria& r);
+
+private:
+  fs::FS& _fs;
+  const char* _directorio;
+  uint32_t _segmentosMax;
+  bool _listo;
+
+  // Segmentos en flash: de _primero (el más viejo) a _ultimo (el abierto)
+  uint32_t _primero;
+  uint32_t _ultimo;
+  uint16_t _enPrimero;        // registros en _primero
+  uint16_t _leidosPrimero;    // ya confirmados de _primero
+  uint16_t _enUltimo;         // registros escritos en _ultimo
+  uint32_t _pendientesFlash;
+
+  RegistroTelemetria _lote[SPOOL_LOTE];
+  uint8_t _enLote;
+  uint32_t _loteDesde;
+
+  uint32_t _descartados;
+  uint32_t _corruptos;
+
+  void rutaSegmento(uint32_t n, char* ruta, size_t tam) const;
+  uint16_t registrosEn(uint32_t n);
+  void cerrarPrimero();
+  void descartarPrimero();
+};
@@ -0,0 +1,71 @@
+#ifndef TABLA_NODOS_H
+#define TABLA_NODOS_H
+
+#include <stdint.h>
+#include <TramaLoRa.h>
+#include "EnlaceNodo.h"
+#include "TendenciaNodo.h"
+
+#ifndef TABLA_NODOS_CAPACIDAD
+#define TABLA_NODOS_CAPACIDAD 128   // un nodo por slot TDMA (PLAN_TDMA_SLOTS)
+#endif
+
+// Estado del último paquete de cada nodo sensor, calidad de su enlace y
+// tendencia de la ppm (136 bytes por entrada)
+struct EstadoNodo {
+  uint32_t ultimoVisto;     // millis() de la última trama válida
+  float    ppm;
+  float    ratio;
+  uint16_t raw;
+  uint16_t seq;
+  int16_t  rssi;            // dBm
+  int8_t   snrCuartos;      // SNR en pasos de 0.25 dB
+  uint8_t  nodo;
+  uint8_t  flags;           // TRAMA_FLAG_* de la última trama
+  bool     alarma;          // ppm sobre el umbral del gateway o alerta del nodo
+  EnlaceNodo enlace;
+  TendenciaNodo tendencia;  // lecturas confiables recientes
+
+  float snr() const { return snrCuartos / 4.0f; }
+};
+
+// Tabla de capacidad fija indexada por id de nodo. Un índice directo de 256
+// bytes da búsqueda O(1); las entradas van contiguas para recorrerlas rápido.
+// Con la tabla llena, un nodo nuevo reemplaza al que lleva más tiempo sin
+// reportar.
+class TablaNodos {
+public:
+  static const uint8_t CAPACIDAD = TABLA_NODOS_CAPACIDAD;
+
+  TablaNodos();
+
+  EstadoNodo* buscar(uint8_t nodo);
+  EstadoNodo* obtener(uint8_t nodo, uint32_t ahora);   // crea la entrada si no existe
+
+  // Registra una lectura y devuelve la entrada actualizada
+  EstadoNodo* actualizar(const LecturaGas& lectura, int rssi, float snr, float umbral, uint32_t ahora);
+
+  // Mayor ppm entre los nodos vistos en los últimos vigenciaMs (ignora los
+  // que todavía no tienen Ro calibrado o están precalentando)
+  float ppmMaxima(uint32_t ahora, uint32_t vigenciaMs) const;
+
+  // Mayor ppm proyectada a horizonteS segundos (TendenciaNodo::proyectar)
+  // entre los mismos nodos
+  float ppmProyectadaMaxima(uint32_t ahora, uint32_t vigenciaMs, float horizonteS) const;
+
+  // true si algún nodo vigente está en alarma
+  bool hayAlarma(uint32_t ahora, uint32_t vigenciaMs) const;
+
+  uint8_t cantidad() const { return ocupadas; }
+  const EstadoNodo& enPosicion(uint8_t i) const { return entradas[i]; }
+  EstadoNodo& enPosicion(uint8_t i) { return entradas[i]; }
+
+private:
+  static const uint8_t LIBRE = 0xFF;
+
+  EstadoNodo entradas[CAPACIDAD];
+  uint8_t indice[256];      // id de nodo -> posición en entradas (LIBRE si no está)
+  uint8_t ocupadas;
+};
+
+#endif
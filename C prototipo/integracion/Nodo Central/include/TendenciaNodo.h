@@ -0,0 +1,59 @@
+#ifndef TENDENCIA_NODO_H
+#define TENDENCIA_NODO_H
+
+#include <stdint.h>
+
+#ifndef TENDENCIA_MUESTRAS
+#define TENDENCIA_MUESTRAS 8
+#endif
+
+// Tendencia de la ppm de un nodo (92 bytes con 8 muestras).
+//
+// Las últimas MUESTRAS lecturas confiables quedan en un buffer circular.
+// Las sumas de la regresión lineal de ppm contra tiempo se actualizan al
+// entrar y salir cada muestra: la pendiente cuesta O(1). También salen las
+// lecturas más viejas que VENTANA_MS: con el reporte por excepción, los
+// heartbeats de antes de una fuga aplanarían la pendiente. Los tiempos de
+// las sumas van en segundos desde baseMs, que se corre a la muestra más
+// vieja cada MUESTRAS altas o cuando sale una por vieja; en ese momento las
+// sumas se rehacen desde el buffer y el redondeo no se acumula.
+//
+// La EWMA usa una constante de tiempo porque las lecturas llegan a
+// intervalos irregulares: alfa = 1 - exp(-dt / TAU_S). En una rampa la EWMA
+// atrasa pendiente * TAU_S; proyectar() lo compensa.
+//
+// Con ceros es una tendencia vacía, como la deja memset() en TablaNodos.
+struct TendenciaNodo {
+  static const uint8_t  MUESTRAS = TENDENCIA_MUESTRAS;
+  static const uint8_t  MINIMO = 3;            // muestras para dar pendiente
+  static const uint32_t VENTANA_MS = 180000;
+  static constexpr float TAU_S = 10.0f;
+
+  uint32_t tiempos[MUESTRAS];     // millis() de cada lectura
+  float    ppms[MUESTRAS];
+  float    st, sy, stt, sty;      // sumas de la regresión, t en s desde baseMs
+  float    ewma;
+  uint32_t baseMs;
+  uint8_t  primera;               // posición de la más vieja
+  uint8_t  cantidad;
+  uint8_t  altas;                 // desde que se rehicieron las sumas
+
+  void agregar(float ppm, uint32_t ahora);
+  void reiniciar();
+
+  // ppm por segundo; 0 con menos de MINIMO muestras o todas juntas
+  float pendiente() const;
+  float media() const { return ewma; }
+  uint32_t ultimoMs() const;
+
+  // ppm esperada horizonteS segundos después de la última lectura. Sin
+  // pendiente, o con la última lectura más vieja que VENTANA_MS, la EWMA.
+  float proyectar(float horizonteS, uint32_t ahora) const;
+
+private:
+  void sumar(uint8_t pos, float signo);
+  void quitarPrimera();
+  void rehacerSumas();
+};
+
+#endif
@@ -0,0 +1,442 @@
+#include "BancoVentiladores.h"
+
+#define ESCALON_MS    3000UL          // entre arranques
+#define ROTACION_MS   86400000UL      // un día
+#define REVISION_MS   60000UL         // acumular marcha y evaluar la rotación
+
+static inline uint32_t bitDe(uint8_t i) { return 1UL << i; }
+
+BancoVentiladores::BancoVentiladores(const uint8_t* pines, uint8_t cantidad, int velocidadMin) {
+  n = cantidad < MAX ? cantidad : MAX;
+  if (n == 0) n = 1;    // sin pines no hay banco; se evita dividir por cero
+  for (uint8_t i = 0; i < n; i++) {
+    pin[i] = cantidad ? pines[i] : 0;
+    pwm[i] = 0;
+    objetivo[i] = 0;
+    desde[i] = 0;
+    minimo[i] = velocidadMin;
+    estado[i] = SUAVE;
+    rampaInicio[i] = 0;
+    rampaDuracion[i] = 0;
+    marchaS[i] = 0;
+    marchaDesde[i] = 0;
+  }
+  enRampa = 0;
+  enEspera = 0;
+  activos = 0;
+  primero = 0;
+  entrante = NINGUNO;
+  saliente = NINGUNO;
+  demanda = 0;
+  pwmPorExtractor = 0;
+  anulacion = false;
+  pendiente = 100.0f;
+  curva = CURVA_LINEAL;
+  escalonMs = ESCALON_MS;
+  rotacionMs = ROTACION_MS;
+  proximoArranque = 0;
+  proximaRevision = 0;
+  proximaRotacion = 0;
+}
+
+void BancoVentiladores::inicializar() {
+  uint32_t ahora = millis();
+  for (uint8_t i = 0; i < n; i++) {
+    pinMode(pin[i], OUTPUT);
+    analogWrite(pin[i], 0);
+  }
+  proximoArranque = ahora;
+  proximaRevision = ahora + REVISION_MS;
+  proximaRotacion = ahora + rotacionMs;
+  String pines;
+  for (uint8_t i = 0; i < n; i++) pines += (i ? "," : "") + String(pin[i]);
+  Serial.println("Banco de " + String(n) + " ventiladores inicializado en pines " + pines);
+}
+
+// Demanda del banco (0-100%)
+void BancoVentiladores::establecerVelocidad(int porcentaje) {
+  if (anulacion) return;
+  porcentaje = constrain(porcentaje, 0, 100);
+  // Cada lectura repite la demanda: repartirla de nuevo no cambia nada
+  if (porcentaje == demanda) return;
+
+  demanda = porcentaje;
+  repartir(millis());
+  Serial.println("Nueva demanda del banco: " + String(demanda) + "% (" + String(activos) +
+                 " extractores, PWM: " + String(pwmPorExtractor) + ")");
+}
+
+void BancoVentiladores::encender(int porcentaje) {
+  establecerVelocidad(porcentaje);
+}
+
+void BancoVentiladores::apagar() {
+  establecerVelocidad(0);
+}
+
+// Cuántos extractores andan y a qué velocidad, según la demanda
+void BancoVentiladores::repartir(uint32_t ahora) {
+  cancelarRelevo();
+
+  // Demanda en % de un extractor: entra uno si los que andan no la cubren,
+  // sale uno si los demás la cubren al 80%
+  uint32_t total = (uint32_t)demanda * n;
+  uint8_t k = activos;
+  if (total == 0) {
+    k = 0;
+  } else {
+    uint8_t kMin = (uint8_t)((total + 99) / 100);
+    if (k < kMin) k = kMin;
+    while (k > kMin && total <= 80UL * (k - 1)) k--;
+  }
+  pwmPorExtractor = k ? map((total + k - 1) / k, 0, 100, 0, 255) : 0;
+
+  while (activos < k) {
+    uint8_t i = elegirEntrante(ahora);
+    if (i == NINGUNO) break;
+    estado[i] |= ACTIVO;
+    // Uno que todavía gira no necesita turno de arranque
+    if (pwm[i] == 0) {
+      estado[i] |= ESPERA;
+      enEspera |= bitDe(i);
+    }
+    activos++;
+  }
+  while (activos > k) {
+    uint8_t i = elegirSaliente(ahora);
+    if (i == NINGUNO) break;
+    estado[i] &= ~(ACTIVO | ESPERA);
+    enEspera &= ~bitDe(i);
+    activos--;
+  }
+
+  for (uint8_t i = 0; i < n; i++) {
+    if (!(estado[i] & ACTIVO)) fijar(i, 0, ahora);
+    else if (!(estado[i] & ESPERA)) fijar(i, pwmPorExtractor, ahora);
+  }
+  arrancarPendientes(ahora);
+}
+
+// El que sale vuelve a ser uno más: el reparto decide de nuevo
+void BancoVentiladores::cancelarRelevo() {
+  if (entrante == NINGUNO) return;
+  estado[saliente] &= ~RELEVO;
+  entrante = NINGUNO;
+  saliente = NINGUNO;
+}
+
+// Entre los que no están asignados: uno que todavía gira, si no el de
+// menos marcha; a igual marcha, por orden desde primero
+uint8_t BancoVentiladores::elegirEntrante(uint32_t ahora) {
+  uint8_t mejor = NINGUNO;
+  bool mejorGira = false;
+  uint32_t mejorMarcha = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    if (estado[i] & (ACTIVO | RELEVO)) continue;
+    bool gira = pwm[i] > 0;
+    uint32_t m = marcha(i, ahora);
+    if (mejor == NINGUNO || (gira && !mejorGira) ||
+        (gira == mejorGira && (m < mejorMarcha || (m == mejorMarcha && orden(i) < orden(mejor))))) {
+      mejor = i;
+      mejorGira = gira;
+      mejorMarcha = m;
+    }
+  }
+  return mejor;
+}
+
+// Entre los asignados: uno que no arrancó todavía, si no el de más marcha;
+// a igual marcha, el último por orden
+uint8_t BancoVentiladores::elegirSaliente(uint32_t ahora) {
+  uint8_t peor = NINGUNO;
+  bool peorEspera = false;
+  uint32_t peorMarcha = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    if (!(estado[i] & ACTIVO)) continue;
+    bool espera = estado[i] & ESPERA;
+    uint32_t m = marcha(i, ahora);
+    if (peor == NINGUNO || (espera && !peorEspera) ||
+        (espera == peorEspera && (m > peorMarcha || (m == peorMarcha && orden(i) > orden(peor))))) {
+      peor = i;
+      peorEspera = espera;
+      peorMarcha = m;
+    }
+  }
+  return peor;
+}
+
+// Arranca el próximo en espera si pasó el escalón desde el anterior
+void BancoVentiladores::arrancarPendientes(uint32_t ahora) {
+  while (enEspera && (int32_t)(ahora - proximoArranque) >= 0) {
+    uint8_t i = NINGUNO;
+    for (uint32_t m = enEspera; m; m &= m - 1) {
+      uint8_t j = __builtin_ctz(m);
+      if (i == NINGUNO || orden(j) < orden(i)) i = j;
+    }
+    estado[i] &= ~ESPERA;
+    enEspera &= ~bitDe(i);
+    proximoArranque = ahora + escalonMs;
+    if (anulacion) {
+      objetivo[i] = 255;
+      escribir(i, 255, ahora);
+    } else {
+      fijar(i, pwmPorExtractor, ahora);
+    }
+    Serial.println("Arranque extractor " + String(i) + " (pin " + String(pin[i]) + ")");
+  }
+}
+
+// Función principal - debe llamarse en el loop(). Sólo recorre los
+// extractores con rampa en curso.
+void BancoVentiladores::actualizar() {
+  uint32_t ahora = millis();
+  bool enCurso = enRampa || enEspera;
+
+  arrancarPendientes(ahora);
+
+  for (uint32_t m = enRampa; m; m &= m - 1) {
+    uint8_t i = __builtin_ctz(m);
+    uint32_t transcurrido = ahora - rampaInicio[i];
+    int valor = valorRampa(i, transcurrido);
+    if (valor != pwm[i]) escribir(i, valor, ahora);
+    if (transcurrido >= rampaDuracion[i]) enRampa &= ~bitDe(i);
+  }
+
+  // Relevo: el que entra llegó a su velocidad, el otro ya puede salir
+  if (entrante != NINGUNO && !((enRampa | enEspera) & bitDe(entrante))) {
+    uint8_t s = saliente;
+    cancelarRelevo();
+    fijar(s, 0, ahora);
+    Serial.println("Relevo: extractor " + String(s) + " detenido");
+  }
+
+  if (enCurso && !enRampa && !enEspera) {
+    Serial.println("Transición del banco completada - " + String(enMarcha()) + " en marcha, PWM " +
+                   String(pwmPorExtractor));
+  }
+  if ((int32_t)(ahora - proximaRevision) >= 0) revisar(ahora);
+}
+
+// Cada REVISION_MS: acumula la marcha (millis() - marchaDesde no puede
+// pasar de 49 días) y, cuando toca, releva al más gastado
+void BancoVentiladores::revisar(uint32_t ahora) {
+  proximaRevision = ahora + REVISION_MS;
+  for (uint8_t i = 0; i < n; i++) {
+    if (!pwm[i]) continue;
+    uint32_t s = (ahora - marchaDesde[i]) / 1000;
+    marchaS[i] += s;
+    marchaDesde[i] += s * 1000;
+  }
+
+  if (!rotacionMs || (int32_t)(ahora - proximaRotacion) < 0) return;
+  proximaRotacion = ahora + rotacionMs;
+  if (anulacion || entrante != NINGUNO || enEspera || activos == 0 || activos == n) return;
+
+  uint8_t sale = elegirSaliente(ahora);
+  uint8_t entra = elegirEntrante(ahora);
+  if (sale == NINGUNO || entra == NINGUNO || marcha(entra, ahora) >= marcha(sale, ahora)) return;
+
+  // El que sale sigue a su velocidad hasta que el otro llegue
+  estado[sale] = (estado[sale] & ~ACTIVO) | RELEVO;
+  estado[entra] |= ACTIVO;
+  if (pwm[entra] == 0) {
+    estado[entra] |= ESPERA;
+    enEspera |= bitDe(entra);
+  } else {
+    fijar(entra, pwmPorExtractor, ahora);
+  }
+  entrante = entra;
+  saliente = sale;
+  Serial.println("Relevo: extractor " + String(entra) + " reemplaza al " + String(sale));
+  arrancarPendientes(ahora);
+}
+
+// Nuevo objetivo de un extractor, con su mínimo de arranque suave
+void BancoVentiladores::fijar(uint8_t i, int valor, uint32_t ahora) {
+  if (valor > 0 && (estado[i] & SUAVE) && valor < minimo[i]) valor = minimo[i];
+  bool enCurso = enRampa & bitDe(i);
+  if (valor == objetivo[i] && (enCurso || pwm[i] == valor)) return;
+  if (enCurso) desde[i] = valorRampa(i, ahora - rampaInicio[i]);
+  else desde[i] = pwm[i];
+  objetivo[i] = valor;
+  iniciarRampa(i, ahora);
+}
+
+// Rampa desde la posición en desde[i], sin saltos
+void BancoVentiladores::iniciarRampa(uint8_t i, uint32_t ahora) {
+  rampaInicio[i] = ahora;
+  rampaDuracion[i] = (uint32_t)ceilf((float)abs(objetivo[i] - desde[i]) * 1000.0f / pendiente);
+  if (rampaDuracion[i]) enRampa |= bitDe(i);
+  else enRampa &= ~bitDe(i);
+}
+
+void BancoVentiladores::escribir(uint8_t i, int valor, uint32_t ahora) {
+  if (!pwm[i] && valor) {
+    marchaDesde[i] = ahora;
+  } else if (pwm[i] && !valor) {
+    marchaS[i] += (ahora - marchaDesde[i]) / 1000;
+  }
+  pwm[i] = valor;
+  analogWrite(pin[i], valor);
+}
+
+int BancoVentiladores::valorRampa(uint8_t i, uint32_t transcurrido) {
+  if (transcurrido >= rampaDuracion[i]) return objetivo[i];
+  float f = (float)transcurrido / (float)rampaDuracion[i];
+  if (curva == CURVA_SUAVE) f = f * f * (3.0f - 2.0f * f);
+  return desde[i] + (int)lroundf((float)(objetivo[i] - desde[i]) * f);
+}
+
+uint32_t BancoVentiladores::marcha(uint8_t i, uint32_t ahora) {
+  return marchaS[i] + (pwm[i] ? (ahora - marchaDesde[i]) / 1000 : 0);
+}
+
+uint32_t BancoVentiladores::marchaDe(uint8_t i) {
+  return i < n ? marcha(i, millis()) : 0;
+}
+
+// Configuración
+void BancoVentiladores::configurarPendiente(float porcentajePorSegundo, CurvaRampa forma) {
+  pendiente = constrain(porcentajePorSegundo, 0.5f, 1000.0f) * 255.0f / 100.0f;
+  curva = forma;
+  // Las rampas en curso siguen con la nueva desde donde están
+  uint32_t ahora = millis();
+  for (uint32_t m = enRampa; m; m &= m - 1) {
+    uint8_t i = __builtin_ctz(m);
+    desde[i] = valorRampa(i, ahora - rampaInicio[i]);
+    iniciarRampa(i, ahora);
+  }
+}
+
+void BancoVentiladores::configurarArranqueSuave(bool habilitado, int velocidadMin) {
+  for (uint8_t i = 0; i < n; i++) configurarArranqueSuave(i, habilitado, velocidadMin);
+}
+
+void BancoVentiladores::configurarArranqueSuave(uint8_t indice, bool habilitado, int velocidadMin) {
+  if (indice >= n) return;
+  if (habilitado) estado[indice] |= SUAVE;
+  else estado[indice] &= ~SUAVE;
+  minimo[indice] = constrain(velocidadMin, 50, 200);
+}
+
+void BancoVentiladores::configurarEscalon(unsigned long ms) {
+  escalonMs = constrain(ms, 0UL, 60000UL);
+}
+
+void BancoVentiladores::configurarRotacion(unsigned long ms) {
+  rotacionMs = ms;
+  proximaRotacion = millis() + ms;
+}
+
+void BancoVentiladores::empezarPor(uint8_t indice) {
+  primero = indice % n;
+}
+
+// Getters para monitoreo
+int BancoVentiladores::obtenerVelocidadActual() {
+  uint32_t suma = 0;
+  for (uint8_t i = 0; i < n; i++) suma += pwm[i];
+  return map(suma, 0, 255UL * n, 0, 100);
+}
+
+int BancoVentiladores::obtenerVelocidadObjetivo() {
+  return demanda;
+}
+
+bool BancoVentiladores::estaEncendido() {
+  return demanda > 0;
+}
+
+bool BancoVentiladores::estaEnTransicion() {
+  return enRampa || enEspera || entrante != NINGUNO;
+}
+
+int BancoVentiladores::obtenerPin() {
+  uint8_t elegido = NINGUNO;
+  for (uint8_t i = 0; i < n; i++) {
+    if (pwm[i] && (elegido == NINGUNO || orden(i) < orden(elegido))) elegido = i;
+  }
+  return pin[elegido == NINGUNO ? primero : elegido];
+}
+
+int BancoVentiladores::obtenerPWM() {
+  uint8_t mayor = 0;
+  for (uint8_t i = 0; i < n; i++) if (pwm[i] > mayor) mayor = pwm[i];
+  return mayor;
+}
+
+float BancoVentiladores::obtenerPendiente() {
+  return pendiente * 100.0f / 255.0f;
+}
+
+uint8_t BancoVentiladores::enMarcha() {
+  uint8_t k = 0;
+  for (uint8_t i = 0; i < n; i++) if (pwm[i]) k++;
+  return k;
+}
+
+// Alarma: se escribe el PWM antes que nada, sin esperar a actualizar()
+void BancoVentiladores::forzarMaximo() {
+  uint32_t ahora = millis();
+  cancelarRelevo();
+  anulacion = true;
+  demanda = 100;
+  pwmPorExtractor = 255;
+  activos = n;
+  enRampa = 0;
+  bool algunoGira = false;
+  for (uint8_t i = 0; i < n; i++) {
+    estado[i] = (estado[i] & SUAVE) | ACTIVO;
+    objetivo[i] = 255;
+    if (pwm[i]) {
+      escribir(i, 255, ahora);
+      algunoGira = true;
+    } else {
+      estado[i] |= ESPERA;
+      enEspera |= bitDe(i);
+    }
+  }
+  // Sin ninguno andando el primero no espera el escalón
+  if (!algunoGira) proximoArranque = ahora;
+  arrancarPendientes(ahora);
+  Serial.println("ALARMA - Banco al maximo");
+}
+
+// El control vuelve a fijar la demanda; el cambio sigue la rampa normal
+void BancoVentiladores::liberarAnulacion() {
+  anulacion = false;
+}
+
+bool BancoVentiladores::anulacionActiva() {
+  return anulacion;
+}
+
+// Parada de emergencia (también libera la anulación)
+void BancoVentiladores::paradaEmergencia() {
+  uint32_t ahora = millis();
+  cancelarRelevo();
+  for (uint8_t i = 0; i < n; i++) {
+    estado[i] &= SUAVE;
+    objetivo[i] = 0;
+    if (pwm[i]) escribir(i, 0, ahora);
+  }
+  enRampa = 0;
+  enEspera = 0;
+  activos = 0;
+  demanda = 0;
+  pwmPorExtractor = 0;
+  anulacion = false;
+  Serial.println("PARADA DE EMERGENCIA - Banco detenido");
+}
+
+String BancoVentiladores::obtenerEstadoCompleto() {
+  String estadoBanco = "Extractores:" + String(n) +
+                       ",EnMarcha:" + String(enMarcha()) +
+                       ",Velocidad:" + String(obtenerVelocidadActual()) + "%" +
+                       ",Objetivo:" + String(demanda) + "%" +
+                       ",Encendido:" + (estaEncendido() ? "SI" : "NO") +
+                       ",Transicion:" + (estaEnTransicion() ? "SI" : "NO") +
+                       ",Anulacion:" + (anulacion ? "SI" : "NO") +
+                       ",PWM:" + String(obtenerPWM());
+  return estadoBanco;
+}
@@ -0,0 +1,99 @@
+#include "ColaComandos.h"
+#include <Arduino.h>
+#include <string.h>
+
+// Constructor
+ColaComandos::ColaComandos() {
+  cantidad = 0;
+  proximoSeq = 0;
+}
+
+void ColaComandos::begin(uint16_t seqInicial) {
+  cantidad = 0;
+  proximoSeq = seqInicial;
+}
+
+const ComandoLoRa* ColaComandos::encolar(uint8_t nodo, const char* texto, size_t largo, uint32_t ahora) {
+  if (cantidad >= CAPACIDAD || largo == 0 || largo > COMANDO_LARGO_MAX) return nullptr;
+  uint8_t delNodo = 0;
+  for (uint8_t i = 0; i < cantidad; i++) {
+    if (items[i].nodo == nodo) delNodo++;
+  }
+  if (delNodo >= POR_NODO) return nullptr;
+
+  ComandoLoRa& c = items[cantidad++];
+  c.encoladoMs = ahora;
+  c.enviadoMs = ahora;
+  c.proximoMs = ahora + ESPERA_UPLINK_MS;
+  c.seq = proximoSeq++;
+  c.nodo = nodo;
+  c.intentos = 0;
+  c.largo = (uint8_t)largo;
+  memcpy(c.texto, texto, largo);
+  c.texto[largo] = '\0';
+  return &c;
+}
+
+void ColaComandos::alRecibirUplink(uint8_t nodo, uint32_t ahora) {
+  for (uint8_t i = 0; i < cantidad; i++) {
+    ComandoLoRa& c = items[i];
+    if (c.nodo != nodo) continue;
+    // Sólo el primero del nodo; un intento recién hecho todavía puede tener
+    // la respuesta en camino
+    if (c.intentos >= MAX_INTENTOS) return;
+    if (c.intentos > 0 && ahora - c.enviadoMs < TIMEOUT_MS / 2) return;
+    if (!llego(ahora + VENTANA_MS, c.proximoMs)) c.proximoMs = ahora + VENTANA_MS;
+    return;
+  }
+}
+
+ComandoLoRa* ColaComandos::proximoEnvio(uint32_t ahora) {
+  for (uint8_t i = 0; i < cantidad; i++) {
+    ComandoLoRa& c = items[i];
+    if (c.intentos < MAX_INTENTOS && llego(ahora, c.proximoMs) && esPrimero(i)) return &c;
+  }
+  return nullptr;
+}
+
+void ColaComandos::marcarEnviado(ComandoLoRa* c, uint32_t ahora) {
+  c->intentos++;
+  c->enviadoMs = ahora;
+  uint32_t espera = TIMEOUT_MS << (c->intentos - 1);
+  c->proximoMs = ahora + espera + (uint32_t)random((long)(espera / 4) + 1);
+}
+
+bool ColaComandos::confirmar(uint8_t nodo, uint16_t seq, ComandoLoRa& c) {
+  for (uint8_t i = 0; i < cantidad; i++) {
+    if (items[i].nodo == nodo && items[i].seq == seq) {
+      c = items[i];
+      quitar(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ColaComandos::vencido(uint32_t ahora, ComandoLoRa& c) {
+  for (uint8_t i = 0; i < cantidad; i++) {
+    if (items[i].intentos >= MAX_INTENTOS && llego(ahora, items[i].proximoMs)) {
+      c = items[i];
+      quitar(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+// No hay un comando anterior para el mismo nodo
+bool ColaComandos::esPrimero(uint8_t i) const {
+  for (uint8_t j = 0; j < i; j++) {
+    if (items[j].nodo == items[i].nodo) return false;
+  }
+  return true;
+}
+
+// Conserva el orden de llegada: son pocas entradas
+void ColaComandos::quitar(uint8_t i) {
+  cantidad--;
+  for (; i < cantidad; i++) items[i] = items[i + 1];
+}
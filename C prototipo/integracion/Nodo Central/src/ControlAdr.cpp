@@ -0,0 +1,53 @@
+#include "ControlAdr.h"
+#include <TiempoEnAire.h>
+#include <math.h>
+#include <stdio.h>
+
+// Constructor
+ControlAdr::ControlAdr(uint8_t sf, float margen) : sfRed(sf), margenDb(margen), habilitado(true) {
+  for (uint16_t i = 0; i < 256; i++) alReiniciarNodo((uint8_t)i);
+}
+
+bool ControlAdr::evaluar(uint8_t nodo, const EnlaceNodo& enlace, char* comando, size_t cap) {
+  Ajuste& a = ajustes[nodo];
+  if (a.tramas < 255) a.tramas++;
+  if (a.sinBajada < 255) a.sinBajada++;
+  if (!habilitado || a.pendiente || a.tramas < (TRAMAS_MIN << a.fallos)) return false;
+
+  float margen = enlace.snr() - snrMinimoDb(sfRed) - margenDb;
+  int pasos = (int)floorf(margen / PASO_DB);
+  int nueva = a.potencia - pasos * PASO_DB;
+  if (nueva < POTENCIA_MIN) nueva = POTENCIA_MIN;
+  if (nueva > POTENCIA_MAX) nueva = POTENCIA_MAX;
+
+  bool refrescar = a.potencia < POTENCIA_MAX && a.sinBajada >= REFRESCO;
+  if (nueva == a.potencia && !refrescar) return false;
+
+  a.objetivo = (int8_t)nueva;
+  a.pendiente = true;
+  snprintf(comando, cap, "RADIO:%u:%d", sfRed, nueva);
+  return true;
+}
+
+void ControlAdr::enviado(uint8_t nodo, bool entregado, EnlaceNodo& enlace) {
+  Ajuste& a = ajustes[nodo];
+  if (!a.pendiente) return;
+  a.pendiente = false;
+  if (!entregado) {
+    a.tramas = 0;
+    if (a.fallos < 4) a.fallos++;
+    return;
+  }
+  a.fallos = 0;
+  enlace.desplazar((int8_t)(a.objetivo - a.potencia));
+  if (a.objetivo != a.potencia) a.tramas = 0;
+  a.potencia = a.objetivo;
+  a.sinBajada = 0;
+}
+
+void ControlAdr::alReiniciarNodo(uint8_t nodo) {
+  Ajuste& a = ajustes[nodo];
+  a.potencia = a.objetivo = POTENCIA_MAX;
+  a.tramas = a.sinBajada = a.fallos = 0;
+  a.pendiente = false;
+}
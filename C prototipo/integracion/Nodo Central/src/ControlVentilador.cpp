@@ -1,46 +1,67 @@
 #include "ControlVentilador.h"
 
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_NATIVO)
+#include <driver/ledc.h>
+#define HAY_LEDC 1
+#endif
+
+// La misma frecuencia y resolución que analogWrite() en el core 2.x
+#define FRECUENCIA_PWM 1000
+
 // Constructor
 ControlVentilador::ControlVentilador(int pin, int velocidadMin) {
   pinPWM = pin;
   velocidadActual = 0;
   velocidadObjetivo = 0;
   velocidadMinima = velocidadMin;
-  incrementoVelocidad = 5;
-  intervaloTransicion = 50; // 50ms entre cambios
-  tiempoAnterior = 0;
+  pendiente = 100.0f;       // 5 PWM cada 50 ms
+  curva = CURVA_LINEAL;
+  rampaDesde = 0;
+  rampaInicio = 0;
+  rampaDuracion = 0;
+  canalLedc = -1;
+  tramoMs = 250;
+  finTramo = 0;
+  destinoTramo = 0;
+  pinSuelto = false;
   transicionActiva = false;
   ventiladorEncendido = false;
+  anulacion = false;
   arranqueSuave = true;
 }
 
 // Inicializar el ventilador
 void ControlVentilador::inicializar() {
   pinMode(pinPWM, OUTPUT);
-  analogWrite(pinPWM, 0);
-  Serial.println("Ventilador inicializado en pin " + String(pinPWM));
+  if (canalLedc >= 0) ledcWrite(canalLedc, 0);
+  else analogWrite(pinPWM, 0);
+  Serial.println("Ventilador inicializado en pin " + String(pinPWM) + (canalLedc >= 0 ? " (fade LEDC)" : ""));
 }
 
 // Establecer velocidad objetivo (0-100%)
 void ControlVentilador::establecerVelocidad(int porcentaje) {
+  // Con alarma activa manda forzarMaximo()
+  if (anulacion) return;
+
   // Validar rango
   porcentaje = constrain(porcentaje, 0, 100);
   
   // Convertir porcentaje a valor PWM (0-255)
-  if (porcentaje == 0) {
-    velocidadObjetivo = 0;
-    ventiladorEncendido = false;
-  } else {
+  int valorPWM = 0;
+  if (porcentaje > 0) {
     // Aplicar velocidad mínima si está habilitada
-    int valorPWM = map(porcentaje, 0, 100, 0, 255);
+    valorPWM = map(porcentaje, 0, 100, 0, 255);
     if (arranqueSuave && valorPWM > 0 && valorPWM < velocidadMinima) {
       valorPWM = velocidadMinima;
     }
-    velocidadObjetivo = valorPWM;
-    ventiladorEncendido = true;
   }
-  
-  transicionActiva = true;
+  ventiladorEncendido = porcentaje > 0;
+
+  // Cada lectura repite el objetivo: reiniciar la rampa la frenaría
+  if (valorPWM == velocidadObjetivo && (transicionActiva || velocidadActual == valorPWM)) return;
+
+  velocidadObjetivo = valorPWM;
+  iniciarRampa();
   Serial.println("Nueva velocidad objetivo: " + String(porcentaje) + "% (PWM: " + String(velocidadObjetivo) + ")");
 }
 
@@ -56,39 +77,139 @@ void ControlVentilador::apagar() {
 
 // Función principal - debe llamarse en el loop()
 void ControlVentilador::actualizar() {
-  unsigned long tiempoActual = millis();
-  
-  // Solo actualizar si hay transición activa y ha pasado el tiempo suficiente
-  if (transicionActiva && (tiempoActual - tiempoAnterior >= intervaloTransicion)) {
-    
-    if (velocidadActual != velocidadObjetivo) {
-      // Calcular siguiente paso
-      if (velocidadActual < velocidadObjetivo) {
-        velocidadActual = min(velocidadActual + incrementoVelocidad, velocidadObjetivo);
-      } else {
-        velocidadActual = max(velocidadActual - incrementoVelocidad, velocidadObjetivo);
-      }
-      
-      // Aplicar nueva velocidad
+#ifdef HAY_LEDC
+  // Terminó el fade que había cuando se escribió directo al pin: el LEDC
+  // vuelve a manejarlo desde ese valor
+  if (pinSuelto && (long)(millis() - finTramo) >= 0) {
+    ledcWrite(canalLedc, velocidadActual);
+    destinoTramo = velocidadActual;
+    ledcAttachPin(pinPWM, canalLedc);
+    pinSuelto = false;
+  }
+#endif
+  if (!transicionActiva) return;
+
+  // La posición sale del tiempo transcurrido: tras un loop() bloqueado la
+  // rampa se pone al día de una vez en lugar de seguir desde donde quedó
+  unsigned long transcurrido = millis() - rampaInicio;
+  int valor = valorRampa(transcurrido);
+  bool terminada;
+  if (canalLedc >= 0) {
+    velocidadActual = valor;
+    terminada = avanzarFade(transcurrido);
+  } else {
+    if (valor != velocidadActual) {
+      velocidadActual = valor;
       analogWrite(pinPWM, velocidadActual);
-      
-      // Debug info
-      Serial.println("Velocidad actual: " + String(map(velocidadActual, 0, 255, 0, 100)) + "% (PWM: " + String(velocidadActual) + ")");
-      
-    } else {
-      // Transición completada
-      transicionActiva = false;
-      Serial.println("Transición completada - Velocidad final: " + String(map(velocidadActual, 0, 255, 0, 100)) + "%");
     }
-    
-    tiempoAnterior = tiempoActual;
+    terminada = transcurrido >= rampaDuracion;
+  }
+
+  if (terminada) {
+    transicionActiva = false;
+    Serial.println("Transición completada - Velocidad final: " + String(map(velocidadActual, 0, 255, 0, 100)) + "%");
+  }
+}
+
+// PWM de la rampa en curso a los ms indicados desde que empezó
+int ControlVentilador::valorRampa(unsigned long transcurrido) {
+  if (transcurrido >= rampaDuracion) return velocidadObjetivo;
+  float f = (float)transcurrido / (float)rampaDuracion;
+  if (curva == CURVA_SUAVE) f = f * f * (3.0f - 2.0f * f);
+  return rampaDesde + (int)lroundf((float)(velocidadObjetivo - rampaDesde) * f);
+}
+
+// Rampa nueva desde la posición actual, sin saltos
+void ControlVentilador::iniciarRampa() {
+  if (transicionActiva) velocidadActual = valorRampa(millis() - rampaInicio);
+  rampaDesde = velocidadActual;
+  rampaInicio = millis();
+  rampaDuracion = (unsigned long)ceilf((float)abs(velocidadObjetivo - rampaDesde) * 1000.0f / pendiente);
+  transicionActiva = true;
+}
+
+// Encadena el próximo tramo cuando el LEDC terminó el anterior. Devuelve
+// true cuando la salida llegó al objetivo.
+bool ControlVentilador::avanzarFade(unsigned long transcurrido) {
+#ifdef HAY_LEDC
+  if (pinSuelto || (long)(millis() - finTramo) < 0) return false;
+
+  unsigned long hasta = min(transcurrido + tramoMs, rampaDuracion);
+  int destino = valorRampa(hasta);
+  if (hasta <= transcurrido) {
+    // Fin de la rampa (o atrasada más que ella): directo al objetivo
+    if (destinoTramo != destino) ledcWrite(canalLedc, destino);
+    destinoTramo = destino;
+    return true;
+  }
+  if (destino != destinoTramo) {
+    ledc_mode_t modo = (ledc_mode_t)(canalLedc / 8);
+    ledc_channel_t canal = (ledc_channel_t)(canalLedc % 8);
+    ledc_set_fade_with_time(modo, canal, destino, (int)(hasta - transcurrido));
+    ledc_fade_start(modo, canal, LEDC_FADE_NO_WAIT);
+    destinoTramo = destino;
+    finTramo = millis() + (hasta - transcurrido);
   }
+  return false;
+#else
+  (void)transcurrido;
+  return true;
+#endif
+}
+
+// 0 o 255 sin rampa. El driver del LEDC (IDF 4.4) no interrumpe un fade:
+// en lugar de esperarlo, el pin pasa a GPIO hasta que termine.
+void ControlVentilador::escribirInmediato(int valor) {
+#ifdef HAY_LEDC
+  if (canalLedc >= 0) {
+    if (!pinSuelto && (long)(millis() - finTramo) >= 0) {
+      ledcWrite(canalLedc, valor);
+      destinoTramo = valor;
+      return;
+    }
+    ledcDetachPin(pinPWM);
+    pinMode(pinPWM, OUTPUT);
+    digitalWrite(pinPWM, valor > 0 ? HIGH : LOW);
+    pinSuelto = true;
+    return;
+  }
+#endif
+  analogWrite(pinPWM, valor);
+}
+
+// Configurar la pendiente de la rampa; una rampa en curso sigue con la nueva
+void ControlVentilador::configurarPendiente(float porcentajePorSegundo, CurvaRampa forma) {
+  pendiente = constrain(porcentajePorSegundo, 0.5f, 1000.0f) * 255.0f / 100.0f;
+  curva = forma;
+  if (transicionActiva) iniciarRampa();
 }
 
 // Configurar parámetros de transición
 void ControlVentilador::configurarTransicion(int incremento, unsigned long intervalo) {
-  incrementoVelocidad = constrain(incremento, 1, 50);
-  intervaloTransicion = constrain(intervalo, 10, 1000);
+  incremento = constrain(incremento, 1, 50);
+  intervalo = constrain(intervalo, 10UL, 1000UL);
+  configurarPendiente((float)incremento * 1000.0f / (float)intervalo * 100.0f / 255.0f, curva);
+}
+
+bool ControlVentilador::usarFadeHardware(uint8_t canal, unsigned long tramo) {
+#ifdef HAY_LEDC
+  if (canal >= 16 || ledcSetup(canal, FRECUENCIA_PWM, 8) == 0) return false;
+  tramoMs = constrain(tramo, 20UL, 2000UL);
+  // Otro módulo pudo haberlo instalado antes
+  esp_err_t e = ledc_fade_func_install(0);
+  if (e != ESP_OK && e != ESP_ERR_INVALID_STATE) return false;
+  ledcAttachPin(pinPWM, canal);
+  canalLedc = canal;
+  return true;
+#else
+  (void)canal;
+  (void)tramo;
+  return false;
+#endif
+}
+
+bool ControlVentilador::fadeHardware() {
+  return canalLedc >= 0;
 }
 
 // Habilitar/deshabilitar arranque suave
@@ -114,16 +235,49 @@ bool ControlVentilador::estaEnTransicion() {
   return transicionActiva;
 }
 
+int ControlVentilador::obtenerPin() {
+  return pinPWM;
+}
+
+int ControlVentilador::obtenerPWM() {
+  return velocidadActual;
+}
+
+float ControlVentilador::obtenerPendiente() {
+  return pendiente * 100.0f / 255.0f;
+}
+
 // Parada de emergencia
 void ControlVentilador::paradaEmergencia() {
+  escribirInmediato(0);
   velocidadActual = 0;
   velocidadObjetivo = 0;
   transicionActiva = false;
   ventiladorEncendido = false;
-  analogWrite(pinPWM, 0);
+  anulacion = false;
   Serial.println("PARADA DE EMERGENCIA - Ventilador detenido");
 }
 
+// Alarma: se escribe el PWM antes que nada, sin esperar a actualizar()
+void ControlVentilador::forzarMaximo() {
+  escribirInmediato(255);
+  velocidadActual = 255;
+  velocidadObjetivo = 255;
+  transicionActiva = false;
+  ventiladorEncendido = true;
+  anulacion = true;
+  Serial.println("ALARMA - Ventilador al maximo");
+}
+
+// El control vuelve a fijar el objetivo; el cambio sigue la rampa normal
+void ControlVentilador::liberarAnulacion() {
+  anulacion = false;
+}
+
+bool ControlVentilador::anulacionActiva() {
+  return anulacion;
+}
+
 // Obtener estado completo del ventilador (para reportes)
 String ControlVentilador::obtenerEstadoCompleto() {
   String estado = "Pin:" + String(pinPWM) + 
@@ -131,6 +285,7 @@ String ControlVentilador::obtenerEstadoCompleto() {
                   ",Objetivo:" + String(obtenerVelocidadObjetivo()) + "%" +
                   ",Encendido:" + (estaEncendido() ? "SI" : "NO") +
                   ",Transicion:" + (estaEnTransicion() ? "SI" : "NO") +
+                  ",Anulacion:" + (anulacion ? "SI" : "NO") +
                   ",PWM:" + String(velocidadActual);
   return estado;
 }
\ No newline at end of file
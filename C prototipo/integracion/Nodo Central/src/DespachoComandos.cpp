@@ -0,0 +1,182 @@
+#include "DespachoComandos.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+uint32_t hashComando(const char* s, size_t largo) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < largo; i++) h = (h ^ (uint8_t)s[i]) * 16777619u;
+  return h;
+}
+
+const char* textoResultado(ResultadoComando r) {
+  switch (r) {
+    case COMANDO_OK:            return "ok";
+    case COMANDO_DESCONOCIDO:   return "desconocido";
+    case COMANDO_INVALIDO:      return "invalido";
+    case COMANDO_ALARMA_ACTIVA: return "alarma_activa";
+    case COMANDO_FUERA_DE_LOTE: return "fuera_de_lote";
+    default:                    return "lote_invalido";
+  }
+}
+
+const ComandoMqtt* DespachoComandos::buscar(const char* texto, const char*& arg) const {
+  const char* sep = strchr(texto, ':');
+  size_t largo = sep ? (size_t)(sep - texto) : strlen(texto);
+  arg = sep ? sep + 1 : texto + largo;
+  uint32_t h = hashComando(texto, largo);
+  for (size_t i = 0; i < cantidad; i++) {
+    const ComandoMqtt& c = tabla[i];
+    if (c.hash == h) return c.largo == largo && memcmp(c.nombre, texto, largo) == 0 ? &c : nullptr;
+  }
+  return nullptr;
+}
+
+ResultadoComando DespachoComandos::ejecutar(const char* texto) const {
+  const char* arg;
+  const ComandoMqtt* c = buscar(texto, arg);
+  if (!c) return COMANDO_DESCONOCIDO;
+  return c->atender(arg, true);
+}
+
+ResultadoComando DespachoComandos::ejecutarLote(const LoteComandos& lote, uint8_t& fallido) const {
+  const ComandoMqtt* cmds[LOTE_COMANDOS_MAX];
+  const char* args[LOTE_COMANDOS_MAX];
+  for (uint8_t i = 0; i < lote.cantidad; i++) {
+    fallido = i;
+    cmds[i] = buscar(lote.textos[i], args[i]);
+    if (!cmds[i]) return COMANDO_DESCONOCIDO;
+    if (!(cmds[i]->opciones & COMANDO_EN_LOTE)) return COMANDO_FUERA_DE_LOTE;
+    ResultadoComando r = cmds[i]->atender(args[i], false);
+    if (r != COMANDO_OK) return r;
+  }
+  for (uint8_t i = 0; i < lote.cantidad; i++) cmds[i]->atender(args[i], true);
+  return COMANDO_OK;
+}
+
+// ==============================
+// Lector del lote JSON
+// ==============================
+namespace {
+
+void saltarEspacios(char*& p) {
+  while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+}
+
+// p en la comilla de apertura. Desescapa en el lugar y termina la cadena
+// con '\0' (donde estaba, como mucho, la comilla de cierre); p queda
+// después del cierre. \u sólo para ASCII.
+char* leerCadena(char*& p) {
+  if (*p != '"') return nullptr;
+  char* inicio = ++p;
+  char* w = p;
+  while (*p && *p != '"') {
+    char c = *p++;
+    if (c == '\\') {
+      c = *p++;
+      switch (c) {
+        case '"': case '\\': case '/': break;
+        case 'n': c = '\n'; break;
+        case 't': c = '\t'; break;
+        case 'r': c = '\r'; break;
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'u': {
+          char hex[5];
+          for (uint8_t i = 0; i < 4; i++) {
+            if (!isxdigit((uint8_t)p[i])) return nullptr;
+            hex[i] = p[i];
+          }
+          hex[4] = '\0';
+          long v = strtol(hex, nullptr, 16);
+          if (v == 0 || v > 0x7f) return nullptr;
+          p += 4;
+          c = (char)v;
+          break;
+        }
+        default: return nullptr;
+      }
+    } else if ((uint8_t)c < 0x20) {
+      return nullptr;
+    }
+    *w++ = c;
+  }
+  if (*p != '"') return nullptr;
+  p++;
+  *w = '\0';
+  return inicio;
+}
+
+// Número, true, false o null: hasta el próximo separador. Devuelve el
+// largo, 0 si no hay valor o es un objeto o arreglo.
+size_t saltarEscalar(char*& p) {
+  if (*p == '{' || *p == '[') return 0;
+  size_t n = strcspn(p, ",}] \t\r\n");
+  p += n;
+  return n;
+}
+
+}  // namespace
+
+bool leerLote(char* buf, size_t largo, LoteComandos& lote) {
+  memset(&lote, 0, sizeof(lote));
+  if (strlen(buf) != largo) return false;    // un '\0' en el payload
+  bool hayComandos = false;
+  char* p = buf;
+  saltarEspacios(p);
+  if (*p++ != '{') return false;
+  saltarEspacios(p);
+  if (*p == '}') return false;
+
+  for (;;) {
+    saltarEspacios(p);
+    char* clave = leerCadena(p);
+    if (!clave) return false;
+    saltarEspacios(p);
+    if (*p++ != ':') return false;
+    saltarEspacios(p);
+
+    if (strcmp(clave, "comandos") == 0) {
+      if (*p++ != '[') return false;
+      saltarEspacios(p);
+      while (*p != ']') {
+        if (lote.cantidad >= LOTE_COMANDOS_MAX) return false;
+        const char* texto = leerCadena(p);
+        if (!texto || !*texto) return false;
+        lote.textos[lote.cantidad++] = texto;
+        saltarEspacios(p);
+        if (*p == ',') {
+          p++;
+          saltarEspacios(p);
+        } else if (*p != ']') {
+          return false;
+        }
+      }
+      p++;
+      hayComandos = true;
+    } else if (*p == '"') {
+      // El id puede venir como texto o número; el resto se ignora
+      const char* valor = leerCadena(p);
+      if (!valor) return false;
+      if (strcmp(clave, "id") == 0) snprintf(lote.id, sizeof(lote.id), "%s", valor);
+    } else {
+      const char* valor = p;
+      size_t n = saltarEscalar(p);
+      if (!n) return false;
+      if (strcmp(clave, "id") == 0) snprintf(lote.id, sizeof(lote.id), "%.*s", (int)n, valor);
+    }
+
+    saltarEspacios(p);
+    if (*p == ',') {
+      p++;
+    } else if (*p == '}') {
+      p++;
+      break;
+    } else {
+      return false;
+    }
+  }
+  saltarEspacios(p);
+  return !*p && hayComandos && lote.cantidad > 0;
+}
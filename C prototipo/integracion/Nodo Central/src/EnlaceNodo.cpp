@@ -0,0 +1,67 @@
+#include "EnlaceNodo.h"
+
+ResultadoSecuencia EnlaceNodo::registrar(uint16_t seq, int rssi, float snr) {
+  medir(rssi, snr);
+  if (!ventana) {
+    empezar(seq);
+    return SEQ_NUEVA;
+  }
+
+  int16_t d = (int16_t)(seq - ultimaSeq);
+  if (d == 1 || (d > 0 && seq != 0)) {
+    perdidas += d - 1;
+    ventana = d < VENTANA ? (ventana << d) | 1 : 1;
+    ultimaSeq = seq;
+    recibidas++;
+    return SEQ_NUEVA;
+  }
+  if (seq == 0 || d <= -(int16_t)VENTANA) {
+    reinicios++;
+    empezar(seq);
+    return SEQ_REINICIO;
+  }
+
+  uint32_t bit = 1UL << (uint8_t)(-d);
+  if (ventana & bit) {
+    duplicadas++;
+    return SEQ_DUPLICADA;
+  }
+  ventana |= bit;
+  recibidas++;
+  atrasadas++;
+  if (perdidas) perdidas--;   // se contó al llegar la más nueva
+  return SEQ_ATRASADA;
+}
+
+void EnlaceNodo::registrarSinSecuencia(int rssi, float snr) {
+  medir(rssi, snr);
+  recibidas++;
+}
+
+float EnlaceNodo::porcentajePerdidas() const {
+  uint32_t esperadas = (uint32_t)recibidas + perdidas;
+  return esperadas ? 100.0f * perdidas / esperadas : 0.0f;
+}
+
+void EnlaceNodo::cerrarPeriodo() {
+  recibidas = perdidas = duplicadas = atrasadas = reinicios = 0;
+}
+
+void EnlaceNodo::desplazar(int8_t db) {
+  rssi16 = (int16_t)(rssi16 + db * 16);
+  snr16 = (int16_t)(snr16 + db * 16);
+}
+
+void EnlaceNodo::medir(int rssi, float snr) {
+  int16_t r = (int16_t)(rssi * 16);
+  int16_t s = (int16_t)(snr * 16.0f);
+  bool primera = rssi16 == 0;   // ninguna radio entrega exactamente 0 dBm
+  rssi16 = primera ? r : (int16_t)(rssi16 + (r - rssi16) / 8);
+  snr16 = primera ? s : (int16_t)(snr16 + (s - snr16) / 8);
+}
+
+void EnlaceNodo::empezar(uint16_t seq) {
+  ventana = 1;
+  ultimaSeq = seq;
+  recibidas++;
+}
@@ -0,0 +1,148 @@
+#include "EscritorJson.h"
+
+// Constructor
+EscritorJson::EscritorJson(char* buffer, size_t capacidad) {
+  buf = buffer;
+  cap = capacidad;
+  pos = 0;
+  desborde = (capacidad == 0);
+  nivel = 0;
+  hayCampos = 0;
+  if (!desborde) buf[0] = '\0';
+}
+
+// Escritura básica: siempre deja lugar para el '\0' final
+void EscritorJson::ponerChar(char c) {
+  if (desborde) return;
+  if (pos + 1 >= cap) {
+    desborde = true;
+    return;
+  }
+  buf[pos++] = c;
+  buf[pos] = '\0';
+}
+
+void EscritorJson::ponerCadena(const char* s) {
+  while (*s) ponerChar(*s++);
+}
+
+void EscritorJson::ponerCadenaEscapada(const char* s) {
+  static const char hex[] = "0123456789abcdef";
+  ponerChar('"');
+  for (; *s; s++) {
+    char c = *s;
+    if (c == '"' || c == '\\') {
+      ponerChar('\\');
+      ponerChar(c);
+    } else if ((uint8_t)c < 0x20) {
+      ponerCadena("\\u00");
+      ponerChar(hex[(c >> 4) & 0x0F]);
+      ponerChar(hex[c & 0x0F]);
+    } else {
+      ponerChar(c);
+    }
+  }
+  ponerChar('"');
+}
+
+void EscritorJson::ponerNatural(unsigned long v) {
+  char tmp[12];
+  uint8_t n = 0;
+  do {
+    tmp[n++] = (char)('0' + v % 10);
+    v /= 10;
+  } while (v);
+  while (n) ponerChar(tmp[--n]);
+}
+
+// Separador y clave de un campo dentro del objeto actual
+void EscritorJson::clave(const char* k) {
+  if (nivel > 0) {
+    uint8_t bit = 1 << (nivel - 1);
+    if (hayCampos & bit) ponerChar(',');
+    hayCampos |= bit;
+  }
+  if (k) {
+    ponerCadenaEscapada(k);
+    ponerChar(':');
+  }
+}
+
+// Objetos
+void EscritorJson::abrirObjeto(const char* k) {
+  if (nivel >= NIVEL_MAX) {
+    desborde = true;
+    return;
+  }
+  clave(k);
+  ponerChar('{');
+  nivel++;
+  hayCampos &= ~(1 << (nivel - 1));
+}
+
+void EscritorJson::cerrarObjeto() {
+  if (nivel == 0) {
+    desborde = true;
+    return;
+  }
+  ponerChar('}');
+  nivel--;
+}
+
+// Campos
+void EscritorJson::texto(const char* k, const char* valor) {
+  clave(k);
+  ponerCadenaEscapada(valor);
+}
+
+void EscritorJson::entero(const char* k, long valor) {
+  clave(k);
+  if (valor < 0) {
+    ponerChar('-');
+    ponerNatural(0UL - (unsigned long)valor);
+  } else {
+    ponerNatural((unsigned long)valor);
+  }
+}
+
+void EscritorJson::natural(const char* k, unsigned long valor) {
+  clave(k);
+  ponerNatural(valor);
+}
+
+// Decimal en punto fijo: evita printf("%f"), que en newlib reserva heap
+void EscritorJson::decimal(const char* k, float valor, uint8_t decimales) {
+  clave(k);
+  if (valor != valor || valor > 4.0e9f || valor < -4.0e9f) {
+    ponerCadena("null");            // NaN o fuera de rango no son JSON válido
+    return;
+  }
+  if (decimales > 4) decimales = 4;
+
+  unsigned long escala = 1;
+  for (uint8_t i = 0; i < decimales; i++) escala *= 10;
+
+  if (valor < 0) {
+    valor = -valor;
+    ponerChar('-');
+  }
+  // Redondeo en doble paso para no perder precisión de la parte entera
+  unsigned long parteEntera = (unsigned long)valor;
+  unsigned long parteFrac = (unsigned long)((valor - (float)parteEntera) * escala + 0.5f);
+  if (parteFrac >= escala) {
+    parteEntera++;
+    parteFrac -= escala;
+  }
+
+  ponerNatural(parteEntera);
+  if (decimales == 0) return;
+  ponerChar('.');
+  for (unsigned long d = escala / 10; d > 0; d /= 10) {
+    ponerChar((char)('0' + (parteFrac / d) % 10));
+  }
+}
+
+void EscritorJson::booleano(const char* k, bool valor) {
+  clave(k);
+  ponerCadena(valor ? "true" : "false");
+}
@@ -0,0 +1,87 @@
+#include "GestorConexion.h"
+
+GestorConexion::GestorConexion(PubSubClient& mqtt)
+  : _mqtt(mqtt), _ssid(nullptr), _pass(nullptr), _clienteId(nullptr),
+    _estado(SIN_WIFI), _backoffMs(BACKOFF_MIN_MS), _proximoIntento(0),
+    _desdeSinWifi(0), _fallidos(0) {}
+
+void GestorConexion::begin(const char* ssid, const char* pass, const char* clienteId) {
+  _ssid = ssid;
+  _pass = pass;
+  _clienteId = clienteId;
+
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(true);
+  WiFi.begin(ssid, pass);        // no bloquea: el driver asocia en segundo plano
+  _desdeSinWifi = millis();
+  Serial.printf("[WiFi] Conectando a %s ...\n", ssid);
+}
+
+void GestorConexion::actualizar() {
+  unsigned long ahora = millis();
+  bool wifiOk = WiFi.status() == WL_CONNECTED;
+
+  switch (_estado) {
+    case SIN_WIFI:
+      if (wifiOk) {
+        Serial.println("[WiFi] Conectado, IP: " + WiFi.localIP().toString());
+        _backoffMs = BACKOFF_MIN_MS;
+        _proximoIntento = ahora;
+        _estado = SIN_BROKER;
+      } else if (ahora - _desdeSinWifi >= WIFI_REINTENTO_MS) {
+        Serial.println("[WiFi] Sin asociación, reintentando");
+        WiFi.reconnect();
+        _desdeSinWifi = ahora;
+      }
+      break;
+
+    case SIN_BROKER:
+      if (!wifiOk) {
+        _desdeSinWifi = ahora;
+        _estado = SIN_WIFI;
+      } else if ((long)(ahora - _proximoIntento) >= 0) {
+        intentarBroker();
+      }
+      break;
+
+    case CONECTADO:
+      if (!_mqtt.connected()) {
+        Serial.printf("[MQTT] Conexión perdida (rc=%d)\n", _mqtt.state());
+        _backoffMs = BACKOFF_MIN_MS;
+        programarReintento(ahora);
+        if (wifiOk) {
+          _estado = SIN_BROKER;
+        } else {
+          _desdeSinWifi = ahora;
+          _estado = SIN_WIFI;
+        }
+      } else {
+        _mqtt.loop();
+      }
+      break;
+  }
+}
+
+// Un único intento; si falla se agenda el siguiente con backoff
+void GestorConexion::intentarBroker() {
+  Serial.println("[MQTT] Conectando al broker...");
+  if (_mqtt.connect(_clienteId)) {
+    Serial.println("[MQTT] Conectado");
+    _fallidos = 0;
+    _backoffMs = BACKOFF_MIN_MS;
+    _estado = CONECTADO;
+    if (_onConnect) _onConnect();
+    return;
+  }
+
+  _fallidos++;
+  Serial.printf("[MQTT] Fallo (rc=%d), reintento en %lu ms\n", _mqtt.state(), (unsigned long)_backoffMs);
+  programarReintento(millis());   // millis() otra vez: connect() pudo tardar
+}
+
+void GestorConexion::programarReintento(unsigned long ahora) {
+  // Jitter de +-25% para que varios gateways no reintenten a la vez
+  long jitter = random(-(long)_backoffMs / 4, (long)_backoffMs / 4 + 1);
+  _proximoIntento = ahora + _backoffMs + jitter;
+  _backoffMs = (_backoffMs * 2 > BACKOFF_MAX_MS) ? BACKOFF_MAX_MS : _backoffMs * 2;
+}
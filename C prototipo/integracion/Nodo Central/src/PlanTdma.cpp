@@ -0,0 +1,114 @@
+#include "PlanTdma.h"
+#include <TiempoEnAire.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Constructor
+PlanTdma::PlanTdma(uint8_t sf) : proximaMs(0), finBalizaMs(0), usados(0), habilitado(false) {
+  ParametrosRadio radio = radioPorDefecto(sf);
+  uint32_t slot = (uint32_t)ceilf(tiempoEnAireMs(radio, TRAMA_LARGO_DATOS)) + 2 * TRAMA_TDMA_GUARDA_MS;
+  duracionBalizaMs = (uint16_t)ceilf(tiempoEnAireMs(radio, TRAMA_LARGO_BALIZA));
+
+  // El superciclo redondeado al segundo, con lugar para todos los slots
+  uint32_t periodo = INICIO_MS + SLOTS_MAX * slot + CONTENCION_MIN_MS;
+  periodo = (periodo + 999) / 1000 * 1000;
+  if (periodo < PERIODO_MIN_MS) periodo = PERIODO_MIN_MS;
+  valido = slot <= 255 && periodo <= 65000;
+
+  memset(&plan, 0, sizeof(plan));
+  plan.periodoMs = (uint16_t)periodo;
+  plan.inicioMs = INICIO_MS;
+  plan.slotMs = (uint8_t)(valido ? slot : 255);
+
+  memset(nodoDeSlot, 0, sizeof(nodoDeSlot));
+  memset(vistoMs, 0, sizeof(vistoMs));
+  for (uint16_t i = 0; i < 256; i++) {
+    nodos[i].slot = SIN_SLOT;
+    nodos[i].tramas = nodos[i].fallos = 0;
+    nodos[i].confirmado = nodos[i].pendiente = false;
+  }
+}
+
+void PlanTdma::begin(uint8_t epoca, uint32_t ahora) {
+  plan.epoca = epoca;
+  proximaMs = ahora;
+  finBalizaMs = ahora - plan.periodoMs;
+}
+
+size_t PlanTdma::baliza(uint32_t ahora, uint8_t* buf, size_t cap) {
+  if (!habilitado || (int32_t)(ahora - proximaMs) < 0) return 0;
+
+  plan.numero++;
+  plan.slots = usados;
+  size_t n = tramaCodificarBaliza(plan, buf, cap);
+  finBalizaMs = ahora + duracionBalizaMs;
+  // Mantiene la cadencia; tras un loop() muy atrasado arranca de nuevo
+  proximaMs += plan.periodoMs;
+  if ((int32_t)(ahora - proximaMs) >= 0) proximaMs = ahora + plan.periodoMs;
+  return n;
+}
+
+bool PlanTdma::enContencion(uint32_t ahora, uint32_t duracionMs) const {
+  if (!habilitado) return true;
+  uint32_t desde = ahora - finBalizaMs;
+  if (desde < (uint32_t)plan.inicioMs + (uint32_t)plan.slots * plan.slotMs) return false;
+  return (int32_t)(proximaMs - ahora) > (int32_t)(duracionMs + MARGEN_BALIZA_MS);
+}
+
+bool PlanTdma::evaluar(uint8_t nodo, uint32_t ahora, char* comando, size_t cap) {
+  // 0 marca el slot libre en nodoDeSlot[]: esos ids siguen en acceso aleatorio
+  if (nodo == 0 || nodo == 0xFF) return false;
+  Asignacion& a = nodos[nodo];
+  if (a.slot != SIN_SLOT) vistoMs[a.slot] = ahora;
+  if (a.tramas < 255) a.tramas++;
+  if (!habilitado || a.confirmado || a.pendiente) return false;
+  if (a.fallos && a.tramas < (ESPERA_TRAMAS << a.fallos)) return false;
+
+  if (a.slot == SIN_SLOT && asignar(nodo, ahora) == SIN_SLOT) return false;
+  a.pendiente = true;
+  snprintf(comando, cap, "SLOT:%u:%u", a.slot, plan.epoca);
+  return true;
+}
+
+void PlanTdma::enviado(uint8_t nodo, bool entregado) {
+  Asignacion& a = nodos[nodo];
+  if (!a.pendiente) return;
+  a.pendiente = false;
+  a.tramas = 0;
+  if (!entregado) {
+    if (a.fallos < 4) a.fallos++;
+    return;
+  }
+  a.fallos = 0;
+  a.confirmado = a.slot != SIN_SLOT;
+}
+
+// Primer slot libre; si no hay, el del nodo callado hace más tiempo
+uint8_t PlanTdma::asignar(uint8_t nodo, uint32_t ahora) {
+  uint8_t elegido = SIN_SLOT;
+  uint32_t mayorSilencio = VIGENCIA_MS;
+  for (uint8_t s = 0; s < SLOTS_MAX; s++) {
+    if (!nodoDeSlot[s]) { elegido = s; break; }
+    uint32_t silencio = ahora - vistoMs[s];
+    if (silencio > mayorSilencio) { mayorSilencio = silencio; elegido = s; }
+  }
+  if (elegido == SIN_SLOT) return SIN_SLOT;
+
+  uint8_t anterior = nodoDeSlot[elegido];
+  if (anterior) {
+    // Si vuelve, pide slot otra vez con su próxima trama
+    nodos[anterior].slot = SIN_SLOT;
+    nodos[anterior].confirmado = false;
+  }
+  nodoDeSlot[elegido] = nodo;
+  vistoMs[elegido] = ahora;
+  nodos[nodo].slot = elegido;
+  recalcularUsados();
+  return elegido;
+}
+
+void PlanTdma::recalcularUsados() {
+  usados = SLOTS_MAX;
+  while (usados > 0 && !nodoDeSlot[usados - 1]) usados--;
+}
@@ -0,0 +1,116 @@
+#include "ReceptorLoRa.h"
+#include <LoRa.h>
+
+#ifndef ARDUINO_NATIVO
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+static ReceptorLoRa* instancia = nullptr;
+
+bool ReceptorLoRa::begin(uint8_t pinDio0, uint8_t nucleo, uint8_t prioridad) {
+  instancia = this;
+  _pinDio0 = pinDio0;
+#ifdef ARDUINO_NATIVO
+  // En el host no hay FreeRTOS: atender() corre en la interrupción simulada,
+  // que llega aunque loop() esté bloqueado, igual que la tarea real
+  (void)nucleo; (void)prioridad;
+#else
+  TaskHandle_t handle = nullptr;
+  if (xTaskCreatePinnedToCore(tarea, "loraRx", 4096, this, prioridad, &handle, nucleo) != pdPASS) {
+    return false;
+  }
+  _tarea = handle;
+#endif
+  pinMode(pinDio0, INPUT);
+  attachInterrupt(digitalPinToInterrupt(pinDio0), isrDio0, RISING);
+  LoRa.receive();   // RX continuo: la radio queda escuchando hasta el próximo TX
+  return true;
+}
+
+bool ReceptorLoRa::transmitir(const uint8_t* datos, uint8_t largo) {
+  if (largo > TRAMA_LARGO_MAX) return false;
+  TramaCruda* t = _salida.reservar();
+  if (!t) return false;
+  t->recibidaMs = millis();
+  t->largo = largo;
+  memcpy(t->datos, datos, largo);
+  _salida.publicar();
+#ifdef ARDUINO_NATIVO
+  atender();
+#else
+  xTaskNotifyGive((TaskHandle_t)_tarea);
+#endif
+  return true;
+}
+
+// Primero se vacía la FIFO: el TX la reutiliza. endPacket() bloquea la
+// tarea el tiempo en el aire; después la radio vuelve a RX continuo.
+void ReceptorLoRa::atender() {
+  recibir();
+  TramaCruda* s;
+  while ((s = _salida.frente()) != nullptr) {
+    LoRa.beginPacket();
+    LoRa.write(s->datos, s->largo);
+    LoRa.endPacket();
+    _salida.liberar();
+    _transmitidas++;
+    LoRa.receive();
+  }
+}
+
+// Copia a la cola el paquete de un RX_DONE pendiente. Sólo con DIO0 en alto:
+// sin paquete, parsePacket() pasaría la radio a RX simple, que vence a los
+// ~100 símbolos y queda en standby sin avisar por DIO0. Con paquete la deja
+// en standby (y en RX simple si falló el CRC): receive() vuelve a RX continuo.
+void ReceptorLoRa::recibir() {
+  if (digitalRead(_pinDio0) != HIGH) return;
+  int largo = LoRa.parsePacket();
+  if (largo > 0) guardar(largo);
+  LoRa.receive();
+}
+
+void ReceptorLoRa::guardar(int largo) {
+  _recibidas++;
+  if (largo > TRAMA_LARGO_MAX) {
+    while (LoRa.available()) LoRa.read();
+    _descartadasLargo++;
+    return;
+  }
+  bool alarma = largo == TRAMA_LARGO_DATOS && LoRa.peek() == tramaCabecera(TRAMA_TIPO_ALARMA);
+  TramaCruda* t = alarma ? _alarmas.reservar() : _cola.reservar();
+  if (!t) {
+    while (LoRa.available()) LoRa.read();   // cola llena: ya contado
+    return;
+  }
+  t->recibidaMs = millis();
+  t->largo = (uint8_t)LoRa.readBytes(t->datos, largo);
+  t->rssi = (int16_t)LoRa.packetRssi();
+  float snr = LoRa.packetSnr();
+  t->snrCuartos = (int8_t)constrain((int)(snr * 4.0f + (snr < 0 ? -0.5f : 0.5f)), -128, 127);
+  if (alarma) _alarmas.publicar();
+  else _cola.publicar();
+}
+
+#ifndef ARDUINO_NATIVO
+void ReceptorLoRa::tarea(void* arg) {
+  ReceptorLoRa* self = (ReceptorLoRa*)arg;
+  for (;;) {
+    // Con una notificación perdida, el timeout encuentra DIO0 en alto
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+    self->atender();
+  }
+}
+
+void IRAM_ATTR ReceptorLoRa::isrDio0() {
+  BaseType_t despertar = pdFALSE;
+  vTaskNotifyGiveFromISR((TaskHandle_t)instancia->_tarea, &despertar);
+  if (despertar) portYIELD_FROM_ISR();
+}
+#else
+void ReceptorLoRa::tarea(void*) {}
+
+void ReceptorLoRa::isrDio0() {
+  if (instancia) instancia->atender();
+}
+#endif
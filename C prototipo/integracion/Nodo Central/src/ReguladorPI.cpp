@@ -0,0 +1,91 @@
+#include "ReguladorPI.h"
+#include <math.h>
+
+static float limitar(float v, float lo, float hi) {
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+ReguladorPI::ReguladorPI() {
+  kp = 2.0f;
+  ki = 0.05f;
+  kd = 0.0f;
+  minimo = 30.0f;
+  maximo = 90.0f;
+  histeresis = 5.0f;
+  reiniciar();
+}
+
+void ReguladorPI::configurarGanancias(float p, float i, float d) {
+  kp = p < 0 ? 0 : p;
+  ki = i < 0 ? 0 : i;
+  kd = d < 0 ? 0 : d;
+}
+
+void ReguladorPI::configurarLimites(float minimoPct, float maximoPct, float histeresisPct) {
+  maximo = limitar(maximoPct, 1.0f, 100.0f);
+  minimo = limitar(minimoPct, 0.0f, maximo);
+  histeresis = limitar(histeresisPct, 0.0f, 50.0f);
+  integral = limitar(integral, 0.0f, maximo);
+}
+
+void ReguladorPI::reiniciar() {
+  integral = 0;
+  derivada = 0;
+  medidaAnterior = 0;
+  ultimaSalida = 0;
+  ultimoMs = 0;
+  activo = false;
+}
+
+float ReguladorPI::actualizar(float ppm, float consigna, uint32_t ahora) {
+  if (consigna <= 0) return 0;
+  float medida = ppm * 100.0f / consigna;
+  float error = medida - 100.0f;
+
+  if (!activo) {
+    if (error <= 0) return 0;
+    // Arranca en el mínimo: el proporcional suma desde ahí
+    activo = true;
+    integral = minimo;
+    derivada = 0;
+    medidaAnterior = medida;
+    ultimoMs = ahora;
+    ultimaSalida = limitar(kp * error + integral, minimo, maximo);
+    return ultimaSalida;
+  }
+
+  float dt = (float)(ahora - ultimoMs) / 1000.0f;
+  if (dt > DT_MAX_S) dt = DT_MAX_S;
+  ultimoMs = ahora;
+
+  if (kd > 0 && dt > 0) {
+    float alfa = dt / (TAU_DERIVADA_S + dt);
+    derivada += alfa * (-kd * (medida - medidaAnterior) / dt - derivada);
+  }
+  medidaAnterior = medida;
+
+  float u = kp * error + integral + derivada;
+  float paso = ki * error * dt;
+  // Anti-windup: saturado, sólo integra lo que lo saca del límite
+  if (!((u >= maximo && paso > 0) || (u <= minimo && paso < 0))) {
+    integral = limitar(integral + paso, 0.0f, maximo);
+    u = kp * error + integral + derivada;
+  }
+
+  if (u <= minimo && ppm < consigna * (1.0f - histeresis / 100.0f)) {
+    reiniciar();
+    return 0;
+  }
+  ultimaSalida = limitar(u, minimo, maximo);
+  return ultimaSalida;
+}
+
+void ReguladorPI::seguir(float salida, float ppm, float consigna, uint32_t ahora) {
+  float medida = consigna > 0 ? ppm * 100.0f / consigna : 0;
+  ultimaSalida = limitar(salida, minimo, maximo);
+  integral = limitar(ultimaSalida - kp * (medida - 100.0f), 0.0f, maximo);
+  derivada = 0;
+  medidaAnterior = medida;
+  ultimoMs = ahora;
+  activo = true;
+}
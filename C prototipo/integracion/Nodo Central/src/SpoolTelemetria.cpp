@@ -0,0 +1,228 @@
+#include "SpoolTelemetria.h"
+#include <TramaLoRa.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const size_t TAM_REGISTRO = sizeof(RegistroTelemetria);
+
+// Constructor
+SpoolTelemetria::SpoolTelemetria(fs::FS& fs, const char* directorio, uint32_t segmentosMax)
+  : _fs(fs), _directorio(directorio), _segmentosMax(segmentosMax < 2 ? 2 : segmentosMax),
+    _listo(false), _primero(0), _ultimo(0), _enPrimero(0), _leidosPrimero(0),
+    _enUltimo(0), _pendientesFlash(0), _enLote(0), _loteDesde(0),
+    _descartados(0), _corruptos(0) {}
+
+uint16_t SpoolTelemetria::calcularCrc(const RegistroTelemetria& r) {
+  return crc16Ccitt((const uint8_t*)&r, offsetof(RegistroTelemetria, crc));
+}
+
+void SpoolTelemetria::rutaSegmento(uint32_t n, char* ruta, size_t tam) const {
+  snprintf(ruta, tam, "%s/%lu", _directorio, (unsigned long)n);
+}
+
+uint16_t SpoolTelemetria::registrosEn(uint32_t n) {
+  char ruta[32];
+  rutaSegmento(n, ruta, sizeof(ruta));
+  File f = _fs.open(ruta, FILE_READ);
+  if (!f) return 0;
+  size_t registros = f.size() / TAM_REGISTRO;
+  f.close();
+  return (uint16_t)(registros > SPOOL_REGISTROS_POR_SEGMENTO ? SPOOL_REGISTROS_POR_SEGMENTO : registros);
+}
+
+// ==============================
+// Recuperación al arrancar
+// ==============================
+bool SpoolTelemetria::begin() {
+  _fs.mkdir(_directorio);
+  File dir = _fs.open(_directorio);
+  if (!dir || !dir.isDirectory()) return false;
+
+  bool hay = false;
+  uint32_t menor = 0, mayor = 0;
+  for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+    // name() es el nombre base en LittleFS; por las dudas se corta en la última '/'
+    const char* nombre = f.name();
+    const char* barra = strrchr(nombre, '/');
+    if (barra) nombre = barra + 1;
+    char* fin;
+    unsigned long n = strtoul(nombre, &fin, 10);
+    if (fin == nombre || *fin) continue;
+
+    _pendientesFlash += f.size() / TAM_REGISTRO;
+    if (!hay || n < menor) menor = n;
+    if (!hay || n > mayor) mayor = n;
+    hay = true;
+  }
+  dir.close();
+
+  if (hay) {
+    _primero = menor;
+    _ultimo = mayor;
+    _enUltimo = registrosEn(_ultimo);
+    _enPrimero = registrosEn(_primero);
+    // Un segmento lleno o con un registro a medio escribir no se reabre
+    char ruta[32];
+    rutaSegmento(_ultimo, ruta, sizeof(ruta));
+    File f = _fs.open(ruta, FILE_READ);
+    bool cortado = f && (f.size() % TAM_REGISTRO) != 0;
+    f.close();
+    if (cortado || _enUltimo >= SPOOL_REGISTROS_POR_SEGMENTO) {
+      _ultimo++;
+      _enUltimo = 0;
+    }
+  }
+
+  _listo = true;
+  return true;
+}
+
+// ==============================
+// Escritura
+// ==============================
+bool SpoolTelemetria::agregar(const RegistroTelemetria& r, uint32_t ahora) {
+  if (!_listo) return false;
+  if (_enLote == SPOOL_LOTE && !volcar()) {
+    // Sin flash el lote funciona como anillo en RAM
+    memmove(&_lote[0], &_lote[1], (SPOOL_LOTE - 1) * TAM_REGISTRO);
+    _enLote--;
+    _descartados++;
+  }
+  if (_enLote == 0) _loteDesde = ahora;
+  _lote[_enLote] = r;
+  _lote[_enLote].crc = calcularCrc(r);
+  _enLote++;
+  if (_enLote == SPOOL_LOTE) volcar();
+  return true;
+}
+
+void SpoolTelemetria::actualizar(uint32_t ahora) {
+  if (_enLote && ahora - _loteDesde >= LOTE_MAX_MS) volcar();
+}
+
+bool SpoolTelemetria::volcar() {
+  if (!_listo || !_enLote) return true;
+
+  uint8_t escritos = 0;
+  while (escritos < _enLote) {
+    if (_enUltimo >= SPOOL_REGISTROS_POR_SEGMENTO) {
+      _ultimo++;
+      _enUltimo = 0;
+      if (_ultimo - _primero >= _segmentosMax) descartarPrimero();
+    }
+
+    char ruta[32];
+    rutaSegmento(_ultimo, ruta, sizeof(ruta));
+    File f = _fs.open(ruta, FILE_APPEND, true);
+    if (!f) break;
+
+    size_t cabe = SPOOL_REGISTROS_POR_SEGMENTO - _enUltimo;
+    size_t n = _enLote - escritos;
+    if (n > cabe) n = cabe;
+    size_t bytes = f.write((const uint8_t*)&_lote[escritos], n * TAM_REGISTRO);
+    f.close();
+
+    size_t completos = bytes / TAM_REGISTRO;
+    _enUltimo += completos;
+    _pendientesFlash += completos;
+    if (_primero == _ultimo) _enPrimero = _enUltimo;
+    escritos += completos;
+    if (completos < n) break;    // flash llena o error de escritura
+  }
+
+  if (escritos) {
+    memmove(&_lote[0], &_lote[escritos], (_enLote - escritos) * TAM_REGISTRO);
+    _enLote -= escritos;
+  }
+  return _enLote == 0;
+}
+
+// Con el spool lleno se pierde lo más viejo, nunca lo recién llegado
+void SpoolTelemetria::descartarPrimero() {
+  _descartados += _enPrimero - _leidosPrimero;
+  _pendientesFlash -= _enPrimero - _leidosPrimero;
+  _leidosPrimero = _enPrimero;
+  cerrarPrimero();
+}
+
+// Borra _primero ya consumido y pasa al siguiente
+void SpoolTelemetria::cerrarPrimero() {
+  char ruta[32];
+  rutaSegmento(_primero, ruta, sizeof(ruta));
+  _fs.remove(ruta);
+  _leidosPrimero = 0;
+  if (_primero == _ultimo) {
+    _primero = ++_ultimo;
+    _enUltimo = 0;
+    _enPrimero = 0;
+    return;
+  }
+  _primero++;
+  _enPrimero = (_primero == _ultimo) ? _enUltimo : registrosEn(_primero);
+}
+
+// ==============================
+// Lectura
+// ==============================
+size_t SpoolTelemetria::leer(RegistroTelemetria* destino, size_t max) {
+  if (!_listo || !max) return 0;
+
+  if (!_pendientesFlash) {
+    size_t n = _enLote < max ? _enLote : max;
+    memcpy(destino, _lote, n * TAM_REGISTRO);
+    return n;
+  }
+
+  // Segmentos vacíos o ausentes (por ejemplo, recortados por un reinicio)
+  while (_leidosPrimero >= _enPrimero && _primero != _ultimo) cerrarPrimero();
+  if (_leidosPrimero >= _enPrimero) return 0;
+
+  char ruta[32];
+  rutaSegmento(_primero, ruta, sizeof(ruta));
+  File f = _fs.open(ruta, FILE_READ);
+  if (!f) return 0;
+  f.seek(_leidosPrimero * TAM_REGISTRO);
+
+  size_t disponibles = _enPrimero - _leidosPrimero;
+  size_t n = 0;
+  while (n < max && disponibles--) {
+    if (f.read((uint8_t*)&destino[n], TAM_REGISTRO) != TAM_REGISTRO) break;
+    if (destino[n].crc == calcularCrc(destino[n])) {
+      n++;
+    } else if (n == 0) {
+      // Registro dañado al frente: se saltea para no trabar el drenaje
+      _corruptos++;
+      _leidosPrimero++;
+      _pendientesFlash--;
+    } else {
+      break;   // se devuelve el tramo válido; el dañado queda al frente
+    }
+  }
+  f.close();
+
+  if (n == 0 && _leidosPrimero >= _enPrimero && _primero != _ultimo) {
+    cerrarPrimero();
+    return leer(destino, max);
+  }
+  return n;
+}
+
+void SpoolTelemetria::confirmar(size_t n) {
+  if (!_listo || !n) return;
+
+  if (!_pendientesFlash) {
+    if (n > _enLote) n = _enLote;
+    memmove(&_lote[0], &_lote[n], (_enLote - n) * TAM_REGISTRO);
+    _enLote -= n;
+    return;
+  }
+
+  _leidosPrimero += n;
+  _pendientesFlash -= n;
+  if (_leidosPrimero >= _enPrimero) {
+    // Un segmento abierto sólo se cierra cuando ya no entra nada más en él
+    if (_primero != _ultimo || _pendientesFlash == 0) cerrarPrimero();
+  }
+}
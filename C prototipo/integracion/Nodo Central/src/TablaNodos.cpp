@@ -0,0 +1,89 @@
+#include "TablaNodos.h"
+#include <string.h>
+
+// Constructor
+TablaNodos::TablaNodos() {
+  memset(indice, LIBRE, sizeof(indice));
+  memset(entradas, 0, sizeof(entradas));
+  ocupadas = 0;
+}
+
+EstadoNodo* TablaNodos::buscar(uint8_t nodo) {
+  uint8_t pos = indice[nodo];
+  return pos == LIBRE ? nullptr : &entradas[pos];
+}
+
+EstadoNodo* TablaNodos::obtener(uint8_t nodo, uint32_t ahora) {
+  EstadoNodo* e = buscar(nodo);
+  if (e) return e;
+
+  uint8_t pos;
+  if (ocupadas < CAPACIDAD) {
+    pos = ocupadas++;
+  } else {
+    // Tabla llena: se reutiliza la entrada más antigua
+    pos = 0;
+    for (uint8_t i = 1; i < CAPACIDAD; i++) {
+      if (ahora - entradas[i].ultimoVisto > ahora - entradas[pos].ultimoVisto) pos = i;
+    }
+    indice[entradas[pos].nodo] = LIBRE;
+  }
+
+  e = &entradas[pos];
+  memset(e, 0, sizeof(*e));
+  e->nodo = nodo;
+  e->ultimoVisto = ahora;
+  indice[nodo] = pos;
+  return e;
+}
+
+EstadoNodo* TablaNodos::actualizar(const LecturaGas& lectura, int rssi, float snr, float umbral, uint32_t ahora) {
+  EstadoNodo* e = obtener(lectura.nodo, ahora);
+
+  e->ultimoVisto = ahora;
+  e->ppm = lectura.ppm;
+  e->ratio = lectura.ratio;
+  e->raw = lectura.raw;
+  e->seq = lectura.seq;
+  e->flags = lectura.flags;
+  e->rssi = (int16_t)rssi;
+  int snrQ = (int)(snr * 4.0f + (snr < 0 ? -0.5f : 0.5f));
+  e->snrCuartos = (int8_t)(snrQ < -128 ? -128 : (snrQ > 127 ? 127 : snrQ));
+  // Sin Ro calibrado o con el sensor frío el ppm no significa nada: no
+  // alarma ni entra al control. El umbral propio del nodo (THRESHOLD:)
+  // también cuenta.
+  e->alarma = tramaPpmConfiable(lectura.flags) &&
+              (lectura.ppm > umbral || (lectura.flags & TRAMA_FLAG_ALERTA));
+  if (tramaPpmConfiable(lectura.flags)) e->tendencia.agregar(lectura.ppm, ahora);
+  else e->tendencia.reiniciar();
+  return e;
+}
+
+float TablaNodos::ppmMaxima(uint32_t ahora, uint32_t vigenciaMs) const {
+  float maxima = 0;
+  for (uint8_t i = 0; i < ocupadas; i++) {
+    const EstadoNodo& e = entradas[i];
+    if (!tramaPpmConfiable(e.flags)) continue;
+    if (ahora - e.ultimoVisto <= vigenciaMs && e.ppm > maxima) maxima = e.ppm;
+  }
+  return maxima;
+}
+
+float TablaNodos::ppmProyectadaMaxima(uint32_t ahora, uint32_t vigenciaMs, float horizonteS) const {
+  float maxima = 0;
+  for (uint8_t i = 0; i < ocupadas; i++) {
+    const EstadoNodo& e = entradas[i];
+    if (!tramaPpmConfiable(e.flags) || ahora - e.ultimoVisto > vigenciaMs) continue;
+    float p = e.tendencia.proyectar(horizonteS, ahora);
+    if (p > maxima) maxima = p;
+  }
+  return maxima;
+}
+
+bool TablaNodos::hayAlarma(uint32_t ahora, uint32_t vigenciaMs) const {
+  for (uint8_t i = 0; i < ocupadas; i++) {
+    const EstadoNodo& e = entradas[i];
+    if (e.alarma && ahora - e.ultimoVisto <= vigenciaMs) return true;
+  }
+  return false;
+}
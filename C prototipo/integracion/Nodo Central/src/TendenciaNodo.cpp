@@ -0,0 +1,77 @@
+#include "TendenciaNodo.h"
+#include <math.h>
+#include <string.h>
+
+void TendenciaNodo::agregar(float ppm, uint32_t ahora) {
+  if (!cantidad) {
+    ewma = ppm;
+  } else {
+    float dt = (float)(ahora - ultimoMs()) / 1000.0f;
+    ewma += (ppm - ewma) * (1.0f - expf(-dt / TAU_S));
+  }
+
+  bool rehacer = false;
+  while (cantidad && ahora - tiempos[primera] > VENTANA_MS) {
+    quitarPrimera();
+    rehacer = true;
+  }
+  if (cantidad == MUESTRAS) quitarPrimera();
+  if (!cantidad) {
+    st = sy = stt = sty = 0;
+    baseMs = ahora;
+    altas = 0;
+  }
+
+  uint8_t pos = (primera + cantidad) % MUESTRAS;
+  tiempos[pos] = ahora;
+  ppms[pos] = ppm;
+  cantidad++;
+  sumar(pos, 1.0f);
+  if (rehacer || ++altas >= MUESTRAS) rehacerSumas();
+}
+
+void TendenciaNodo::reiniciar() {
+  memset(this, 0, sizeof(*this));
+}
+
+float TendenciaNodo::pendiente() const {
+  if (cantidad < MINIMO) return 0;
+  float n = cantidad;
+  // n^2 por la varianza de t: con las lecturas en menos de ~1 s no hay recta
+  float den = n * stt - st * st;
+  if (den < n * n) return 0;
+  return (n * sty - st * sy) / den;
+}
+
+uint32_t TendenciaNodo::ultimoMs() const {
+  return cantidad ? tiempos[(primera + cantidad - 1) % MUESTRAS] : 0;
+}
+
+float TendenciaNodo::proyectar(float horizonteS, uint32_t ahora) const {
+  if (!cantidad) return 0;
+  if (ahora - ultimoMs() > VENTANA_MS) return ewma;
+  float p = ewma + pendiente() * (TAU_S + horizonteS);
+  return p > 0 ? p : 0;
+}
+
+void TendenciaNodo::sumar(uint8_t pos, float signo) {
+  float t = (float)(tiempos[pos] - baseMs) / 1000.0f;
+  float y = ppms[pos];
+  st  += signo * t;
+  sy  += signo * y;
+  stt += signo * t * t;
+  sty += signo * t * y;
+}
+
+void TendenciaNodo::quitarPrimera() {
+  sumar(primera, -1.0f);
+  primera = (primera + 1) % MUESTRAS;
+  cantidad--;
+}
+
+void TendenciaNodo::rehacerSumas() {
+  st = sy = stt = sty = 0;
+  baseMs = tiempos[primera];
+  for (uint8_t i = 0; i < cantidad; i++) sumar((primera + i) % MUESTRAS, 1.0f);
+  altas = 0;
+}
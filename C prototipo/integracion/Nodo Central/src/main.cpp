@@ -3,7 +3,22 @@
 #include <LoRa.h>
 #include <PubSubClient.h>
 #include <Preferences.h>
+#include <LittleFS.h>
+#include <TramaLoRa.h>
+#include <TiempoEnAire.h>
 #include "ControlVentilador.h"
+#include "BancoVentiladores.h"
+#include "EscritorJson.h"
+#include "TablaNodos.h"
+#include "GestorConexion.h"
+#include "SpoolTelemetria.h"
+#include "ReceptorLoRa.h"
+#include "ColaComandos.h"
+#include "ControlAdr.h"
+#include "PlanTdma.h"
+#include "ReguladorPI.h"
+#include "ConfigPersistente.h"
+#include "DespachoComandos.h"
 
 // ==============================
 // CONFIGURACIÓN WIFI y MQTT
@@ -11,6 +26,11 @@
 const char* mqtt_server = "test.mosquitto.org";
 const char* topic_config = "gas/control";
 const char* topic_envio = "gas/datos";
+const char* topic_alarma = "gas/alarma";   // estado de alarma, retenido
+const char* topic_comandos = "gas/comandos"; // estado de los comandos a los nodos
+const char* topic_enlace = "gas/enlace";     // calidad del enlace por nodo
+const char* topic_resultado = "gas/resultado"; // resultado de cada mensaje de gas/control
+const char* gateway_id = "esp32-central-001";
 
 char ssid[32]       = "SSID";
 char password[64]   = "PASSWORD";
@@ -23,75 +43,294 @@ Preferences prefs;
 #define LORA_SS    5
 #define LORA_RST   14
 #define LORA_DIO0  2
+#ifndef LORA_SF
+#define LORA_SF    7    // SF de la red: el SX1276 escucha uno solo
+#endif
 #define PIN_EXTRACTOR 27
+#ifndef EXTRACTOR_CANAL_LEDC
+#define EXTRACTOR_CANAL_LEDC 0   // fade por hardware; -1: rampa por software
+#endif
+// Con varios extractores (-DPINES_EXTRACTORES=27,26,25) los maneja un
+// BancoVentiladores con la misma interfaz: la demanda se reparte entre ellos,
+// arrancan escalonados y rotan por tiempo de marcha
+#ifndef EXTRACTOR_ESCALON_MS
+#define EXTRACTOR_ESCALON_MS 3000
+#endif
 
 WiFiClient espClient;
 PubSubClient client(espClient);
+GestorConexion conexion(client);
+#ifdef PINES_EXTRACTORES
+const uint8_t pinesExtractores[] = { PINES_EXTRACTORES };
+BancoVentiladores extractor(pinesExtractores, sizeof(pinesExtractores), 100);
+#else
 ControlVentilador extractor(PIN_EXTRACTOR, 100); // pin, PWM mínimo
+#endif
 
 float umbralGas = 500.0;
 bool modoAutomatico = true;
-float ultimaPPM = 0;
-float ultimaRatio = 0;
-int ultimoRaw = 0;
-String ultimoEstado = "NORMAL";
+float pendienteRampa = 40.0;    // % por segundo: ~5 PWM cada 50 ms
+bool rampaSuave = false;
+
+// Modo automático: un PI lleva la mayor ppm vigente a consignaPct % de
+// umbralGas, por debajo de la alarma. Velocidad mínima, máxima e
+// histéresis con las claves y valores por defecto de UmbralesManager.
+ReguladorPI regulador;
+float consignaPct = 80.0;
+const uint32_t CONTROL_PERIODO_MS = 1000;
+
+// Anticipación: si la tendencia de algún nodo cruza umbralGas dentro de
+// horizonteS segundos, el PI regula con esa ppm proyectada en lugar de la
+// actual y el extractor arranca antes del cruce (0 = sin anticipación)
+float horizonteS = 60.0;
+bool anticipando = false;
+
+// Alarma: con algún nodo en alarma el extractor va al máximo sin rampa y el
+// estado se publica retenido en topic_alarma. Sobre ppmParada (0 = nunca)
+// el gateway detiene el extractor: por encima del límite de explosividad
+// del gas no conviene tener un motor andando.
+bool alarmaActiva = false;
+bool alarmaPendiente = false;   // estado sin publicar todavía
+bool paradaActiva = false;      // parada de emergencia hasta extractor_on / modo_auto_on
+float ppmParada = 0;
+uint32_t alarmaCambioMs = 0;
+uint8_t alarmaNodo = 0;
+float alarmaPpm = 0;
+uint32_t alarmasRepetidas = 0;
+
+// Estado por nodo sensor; el control automático usa la mayor ppm entre los
+// nodos que reportaron dentro de VIGENCIA_LECTURA_MS. Los sensores reportan
+// por excepción: con el aire estable sólo mandan un heartbeat (300 s como
+// máximo), así que la vigencia cubre dos heartbeats.
+TablaNodos nodos;
+const uint32_t VIGENCIA_LECTURA_MS = 660000;
+
+// Lecturas que no se pudieron publicar esperan en flash; al volver el broker
+// se drenan de a DRENAJE_LOTE cada DRENAJE_INTERVALO_MS (20 msg/s)
+SpoolTelemetria spool(LittleFS);
+const uint8_t DRENAJE_LOTE = 5;
+const uint32_t DRENAJE_INTERVALO_MS = 250;
+uint16_t arranque = 0;
+
+// Configuración persistente: un blob con CRC en NVS. Los comandos cambian
+// las variables en RAM y guardarConfiguracion() sólo anota el cambio; el
+// blob se escribe tras CONFIG_QUIETUD_MS sin otros cambios, y sólo si
+// difiere de lo guardado. El contador de arranques sigue en su clave: se
+// escribe una vez por arranque, sin esperar.
+struct ConfigGateway {
+  char    ssid[32];
+  char    password[64];
+  float   umbralGas;
+  float   ppmParada;
+  float   pendienteRampa;
+  float   kp, ki, kd;
+  float   consignaPct;
+  float   horizonteS;
+  int16_t minVelocidad, maxVelocidad, histeresis;
+  bool    adr, tdma, rampaSuave;
+};
+const uint8_t CONFIG_VERSION = 1;
+const uint32_t CONFIG_QUIETUD_MS = 5000;
+ConfigPersistente<ConfigGateway> configNvs("config", "gateway", CONFIG_VERSION, CONFIG_QUIETUD_MS);
+
+// La radio la atiende una tarea en el núcleo 0; loop() (núcleo 1) consume
+// las tramas de la cola
+ReceptorLoRa receptor;
+
+// Comandos MQTT -> LoRa para los nodos sensores ("nodo:<id>:<comando>" en
+// topic_config), con secuencia, confirmación y reintentos. Cada cambio de
+// estado se informa en topic_comandos.
+ColaComandos comandos;
+
+// Tras cada bajada el canal queda para la respuesta del nodo (proceso y
+// hasta ~130 ms de TX a SF7): otra bajada encima la taparía, el gateway no
+// recibe mientras transmite
+const uint32_t RESPUESTA_MS = 200;
+
+// Potencia de cada nodo según su margen de SNR (comandos RADIO: por la
+// misma bajada). Se desactiva con set_adr:0.
+ControlAdr adr(LORA_SF);
+
+// Turnos de transmisión anunciados con una baliza (SLOT:<n>:<época> a cada
+// nodo). Las bajadas salen en la ventana de contención. Se desactiva con
+// set_tdma:0.
+PlanTdma tdma(LORA_SF);
+
+// Estadísticas de recepción LoRa
+uint32_t tramasRecibidas = 0;
+uint32_t tramasInvalidas = 0;
+uint32_t tramasDuplicadas = 0;   // sin contar las repeticiones de alarma
+uint32_t tramasAtrasadas = 0;
+uint32_t descartesInformados = 0;
+
+// Reporte de calidad de enlace (EnlaceNodo de cada nodo) en topic_enlace,
+// de a ENLACE_POR_MENSAJE nodos por mensaje
+const uint32_t REPORTE_ENLACE_MS = 60000;
+const uint8_t ENLACE_POR_MENSAJE = 6;
+
+// Mensajes de gas/control: "nombre[:arg]" o un lote JSON. PubSubClient
+// recibe hasta 256 bytes por paquete, con el tópico y la cabecera.
+const unsigned int COMANDO_MQTT_MAX = 240;
 
 // ==============================
 // Prototipos
 // ==============================
 void cargarConfiguracion();
 void guardarConfiguracion();
+void persistirConfiguracion(bool yaMismo = false);
 void callbackMQTT(char* topic, byte* payload, unsigned int length);
-void reconectarMQTT();
+void publicarResultado(const LoteComandos* lote, const char* comando, ResultadoComando r, int indice);
+void alConectarMQTT();
 void recibirLoRa();
-void procesarMensajeLoRa(String mensaje);
-void publicarEstadoMQTT();
+bool decodificarTrama(const uint8_t* buf, size_t largo, LecturaGas& lectura);
+void procesarLectura(const LecturaGas& lectura, int rssi, float snr);
+bool procesarRespuesta(const uint8_t* buf, size_t largo);
+void atenderComandos();
+void atenderTdma();
+bool encolarComando(long nodo, const String& texto);
+void ajustarRadio(uint8_t nodo, const EnlaceNodo& enlace);
+void asignarSlot(uint8_t nodo);
+void resultadoBajada(const ComandoLoRa& c, bool entregado);
+void publicarEstadoComando(const ComandoLoRa& c, const char* estado, const char* respuesta);
+void actualizarAlarma(const EstadoNodo& nodo, float ppm, uint32_t ahora);
+void controlarVentilacion();
+void detenerPorEmergencia();
+void publicarAlarma();
+void publicarEnlace();
+RegistroTelemetria capturarRegistro(const EstadoNodo& nodo, uint32_t ahora);
+bool publicarRegistro(const RegistroTelemetria& r, bool diferido);
+void drenarSpool();
 
 // ==============================
 // Funciones Preferences
 // ==============================
-void cargarConfiguracion() {
-  prefs.begin("config", false);
+void capturarConfiguracion(ConfigGateway& c) {
+  memset(&c, 0, sizeof(c));   // el relleno también se compara
+  snprintf(c.ssid, sizeof(c.ssid), "%s", ssid);
+  snprintf(c.password, sizeof(c.password), "%s", password);
+  c.umbralGas = umbralGas;
+  c.ppmParada = ppmParada;
+  c.pendienteRampa = pendienteRampa;
+  c.kp = regulador.obtenerKp();
+  c.ki = regulador.obtenerKi();
+  c.kd = regulador.obtenerKd();
+  c.consignaPct = consignaPct;
+  c.horizonteS = horizonteS;
+  c.minVelocidad = (int16_t)regulador.obtenerMinimo();
+  c.maxVelocidad = (int16_t)regulador.obtenerMaximo();
+  c.histeresis = (int16_t)regulador.obtenerHisteresis();
+  c.adr = adr.activo();
+  c.tdma = tdma.activo();
+  c.rampaSuave = rampaSuave;
+}
+
+void aplicarConfiguracion(const ConfigGateway& c) {
+  snprintf(ssid, sizeof(ssid), "%s", c.ssid);
+  snprintf(password, sizeof(password), "%s", c.password);
+  umbralGas = c.umbralGas;
+  ppmParada = c.ppmParada;
+  pendienteRampa = c.pendienteRampa;
+  regulador.configurarGanancias(c.kp, c.ki, c.kd);
+  consignaPct = c.consignaPct;
+  horizonteS = c.horizonteS;
+  regulador.configurarLimites(c.minVelocidad, c.maxVelocidad, c.histeresis);
+  adr.habilitar(c.adr);
+  tdma.habilitar(c.tdma);
+  rampaSuave = c.rampaSuave;
+}
+
+// Sin blob (primer arranque con esta versión): las claves sueltas de antes,
+// y de "ventilador" las de UmbralesManager
+void cargarClavesSueltas() {
+  prefs.begin("config", true);
   String s = prefs.getString("ssid", ssid);
   s.toCharArray(ssid, sizeof(ssid));
   String p = prefs.getString("pass", password);
   p.toCharArray(password, sizeof(password));
   umbralGas = prefs.getFloat("umbralGas", umbralGas);
+  ppmParada = prefs.getFloat("ppmParada", ppmParada);
+  adr.habilitar(prefs.getBool("adr", true));
+  tdma.habilitar(prefs.getBool("tdma", true));
+  pendienteRampa = prefs.getFloat("rampa", pendienteRampa);
+  rampaSuave = prefs.getBool("rampaSuave", rampaSuave);
+  regulador.configurarGanancias(prefs.getFloat("kp", regulador.obtenerKp()),
+                                prefs.getFloat("ki", regulador.obtenerKi()),
+                                prefs.getFloat("kd", regulador.obtenerKd()));
+  consignaPct = prefs.getFloat("consigna", consignaPct);
+  horizonteS = prefs.getFloat("horizonte", horizonteS);
+  prefs.end();
+
+  prefs.begin("ventilador", true);
+  regulador.configurarLimites(prefs.getInt("minVelocidad", 30), prefs.getInt("maxVelocidad", 90),
+                              prefs.getInt("histeresis", 5));
   prefs.end();
 }
 
-void guardarConfiguracion() {
+void cargarConfiguracion() {
+  ConfigGateway c;
+  if (configNvs.cargar(c)) {
+    aplicarConfiguracion(c);
+  } else {
+    cargarClavesSueltas();
+    configNvs.marcar(millis());
+  }
+
   prefs.begin("config", false);
-  prefs.putString("ssid", ssid);
-  prefs.putString("pass", password);
-  prefs.putFloat("umbralGas", umbralGas);
+  arranque = prefs.getUShort("arranque", 0) + 1;
+  prefs.putUShort("arranque", arranque);
   prefs.end();
 }
 
+// Los comandos llaman acá después de cada cambio: sólo queda anotado
+void guardarConfiguracion() {
+  configNvs.marcar(millis());
+}
+
+// Una escritura por ráfaga de cambios, cuando se calmaron. Un lote JSON
+// se guarda enseguida.
+void persistirConfiguracion(bool yaMismo) {
+  if (!configNvs.pendiente() || !(yaMismo || configNvs.vencida(millis()))) return;
+  ConfigGateway c;
+  capturarConfiguracion(c);
+  if (configNvs.guardar(c, millis())) {
+    Serial.printf(" Configuracion guardada en NVS (%lu escrituras)\n", (unsigned long)configNvs.escrituras());
+  }
+}
+
 // ==============================
 // SETUP
 // ==============================
 void setup() {
   Serial.begin(115200);
   cargarConfiguracion();
+  comandos.begin((uint16_t)(arranque << 8));
 
   // Inicializar extractor
+#ifdef PINES_EXTRACTORES
+  // La marcha acumulada se pierde al reiniciar: cada arranque empieza otro
+  extractor.empezarPor(arranque % extractor.cantidad());
+  extractor.configurarEscalon(EXTRACTOR_ESCALON_MS);
+#else
+  if (EXTRACTOR_CANAL_LEDC >= 0 && !extractor.usarFadeHardware(EXTRACTOR_CANAL_LEDC)) {
+    Serial.println(" Fade LEDC no disponible: rampa por software");
+  }
+#endif
   extractor.inicializar();
   extractor.configurarArranqueSuave(true, 100);
-  extractor.configurarTransicion(5, 50);
-
-  // Conexión Wi-Fi
-  WiFi.begin(ssid, password);
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(500);
-    Serial.print(".");
-  }
-  Serial.println("\nWiFi conectado");
-  delay(3000);
+  extractor.configurarPendiente(pendienteRampa, rampaSuave ? CURVA_SUAVE : CURVA_LINEAL);
 
-  // MQTT
+  // Wi-Fi y MQTT se conectan en segundo plano desde loop()
   client.setServer(mqtt_server, 1883);
   client.setCallback(callbackMQTT);
+  conexion.onConnect(alConectarMQTT);
+  conexion.begin(ssid, password, "esp32-central");
+
+  // Spool de telemetría (formatea la partición si no tiene sistema de archivos)
+  if (LittleFS.begin(true) && spool.begin()) {
+    Serial.printf(" Spool listo: %lu registros pendientes\n", (unsigned long)spool.pendientes());
+  } else {
+    Serial.println(" Spool no disponible: sin broker se pierden las lecturas");
+  }
 
   // LoRa
   LoRa.setPins(LORA_SS, LORA_RST, LORA_DIO0);
@@ -99,6 +338,12 @@ void setup() {
     Serial.println(" Error iniciando LoRa");
     while (1);
   }
+  LoRa.setSpreadingFactor(LORA_SF);
+  if (!receptor.begin(LORA_DIO0)) {
+    Serial.println(" Error creando la tarea de recepción LoRa");
+    while (1);
+  }
+  tdma.begin((uint8_t)arranque, millis());
   Serial.println(" LoRa listo");
 }
 
@@ -106,144 +351,774 @@ void setup() {
 // LOOP PRINCIPAL
 // ==============================
 void loop() {
-  if (!client.connected()) reconectarMQTT();
-  client.loop();
-
-  recibirLoRa();
+  recibirLoRa();           // primero: una alarma mueve el extractor
+  atenderTdma();           // la baliza antes que las bajadas
+  atenderComandos();
+  conexion.actualizar();   // nunca espera: un paso de la máquina de estados
+  controlarVentilacion();
   extractor.actualizar();  // mantener transiciones PWM suaves
+  publicarAlarma();        // reintenta hasta que el broker la acepte
+  publicarEnlace();
+
+  spool.actualizar(millis());
+  drenarSpool();
+  persistirConfiguracion();
 }
 
 // ==============================
 // LoRa
 // ==============================
 void recibirLoRa() {
-  int packetSize = LoRa.parsePacket();
-  if (packetSize) {
-    String msg;
-    while (LoRa.available()) msg += (char)LoRa.read();
-    Serial.println(" LoRa recibido: " + msg);
-    procesarMensajeLoRa(msg);
+  TramaCruda* t;
+  while ((t = receptor.frente()) != nullptr) {
+    tramasRecibidas++;
+    LecturaGas lectura;
+    bool alarma = tramaEsAlarma(t->datos, t->largo);
+    if (tramaEsBinaria(t->datos, t->largo) && tramaTipo(t->datos[0]) == TRAMA_TIPO_RESPUESTA) {
+      if (!procesarRespuesta(t->datos, t->largo)) {
+        tramasInvalidas++;
+        Serial.printf(" LoRa descartado: respuesta invalida (%u bytes)\n", (unsigned)t->largo);
+      }
+    } else if (decodificarTrama(t->datos, t->largo, lectura)) {
+      comandos.alRecibirUplink(lectura.nodo, millis());
+      EnlaceNodo& enlace = nodos.obtener(lectura.nodo, millis())->enlace;
+      ResultadoSecuencia r = SEQ_NUEVA;
+      bool binaria = tramaEsBinaria(t->datos, t->largo);
+      if (binaria) r = enlace.registrar(lectura.seq, t->rssi, t->snr());
+      else enlace.registrarSinSecuencia(t->rssi, t->snr());
+
+      if (r == SEQ_DUPLICADA) {
+        // Las repeticiones de una alarma traen la secuencia ya procesada
+        if (alarma) alarmasRepetidas++;
+        else tramasDuplicadas++;
+      } else if (r == SEQ_ATRASADA) {
+        // Ya se procesó una más nueva (una alarma pasa delante de la
+        // telemetría en cola): aplicarla volvería atrás el estado del nodo
+        tramasAtrasadas++;
+        Serial.printf(" LoRa atrasado: nodo %u seq %u, se ignora\n", lectura.nodo, lectura.seq);
+      } else {
+        Serial.printf(" LoRa recibido: nodo %u seq %u%s%s\n", lectura.nodo, lectura.seq,
+                      alarma ? " (alarma)" : "", r == SEQ_REINICIO ? " (nodo reiniciado)" : "");
+        if (r == SEQ_REINICIO) {
+          adr.alReiniciarNodo(lectura.nodo);
+          tdma.alReiniciarNodo(lectura.nodo);
+        }
+        procesarLectura(lectura, t->rssi, t->snr());
+        // El firmware ASCII heredado no entiende RADIO: ni SLOT:
+        if (binaria) {
+          asignarSlot(lectura.nodo);
+          ajustarRadio(lectura.nodo, enlace);
+        }
+      }
+    } else {
+      tramasInvalidas++;
+      Serial.printf(" LoRa descartado: trama invalida (%u bytes)\n", (unsigned)t->largo);
+    }
+    receptor.liberar();
+  }
+
+  // Los descartes ocurren en la tarea; se informan desde acá
+  uint32_t descartes = receptor.descartadasCola() + receptor.descartadasLargo();
+  if (descartes != descartesInformados) {
+    Serial.printf(" LoRa: %lu tramas descartadas (cola llena %lu, largo %lu)\n",
+                  (unsigned long)descartes, (unsigned long)receptor.descartadasCola(),
+                  (unsigned long)receptor.descartadasLargo());
+    descartesInformados = descartes;
   }
 }
 
-void procesarMensajeLoRa(String mensaje) {
-  float ppm = 0;
-  float ratio = 0;
-  int raw = 0;
-  String estado = "NORMAL";
+// Acepta la trama binaria y, durante la migración, el formato ASCII heredado
+bool decodificarTrama(const uint8_t* buf, size_t largo, LecturaGas& lectura) {
+  if (tramaEsBinaria(buf, largo)) {
+    return tramaDecodificarDatos(buf, largo, lectura);
+  }
+  return tramaDecodificarAscii((const char*)buf, largo, lectura);
+}
 
-  if (mensaje.startsWith("GAS_DATA|")) {
-    int p1 = mensaje.indexOf("PPM:") + 4;
-    int p2 = mensaje.indexOf("|Ratio:");
-    ppm = mensaje.substring(p1, p2).toFloat();
+// Respuesta de un nodo a un comando de bajada
+bool procesarRespuesta(const uint8_t* buf, size_t largo) {
+  uint8_t nodo;
+  uint16_t seq;
+  const char* texto;
+  size_t largoTexto;
+  if (!tramaDecodificarTexto(buf, largo, TRAMA_TIPO_RESPUESTA, nodo, seq, texto, largoTexto)) return false;
 
-    int p3 = mensaje.indexOf("Ratio:") + 6;
-    int p4 = mensaje.indexOf("|Raw:");
-    ratio = mensaje.substring(p3, p4).toFloat();
+  char respuesta[TRAMA_LARGO_MAX];
+  memcpy(respuesta, texto, largoTexto);
+  respuesta[largoTexto] = '\0';
+  Serial.printf(" LoRa respuesta: nodo %u seq %u: %s\n", nodo, seq, respuesta);
 
-    int p5 = mensaje.indexOf("Raw:") + 4;
-    int p6 = mensaje.indexOf("|Status:");
-    raw = mensaje.substring(p5, p6).toInt();
+  ComandoLoRa c;
+  if (comandos.confirmar(nodo, seq, c)) {
+    resultadoBajada(c, true);
+    publicarEstadoComando(c, "entregado", respuesta);
+  } else {
+    // Ya confirmado (CALIBRATION_OK llega al terminar la calibración) o vencido
+    memset(&c, 0, sizeof(c));
+    c.nodo = nodo;
+    c.seq = seq;
+    publicarEstadoComando(c, "respuesta", respuesta);
+  }
+  // El nodo acaba de transmitir: su próximo comando puede salir ya
+  comandos.alRecibirUplink(nodo, millis());
+  return true;
+}
 
-    estado = (ppm > umbralGas) ? "ALERTA" : "NORMAL";
+void procesarLectura(const LecturaGas& lectura, int rssi, float snr) {
+  uint32_t ahora = millis();
+  EstadoNodo* nodo = nodos.actualizar(lectura, rssi, snr, umbralGas, ahora);
+  float ppm = nodos.ppmMaxima(ahora, VIGENCIA_LECTURA_MS);
 
-    if (modoAutomatico) {
-      if (ppm > umbralGas) {
-        int pwmPorcentaje = map(ppm, umbralGas, 1000, 50, 100);
-        pwmPorcentaje = constrain(pwmPorcentaje, 50, 100);
-        extractor.establecerVelocidad(pwmPorcentaje);
-      } else {
-        extractor.apagar();
-      }
+  // El extractor antes que la red: publicar puede bloquear. El control
+  // automático corre aparte, cada CONTROL_PERIODO_MS.
+  actualizarAlarma(*nodo, ppm, ahora);
+
+  publicarAlarma();
+  RegistroTelemetria r = capturarRegistro(*nodo, ahora);
+  if (!publicarRegistro(r, false)) spool.agregar(r, ahora);
+}
+
+// Entrada y salida de la alarma: el PWM cambia acá, sin esperar a la rampa
+// de actualizar() ni al broker
+void actualizarAlarma(const EstadoNodo& nodo, float ppm, uint32_t ahora) {
+  if (ppmParada > 0 && ppm >= ppmParada && !paradaActiva) {
+    Serial.printf(" ppm %.1f sobre el limite de parada %.1f\n", ppm, ppmParada);
+    detenerPorEmergencia();
+  }
+
+  bool alarma = nodos.hayAlarma(ahora, VIGENCIA_LECTURA_MS);
+  if (alarma == alarmaActiva) return;
+
+  alarmaActiva = alarma;
+  alarmaCambioMs = ahora;
+  alarmaNodo = nodo.nodo;
+  alarmaPpm = ppm;
+  if (!alarma) extractor.liberarAnulacion();
+  else if (!paradaActiva) extractor.forzarMaximo();
+  alarmaPendiente = true;
+}
+
+// Control automático con la mayor ppm vigente, o la proyectada si cruza el
+// umbral dentro del horizonte. Las lecturas llegan por excepción y a
+// intervalos irregulares: el PI corre a período fijo con la última de cada
+// nodo.
+void controlarVentilacion() {
+  static uint32_t ultimoMs = 0;
+  uint32_t ahora = millis();
+  if (ahora - ultimoMs < CONTROL_PERIODO_MS) return;
+  ultimoMs = ahora;
+
+  anticipando = false;
+  if (!modoAutomatico) {
+    regulador.reiniciar();
+    return;
+  }
+  float ppm = nodos.ppmMaxima(ahora, VIGENCIA_LECTURA_MS);
+  if (horizonteS > 0) {
+    float proyectada = nodos.ppmProyectadaMaxima(ahora, VIGENCIA_LECTURA_MS, horizonteS);
+    if (proyectada > umbralGas && proyectada > ppm) {
+      ppm = proyectada;
+      anticipando = true;
     }
+  }
+  float consigna = umbralGas * consignaPct / 100.0f;
+  if (extractor.anulacionActiva()) {
+    // Con la alarma el extractor va al máximo: al terminar el PI sigue
+    // desde ahí, sin saltos
+    regulador.seguir(100, ppm, consigna, ahora);
+    return;
+  }
+  float velocidad = regulador.actualizar(ppm, consigna, ahora);
+  if (regulador.encendido()) extractor.establecerVelocidad((int)lroundf(velocidad));
+  else extractor.apagar();
+}
+
+// Queda detenido hasta extractor_on o modo_auto_on
+void detenerPorEmergencia() {
+  paradaActiva = true;
+  modoAutomatico = false;
+  extractor.paradaEmergencia();
+  alarmaPendiente = true;
+}
+
+// ==============================
+// Comandos a los nodos
+// ==============================
+// Vence los que agotaron los intentos y transmite uno si le toca
+void atenderComandos() {
+  static uint32_t libreDesdeMs = 0;
+  ComandoLoRa c;
+  while (comandos.vencido(millis(), c)) {
+    resultadoBajada(c, false);
+    publicarEstadoComando(c, "fallido", nullptr);
+  }
+
+  ComandoLoRa* p = comandos.proximoEnvio(millis());
+  if (!p) return;
+  uint8_t buf[TRAMA_LARGO_MAX];
+  size_t n = tramaCodificarTexto(TRAMA_TIPO_COMANDO, p->nodo, p->seq, p->texto, p->largo, buf, sizeof(buf));
+  // Con TDMA sólo en la ventana de contención: fuera de ella pisaría un slot
+  uint32_t aire = (uint32_t)ceilf(tiempoEnAireMs(radioPorDefecto(LORA_SF), (uint8_t)n));
+  if ((int32_t)(millis() - libreDesdeMs) < 0 || !tdma.enContencion(millis(), aire + RESPUESTA_MS)) return;
+  if (!receptor.transmitir(buf, (uint8_t)n)) return;   // cola de salida llena: en la próxima vuelta
+  libreDesdeMs = millis() + aire + RESPUESTA_MS;
+  comandos.marcarEnviado(p, millis());
+  Serial.printf(" LoRa comando: nodo %u seq %u intento %u: %s\n", p->nodo, p->seq, p->intentos, p->texto);
+}
+
+// Baliza del superciclo TDMA cuando toca
+void atenderTdma() {
+  uint8_t buf[TRAMA_LARGO_BALIZA];
+  size_t n = tdma.baliza(millis(), buf, sizeof(buf));
+  if (!n) return;
+  if (!receptor.transmitir(buf, (uint8_t)n)) {
+    Serial.println(" TDMA: cola de salida llena, baliza perdida");
+  }
+}
+
+bool encolarComando(long nodo, const String& texto) {
+  const ComandoLoRa* c = nullptr;
+  if (nodo > 0 && nodo < 255) c = comandos.encolar((uint8_t)nodo, texto.c_str(), texto.length(), millis());
+  if (c) {
+    publicarEstadoComando(*c, "encolado", nullptr);
+    return true;
+  }
+  // Nodo inválido, texto vacío o largo, o cola llena
+  ComandoLoRa r;
+  memset(&r, 0, sizeof(r));
+  r.nodo = (uint8_t)constrain(nodo, 0L, 255L);
+  r.largo = (uint8_t)min(texto.length(), (unsigned int)COMANDO_LARGO_MAX);
+  memcpy(r.texto, texto.c_str(), r.largo);
+  publicarEstadoComando(r, "rechazado", nullptr);
+  return false;
+}
 
-    publicarEstadoMQTT();
+void ajustarRadio(uint8_t nodo, const EnlaceNodo& enlace) {
+  char texto[COMANDO_LARGO_MAX + 1];
+  if (!adr.evaluar(nodo, enlace, texto, sizeof(texto))) return;
+  Serial.printf(" ADR: nodo %u, SNR %.1f dB -> %s\n", nodo, enlace.snr(), texto);
+  if (!encolarComando(nodo, String(texto))) adr.cancelado(nodo);
+}
+
+void asignarSlot(uint8_t nodo) {
+  char texto[COMANDO_LARGO_MAX + 1];
+  if (!tdma.evaluar(nodo, millis(), texto, sizeof(texto))) return;
+  Serial.printf(" TDMA: nodo %u -> %s\n", nodo, texto);
+  if (!encolarComando(nodo, String(texto))) tdma.cancelado(nodo);
+}
+
+// Cualquier bajada entregada renueva el ajuste del nodo; la de un RADIO:
+// del ADR además fija la potencia nueva
+void resultadoBajada(const ComandoLoRa& c, bool entregado) {
+  if (entregado) adr.alRecibirBajada(c.nodo);
+  if (strncmp(c.texto, "SLOT:", 5) == 0) tdma.enviado(c.nodo, entregado);
+  if (strncmp(c.texto, "RADIO:", 6) != 0) return;
+  EstadoNodo* e = nodos.buscar(c.nodo);
+  if (e) adr.enviado(c.nodo, entregado, e->enlace);
+  else adr.cancelado(c.nodo);
+}
+
+// Sin broker el estado se pierde; el comando sigue su curso igual
+void publicarEstadoComando(const ComandoLoRa& c, const char* estado, const char* respuesta) {
+  if (!conexion.conectado()) return;
+
+  char payload[192];
+  EscritorJson json(payload, sizeof(payload));
+  json.abrirObjeto();
+  json.texto("gatewayId", gateway_id);
+  json.natural("timestamp", millis());
+  json.natural("nodoId", c.nodo);
+  if (strcmp(estado, "rechazado") != 0) json.natural("seq", c.seq);
+  if (c.largo) json.texto("comando", c.texto);
+  json.texto("estado", estado);
+  if (c.intentos) {
+    json.natural("intentos", c.intentos);
+    json.natural("latenciaMs", millis() - c.encoladoMs);
   }
+  if (respuesta) json.texto("respuesta", respuesta);
+  json.cerrarObjeto();
+  if (!json.ok()) return;
+
+  if (!client.beginPublish(topic_comandos, json.largo(), false)) return;
+  client.write((const uint8_t*)json.c_str(), json.largo());
+  client.endPublish();
 }
 
 // ==============================
 // MQTT
 // ==============================
+// Cada comando de gas/control valida su argumento y, con aplicar, lo
+// aplica. Los de configuración van en COMANDO_EN_LOTE.
+
+// El número tiene que ocupar todo el argumento: "5xyz" o "" son
+// inválidos, no 5 y 0
+bool leerDecimal(const char* arg, float& valor) {
+  char* fin;
+  valor = strtof(arg, &fin);
+  return fin != arg && !*fin;
+}
+
+bool leerEntero(const char* arg, long& valor) {
+  char* fin;
+  valor = strtol(arg, &fin, 10);
+  return fin != arg && !*fin;
+}
+
+ResultadoComando comandoParada(const char* arg, bool aplicar) {
+  if (*arg) return COMANDO_INVALIDO;
+  if (aplicar) detenerPorEmergencia();
+  return COMANDO_OK;
+}
+
+ResultadoComando comandoExtractorOn(const char* arg, bool aplicar) {
+  if (*arg) return COMANDO_INVALIDO;
+  if (!aplicar) return COMANDO_OK;
+  modoAutomatico = false;
+  paradaActiva = false;
+  alarmaPendiente = true;
+  extractor.encender(80);
+  return COMANDO_OK;
+}
+
+// Con la alarma el banco ignora el apagado: se avisa en vez de responder ok
+ResultadoComando comandoExtractorOff(const char* arg, bool aplicar) {
+  if (*arg) return COMANDO_INVALIDO;
+  if (extractor.anulacionActiva()) return COMANDO_ALARMA_ACTIVA;
+  if (!aplicar) return COMANDO_OK;
+  modoAutomatico = false;
+  extractor.apagar();
+  return COMANDO_OK;
+}
+
+ResultadoComando comandoModoAuto(const char* arg, bool aplicar) {
+  if (*arg) return COMANDO_INVALIDO;
+  if (!aplicar) return COMANDO_OK;
+  modoAutomatico = true;
+  if (paradaActiva) {
+    paradaActiva = false;
+    alarmaPendiente = true;
+    if (alarmaActiva) extractor.forzarMaximo();
+  }
+  return COMANDO_OK;
+}
+
+// Comando para un nodo sensor: nodo:<id>:<comando>, p. ej. nodo:1:THRESHOLD:600
+ResultadoComando comandoNodo(const char* arg, bool aplicar) {
+  if (!aplicar) return COMANDO_OK;
+  const char* sep = strchr(arg, ':');
+  bool conId = sep && sep > arg;
+  return encolarComando(conId ? atol(arg) : 0, conId ? String(sep + 1) : String()) ? COMANDO_OK : COMANDO_INVALIDO;
+}
+
+ResultadoComando comandoAdr(const char* arg, bool aplicar) {
+  long activo;
+  if (!leerEntero(arg, activo)) return COMANDO_INVALIDO;
+  if (!aplicar) return COMANDO_OK;
+  adr.habilitar(activo != 0);
+  Serial.println(adr.activo() ? " ADR activado" : " ADR desactivado");
+  guardarConfiguracion();
+  return COMANDO_OK;
+}
+
+ResultadoComando comandoTdma(const char* arg, bool aplicar) {
+  long activo;
+  if (!leerEntero(arg, activo)) return COMANDO_INVALIDO;
+  if (!aplicar) return COMANDO_OK;
+  tdma.habilitar(activo != 0);
+  Serial.println(tdma.activo() ? " TDMA activado" : " TDMA desactivado");
+  guardarConfiguracion();
+  return COMANDO_OK;
+}
+
+// set_rampa:<% por segundo>[:suave]
+ResultadoComando comandoRampa(const char* arg, bool aplicar) {
+  char* fin;
+  float nueva = strtof(arg, &fin);
+  bool suave = strcmp(fin, ":suave") == 0;
+  if (fin == arg || (*fin && !suave) || nueva < 0.5 || nueva > 1000) return COMANDO_INVALIDO;
+  if (!aplicar) return COMANDO_OK;
+  pendienteRampa = nueva;
+  rampaSuave = suave;
+  extractor.configurarPendiente(pendienteRampa, rampaSuave ? CURVA_SUAVE : CURVA_LINEAL);
+  Serial.printf(" Rampa: %.2f %%/s%s\n", pendienteRampa, rampaSuave ? " suave" : "");
+  guardarConfiguracion();
+  return COMANDO_OK;
+}
+
+// set_pi:<kp>:<ki>[:<kd>]
+ResultadoComando comandoPi(const char* arg, bool aplicar) {
+  float kp, ki, kd = 0;
+  int usado = 0;
+  if (sscanf(arg, "%f:%f%n:%f%n", &kp, &ki, &usado, &kd, &usado) < 2 || arg[usado] ||
+      kp < 0 || ki < 0 || kd < 0) return COMANDO_INVALIDO;
+  if (!aplicar) return COMANDO_OK;
+  regulador.configurarGanancias(kp, ki, kd);
+  Serial.printf(" PI: kp %.3f ki %.4f kd %.3f\n", kp, ki, kd);
+  guardarConfiguracion();
+  return COMANDO_OK;
+}
+
+ResultadoComando comandoConsigna(const char* arg, bool aplicar) {
+  float nueva;
+  if (!leerDecimal(arg, nueva) || nueva < 10 || nueva > 100) return COMANDO_INVALIDO;
+  if (!aplicar) return COMANDO_OK;
+  consignaPct = nueva;
+  Serial.printf(" Consigna: %.2f%% del umbral\n", consignaPct);
+  guardarConfiguracion();
+  return COMANDO_OK;
+}
+
+ResultadoComando comandoHorizonte(const char* arg, bool aplicar) {
+  float nuevo;
+  if (!leerDecimal(arg, nuevo) || nuevo < 0 || nuevo > 600) return COMANDO_INVALIDO;
+  if (!aplicar) return COMANDO_OK;
+  horizonteS = nuevo;
+  Serial.printf(" Horizonte de anticipacion: %.2f s\n", horizonteS);
+  guardarConfiguracion();
+  return COMANDO_OK;
+}
+
+// set_ventilador:<min %>:<max %>:<histeresis %>, los campos de UmbralesManager
+ResultadoComando comandoVentilador(const char* arg, bool aplicar) {
+  int minimo, maximo, histeresis;
+  int usado = 0;
+  if (sscanf(arg, "%d:%d:%d%n", &minimo, &maximo, &histeresis, &usado) != 3 || arg[usado] ||
+      minimo < 0 || minimo > maximo ||
+      maximo > 100 || histeresis < 0 || histeresis > 50) return COMANDO_INVALIDO;
+  if (!aplicar) return COMANDO_OK;
+  regulador.configurarLimites(minimo, maximo, histeresis);
+  Serial.printf(" Ventilador: %d-%d%%, histeresis %d%%\n", minimo, maximo, histeresis);
+  guardarConfiguracion();
+  return COMANDO_OK;
+}
+
+ResultadoComando comandoParadaPpm(const char* arg, bool aplicar) {
+  long nuevo;
+  if (!leerEntero(arg, nuevo) || nuevo < 0 || nuevo >= 10000) return COMANDO_INVALIDO;
+  if (!aplicar) return COMANDO_OK;
+  ppmParada = nuevo;
+  Serial.printf(" Limite de parada: %.2f\n", ppmParada);
+  guardarConfiguracion();
+  return COMANDO_OK;
+}
+
+ResultadoComando comandoUmbral(const char* arg, bool aplicar) {
+  long nuevo;
+  if (!leerEntero(arg, nuevo) || nuevo <= 0 || nuevo >= 5000) return COMANDO_INVALIDO;
+  if (!aplicar) return COMANDO_OK;
+  umbralGas = nuevo;
+  Serial.printf(" Nuevo umbral: %.2f\n", umbralGas);
+  guardarConfiguracion();
+  return COMANDO_OK;
+}
+
+ResultadoComando comandoSsid(const char* arg, bool aplicar) {
+  if (!aplicar) return COMANDO_OK;
+  snprintf(ssid, sizeof(ssid), "%s", arg);
+  guardarConfiguracion();
+  Serial.println("SSID guardado");
+  return COMANDO_OK;
+}
+
+ResultadoComando comandoPass(const char* arg, bool aplicar) {
+  if (!aplicar) return COMANDO_OK;
+  snprintf(password, sizeof(password), "%s", arg);
+  guardarConfiguracion();
+  Serial.println("Password guardada");
+  return COMANDO_OK;
+}
+
+ResultadoComando comandoVelocidad(const char* arg, bool aplicar) {
+  long v;
+  if (!leerEntero(arg, v) || v < 0 || v > 100) return COMANDO_INVALIDO;
+  if (extractor.anulacionActiva()) return COMANDO_ALARMA_ACTIVA;
+  if (!aplicar) return COMANDO_OK;
+  extractor.establecerVelocidad(v);
+  Serial.println("Velocidad Objetivo guardada");
+  return COMANDO_OK;
+}
+
+// Nombre hasta el primer ':'. El hash de cada nombre se calcula al compilar.
+constexpr ComandoMqtt COMANDOS_MQTT[] = {
+  { "parada_emergencia", 0, comandoParada },
+  { "extractor_on",      0, comandoExtractorOn },
+  { "extractor_off",     0, comandoExtractorOff },
+  { "modo_auto_on",      0, comandoModoAuto },
+  { "nodo",              0, comandoNodo },
+  { "set_adr",        COMANDO_EN_LOTE, comandoAdr },
+  { "set_tdma",       COMANDO_EN_LOTE, comandoTdma },
+  { "set_rampa",      COMANDO_EN_LOTE, comandoRampa },
+  { "set_pi",         COMANDO_EN_LOTE, comandoPi },
+  { "set_consigna",   COMANDO_EN_LOTE, comandoConsigna },
+  { "set_horizonte",  COMANDO_EN_LOTE, comandoHorizonte },
+  { "set_ventilador", COMANDO_EN_LOTE, comandoVentilador },
+  { "set_parada",     COMANDO_EN_LOTE, comandoParadaPpm },
+  { "set_umbral",     COMANDO_EN_LOTE, comandoUmbral },
+  { "set_ssid",       COMANDO_EN_LOTE, comandoSsid },
+  { "set_pass",       COMANDO_EN_LOTE, comandoPass },
+  { "set_velObj",     COMANDO_EN_LOTE, comandoVelocidad },
+};
+const size_t CANTIDAD_COMANDOS = sizeof(COMANDOS_MQTT) / sizeof(COMANDOS_MQTT[0]);
+static_assert(hashesUnicos(COMANDOS_MQTT, CANTIDAD_COMANDOS), "dos comandos MQTT con el mismo hash");
+DespachoComandos despacho(COMANDOS_MQTT, CANTIDAD_COMANDOS);
+
 void callbackMQTT(char* topic, byte* payload, unsigned int length) {
-  String msg;
-  for (unsigned int i = 0; i < length; i++) msg += (char)payload[i];
-  Serial.println(" Comando MQTT: " + msg);
-
-  if (msg == "extractor_on") {
-    modoAutomatico = false;
-    extractor.encender(80);
-  } else if (msg == "extractor_off") {
-    modoAutomatico = false;
-    extractor.apagar();
-  } else if (msg == "modo_auto_on") {
-    modoAutomatico = true;
-  } else if (msg.startsWith("set_umbral:")) {
-    int nuevo = msg.substring(11).toInt();
-    if (nuevo > 0 && nuevo < 5000) {
-      umbralGas = nuevo;
-      Serial.println(" Nuevo umbral: " + String(umbralGas));
-      guardarConfiguracion();
+  (void)topic;    // sólo hay suscripción a gas/control
+  // Copia terminada en '\0' para los argumentos y el lector del lote
+  char texto[COMANDO_MQTT_MAX + 1];
+  if (length > COMANDO_MQTT_MAX) {
+    Serial.printf(" Comando MQTT de %u bytes, descartado\n", length);
+    publicarResultado(nullptr, nullptr, COMANDO_INVALIDO, -1);
+    return;
+  }
+  memcpy(texto, payload, length);
+  texto[length] = '\0';
+  Serial.printf(" Comando MQTT: %s\n", texto);
+
+  if (texto[0] == '{') {
+    // Lote: todos o ninguno, y una sola escritura en NVS
+    LoteComandos lote;
+    if (!leerLote(texto, length, lote)) {
+      publicarResultado(&lote, nullptr, COMANDO_LOTE_INVALIDO, -1);
+      return;
     }
-  } else if (msg.startsWith("set_ssid:")) {
-    String nuevoSSID = msg.substring(9);
-    nuevoSSID.toCharArray(ssid, sizeof(ssid));
-    guardarConfiguracion();
-    Serial.println("SSID guardado");
-  } else if (msg.startsWith("set_pass:")) {
-    String nuevoPass = msg.substring(9);
-    nuevoPass.toCharArray(password, sizeof(password));
-    guardarConfiguracion();
-    Serial.println("Password guardada");
-  } else if (msg.startsWith("set_velObj:")) {
-    uint8_t v = msg.substring(11).toInt();
-    extractor.establecerVelocidad(v);
-    guardarConfiguracion();
-    Serial.println("Velocidad Objetivo guardada");
-  } else {
-    Serial.println(" Comando desconocido: " + msg);
+    uint8_t fallido = 0;
+    ResultadoComando r = despacho.ejecutarLote(lote, fallido);
+    if (r == COMANDO_OK) {
+      persistirConfiguracion(true);
+      publicarResultado(&lote, nullptr, r, -1);
+    } else {
+      Serial.printf(" Lote rechazado: %s (%s)\n", lote.textos[fallido], textoResultado(r));
+      publicarResultado(&lote, lote.textos[fallido], r, fallido);
+    }
+    return;
   }
 
+  ResultadoComando r = despacho.ejecutar(texto);
+  if (r == COMANDO_DESCONOCIDO) Serial.printf(" Comando desconocido: %s\n", texto);
+  publicarResultado(nullptr, texto, r, -1);
 }
 
-void reconectarMQTT() {
-  while (!client.connected()) {
-    Serial.print("Conectando a MQTT...");
-    if (client.connect("esp32-central")) {
-      Serial.println(" ok");
-      client.subscribe("topic_config");
-    } else {
-      Serial.print("  (rc=");
-      Serial.print(client.state());
-      Serial.println(")");
-      delay(2000);
+// Resultado de cada mensaje de gas/control en topic_resultado. Un lote
+// informa su id y cuántos comandos aplicó, o cuál falló.
+void publicarResultado(const LoteComandos* lote, const char* comando, ResultadoComando r, int indice) {
+  if (!conexion.conectado()) return;
+
+  char payload[COMANDO_MQTT_MAX + 96];
+  EscritorJson json(payload, sizeof(payload));
+  json.abrirObjeto();
+  json.texto("gatewayId", gateway_id);
+  json.natural("timestamp", millis());
+  if (lote && lote->id[0]) json.texto("id", lote->id);
+  if (comando) json.texto("comando", comando);
+  json.texto("resultado", textoResultado(r));
+  if (lote && r == COMANDO_OK) json.natural("aplicados", lote->cantidad);
+  if (indice >= 0) json.natural("indice", indice);
+  json.cerrarObjeto();
+  if (!json.ok()) return;
+
+  if (!client.beginPublish(topic_resultado, json.largo(), false)) return;
+  client.write((const uint8_t*)json.c_str(), json.largo());
+  client.endPublish();
+}
+
+void alConectarMQTT() {
+  client.subscribe(topic_config);
+  alarmaPendiente = true;   // el retenido del broker puede ser de antes de un reinicio
+}
+
+// Estado de alarma en topic_alarma, retenido: quien se suscribe lo recibe
+// al instante. PubSubClient sólo publica con QoS 0, así que la entrega se
+// asegura desde acá: el estado queda pendiente hasta que el publish sale y
+// se vuelve a publicar en cada reconexión.
+void publicarAlarma() {
+  if (!alarmaPendiente || !conexion.conectado()) return;
+
+  char payload[192];
+  EscritorJson json(payload, sizeof(payload));
+  json.abrirObjeto();
+  json.texto("gatewayId", gateway_id);
+  json.natural("timestamp", alarmaCambioMs);
+  json.natural("arranque", arranque);
+  json.booleano("alarma", alarmaActiva);
+  json.natural("nodoId", alarmaNodo);
+  json.decimal("ppm", alarmaPpm, 1);
+  json.decimal("umbral", umbralGas, 2);
+  json.booleano("parada", paradaActiva);
+  json.entero("pwm", extractor.obtenerPWM());
+  json.cerrarObjeto();
+
+  if (!client.beginPublish(topic_alarma, json.largo(), true)) return;
+  client.write((const uint8_t*)json.c_str(), json.largo());
+  if (!client.endPublish()) return;
+  alarmaPendiente = false;
+  Serial.println(" MQTT alarma: " + String(json.c_str()));
+}
+
+// Contadores del período por nodo, RSSI y SNR promedio. Un nodo vuelve a
+// cero cuando su mensaje sale; sin broker el período se alarga.
+void publicarEnlace() {
+  static uint32_t desdeMs = 0;
+  uint32_t ahora = millis();
+  if (ahora - desdeMs < REPORTE_ENLACE_MS || !conexion.conectado()) return;
+
+  static char payload[1024];   // ~130 bytes por nodo
+  uint8_t i = 0;
+  while (i < nodos.cantidad()) {
+    EscritorJson json(payload, sizeof(payload));
+    json.abrirObjeto();
+    json.texto("gatewayId", gateway_id);
+    json.natural("timestamp", ahora);
+    json.natural("periodoMs", ahora - desdeMs);
+    json.abrirObjeto("nodos");
+    uint8_t desde = i, incluidos = 0;
+    for (; i < nodos.cantidad() && incluidos < ENLACE_POR_MENSAJE; i++) {
+      const EstadoNodo& e = nodos.enPosicion(i);
+      if (!e.enlace.huboTrafico()) continue;
+      char clave[4];
+      snprintf(clave, sizeof(clave), "%u", e.nodo);
+      json.abrirObjeto(clave);
+      json.natural("recibidas", e.enlace.recibidas);
+      json.natural("perdidas", e.enlace.perdidas);
+      json.decimal("perdidasPct", e.enlace.porcentajePerdidas(), 1);
+      json.natural("duplicadas", e.enlace.duplicadas);
+      json.natural("atrasadas", e.enlace.atrasadas);
+      json.natural("reinicios", e.enlace.reinicios);
+      json.decimal("rssi", e.enlace.rssi(), 1);
+      json.decimal("snr", e.enlace.snr(), 1);
+      json.entero("potencia", adr.potencia(e.nodo));
+      if (tdma.slot(e.nodo) != PlanTdma::SIN_SLOT) json.natural("slot", tdma.slot(e.nodo));
+      json.cerrarObjeto();
+      incluidos++;
     }
+    json.cerrarObjeto();
+    json.cerrarObjeto();
+    if (!incluidos || !json.ok()) continue;
+
+    if (!client.beginPublish(topic_enlace, json.largo(), false)) return;
+    client.write((const uint8_t*)json.c_str(), json.largo());
+    if (!client.endPublish()) return;
+    for (uint8_t j = desde; j < i; j++) nodos.enPosicion(j).enlace.cerrarPeriodo();
   }
+  desdeMs = ahora;
+  Serial.printf(" Enlace: %lu duplicadas, %lu atrasadas, %lu repeticiones de alarma\n",
+                (unsigned long)tramasDuplicadas, (unsigned long)tramasAtrasadas,
+                (unsigned long)alarmasRepetidas);
 }
 
 // ==============================
 // Publicar estado
 // ==============================
-void publicarEstadoMQTT() {
-  String payload = "{";
-  payload += "\"gatewayId\":\"esp32-central-001\",";
-  payload += "\"timestamp\":" + String(millis()) + ",";
-  payload += "\"sensor\":{";
-  payload += "\"ppm\":" + String(ultimaPPM, 1) + ",";
-  payload += "\"ratio\":" + String(ultimaRatio, 2) + ",";
-  payload += "\"raw\":" + String(ultimoRaw) + ",";
-  payload += "\"estado\":\"" + ultimoEstado + "\",";
-  payload += "\"umbral\":" + String(umbralGas);
-  payload += "},";
-  payload += "\"control\":{";
-  payload += "\"automatico\":" + String(modoAutomatico ? "true" : "false") + ",";
-  payload += "\"encendido\":" + String(extractor.estaEncendido() ? "true" : "false") + ",";
-  payload += "\"transicion\":" + String(extractor.estaEnTransicion() ? "true" : "false") + ",";
-  payload += "\"velocidad\":" + String(extractor.obtenerVelocidadActual());
-  payload += "},";
-  payload += "\"estadoVentilador\":\"" + extractor.obtenerEstadoCompleto() + "\"";
-  payload += "}";
-
-  client.publish("topic_envio", payload.c_str());
-  Serial.println(" MQTT publicado:");
-  Serial.println(payload);
+// Foto del nodo y del extractor al momento de la lectura: si el mensaje sale
+// más tarde desde el spool, conserva la hora y el estado originales
+RegistroTelemetria capturarRegistro(const EstadoNodo& nodo, uint32_t ahora) {
+  RegistroTelemetria r;
+  memset(&r, 0, sizeof(r));
+  r.tomadoMs = ahora;
+  r.ppm = nodo.ppm;
+  r.ratio = nodo.ratio;
+  r.umbral = umbralGas;
+  r.raw = nodo.raw;
+  r.seq = nodo.seq;
+  r.arranque = arranque;
+  r.rssi = nodo.rssi;
+  r.snrCuartos = nodo.snrCuartos;
+  r.nodo = nodo.nodo;
+  r.flags = nodo.flags;
+  if (nodo.alarma) r.estado |= REGISTRO_ALARMA;
+  if (modoAutomatico) r.estado |= REGISTRO_AUTOMATICO;
+  if (extractor.estaEncendido()) r.estado |= REGISTRO_ENCENDIDO;
+  if (extractor.estaEnTransicion()) r.estado |= REGISTRO_TRANSICION;
+  if (anticipando) r.estado |= REGISTRO_ANTICIPANDO;
+  r.velocidad = extractor.obtenerVelocidadActual();
+  r.objetivo = extractor.obtenerVelocidadObjetivo();
+  return r;
+}
+
+bool publicarRegistro(const RegistroTelemetria& r, bool diferido) {
+  if (!conexion.conectado()) return false;
+
+  // Buffer estático: el mensaje completo ocupa ~350 bytes
+  static char payload[512];
+  EscritorJson json(payload, sizeof(payload));
+
+  json.abrirObjeto();
+  json.texto("gatewayId", gateway_id);
+  json.natural("timestamp", r.tomadoMs);
+  json.natural("arranque", r.arranque);
+  if (diferido) json.booleano("diferido", true);
+  json.natural("nodoId", r.nodo);
+
+  json.abrirObjeto("sensor");
+  json.decimal("ppm", r.ppm, 1);
+  json.decimal("ratio", r.ratio, 2);
+  json.entero("raw", r.raw);
+  json.texto("estado", (r.estado & REGISTRO_ALARMA) ? "ALERTA" : "NORMAL");
+  json.decimal("umbral", r.umbral, 2);
+  json.entero("rssi", r.rssi);
+  json.decimal("snr", r.snr(), 2);
+  if (r.flags & TRAMA_FLAG_CALIBRANDO) json.entero("calibracion", tramaProgresoCalibracion(r.flags));
+  if (r.flags & TRAMA_FLAG_SIN_RO) json.booleano("calibrado", false);
+  if (r.flags & TRAMA_FLAG_PRECALENTANDO) json.booleano("precalentando", true);
+  json.cerrarObjeto();
+
+  json.abrirObjeto("control");
+  json.booleano("automatico", r.estado & REGISTRO_AUTOMATICO);
+  json.booleano("encendido", r.estado & REGISTRO_ENCENDIDO);
+  json.booleano("transicion", r.estado & REGISTRO_TRANSICION);
+  json.booleano("anticipando", r.estado & REGISTRO_ANTICIPANDO);
+  json.entero("velocidad", r.velocidad);
+  json.cerrarObjeto();
+
+  json.abrirObjeto("actuador");
+  json.entero("pin", extractor.obtenerPin());
+  json.entero("velocidad", r.velocidad);
+  json.entero("objetivo", r.objetivo);
+  json.entero("pwm_max", extractor.obtenerPWM());
+#ifdef PINES_EXTRACTORES
+  json.natural("extractores", extractor.cantidad());
+  json.natural("en_marcha", extractor.enMarcha());
+#endif
+  json.booleano("encendido", r.estado & REGISTRO_ENCENDIDO);
+  json.booleano("transicion", r.estado & REGISTRO_TRANSICION);
+  json.cerrarObjeto();
+
+  json.cerrarObjeto();
+
+  if (!json.ok()) {
+    // Reintentarlo no lo haría entrar: se da por publicado
+    Serial.println(" MQTT: payload excede el buffer, no se publica");
+    return true;
+  }
+
+  // Publicación en streaming: el buffer va directo al socket sin copia
+  // intermedia ni límite de MQTT_MAX_PACKET_SIZE
+  if (!client.beginPublish(topic_envio, json.largo(), false)) return false;
+  client.write((const uint8_t*)json.c_str(), json.largo());
+  if (!client.endPublish()) return false;
+
+  if (!diferido) {
+    Serial.println(" MQTT publicado:");
+    Serial.println(json.c_str());
+  }
+  return true;
+}
+
+// Vacía el spool a ritmo fijo para no inundar al broker al reconectar
+void drenarSpool() {
+  static unsigned long ultimoDrenaje = 0;
+  if (!conexion.conectado() || !spool.pendientes()) return;
+  if (millis() - ultimoDrenaje < DRENAJE_INTERVALO_MS) return;
+  ultimoDrenaje = millis();
+
+  RegistroTelemetria lote[DRENAJE_LOTE];
+  size_t n = spool.leer(lote, DRENAJE_LOTE);
+  size_t enviados = 0;
+  while (enviados < n && publicarRegistro(lote[enviados], true)) enviados++;
+  spool.confirmar(enviados);
+
+  if (!spool.pendientes()) {
+    Serial.printf(" Spool drenado (%lu descartados por falta de espacio)\n",
+                  (unsigned long)spool.descartados());
+  }
 }
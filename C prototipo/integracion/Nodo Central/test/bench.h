@@ -0,0 +1,55 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <ArduinoNativo.h>
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+
+//=============================================
+// Microbenchmarks en el host (pio test -e native_bench)
+//=============================================
+// Tiempo del host, no el reloj virtual: millis()/micros() no avanzan solos.
+// Las reservas son las de new/delete contadas por ArduinoNativo. Los números
+// sirven para comparar caminos en la misma máquina, no como tiempos del
+// ESP32.
+
+struct Medicion {
+  double ns;            // por llamada, la mejor de las rondas
+  double reservas;      // por llamada
+};
+
+// Mejor de 5 rondas de "llamadas" llamadas a f(i). preparar() corre antes
+// de cada ronda, fuera de la medición.
+template <class P, class F>
+Medicion medir(uint32_t llamadas, P preparar, F f) {
+  Medicion m = { 1e30, 0 };
+  for (int ronda = 0; ronda < 5; ronda++) {
+    preparar();
+    uint64_t reservas = nativoMemoria().reservas;
+    auto inicio = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < llamadas; i++) f(i);
+    auto fin = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(fin - inicio).count() / llamadas;
+    if (ns < m.ns) m.ns = ns;
+    m.reservas = (double)(nativoMemoria().reservas - reservas) / llamadas;
+  }
+  return m;
+}
+
+template <class F>
+Medicion medir(uint32_t llamadas, F f) {
+  return medir(llamadas, [] {}, f);
+}
+
+inline void informar(const char* nombre, const Medicion& m) {
+  printf("  %-44s %9.1f ns %7.2f reservas\n", nombre, m.ns, m.reservas);
+}
+
+// Evita que el compilador descarte un resultado que nadie usa
+template <class T>
+inline void consumir(const T& v) {
+  asm volatile("" : : "g"(&v) : "memory");
+}
+
+#endif
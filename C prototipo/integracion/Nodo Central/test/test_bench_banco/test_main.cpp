@@ -0,0 +1,80 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <vector>
+#include "BancoVentiladores.h"
+#include "ControlVentilador.h"
+#include "../bench.h"
+
+//=============================================
+// Costo de actualizar() del banco de extractores
+//=============================================
+// pio test -e native_bench -f test_bench_banco
+//
+// Un tick es 1 ms de reloj virtual y un actualizar(). Se compara el banco con
+// N ControlVentilador independientes, con todas las rampas en curso (0 a
+// 100% a 40 %/s dura 2.5 s, más que una ronda) y con todo quieto. Al
+// resultado se le resta el tick vacío, que sólo avanza el reloj.
+
+static const uint32_t TICKS = 2000;
+
+void setUp() {}
+void tearDown() {}
+
+static void tick() {
+  nativoAvanzar(1000);
+}
+
+void test_bench_actualizar() {
+  nativoSilenciarSerial(true);
+  Medicion vacio = medir(TICKS, [](uint32_t) { tick(); });
+
+  printf("\n  tick vacío: %.1f ns\n", vacio.ns);
+  printf("    N   banco rampa  banco quieto   N x ControlVentilador rampa / quieto\n");
+  const uint8_t cantidades[] = { 1, 2, 4, 8, 16, 32 };
+  for (uint8_t n : cantidades) {
+    uint8_t pines[32];
+    for (uint8_t i = 0; i < n; i++) pines[i] = 2 + i;
+
+    BancoVentiladores banco(pines, n, 100);
+    banco.inicializar();
+    banco.configurarEscalon(0);
+    banco.configurarPendiente(40);
+
+    std::vector<ControlVentilador*> sueltos;
+    for (uint8_t i = 0; i < n; i++) {
+      sueltos.push_back(new ControlVentilador(pines[i], 100));
+      sueltos.back()->inicializar();
+      sueltos.back()->configurarPendiente(40);
+    }
+
+    Medicion bancoRampa = medir(TICKS, [&] { banco.paradaEmergencia(); banco.establecerVelocidad(100); },
+                                [&](uint32_t) { tick(); banco.actualizar(); });
+    // La rampa sigue en curso al terminar la ronda
+    int alcanzada = banco.obtenerVelocidadActual();
+    Medicion bancoQuieto = medir(TICKS, [&] { banco.paradaEmergencia(); },
+                                 [&](uint32_t) { tick(); banco.actualizar(); });
+    Medicion sueltosRampa = medir(TICKS,
+                                  [&] { for (ControlVentilador* v : sueltos) { v->paradaEmergencia(); v->establecerVelocidad(100); } },
+                                  [&](uint32_t) { tick(); for (ControlVentilador* v : sueltos) v->actualizar(); });
+    Medicion sueltosQuieto = medir(TICKS, [&] { for (ControlVentilador* v : sueltos) v->paradaEmergencia(); },
+                                   [&](uint32_t) { tick(); for (ControlVentilador* v : sueltos) v->actualizar(); });
+
+    printf("   %2u   %8.1f ns   %8.1f ns      %8.1f ns / %8.1f ns\n", n,
+           bancoRampa.ns - vacio.ns, bancoQuieto.ns - vacio.ns,
+           sueltosRampa.ns - vacio.ns, sueltosQuieto.ns - vacio.ns);
+
+    TEST_ASSERT_GREATER_THAN(0, alcanzada);
+    TEST_ASSERT_LESS_THAN(100, alcanzada);
+    TEST_ASSERT_EQUAL_FLOAT(0, bancoRampa.reservas - vacio.reservas);
+    TEST_ASSERT_EQUAL_FLOAT(0, bancoQuieto.reservas - vacio.reservas);
+
+    for (ControlVentilador* v : sueltos) delete v;
+  }
+  nativoSilenciarSerial(false);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bench_actualizar);
+  return UNITY_END();
+}
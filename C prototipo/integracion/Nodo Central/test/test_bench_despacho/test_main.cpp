@@ -0,0 +1,193 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "DespachoComandos.h"
+#include "../bench.h"
+
+//=============================================
+// Despacho de gas/control: tabla con hash contra la cadena de startsWith()
+//=============================================
+// pio test -e native_bench -f test_bench_despacho
+//
+// Los dos lados tienen los mismos 17 nombres, en el orden de COMANDOS_MQTT,
+// y cuerpos mínimos que sólo leen el argumento. "Anterior" es el
+// callbackMQTT() de antes: un String armado carácter a carácter y una
+// cadena de == y startsWith() con substring().
+
+static const uint32_t LLAMADAS = 200000;
+static const uint8_t CANTIDAD = 17;
+static const unsigned int COMANDO_MQTT_MAX = 240;    // el de main.cpp
+
+static volatile uint32_t atendidos[CANTIDAD + 1];    // el último: desconocido
+static volatile float leido;
+
+void setUp() {}
+void tearDown() {}
+
+static void anterior(const char* payload, unsigned int length) {
+  String msg;
+  for (unsigned int i = 0; i < length; i++) msg += (char)payload[i];
+  if (msg == "parada_emergencia") atendidos[0]++;
+  else if (msg == "extractor_on") atendidos[1]++;
+  else if (msg == "extractor_off") atendidos[2]++;
+  else if (msg == "modo_auto_on") atendidos[3]++;
+  else if (msg.startsWith("nodo:")) { int sep = msg.indexOf(':', 5); leido = sep > 5 ? msg.substring(5, sep).toInt() : 0; atendidos[4]++; }
+  else if (msg.startsWith("set_adr:")) { leido = msg.substring(8).toInt(); atendidos[5]++; }
+  else if (msg.startsWith("set_tdma:")) { leido = msg.substring(9).toInt(); atendidos[6]++; }
+  else if (msg.startsWith("set_rampa:")) { leido = msg.substring(10).toFloat(); atendidos[7]++; }
+  else if (msg.startsWith("set_pi:")) { float a, b, c = 0; sscanf(msg.c_str() + 7, "%f:%f:%f", &a, &b, &c); leido = a; atendidos[8]++; }
+  else if (msg.startsWith("set_consigna:")) { leido = msg.substring(13).toFloat(); atendidos[9]++; }
+  else if (msg.startsWith("set_horizonte:")) { leido = msg.substring(14).toFloat(); atendidos[10]++; }
+  else if (msg.startsWith("set_ventilador:")) { int a, b, c; sscanf(msg.c_str() + 15, "%d:%d:%d", &a, &b, &c); leido = a; atendidos[11]++; }
+  else if (msg.startsWith("set_parada:")) { leido = msg.substring(11).toInt(); atendidos[12]++; }
+  else if (msg.startsWith("set_umbral:")) { leido = msg.substring(11).toInt(); atendidos[13]++; }
+  else if (msg.startsWith("set_ssid:")) { String s = msg.substring(9); leido = s.length(); atendidos[14]++; }
+  else if (msg.startsWith("set_pass:")) { String s = msg.substring(9); leido = s.length(); atendidos[15]++; }
+  else if (msg.startsWith("set_velObj:")) { leido = msg.substring(11).toInt(); atendidos[16]++; }
+  else atendidos[CANTIDAD]++;
+}
+
+// Sólo la búsqueda, sin leer el argumento
+static void anteriorBusqueda(const char* payload, unsigned int length) {
+  static const char* prefijos[] = { "nodo:", "set_adr:", "set_tdma:", "set_rampa:", "set_pi:", "set_consigna:",
+                                    "set_horizonte:", "set_ventilador:", "set_parada:", "set_umbral:",
+                                    "set_ssid:", "set_pass:", "set_velObj:" };
+  String msg;
+  for (unsigned int i = 0; i < length; i++) msg += (char)payload[i];
+  if (msg == "parada_emergencia") { atendidos[0]++; return; }
+  if (msg == "extractor_on") { atendidos[1]++; return; }
+  if (msg == "extractor_off") { atendidos[2]++; return; }
+  if (msg == "modo_auto_on") { atendidos[3]++; return; }
+  for (uint8_t i = 0; i < 13; i++) {
+    if (msg.startsWith(prefijos[i])) { atendidos[4 + i]++; return; }
+  }
+  atendidos[CANTIDAD]++;
+}
+
+#define COMANDO(nombre, indice, cuerpo)                               \
+  static ResultadoComando nombre(const char* arg, bool aplicar) {     \
+    (void)aplicar;                                                    \
+    cuerpo;                                                           \
+    atendidos[indice]++;                                              \
+    return COMANDO_OK;                                                \
+  }
+
+COMANDO(parada, 0, (void)arg)
+COMANDO(extractorOn, 1, (void)arg)
+COMANDO(extractorOff, 2, (void)arg)
+COMANDO(modoAuto, 3, (void)arg)
+COMANDO(nodo, 4, leido = strtol(arg, nullptr, 10))
+COMANDO(adr, 5, leido = strtol(arg, nullptr, 10))
+COMANDO(tdma, 6, leido = strtol(arg, nullptr, 10))
+COMANDO(rampa, 7, leido = strtof(arg, nullptr))
+COMANDO(pi, 8, float a; float b; float c = 0; sscanf(arg, "%f:%f:%f", &a, &b, &c); leido = a)
+COMANDO(consigna, 9, leido = strtof(arg, nullptr))
+COMANDO(horizonte, 10, leido = strtof(arg, nullptr))
+COMANDO(ventilador, 11, int a; int b; int c; sscanf(arg, "%d:%d:%d", &a, &b, &c); leido = a)
+COMANDO(paradaPpm, 12, leido = strtol(arg, nullptr, 10))
+COMANDO(umbral, 13, leido = strtol(arg, nullptr, 10))
+COMANDO(ssid, 14, leido = strlen(arg))
+COMANDO(pass, 15, leido = strlen(arg))
+COMANDO(velocidad, 16, leido = strtol(arg, nullptr, 10))
+
+constexpr ComandoMqtt TABLA[] = {
+  { "parada_emergencia", 0, parada },
+  { "extractor_on",      0, extractorOn },
+  { "extractor_off",     0, extractorOff },
+  { "modo_auto_on",      0, modoAuto },
+  { "nodo",              0, nodo },
+  { "set_adr",        COMANDO_EN_LOTE, adr },
+  { "set_tdma",       COMANDO_EN_LOTE, tdma },
+  { "set_rampa",      COMANDO_EN_LOTE, rampa },
+  { "set_pi",         COMANDO_EN_LOTE, pi },
+  { "set_consigna",   COMANDO_EN_LOTE, consigna },
+  { "set_horizonte",  COMANDO_EN_LOTE, horizonte },
+  { "set_ventilador", COMANDO_EN_LOTE, ventilador },
+  { "set_parada",     COMANDO_EN_LOTE, paradaPpm },
+  { "set_umbral",     COMANDO_EN_LOTE, umbral },
+  { "set_ssid",       COMANDO_EN_LOTE, ssid },
+  { "set_pass",       COMANDO_EN_LOTE, pass },
+  { "set_velObj",     COMANDO_EN_LOTE, velocidad },
+};
+static_assert(sizeof(TABLA) / sizeof(TABLA[0]) == CANTIDAD, "un nombre por índice de atendidos");
+static_assert(hashesUnicos(TABLA, CANTIDAD), "dos comandos con el mismo hash");
+static const DespachoComandos despacho(TABLA, CANTIDAD);
+
+// Copia terminada en '\0', como callbackMQTT()
+static void nuevo(const char* payload, unsigned int length) {
+  char texto[COMANDO_MQTT_MAX + 1];
+  memcpy(texto, payload, length);
+  texto[length] = '\0';
+  if (despacho.ejecutar(texto) == COMANDO_DESCONOCIDO) atendidos[CANTIDAD]++;
+}
+
+static void nuevoBusqueda(const char* payload, unsigned int length) {
+  char texto[COMANDO_MQTT_MAX + 1];
+  memcpy(texto, payload, length);
+  texto[length] = '\0';
+  const char* arg;
+  const ComandoMqtt* c = despacho.buscar(texto, arg);
+  atendidos[c ? c - TABLA : CANTIDAD]++;
+}
+
+// Uno por comando, en el orden de la tabla, y uno desconocido
+static const char* MEZCLA[] = {
+  "parada_emergencia", "extractor_on", "extractor_off", "modo_auto_on", "nodo:1:THRESHOLD:600",
+  "set_adr:1", "set_tdma:0", "set_rampa:20:suave", "set_pi:2:0.05:0", "set_consigna:80", "set_horizonte:60",
+  "set_ventilador:30:90:5", "set_parada:2000", "set_umbral:600", "set_ssid:MiRed", "set_pass:secreto",
+  "set_velObj:55", "desconocido:1",
+};
+static const size_t EN_MEZCLA = sizeof(MEZCLA) / sizeof(MEZCLA[0]);
+static unsigned int largos[EN_MEZCLA];
+
+template <class F>
+static void comprobar(F atender) {
+  for (size_t i = 0; i < EN_MEZCLA; i++) {
+    uint32_t antes = atendidos[i];
+    atender(MEZCLA[i], largos[i]);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(antes + 1, atendidos[i], MEZCLA[i]);
+  }
+}
+
+// Mezcla: cada llamada atiende el siguiente mensaje de MEZCLA
+template <class F>
+static Medicion medirMezcla(F atender) {
+  return medir(LLAMADAS, [&](uint32_t i) { atender(MEZCLA[i % EN_MEZCLA], largos[i % EN_MEZCLA]); });
+}
+
+template <class F>
+static Medicion medirUno(const char* texto, F atender) {
+  unsigned int largo = strlen(texto);
+  return medir(LLAMADAS, [&](uint32_t) { atender(texto, largo); });
+}
+
+void test_bench_despacho() {
+  for (size_t i = 0; i < EN_MEZCLA; i++) largos[i] = strlen(MEZCLA[i]);
+
+  // Los cuatro caminos atienden cada mensaje con el mismo índice
+  comprobar(anterior);
+  comprobar(anteriorBusqueda);
+  comprobar(nuevo);
+  comprobar(nuevoBusqueda);
+
+  printf("\n");
+  informar("mezcla, búsqueda: startsWith (antes)", medirMezcla(anteriorBusqueda));
+  Medicion busqueda = medirMezcla(nuevoBusqueda);
+  informar("mezcla, búsqueda: tabla con hash", busqueda);
+  informar("set_velObj, búsqueda: startsWith (antes)", medirUno("set_velObj:55", anteriorBusqueda));
+  informar("set_velObj, búsqueda: tabla con hash", medirUno("set_velObj:55", nuevoBusqueda));
+  informar("mezcla, con argumento: startsWith (antes)", medirMezcla(anterior));
+  Medicion completo = medirMezcla(nuevo);
+  informar("mezcla, con argumento: tabla con hash", completo);
+
+  TEST_ASSERT_EQUAL_FLOAT(0, busqueda.reservas);
+  TEST_ASSERT_EQUAL_FLOAT(0, completo.reservas);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bench_despacho);
+  return UNITY_END();
+}
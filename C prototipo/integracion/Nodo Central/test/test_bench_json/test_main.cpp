@@ -0,0 +1,133 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <string.h>
+#include "EscritorJson.h"
+#include "../bench.h"
+
+//=============================================
+// Mensaje de gas/datos: EscritorJson contra String
+//=============================================
+// pio test -e native_bench -f test_bench_json
+//
+// El documento tiene la forma del de publicarRegistro(). La versión con
+// String concatena como lo hacía publicarEstadoMQTT() antes del cambio.
+
+static const uint32_t LLAMADAS = 100000;
+
+void setUp() {}
+void tearDown() {}
+
+struct Estado {
+  uint32_t tomadoMs;
+  float ppm, ratio, umbral, snr;
+  int raw, rssi, velocidad, objetivo, pin, pwm;
+  bool automatico, encendido, transicion;
+};
+
+static const Estado ESTADO = { 123456789, 523.4f, 1.23f, 500.0f, 7.25f, 612, -87, 64, 80, 27, 163,
+                               true, true, false };
+
+static size_t conEscritor(const Estado& e, char* buf, size_t cap) {
+  EscritorJson json(buf, cap);
+  json.abrirObjeto();
+  json.texto("gatewayId", "esp32-central-001");
+  json.natural("timestamp", e.tomadoMs);
+  json.natural("nodoId", 7);
+
+  json.abrirObjeto("sensor");
+  json.decimal("ppm", e.ppm, 1);
+  json.decimal("ratio", e.ratio, 2);
+  json.entero("raw", e.raw);
+  json.texto("estado", e.ppm > e.umbral ? "ALERTA" : "NORMAL");
+  json.decimal("umbral", e.umbral, 2);
+  json.entero("rssi", e.rssi);
+  json.decimal("snr", e.snr, 2);
+  json.cerrarObjeto();
+
+  json.abrirObjeto("control");
+  json.booleano("automatico", e.automatico);
+  json.booleano("encendido", e.encendido);
+  json.booleano("transicion", e.transicion);
+  json.entero("velocidad", e.velocidad);
+  json.cerrarObjeto();
+
+  json.abrirObjeto("actuador");
+  json.entero("pin", e.pin);
+  json.entero("velocidad", e.velocidad);
+  json.entero("objetivo", e.objetivo);
+  json.entero("pwm_max", e.pwm);
+  json.booleano("encendido", e.encendido);
+  json.booleano("transicion", e.transicion);
+  json.cerrarObjeto();
+
+  json.cerrarObjeto();
+  return json.ok() ? json.largo() : 0;
+}
+
+static String conString(const Estado& e) {
+  String payload = "{";
+  payload += "\"gatewayId\":\"esp32-central-001\",";
+  payload += "\"timestamp\":" + String((unsigned long)e.tomadoMs) + ",";
+  payload += "\"nodoId\":" + String(7) + ",";
+  payload += "\"sensor\":{";
+  payload += "\"ppm\":" + String(e.ppm, 1) + ",";
+  payload += "\"ratio\":" + String(e.ratio, 2) + ",";
+  payload += "\"raw\":" + String(e.raw) + ",";
+  payload += "\"estado\":\"" + String(e.ppm > e.umbral ? "ALERTA" : "NORMAL") + "\",";
+  payload += "\"umbral\":" + String(e.umbral, 2) + ",";
+  payload += "\"rssi\":" + String(e.rssi) + ",";
+  payload += "\"snr\":" + String(e.snr, 2);
+  payload += "},";
+  payload += "\"control\":{";
+  payload += "\"automatico\":" + String(e.automatico ? "true" : "false") + ",";
+  payload += "\"encendido\":" + String(e.encendido ? "true" : "false") + ",";
+  payload += "\"transicion\":" + String(e.transicion ? "true" : "false") + ",";
+  payload += "\"velocidad\":" + String(e.velocidad);
+  payload += "},";
+  payload += "\"actuador\":{";
+  payload += "\"pin\":" + String(e.pin) + ",";
+  payload += "\"velocidad\":" + String(e.velocidad) + ",";
+  payload += "\"objetivo\":" + String(e.objetivo) + ",";
+  payload += "\"pwm_max\":" + String(e.pwm) + ",";
+  payload += "\"encendido\":" + String(e.encendido ? "true" : "false") + ",";
+  payload += "\"transicion\":" + String(e.transicion ? "true" : "false");
+  payload += "}}";
+  return payload;
+}
+
+void test_bench_mensaje_estado() {
+  static char buf[512];
+  size_t largo = conEscritor(ESTADO, buf, sizeof(buf));
+  TEST_ASSERT_GREATER_THAN(0, largo);
+  String esperado = conString(ESTADO);
+  TEST_ASSERT_EQUAL(esperado.length(), largo);
+  TEST_ASSERT_EQUAL_STRING(esperado.c_str(), buf);
+
+  // Un buffer corto descarta el documento entero, sin escribir de más
+  char corto[64];
+  TEST_ASSERT_EQUAL(0, conEscritor(ESTADO, corto, sizeof(corto)));
+
+  Medicion anterior = medir(LLAMADAS, [&](uint32_t i) {
+    Estado e = ESTADO;
+    e.tomadoMs += i;
+    String s = conString(e);
+    consumir(s);
+  });
+  Medicion escritor = medir(LLAMADAS, [&](uint32_t i) {
+    Estado e = ESTADO;
+    e.tomadoMs += i;
+    consumir(conEscritor(e, buf, sizeof(buf)));
+  });
+
+  printf("\n  documento de %u bytes\n", (unsigned)largo);
+  informar("String concatenado (antes)", anterior);
+  informar("EscritorJson sobre buffer estático", escritor);
+
+  TEST_ASSERT_EQUAL_FLOAT(0, escritor.reservas);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bench_mensaje_estado);
+  return UNITY_END();
+}
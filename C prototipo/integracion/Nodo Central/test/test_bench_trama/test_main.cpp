@@ -0,0 +1,87 @@
+#include <Arduino.h>
+#include <unity.h>
+#include <TramaLoRa.h>
+#include "../bench.h"
+
+//=============================================
+// Camino de recepción: decodificación sin heap
+//=============================================
+// pio test -e native_bench -f test_bench_trama
+//
+// Compara el decodificador ASCII y el binario de TramaLoRa.h con el camino
+// anterior del gateway, que armaba un String carácter a carácter y lo
+// cortaba con indexOf()/substring().
+
+static const char* ASCII = "GAS_DATA|PPM:523.4|Ratio:1.23|Raw:612|Status:ALERTA";
+static const uint32_t LLAMADAS = 200000;
+
+void setUp() {}
+void tearDown() {}
+
+// procesarMensajeLoRa() antes del cambio, con el String de ArduinoNativo
+static bool decodificarAnterior(const uint8_t* buf, size_t largo, LecturaGas& lectura) {
+  String mensaje;
+  for (size_t i = 0; i < largo; i++) mensaje += (char)buf[i];
+  if (!mensaje.startsWith("GAS_DATA|")) return false;
+
+  int p1 = mensaje.indexOf("PPM:") + 4;
+  int p2 = mensaje.indexOf("|Ratio:");
+  lectura.ppm = mensaje.substring(p1, p2).toFloat();
+
+  int p3 = mensaje.indexOf("Ratio:") + 6;
+  int p4 = mensaje.indexOf("|Raw:");
+  lectura.ratio = mensaje.substring(p3, p4).toFloat();
+
+  int p5 = mensaje.indexOf("Raw:") + 4;
+  int p6 = mensaje.indexOf("|Status:");
+  lectura.raw = mensaje.substring(p5, p6).toInt();
+  return true;
+}
+
+void test_bench_decodificacion() {
+  const uint8_t* ascii = (const uint8_t*)ASCII;
+  size_t largoAscii = strlen(ASCII);
+
+  LecturaGas l = { 7, 1, 523.4f, 1.23f, 612, TRAMA_FLAG_ALERTA };
+  uint8_t binaria[TRAMA_LARGO_DATOS];
+  tramaCodificarDatos(l, binaria, sizeof(binaria));
+
+  // Los tres caminos leen lo mismo
+  LecturaGas a = {}, b = {}, c = {};
+  TEST_ASSERT_TRUE(decodificarAnterior(ascii, largoAscii, a));
+  TEST_ASSERT_TRUE(tramaDecodificarAscii(ASCII, largoAscii, b));
+  TEST_ASSERT_TRUE(tramaDecodificarDatos(binaria, sizeof(binaria), c));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, a.ppm, b.ppm);
+  TEST_ASSERT_FLOAT_WITHIN(0.2f, a.ppm, c.ppm);
+  TEST_ASSERT_EQUAL_UINT16(a.raw, b.raw);
+
+  Medicion anterior = medir(LLAMADAS, [&](uint32_t) {
+    LecturaGas r;
+    decodificarAnterior(ascii, largoAscii, r);
+    consumir(r);
+  });
+  Medicion nuevoAscii = medir(LLAMADAS, [&](uint32_t) {
+    LecturaGas r;
+    tramaDecodificarAscii(ASCII, largoAscii, r);
+    consumir(r);
+  });
+  Medicion nuevoBinario = medir(LLAMADAS, [&](uint32_t) {
+    LecturaGas r;
+    tramaDecodificarDatos(binaria, sizeof(binaria), r);
+    consumir(r);
+  });
+
+  printf("\n");
+  informar("ASCII, String + indexOf/substring (antes)", anterior);
+  informar("ASCII, tramaDecodificarAscii", nuevoAscii);
+  informar("binaria, tramaDecodificarDatos", nuevoBinario);
+
+  TEST_ASSERT_EQUAL_FLOAT(0, nuevoAscii.reservas);
+  TEST_ASSERT_EQUAL_FLOAT(0, nuevoBinario.reservas);
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bench_decodificacion);
+  return UNITY_END();
+}
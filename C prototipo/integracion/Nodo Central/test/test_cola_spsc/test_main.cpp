@@ -0,0 +1,155 @@
+#include <unity.h>
+#include <thread>
+#include "ColaSpsc.h"
+
+//=============================================
+// ColaSpsc: casos de borde y un productor y un consumidor en paralelo
+//=============================================
+// pio test -e native -f test_cola_spsc
+//
+// En el ESP32 el productor es la tarea de radio y el consumidor loop(), en
+// núcleos distintos; acá son dos hilos del host. Con -fsanitize=thread
+// también revisa el orden de memoria.
+
+void setUp() {}
+void tearDown() {}
+
+// Elemento de varias palabras: un consumidor que lo viera a medio escribir
+// encontraría las copias distintas de seq
+struct Elemento {
+  uint32_t seq;
+  uint32_t copias[7];
+};
+
+static void llenar(Elemento& e, uint32_t seq) {
+  e.seq = seq;
+  for (uint32_t& c : e.copias) c = seq * 2654435761u;
+}
+
+static bool consistente(const Elemento& e) {
+  for (uint32_t c : e.copias) {
+    if (c != e.seq * 2654435761u) return false;
+  }
+  return true;
+}
+
+void test_vacia() {
+  ColaSpsc<uint32_t, 4> cola;
+  uint32_t v;
+  TEST_ASSERT_NULL(cola.frente());
+  TEST_ASSERT_FALSE(cola.sacar(v));
+  TEST_ASSERT_EQUAL_UINT32(0, cola.ocupados());
+  TEST_ASSERT_EQUAL_UINT32(0, cola.descartados());
+}
+
+// Llena rechaza y cuenta, sin pisar lo encolado
+void test_llena() {
+  ColaSpsc<uint32_t, 4> cola;
+  for (uint32_t i = 0; i < 4; i++) TEST_ASSERT_TRUE(cola.poner(i));
+  TEST_ASSERT_FALSE(cola.poner(99));
+  TEST_ASSERT_NULL(cola.reservar());
+  TEST_ASSERT_EQUAL_UINT32(2, cola.descartados());
+  TEST_ASSERT_EQUAL_UINT32(4, cola.ocupados());
+  TEST_ASSERT_EQUAL_UINT32(4, cola.maximoOcupado());
+
+  uint32_t v;
+  TEST_ASSERT_TRUE(cola.sacar(v));
+  TEST_ASSERT_EQUAL_UINT32(0, v);
+  TEST_ASSERT_TRUE(cola.poner(4));
+  for (uint32_t i = 1; i <= 4; i++) {
+    TEST_ASSERT_TRUE(cola.sacar(v));
+    TEST_ASSERT_EQUAL_UINT32(i, v);
+  }
+  TEST_ASSERT_FALSE(cola.sacar(v));
+  TEST_ASSERT_EQUAL_UINT32(2, cola.descartados());
+}
+
+// Los índices dan muchas vueltas al arreglo con ocupaciones distintas
+void test_vuelta_del_arreglo() {
+  ColaSpsc<uint32_t, 8> cola;
+  uint32_t siguiente = 0, esperado = 0;
+  for (uint32_t vuelta = 0; vuelta < 1000; vuelta++) {
+    uint32_t poner = 1 + vuelta % 8;
+    for (uint32_t i = 0; i < poner; i++) TEST_ASSERT_TRUE(cola.poner(siguiente++));
+    uint32_t sacar = 1 + (vuelta * 5) % poner;
+    for (uint32_t i = 0; i < sacar; i++) {
+      uint32_t v;
+      TEST_ASSERT_TRUE(cola.sacar(v));
+      TEST_ASSERT_EQUAL_UINT32(esperado++, v);
+    }
+    TEST_ASSERT_EQUAL_UINT32(siguiente - esperado, cola.ocupados());
+    // Lo que quedó se drena para que la próxima vuelta entre entera
+    uint32_t v;
+    while (cola.sacar(v)) TEST_ASSERT_EQUAL_UINT32(esperado++, v);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, cola.descartados());
+  TEST_ASSERT_EQUAL_UINT32(8, cola.maximoOcupado());
+}
+
+// reservar()/publicar() y frente()/liberar() trabajan sobre el mismo slot
+void test_en_su_lugar() {
+  ColaSpsc<Elemento, 2> cola;
+  for (uint32_t seq = 0; seq < 5; seq++) {
+    Elemento* e = cola.reservar();
+    TEST_ASSERT_NOT_NULL(e);
+    llenar(*e, seq);
+    TEST_ASSERT_NULL(cola.frente());    // todavía sin publicar
+    cola.publicar();
+
+    Elemento* f = cola.frente();
+    TEST_ASSERT_TRUE(f == e);
+    TEST_ASSERT_EQUAL_UINT32(seq, f->seq);
+    cola.liberar();
+  }
+}
+
+// Dos hilos: todo llega una vez, en orden y completo. La cola chica fuerza
+// muchas vueltas y muchas veces llena o vacía.
+void test_dos_hilos() {
+  ColaSpsc<Elemento, 8> cola;
+  const uint32_t TOTAL = 1000000;
+
+  uint32_t recibidos = 0, fueraDeOrden = 0, rotos = 0;
+  std::thread consumidor([&]() {
+    while (recibidos < TOTAL) {
+      Elemento* e = cola.frente();
+      if (!e) {
+        std::this_thread::yield();
+        continue;
+      }
+      if (e->seq != recibidos) fueraDeOrden++;
+      if (!consistente(*e)) rotos++;
+      recibidos++;
+      cola.liberar();
+    }
+  });
+
+  uint32_t llena = 0;
+  for (uint32_t seq = 0; seq < TOTAL; seq++) {
+    Elemento* e;
+    while (!(e = cola.reservar())) {
+      llena++;
+      std::this_thread::yield();
+    }
+    llenar(*e, seq);
+    cola.publicar();
+  }
+  consumidor.join();
+
+  TEST_ASSERT_EQUAL_UINT32(TOTAL, recibidos);
+  TEST_ASSERT_EQUAL_UINT32(0, fueraDeOrden);
+  TEST_ASSERT_EQUAL_UINT32(0, rotos);
+  TEST_ASSERT_EQUAL_UINT32(0, cola.ocupados());
+  TEST_ASSERT_EQUAL_UINT32(llena, cola.descartados());
+  TEST_ASSERT_LESS_OR_EQUAL(8, cola.maximoOcupado());
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_vacia);
+  RUN_TEST(test_llena);
+  RUN_TEST(test_vuelta_del_arreglo);
+  RUN_TEST(test_en_su_lugar);
+  RUN_TEST(test_dos_hilos);
+  return UNITY_END();
+}
@@ -0,0 +1,229 @@
+#include <unity.h>
+#include <LittleFS.h>
+#include "SpoolTelemetria.h"
+
+//=============================================
+// SpoolTelemetria sobre la partición LittleFS simulada
+//=============================================
+// pio test -e native -f test_spool
+//
+// Los segmentos son archivos del host (FS.h de ArduinoNativo); cada prueba
+// arranca con la partición vacía. Un reinicio es un SpoolTelemetria nuevo
+// sobre los mismos archivos.
+
+static const char* DIRECTORIO = "/spool";
+static const uint32_t POR_SEGMENTO = SPOOL_REGISTROS_POR_SEGMENTO;
+
+void setUp() {
+  LittleFS.begin(true);
+  LittleFS.format();
+}
+
+void tearDown() {}
+
+static RegistroTelemetria registro(uint16_t seq) {
+  RegistroTelemetria r = {};
+  r.tomadoMs = 1000u * seq;
+  r.ppm = 100.0f + seq;
+  r.nodo = 1;
+  r.seq = seq;
+  return r;
+}
+
+static void agregarVarios(SpoolTelemetria& spool, uint16_t desde, uint16_t cantidad) {
+  for (uint16_t i = 0; i < cantidad; i++) {
+    TEST_ASSERT_TRUE(spool.agregar(registro(desde + i), 0));
+  }
+}
+
+// Drena todo de a "tramo" y verifica que las secuencias sigan desde "desde"
+static uint32_t drenarEnOrden(SpoolTelemetria& spool, uint16_t desde, size_t tramo) {
+  RegistroTelemetria buf[32];
+  uint32_t total = 0;
+  for (;;) {
+    size_t n = spool.leer(buf, tramo);
+    if (!n) break;
+    for (size_t i = 0; i < n; i++) {
+      TEST_ASSERT_EQUAL_UINT16((uint16_t)(desde + total + i), buf[i].seq);
+      TEST_ASSERT_EQUAL_UINT16(SpoolTelemetria::calcularCrc(buf[i]), buf[i].crc);
+    }
+    spool.confirmar(n);
+    total += n;
+  }
+  return total;
+}
+
+// Sobrescribe un byte de un segmento en la flash, como un bit dañado
+static void danarByte(uint32_t segmento, size_t posicion) {
+  char ruta[32];
+  snprintf(ruta, sizeof(ruta), "%s/%lu", DIRECTORIO, (unsigned long)segmento);
+  File f = LittleFS.open(ruta, "r+");
+  TEST_ASSERT_TRUE(f);
+  f.seek(posicion);
+  uint8_t b = (uint8_t)f.read();
+  f.seek(posicion);
+  b ^= 0x5A;
+  f.write(&b, 1);
+  f.close();
+}
+
+void test_orden_de_llegada() {
+  SpoolTelemetria spool(LittleFS, DIRECTORIO);
+  TEST_ASSERT_TRUE(spool.begin());
+
+  // Más de dos segmentos y un resto que queda en el lote en RAM
+  uint16_t total = 2 * POR_SEGMENTO + 40 + SPOOL_LOTE / 2;
+  agregarVarios(spool, 0, total);
+  TEST_ASSERT_EQUAL_UINT32(total, spool.pendientes());
+
+  TEST_ASSERT_EQUAL_UINT32(total, drenarEnOrden(spool, 0, 7));
+  TEST_ASSERT_EQUAL_UINT32(0, spool.pendientes());
+  TEST_ASSERT_EQUAL_UINT32(0, spool.descartados());
+  TEST_ASSERT_EQUAL_UINT32(0, spool.corruptos());
+
+  // Vacío, sigue aceptando y en orden
+  agregarVarios(spool, total, 3);
+  TEST_ASSERT_EQUAL_UINT32(3, drenarEnOrden(spool, total, 32));
+}
+
+// leer() no consume: sin confirmar() vuelve a entregar lo mismo
+void test_leer_sin_confirmar() {
+  SpoolTelemetria spool(LittleFS, DIRECTORIO);
+  spool.begin();
+  agregarVarios(spool, 0, 2 * SPOOL_LOTE);
+
+  RegistroTelemetria a[4], b[4];
+  TEST_ASSERT_EQUAL(4, spool.leer(a, 4));
+  TEST_ASSERT_EQUAL(4, spool.leer(b, 4));
+  TEST_ASSERT_EQUAL_UINT16(a[0].seq, b[0].seq);
+  spool.confirmar(2);
+  TEST_ASSERT_EQUAL(4, spool.leer(b, 4));
+  TEST_ASSERT_EQUAL_UINT16(2, b[0].seq);
+}
+
+// Con el spool lleno se descarta el segmento más viejo entero
+void test_lleno_descarta_el_mas_viejo() {
+  const uint32_t segmentos = 3;
+  SpoolTelemetria spool(LittleFS, DIRECTORIO, segmentos);
+  spool.begin();
+  TEST_ASSERT_EQUAL_UINT32(segmentos * POR_SEGMENTO, spool.capacidad());
+
+  agregarVarios(spool, 0, segmentos * POR_SEGMENTO);
+  TEST_ASSERT_EQUAL_UINT32(0, spool.descartados());
+  TEST_ASSERT_TRUE(LittleFS.exists("/spool/0"));
+
+  // El primer volcado que abre un cuarto segmento se lleva el 0
+  agregarVarios(spool, segmentos * POR_SEGMENTO, SPOOL_LOTE);
+  TEST_ASSERT_EQUAL_UINT32(POR_SEGMENTO, spool.descartados());
+  TEST_ASSERT_FALSE(LittleFS.exists("/spool/0"));
+  TEST_ASSERT_EQUAL_UINT32((segmentos - 1) * POR_SEGMENTO + SPOOL_LOTE, spool.pendientes());
+
+  uint32_t drenados = drenarEnOrden(spool, POR_SEGMENTO, 32);
+  TEST_ASSERT_EQUAL_UINT32((segmentos - 1) * POR_SEGMENTO + SPOOL_LOTE, drenados);
+}
+
+// Lo ya confirmado del segmento más viejo no cuenta como descartado
+void test_lleno_a_medio_drenar() {
+  const uint32_t segmentos = 2;
+  SpoolTelemetria spool(LittleFS, DIRECTORIO, segmentos);
+  spool.begin();
+  agregarVarios(spool, 0, segmentos * POR_SEGMENTO);
+
+  RegistroTelemetria buf[32];
+  TEST_ASSERT_EQUAL(32, spool.leer(buf, 32));
+  spool.confirmar(32);
+
+  agregarVarios(spool, segmentos * POR_SEGMENTO, SPOOL_LOTE);
+  TEST_ASSERT_EQUAL_UINT32(POR_SEGMENTO - 32, spool.descartados());
+  TEST_ASSERT_EQUAL_UINT32(POR_SEGMENTO + SPOOL_LOTE, drenarEnOrden(spool, POR_SEGMENTO, 32));
+}
+
+// Un registro dañado en medio del segmento se saltea sin trabar el drenaje
+void test_registro_danado_se_saltea() {
+  SpoolTelemetria spool(LittleFS, DIRECTORIO);
+  spool.begin();
+  agregarVarios(spool, 0, 3 * SPOOL_LOTE);
+  danarByte(0, 5 * sizeof(RegistroTelemetria) + 4);
+
+  RegistroTelemetria buf[32];
+  // Primero el tramo válido, sin el dañado
+  TEST_ASSERT_EQUAL(5, spool.leer(buf, 32));
+  TEST_ASSERT_EQUAL_UINT16(4, buf[4].seq);
+  spool.confirmar(5);
+
+  size_t n = spool.leer(buf, 32);
+  TEST_ASSERT_EQUAL(32, n);
+  TEST_ASSERT_EQUAL_UINT16(6, buf[0].seq);
+  TEST_ASSERT_EQUAL_UINT32(1, spool.corruptos());
+  spool.confirmar(n);
+
+  TEST_ASSERT_EQUAL_UINT32(3 * SPOOL_LOTE - 6 - 32, drenarEnOrden(spool, 6 + 32, 32));
+  TEST_ASSERT_EQUAL_UINT32(0, spool.pendientes());
+}
+
+// Un corte de energía a mitad de un volcado deja un registro incompleto
+// al final: no se entrega y el segmento no se reabre para escribir
+void test_registro_cortado_al_reiniciar() {
+  {
+    SpoolTelemetria spool(LittleFS, DIRECTORIO);
+    spool.begin();
+    agregarVarios(spool, 0, 2 * SPOOL_LOTE);
+  }
+  File f = LittleFS.open("/spool/0", FILE_APPEND);
+  const uint8_t medio[sizeof(RegistroTelemetria) / 2] = { 0x11, 0x22, 0x33 };
+  f.write(medio, sizeof(medio));
+  f.close();
+
+  SpoolTelemetria spool(LittleFS, DIRECTORIO);
+  TEST_ASSERT_TRUE(spool.begin());
+  TEST_ASSERT_EQUAL_UINT32(2 * SPOOL_LOTE, spool.pendientes());
+
+  agregarVarios(spool, 2 * SPOOL_LOTE, SPOOL_LOTE);
+  TEST_ASSERT_TRUE(LittleFS.exists("/spool/1"));
+  TEST_ASSERT_EQUAL_UINT32(3 * SPOOL_LOTE, drenarEnOrden(spool, 0, 32));
+  TEST_ASSERT_EQUAL_UINT32(0, spool.corruptos());
+}
+
+// Tras un reinicio se retoma lo que había en flash; lo confirmado de un
+// segmento ya borrado no vuelve, lo del segmento a medio drenar sí
+void test_retoma_tras_reinicio() {
+  const uint16_t total = POR_SEGMENTO + 3 * SPOOL_LOTE;
+  {
+    SpoolTelemetria spool(LittleFS, DIRECTORIO);
+    spool.begin();
+    agregarVarios(spool, 0, total);
+
+    RegistroTelemetria buf[32];
+    uint32_t confirmados = 0;
+    while (confirmados < POR_SEGMENTO + 10) {
+      size_t n = spool.leer(buf, POR_SEGMENTO + 10 - confirmados < 32 ? POR_SEGMENTO + 10 - confirmados : 32);
+      spool.confirmar(n);
+      confirmados += n;
+    }
+    TEST_ASSERT_FALSE(LittleFS.exists("/spool/0"));
+
+    // Lo que queda en el lote en RAM se pierde con el corte
+    agregarVarios(spool, total, SPOOL_LOTE / 2);
+  }
+
+  SpoolTelemetria spool(LittleFS, DIRECTORIO);
+  TEST_ASSERT_TRUE(spool.begin());
+  TEST_ASSERT_EQUAL_UINT32(total - POR_SEGMENTO, spool.pendientes());
+
+  // El segmento abierto sigue recibiendo a continuación
+  agregarVarios(spool, total, SPOOL_LOTE);
+  TEST_ASSERT_FALSE(LittleFS.exists("/spool/2"));
+  TEST_ASSERT_EQUAL_UINT32(total - POR_SEGMENTO + SPOOL_LOTE, drenarEnOrden(spool, POR_SEGMENTO, 32));
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_orden_de_llegada);
+  RUN_TEST(test_leer_sin_confirmar);
+  RUN_TEST(test_lleno_descarta_el_mas_viejo);
+  RUN_TEST(test_lleno_a_medio_drenar);
+  RUN_TEST(test_registro_danado_se_saltea);
+  RUN_TEST(test_registro_cortado_al_reiniciar);
+  RUN_TEST(test_retoma_tras_reinicio);
+  return UNITY_END();
+}
@@ -0,0 +1,258 @@
+#include <unity.h>
+#include <string.h>
+#include <TramaLoRa.h>
+
+//=============================================
+// TramaLoRa: trama binaria y formato ASCII heredado
+//=============================================
+// pio test -e native -f test_trama
+
+void setUp() {}
+void tearDown() {}
+
+static LecturaGas lecturaEjemplo() {
+  LecturaGas l;
+  l.nodo  = 7;
+  l.seq   = 0xBEEF;
+  l.ppm   = 523.4f;
+  l.ratio = 1.23f;
+  l.raw   = 612;
+  l.flags = TRAMA_FLAG_ALERTA | tramaFlagsCalibracion(40);
+  return l;
+}
+
+static bool decodificarAscii(const char* txt, LecturaGas& l) {
+  return tramaDecodificarAscii(txt, strlen(txt), l);
+}
+
+// CRC-16/CCITT-FALSE de "123456789" (valor de referencia del catálogo de CRC)
+void test_crc_referencia() {
+  TEST_ASSERT_EQUAL_HEX16(0x29B1, crc16Ccitt((const uint8_t*)"123456789", 9));
+}
+
+void test_datos_ida_y_vuelta() {
+  LecturaGas l = lecturaEjemplo();
+  uint8_t buf[TRAMA_LARGO_DATOS];
+  TEST_ASSERT_EQUAL(TRAMA_LARGO_DATOS, tramaCodificarDatos(l, buf, sizeof(buf)));
+  TEST_ASSERT_TRUE(tramaEsBinaria(buf, sizeof(buf)));
+  TEST_ASSERT_FALSE(tramaEsAlarma(buf, sizeof(buf)));
+
+  LecturaGas d;
+  TEST_ASSERT_TRUE(tramaDecodificarDatos(buf, sizeof(buf), d));
+  TEST_ASSERT_EQUAL_UINT8(l.nodo, d.nodo);
+  TEST_ASSERT_EQUAL_UINT16(l.seq, d.seq);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f / TRAMA_ESCALA_PPM, l.ppm, d.ppm);
+  TEST_ASSERT_FLOAT_WITHIN(0.5f / TRAMA_ESCALA_RATIO, l.ratio, d.ratio);
+  TEST_ASSERT_EQUAL_UINT16(l.raw, d.raw);
+  TEST_ASSERT_EQUAL_HEX8(l.flags, d.flags);
+  TEST_ASSERT_EQUAL_UINT8(40, tramaProgresoCalibracion(d.flags));
+}
+
+void test_alarma_ida_y_vuelta() {
+  LecturaGas l = lecturaEjemplo();
+  uint8_t buf[TRAMA_LARGO_DATOS];
+  TEST_ASSERT_EQUAL(TRAMA_LARGO_DATOS, tramaCodificarDatos(l, buf, sizeof(buf), TRAMA_TIPO_ALARMA));
+  TEST_ASSERT_TRUE(tramaEsAlarma(buf, sizeof(buf)));
+
+  LecturaGas d;
+  TEST_ASSERT_TRUE(tramaDecodificarDatos(buf, sizeof(buf), d));
+  TEST_ASSERT_EQUAL_UINT16(l.seq, d.seq);
+}
+
+// ppm y ratio fuera de la escala se saturan en vez de dar la vuelta
+void test_datos_saturados() {
+  LecturaGas l = lecturaEjemplo();
+  l.ppm = 20000;
+  l.ratio = -3;
+  uint8_t buf[TRAMA_LARGO_DATOS];
+  tramaCodificarDatos(l, buf, sizeof(buf));
+
+  LecturaGas d;
+  TEST_ASSERT_TRUE(tramaDecodificarDatos(buf, sizeof(buf), d));
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 65535.0f / TRAMA_ESCALA_PPM, d.ppm);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 0, d.ratio);
+}
+
+// Cualquier bit cambiado, en la carga o en el CRC, rechaza la trama
+void test_datos_crc_invalido() {
+  uint8_t buf[TRAMA_LARGO_DATOS];
+  tramaCodificarDatos(lecturaEjemplo(), buf, sizeof(buf));
+
+  LecturaGas d;
+  for (size_t i = 0; i < sizeof(buf); i++) {
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      uint8_t copia[TRAMA_LARGO_DATOS];
+      memcpy(copia, buf, sizeof(buf));
+      copia[i] ^= (uint8_t)(1 << bit);
+      TEST_ASSERT_FALSE(tramaDecodificarDatos(copia, sizeof(copia), d));
+    }
+  }
+}
+
+void test_datos_largo_invalido() {
+  uint8_t buf[TRAMA_LARGO_DATOS + 1];
+  TEST_ASSERT_EQUAL(0, tramaCodificarDatos(lecturaEjemplo(), buf, TRAMA_LARGO_DATOS - 1));
+  tramaCodificarDatos(lecturaEjemplo(), buf, sizeof(buf));
+  buf[TRAMA_LARGO_DATOS] = 0;
+
+  LecturaGas d;
+  TEST_ASSERT_FALSE(tramaDecodificarDatos(buf, TRAMA_LARGO_DATOS - 1, d));
+  TEST_ASSERT_FALSE(tramaDecodificarDatos(buf, TRAMA_LARGO_DATOS + 1, d));
+  TEST_ASSERT_FALSE(tramaDecodificarDatos(buf, 0, d));
+  TEST_ASSERT_FALSE(tramaEsAlarma(buf, TRAMA_LARGO_DATOS + 1));
+}
+
+// Tipo o versión ajenos, aun con el CRC bien calculado
+void test_datos_tipo_invalido() {
+  uint8_t buf[TRAMA_LARGO_DATOS];
+  LecturaGas d;
+
+  tramaCodificarDatos(lecturaEjemplo(), buf, sizeof(buf), TRAMA_TIPO_COMANDO);
+  TEST_ASSERT_FALSE(tramaDecodificarDatos(buf, sizeof(buf), d));
+
+  tramaCodificarDatos(lecturaEjemplo(), buf, sizeof(buf));
+  buf[0] = (uint8_t)(((TRAMA_VERSION + 1) << 4) | TRAMA_TIPO_DATOS);
+  tramaPonerU16(buf + 11, crc16Ccitt(buf, 11));
+  TEST_ASSERT_FALSE(tramaEsBinaria(buf, sizeof(buf)));
+  TEST_ASSERT_FALSE(tramaDecodificarDatos(buf, sizeof(buf), d));
+
+  // Una trama de texto del largo justo tampoco pasa por datos
+  uint8_t texto[TRAMA_LARGO_DATOS];
+  TEST_ASSERT_EQUAL(TRAMA_LARGO_DATOS,
+                    tramaCodificarTexto(TRAMA_TIPO_RESPUESTA, 7, 1, "STATUS_", 7, texto, sizeof(texto)));
+  TEST_ASSERT_FALSE(tramaDecodificarDatos(texto, sizeof(texto), d));
+}
+
+void test_texto_ida_y_vuelta() {
+  const char* cmd = "THRESHOLD:600";
+  uint8_t buf[TRAMA_LARGO_MAX];
+  size_t largo = tramaCodificarTexto(TRAMA_TIPO_COMANDO, 3, 42, cmd, strlen(cmd), buf, sizeof(buf));
+  TEST_ASSERT_EQUAL(TRAMA_LARGO_TEXTO_MIN + strlen(cmd), largo);
+
+  uint8_t nodo;
+  uint16_t seq;
+  const char* texto;
+  size_t largoTexto;
+  TEST_ASSERT_TRUE(tramaDecodificarTexto(buf, largo, TRAMA_TIPO_COMANDO, nodo, seq, texto, largoTexto));
+  TEST_ASSERT_EQUAL_UINT8(3, nodo);
+  TEST_ASSERT_EQUAL_UINT16(42, seq);
+  TEST_ASSERT_EQUAL(strlen(cmd), largoTexto);
+  TEST_ASSERT_EQUAL_MEMORY(cmd, texto, largoTexto);
+
+  // El tipo pedido tiene que coincidir, y el CRC cubre el texto
+  TEST_ASSERT_FALSE(tramaDecodificarTexto(buf, largo, TRAMA_TIPO_RESPUESTA, nodo, seq, texto, largoTexto));
+  buf[5] ^= 0x20;
+  TEST_ASSERT_FALSE(tramaDecodificarTexto(buf, largo, TRAMA_TIPO_COMANDO, nodo, seq, texto, largoTexto));
+}
+
+void test_texto_largo_invalido() {
+  char largoMax[TRAMA_LARGO_MAX];
+  memset(largoMax, 'A', sizeof(largoMax));
+  uint8_t buf[TRAMA_LARGO_MAX + 8];
+  size_t cabe = TRAMA_LARGO_MAX - TRAMA_LARGO_TEXTO_MIN;
+  TEST_ASSERT_EQUAL(TRAMA_LARGO_MAX, tramaCodificarTexto(TRAMA_TIPO_COMANDO, 1, 1, largoMax, cabe, buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL(0, tramaCodificarTexto(TRAMA_TIPO_COMANDO, 1, 1, largoMax, cabe + 1, buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL(0, tramaCodificarTexto(TRAMA_TIPO_COMANDO, 1, 1, "STATUS", 6, buf, 11));
+
+  uint8_t nodo;
+  uint16_t seq;
+  const char* texto;
+  size_t largoTexto;
+  TEST_ASSERT_FALSE(tramaDecodificarTexto(buf, TRAMA_LARGO_TEXTO_MIN - 1, TRAMA_TIPO_COMANDO,
+                                          nodo, seq, texto, largoTexto));
+  TEST_ASSERT_FALSE(tramaDecodificarTexto(buf, TRAMA_LARGO_MAX + 1, TRAMA_TIPO_COMANDO,
+                                          nodo, seq, texto, largoTexto));
+}
+
+void test_baliza_ida_y_vuelta() {
+  BalizaTdma b = { 513, 10000, 150, 40, 12, 3 };
+  uint8_t buf[TRAMA_LARGO_BALIZA];
+  TEST_ASSERT_EQUAL(TRAMA_LARGO_BALIZA, tramaCodificarBaliza(b, buf, sizeof(buf)));
+
+  BalizaTdma d;
+  TEST_ASSERT_TRUE(tramaDecodificarBaliza(buf, sizeof(buf), d));
+  TEST_ASSERT_EQUAL_UINT16(b.numero, d.numero);
+  TEST_ASSERT_EQUAL_UINT16(b.periodoMs, d.periodoMs);
+  TEST_ASSERT_EQUAL_UINT16(b.inicioMs, d.inicioMs);
+  TEST_ASSERT_EQUAL_UINT8(b.slotMs, d.slotMs);
+  TEST_ASSERT_EQUAL_UINT8(b.slots, d.slots);
+  TEST_ASSERT_EQUAL_UINT8(b.epoca, d.epoca);
+
+  TEST_ASSERT_FALSE(tramaDecodificarBaliza(buf, sizeof(buf) - 1, d));
+  buf[8] ^= 0x01;
+  TEST_ASSERT_FALSE(tramaDecodificarBaliza(buf, sizeof(buf), d));
+
+  // Un período nulo dividiría por cero en el nodo
+  b.periodoMs = 0;
+  tramaCodificarBaliza(b, buf, sizeof(buf));
+  TEST_ASSERT_FALSE(tramaDecodificarBaliza(buf, sizeof(buf), d));
+}
+
+void test_ascii_valido() {
+  LecturaGas l;
+  TEST_ASSERT_TRUE(decodificarAscii("GAS_DATA|PPM:523.4|Ratio:1.23|Raw:612|Status:ALERTA", l));
+  TEST_ASSERT_FALSE(tramaEsBinaria((const uint8_t*)"GAS_DATA|", 9));
+  TEST_ASSERT_EQUAL_UINT8(0, l.nodo);
+  TEST_ASSERT_EQUAL_UINT16(0, l.seq);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 523.4f, l.ppm);
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.23f, l.ratio);
+  TEST_ASSERT_EQUAL_UINT16(612, l.raw);
+  TEST_ASSERT_EQUAL_HEX8(TRAMA_FLAG_ALERTA, l.flags);
+
+  // Otro orden, progreso de calibración y campos nuevos que se ignoran
+  TEST_ASSERT_TRUE(decodificarAscii("GAS_DATA|Status:NORMAL|Raw:0|Calib:60|Extra:x|Ratio:0|PPM:12", l));
+  TEST_ASSERT_EQUAL_UINT8(TRAMA_FLAG_CALIBRANDO, l.flags & 0x0F);
+  TEST_ASSERT_EQUAL_UINT8(60, tramaProgresoCalibracion(l.flags));
+  TEST_ASSERT_FLOAT_WITHIN(0.001f, 12, l.ppm);
+}
+
+// El largo manda: el texto no necesita terminar en '\0'
+void test_ascii_respeta_largo() {
+  const char* txt = "GAS_DATA|PPM:5|Ratio:1|Raw:7|Status:NORMALXYZ";
+  LecturaGas l;
+  TEST_ASSERT_TRUE(tramaDecodificarAscii(txt, strlen(txt) - 3, l));
+  TEST_ASSERT_FALSE(tramaDecodificarAscii(txt, strlen(txt), l));
+  TEST_ASSERT_FALSE(tramaDecodificarAscii(txt, 5, l));
+}
+
+void test_ascii_invalido() {
+  LecturaGas l;
+  const char* invalidos[] = {
+    "",
+    "GAS_DATA|",
+    "GAS-DATA|PPM:5|Ratio:1|Raw:7|Status:NORMAL",     // prefijo
+    "GAS_DATA|PPM:5|Ratio:1|Raw:7",                   // falta Status
+    "GAS_DATA|Ratio:1|Raw:7|Status:NORMAL",           // falta PPM
+    "GAS_DATA|PPM:12a|Ratio:1|Raw:7|Status:NORMAL",   // número con sobrante
+    "GAS_DATA|PPM:|Ratio:1|Raw:7|Status:NORMAL",      // número vacío
+    "GAS_DATA|PPM:1.2.3|Ratio:1|Raw:7|Status:NORMAL",
+    "GAS_DATA|PPM:-5|Ratio:1|Raw:7|Status:NORMAL",    // negativo
+    "GAS_DATA|PPM:5|Ratio:1|Raw:7.5|Status:NORMAL",   // Raw sin decimales
+    "GAS_DATA|PPM:5|Ratio:1|Raw:70000|Status:NORMAL", // Raw de 16 bits
+    "GAS_DATA|PPM:5|Ratio:1|Raw:7|Status:ALARMA",     // estado desconocido
+    "GAS_DATA|PPM:5|Ratio:1|Raw:7|Status:NORMAL|Calib:101",
+    "GAS_DATA|PPM:5|Ratio:1|Raw:7|Status:NORMAL|Suelto",   // campo sin ':'
+    "GAS_DATA|PPM:99999999999|Ratio:1|Raw:7|Status:NORMAL",
+  };
+  for (size_t i = 0; i < sizeof(invalidos) / sizeof(invalidos[0]); i++) {
+    TEST_ASSERT_FALSE_MESSAGE(decodificarAscii(invalidos[i], l), invalidos[i]);
+  }
+}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_crc_referencia);
+  RUN_TEST(test_datos_ida_y_vuelta);
+  RUN_TEST(test_alarma_ida_y_vuelta);
+  RUN_TEST(test_datos_saturados);
+  RUN_TEST(test_datos_crc_invalido);
+  RUN_TEST(test_datos_largo_invalido);
+  RUN_TEST(test_datos_tipo_invalido);
+  RUN_TEST(test_texto_ida_y_vuelta);
+  RUN_TEST(test_texto_largo_invalido);
+  RUN_TEST(test_baliza_ida_y_vuelta);
+  RUN_TEST(test_ascii_valido);
+  RUN_TEST(test_ascii_respeta_largo);
+  RUN_TEST(test_ascii_invalido);
+  return UNITY_END();
+}
@@ -0,0 +1,114 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <Arduino.h>
+
+//=======================================
+// CALIBRACIÓN DE Ro POR PASOS
+//=======================================
+// Acumula una muestra de Rs por llamada en lugar de bloquear el loop
+// durante toda la calibración. Mientras tanto el nodo sigue midiendo y
+// atendiendo comandos con el Ro anterior.
+class Calibration {
+public:
+  Calibration(float cleanAirRatio, uint8_t samples);
+
+  void start();
+  void cancel() { running = false; }
+  bool active() const { return running; }
+
+  // Suma una muestra; devuelve true con la última, cuando ro() ya es el nuevo
+  bool addSample(float rs);
+
+  uint8_t progress() const { return (uint8_t)((uint16_t)taken * 100 / samples); }
+  float ro() const { return lastRo; }
+
+private:
+  float cleanAirRatio;
+  float sum;
+  float lastRo;
+  uint8_t samples;
+  uint8_t taken;
+  bool running;
+};
+
+//=======================================
+// SEGUIMIENTO DE LA LÍNEA BASE
+//=======================================
+// Corrige la deriva lenta de Ro (envejecimiento, humedad estacional) sin
+// sacar el nodo de servicio. El gas baja Rs, así que el máximo de Rs en
+// una ventana larga es la mejor estimación de aire limpio. Al cerrar cada
+// ventana Ro se acerca a ese máximo, con el paso acotado a maxStepPct % para
+// que una fuga que dure toda la ventana no lo arrastre.
+class BaselineTracker {
+public:
+  BaselineTracker(float cleanAirRatio, unsigned long windowMs, uint8_t maxStepPct);
+
+  void reset(unsigned long now);
+
+  // Registra una muestra; devuelve true si corrigió ro
+  bool update(float rs, unsigned long now, float& ro);
+
+private:
+  float cleanAirRatio;
+  float maxRs;
+  unsigned long windowStart;
+  unsigned long windowMs;
+  uint8_t maxStepPct;
+};
+
+//=======================================
+// DETECCIÓN DE PRECALENTAMIENTO
+//=======================================
+// El calentador del MQ está estable cuando la lectura del ADC deja de
+// moverse: la diferencia entre máximo y mínimo de las últimas WINDOW
+// muestras no supera maxSpread cuentas. Tras un corte breve el sensor
+// sigue caliente y esto se cumple en cuanto se llena la ventana.
+class PreheatDetector {
+public:
+  static const uint8_t WINDOW = 8;
+
+  explicit PreheatDetector(uint8_t maxSpread);
+
+  void reset();
+
+  // Registra una muestra; devuelve true cuando la lectura es estable
+  bool addSample(uint16_t raw);
+
+private:
+  uint16_t window[WINDOW];
+  uint8_t count;
+  uint8_t next;
+  uint8_t maxSpread;
+};
+
+//=======================================
+// CALIBRACIÓN PERSISTENTE (EEPROM)
+//=======================================
+// Ro, sus horas de funcionamiento desde la última calibración y un CRC-16.
+// El Nano no tiene reloj, así que la antigüedad se mide en horas de uso:
+// save() se llama al calibrar (0 h) y una vez por hora. EEPROM.put() sólo
+// reescribe los bytes que cambian.
+class CalibrationStore {
+public:
+  explicit CalibrationStore(int address) : address(address) {}
+
+  // false si la EEPROM está borrada o el CRC no coincide
+  bool load(float& ro, uint16_t& ageHours) const;
+  void save(float ro, uint16_t ageHours);
+
+private:
+  struct Record {
+    uint8_t  magic;
+    float    ro;
+    uint16_t ageHours;
+    uint16_t crc;
+  };
+  static const uint8_t MAGIC = 0xC1;
+
+  int address;
+
+  static uint16_t checksum(const Record& r);
+};
+
+#endif
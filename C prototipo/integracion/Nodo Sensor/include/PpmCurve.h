@@ -0,0 +1,45 @@
+#ifndef PPM_CURVE_H
+#define PPM_CURVE_H
+
+#include <Arduino.h>
+
+//=======================================
+// CURVA Rs/Ro -> PPM EN PUNTO FIJO
+//=======================================
+// ppm = A * (Rs/Ro)^B con Rs = RL * (1024 - raw) / raw (VCC se cancela).
+// En dominio log2 todo sale de enteros:
+//   log2(ratio) = log2(RL / Ro) + log2(1024 - raw) - log2(raw)
+//   log2(ppm)   = log2(A) + B * log2(ratio)
+// log2 y 2^x usan tablas de 33 entradas en PROGMEM generadas con constexpr
+// e interpolación lineal. Sólo setRo() trabaja en float, una vez por
+// calibración; evaluate() no llama a pow() ni divide.
+class PpmCurve {
+public:
+  static const uint16_t PPM_MAX = 10000;
+
+  PpmCurve(float a, float b, float rl);
+
+  void setRo(float ro);
+
+  // Ratio y ppm de una misma muestra del ADC
+  void evaluate(uint16_t raw, float& ratio, float& ppm) const;
+
+  // Menor lectura del ADC cuyo ppm supera al dado (1024 si ninguna). Con
+  // B < 0 el ppm crece con la lectura: comparar el ADC contra este valor
+  // equivale a comparar el ppm contra el umbral, sin evaluar la curva.
+  uint16_t rawAbove(float ppm) const;
+
+  // log2(x) en Q12 para x en 1..1023
+  static int32_t log2Q12(uint16_t x);
+  // 2^(y / 4096) con fracBits bits fraccionarios, saturado
+  static uint32_t exp2Q12(int32_t y, uint8_t fracBits);
+
+private:
+  float a;
+  float rl;
+  int16_t bQ12;         // exponente B en Q12
+  int32_t logAQ12;      // log2(A)
+  int32_t logRlRoQ12;   // log2(RL / Ro)
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef REPORT_POLICY_H
+#define REPORT_POLICY_H
+
+#include <Arduino.h>
+
+//=======================================
+// REPORTE POR EXCEPCIÓN
+//=======================================
+// El nodo mide seguido pero sólo transmite cuando algo cambió:
+//  - el ppm se movió más que la banda muerta desde el último envío,
+//  - cambió algún flag de estado (cruce del umbral, fin de calibración...),
+//  - venció el heartbeat. En alerta o con el ppm todavía no confiable el
+//    heartbeat baja a FAST_INTERVAL_S para que el gateway siga la situación.
+// Umbral, banda muerta y heartbeat se cambian por LoRa y se guardan en
+// EEPROM con un CRC-16.
+class ReportPolicy {
+public:
+  static const uint16_t FAST_INTERVAL_S = 10;
+  static const uint16_t HEARTBEAT_MIN_S = 10;
+  static const uint16_t HEARTBEAT_MAX_S = 300;   // el gateway olvida un nodo tras ~2 heartbeats
+  static const uint16_t THRESHOLD_MAX   = 5000;
+  static const uint16_t DEADBAND_MAX    = 1000;
+
+  ReportPolicy(int address, uint16_t threshold, uint16_t deadband, uint16_t heartbeatS);
+
+  // Carga la configuración guardada; si no hay, quedan los valores por defecto
+  bool load();
+
+  // Validan el rango, guardan en EEPROM y devuelven false si lo rechazan
+  bool setThreshold(uint16_t ppm);
+  bool setDeadband(uint16_t ppm);
+  bool setHeartbeat(uint16_t seconds);
+
+  uint16_t threshold() const { return config.threshold; }
+  uint16_t deadband() const { return config.deadband; }
+  uint16_t heartbeat() const { return config.heartbeatS; }
+
+  bool shouldSend(float ppm, uint8_t flags, unsigned long now) const;
+  void markSent(float ppm, uint8_t flags, unsigned long now);
+
+private:
+  struct Config {
+    uint8_t  magic;
+    uint16_t threshold;
+    uint16_t deadband;
+    uint16_t heartbeatS;
+    uint16_t crc;
+  };
+  static const uint8_t MAGIC = 0xB2;
+
+  int address;
+  Config config;
+  float lastPpm;
+  unsigned long lastSent;
+  uint8_t lastFlags;
+  bool sentOnce;
+
+  void save();
+  static uint16_t checksum(const Config& c);
+};
+
+#endif
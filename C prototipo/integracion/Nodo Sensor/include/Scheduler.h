@@ -0,0 +1,53 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+
+//=======================================
+// PLANIFICADOR COOPERATIVO POR PLAZOS
+//=======================================
+// Tabla fija de tareas, sin heap: 6 bytes por tarea más dos máscaras.
+// Una tarea corre cuando vence su plazo (runIn) o apenas una interrupción
+// la marca (post). Entre eventos el MCU queda en SLEEP_MODE_IDLE, que
+// mantiene vivos Timer0 (millis) y la interrupción de DIO0.
+class Scheduler {
+public:
+  typedef void (*Task)();
+  static const uint8_t MAX_TASKS = 10;
+
+  Scheduler();
+
+  // Registra una tarea y devuelve su id (0xFF si la tabla está llena)
+  uint8_t add(Task task);
+
+  // Vacía la tabla. setup() la llama primero: en el host un reinicio
+  // simulado no vuelve a inicializar las globales.
+  void reset();
+
+  void runIn(uint8_t id, unsigned long delayMs);
+  void cancel(uint8_t id);
+  bool isScheduled(uint8_t id) const { return armed & bit(id); }
+
+  // Desde una ISR, o fuera de ella con las interrupciones cortadas
+  void post(uint8_t id) { posted |= bit(id); }
+
+  // Ejecuta una vez cada tarea marcada o vencida
+  void runDue();
+
+  // Duerme hasta que vence un plazo o una interrupción marca una tarea
+  void sleep();
+
+private:
+  Task tasks[MAX_TASKS];
+  unsigned long due[MAX_TASKS];
+  uint8_t count;
+  uint16_t armed;             // tareas esperando su plazo
+  // Marcadas desde interrupciones. Con 16 bits el acceso no es atómico en
+  // AVR: fuera de una ISR siempre con las interrupciones cortadas.
+  volatile uint16_t posted;
+
+  static uint16_t bit(uint8_t id) { return (uint16_t)(1u << id); }
+  bool anyDue(unsigned long now) const;
+};
+
+#endif
@@ -0,0 +1,112 @@
+#include "Calibration.h"
+#include <EEPROM.h>
+#include <stddef.h>
+#include <TramaLoRa.h>   // crc16Ccitt
+
+//=======================================
+// Calibration
+//=======================================
+
+Calibration::Calibration(float cleanAirRatio, uint8_t samples)
+  : cleanAirRatio(cleanAirRatio), sum(0), lastRo(0),
+    samples(samples ? samples : 1), taken(0), running(false) {}
+
+void Calibration::start() {
+  sum = 0;
+  taken = 0;
+  running = true;
+}
+
+bool Calibration::addSample(float rs) {
+  if (!running) return false;
+  sum += rs;
+  if (++taken < samples) return false;
+
+  // Rs/Ro = cleanAirRatio en aire limpio
+  lastRo = sum / samples / cleanAirRatio;
+  running = false;
+  return true;
+}
+
+//=======================================
+// BaselineTracker
+//=======================================
+
+BaselineTracker::BaselineTracker(float cleanAirRatio, unsigned long windowMs, uint8_t maxStepPct)
+  : cleanAirRatio(cleanAirRatio), maxRs(0), windowStart(0),
+    windowMs(windowMs), maxStepPct(maxStepPct) {}
+
+void BaselineTracker::reset(unsigned long now) {
+  maxRs = 0;
+  windowStart = now;
+}
+
+bool BaselineTracker::update(float rs, unsigned long now, float& ro) {
+  if (rs > maxRs) maxRs = rs;
+  if (now - windowStart < windowMs) return false;
+
+  float target = maxRs / cleanAirRatio;
+  reset(now);
+  if (target <= 0 || ro <= 0) return false;
+
+  float step = ro * maxStepPct / 100.0f;
+  float delta = constrain(target - ro, -step, step);
+  if (delta == 0) return false;
+  ro += delta;
+  return true;
+}
+
+//=======================================
+// PreheatDetector
+//=======================================
+
+PreheatDetector::PreheatDetector(uint8_t maxSpread) : maxSpread(maxSpread) {
+  reset();
+}
+
+void PreheatDetector::reset() {
+  count = 0;
+  next = 0;
+}
+
+bool PreheatDetector::addSample(uint16_t raw) {
+  window[next] = raw;
+  next = (uint8_t)((next + 1) % WINDOW);
+  if (count < WINDOW) count++;
+  if (count < WINDOW) return false;
+
+  uint16_t lo = window[0], hi = window[0];
+  for (uint8_t i = 1; i < WINDOW; i++) {
+    if (window[i] < lo) lo = window[i];
+    if (window[i] > hi) hi = window[i];
+  }
+  return hi - lo <= maxSpread;
+}
+
+//=======================================
+// CalibrationStore
+//=======================================
+
+uint16_t CalibrationStore::checksum(const Record& r) {
+  return crc16Ccitt((const uint8_t*)&r, offsetof(Record, crc));
+}
+
+bool CalibrationStore::load(float& ro, uint16_t& ageHours) const {
+  Record r;
+  EEPROM.get(address, r);
+  if (r.magic != MAGIC || r.crc != checksum(r)) return false;
+  if (!(r.ro > 0)) return false;   // también descarta NaN
+  ro = r.ro;
+  ageHours = r.ageHours;
+  return true;
+}
+
+void CalibrationStore::save(float ro, uint16_t ageHours) {
+  Record r;
+  memset(&r, 0, sizeof(r));        // relleno determinista para el CRC
+  r.magic = MAGIC;
+  r.ro = ro;
+  r.ageHours = ageHours;
+  r.crc = checksum(r);
+  EEPROM.put(address, r);
+}
@@ -0,0 +1,119 @@
+#include "PpmCurve.h"
+
+//=======================================
+// TABLAS GENERADAS EN COMPILACIÓN
+//=======================================
+// Series en constexpr de una sola expresión (C++11, el estándar del core AVR):
+// ln(x) = 2 * atanh((x - 1) / (x + 1)) y e^x por Taylor. Con x en [1, 2]
+// convergen a precisión de float en menos de 20 términos.
+
+constexpr double atanhSeries(double z, double z2, double term, int k) {
+  return k > 41 ? 0 : term / k + atanhSeries(z, z2, term * z2, k + 2);
+}
+
+constexpr double lnConst(double x) {
+  return 2 * atanhSeries((x - 1) / (x + 1), ((x - 1) / (x + 1)) * ((x - 1) / (x + 1)), (x - 1) / (x + 1), 1);
+}
+
+constexpr double expSeries(double x, double term, int k) {
+  return k > 20 ? term : term + expSeries(x, term * x / k, k + 1);
+}
+
+constexpr double LN2 = 0.69314718055994531;
+
+// log2(1 + i/32) en Q12: 0..4096
+constexpr uint16_t log2Entry(int i) {
+  return (uint16_t)(lnConst(1.0 + i / 32.0) / LN2 * 4096.0 + 0.5);
+}
+
+// 2^(i/32) en Q14: 16384..32768
+constexpr uint16_t exp2Entry(int i) {
+  return (uint16_t)(expSeries(i / 32.0 * LN2, 1.0, 1) * 16384.0 + 0.5);
+}
+
+#define TABLE_4(f, i)  f(i), f(i + 1), f(i + 2), f(i + 3)
+#define TABLE_33(f)    TABLE_4(f, 0), TABLE_4(f, 4), TABLE_4(f, 8), TABLE_4(f, 12), \
+                       TABLE_4(f, 16), TABLE_4(f, 20), TABLE_4(f, 24), TABLE_4(f, 28), f(32)
+
+static const uint16_t LOG2_TABLE[33] PROGMEM = { TABLE_33(log2Entry) };
+static const uint16_t EXP2_TABLE[33] PROGMEM = { TABLE_33(exp2Entry) };
+
+static_assert(log2Entry(0) == 0 && log2Entry(32) == 4096, "tabla log2 fuera de rango");
+static_assert(exp2Entry(0) == 16384 && exp2Entry(32) == 32768, "tabla exp2 fuera de rango");
+
+//=======================================
+// EVALUACIÓN
+//=======================================
+
+PpmCurve::PpmCurve(float a, float b, float rl) : a(a), rl(rl) {
+  bQ12 = (int16_t)(b * 4096.0f + (b < 0 ? -0.5f : 0.5f));
+  logAQ12 = (int32_t)(log(a) / LN2 * 4096.0 + 0.5);
+  setRo(rl);
+}
+
+void PpmCurve::setRo(float ro) {
+  if (ro <= 0) return;
+  float l = log(rl / ro) / LN2 * 4096.0f;
+  logRlRoQ12 = (int32_t)(l + (l < 0 ? -0.5f : 0.5f));
+}
+
+int32_t PpmCurve::log2Q12(uint16_t x) {
+  // Normalizar a [512, 1024): el exponente es la posición del bit más alto
+  int8_t n = 9;
+  while (!(x & 0x200)) {
+    x <<= 1;
+    n--;
+  }
+  uint8_t i = (x >> 4) & 31;
+  uint8_t frac = x & 15;
+  int16_t l0 = pgm_read_word(&LOG2_TABLE[i]);
+  int16_t l1 = pgm_read_word(&LOG2_TABLE[i + 1]);
+  return (int32_t)n * 4096 + l0 + (((l1 - l0) * frac) >> 4);
+}
+
+uint32_t PpmCurve::exp2Q12(int32_t y, uint8_t fracBits) {
+  int16_t n = (int16_t)(y >> 12);   // parte entera (hacia -inf)
+  uint16_t f = (uint16_t)(y & 4095);
+  uint8_t i = f >> 7;
+  uint8_t frac = f & 127;
+  uint16_t e0 = pgm_read_word(&EXP2_TABLE[i]);
+  uint16_t e1 = pgm_read_word(&EXP2_TABLE[i + 1]);
+  uint32_t m = e0 + (((uint32_t)(e1 - e0) * frac) >> 7);   // Q14
+
+  int16_t shift = n + fracBits - 14;
+  if (shift >= 17) return 0xFFFFFFFFUL;
+  if (shift >= 0) return m << shift;
+  if (shift <= -16) return 0;
+  return (m + (1UL << (-shift - 1))) >> -shift;
+}
+
+void PpmCurve::evaluate(uint16_t raw, float& ratio, float& ppm) const {
+  if (raw == 0 || raw >= 1024) {
+    // Igual que la versión en float: Rs = 0 satura en PPM_MAX
+    ratio = 0;
+    ppm = PPM_MAX;
+    return;
+  }
+  int32_t logRatio = logRlRoQ12 + log2Q12(1024 - raw) - log2Q12(raw);
+  int32_t logPpm = logAQ12 + (((int32_t)bQ12 * logRatio) >> 12);
+
+  uint32_t ratioQ12 = exp2Q12(logRatio, 12);
+  uint32_t ppmQ8 = exp2Q12(logPpm, 8);
+  if (ppmQ8 > (uint32_t)PPM_MAX << 8) ppmQ8 = (uint32_t)PPM_MAX << 8;
+
+  ratio = ratioQ12 * (1.0f / 4096);
+  ppm = ppmQ8 * (1.0f / 256);
+}
+
+uint16_t PpmCurve::rawAbove(float threshold) const {
+  // Búsqueda binaria en 1..1024: diez evaluaciones
+  uint16_t lo = 1, hi = 1024;
+  while (lo < hi) {
+    uint16_t mid = (lo + hi) / 2;
+    float ratio, ppm;
+    evaluate(mid, ratio, ppm);
+    if (ppm > threshold) hi = mid;
+    else lo = mid + 1;
+  }
+  return lo;
+}
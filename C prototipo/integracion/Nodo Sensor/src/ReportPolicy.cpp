@@ -0,0 +1,74 @@
+#include "ReportPolicy.h"
+#include <EEPROM.h>
+#include <stddef.h>
+#include <TramaLoRa.h>
+
+// Bits de estado que cuentan como cambio (el progreso de calibración no)
+#define STATE_FLAGS (TRAMA_FLAG_ALERTA | TRAMA_FLAG_CALIBRANDO | TRAMA_FLAG_SIN_RO | TRAMA_FLAG_PRECALENTANDO)
+
+ReportPolicy::ReportPolicy(int address, uint16_t threshold, uint16_t deadband, uint16_t heartbeatS)
+  : address(address), lastPpm(0), lastSent(0), lastFlags(0), sentOnce(false) {
+  memset(&config, 0, sizeof(config));
+  config.threshold = threshold;
+  config.deadband = deadband;
+  config.heartbeatS = heartbeatS;
+}
+
+bool ReportPolicy::load() {
+  Config c;
+  EEPROM.get(address, c);
+  if (c.magic != MAGIC || c.crc != checksum(c)) return false;
+  if (c.threshold == 0 || c.threshold >= THRESHOLD_MAX || c.deadband > DEADBAND_MAX ||
+      c.heartbeatS < HEARTBEAT_MIN_S || c.heartbeatS > HEARTBEAT_MAX_S) return false;
+  config = c;
+  return true;
+}
+
+bool ReportPolicy::setThreshold(uint16_t ppm) {
+  if (ppm == 0 || ppm >= THRESHOLD_MAX) return false;
+  config.threshold = ppm;
+  save();
+  return true;
+}
+
+bool ReportPolicy::setDeadband(uint16_t ppm) {
+  if (ppm > DEADBAND_MAX) return false;
+  config.deadband = ppm;
+  save();
+  return true;
+}
+
+bool ReportPolicy::setHeartbeat(uint16_t seconds) {
+  if (seconds < HEARTBEAT_MIN_S || seconds > HEARTBEAT_MAX_S) return false;
+  config.heartbeatS = seconds;
+  save();
+  return true;
+}
+
+bool ReportPolicy::shouldSend(float ppm, uint8_t flags, unsigned long now) const {
+  if (!sentOnce) return true;
+  if ((flags & STATE_FLAGS) != (lastFlags & STATE_FLAGS)) return true;
+  if (fabs(ppm - lastPpm) > config.deadband) return true;
+
+  // Alerta, calibración o precalentamiento: cadencia rápida
+  bool fast = flags & STATE_FLAGS;
+  unsigned long interval = (unsigned long)(fast ? FAST_INTERVAL_S : config.heartbeatS) * 1000UL;
+  return now - lastSent >= interval;
+}
+
+void ReportPolicy::markSent(float ppm, uint8_t flags, unsigned long now) {
+  lastPpm = ppm;
+  lastFlags = flags;
+  lastSent = now;
+  sentOnce = true;
+}
+
+void ReportPolicy::save() {
+  config.magic = MAGIC;
+  config.crc = checksum(config);
+  EEPROM.put(address, config);
+}
+
+uint16_t ReportPolicy::checksum(const Config& c) {
+  return crc16Ccitt((const uint8_t*)&c, offsetof(Config, crc));
+}
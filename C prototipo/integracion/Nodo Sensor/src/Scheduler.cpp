@@ -0,0 +1,83 @@
+#include "Scheduler.h"
+
+#ifndef ARDUINO_NATIVO
+#include <avr/sleep.h>
+#endif
+
+Scheduler::Scheduler() : count(0), armed(0), posted(0) {}
+
+void Scheduler::reset() {
+  noInterrupts();
+  count = 0;
+  armed = 0;
+  posted = 0;
+  interrupts();
+}
+
+uint8_t Scheduler::add(Task task) {
+  if (count >= MAX_TASKS) return 0xFF;
+  tasks[count] = task;
+  return count++;
+}
+
+void Scheduler::runIn(uint8_t id, unsigned long delayMs) {
+  if (id >= count) return;
+  due[id] = millis() + delayMs;
+  armed |= bit(id);
+}
+
+void Scheduler::cancel(uint8_t id) {
+  if (id >= count) return;
+  armed &= ~bit(id);
+  noInterrupts();
+  posted &= ~bit(id);
+  interrupts();
+}
+
+bool Scheduler::anyDue(unsigned long now) const {
+  for (uint8_t i = 0; i < count; i++) {
+    // Diferencia con signo: correcta aunque millis() dé la vuelta
+    if ((armed & bit(i)) && (long)(now - due[i]) >= 0) return true;
+  }
+  return false;
+}
+
+void Scheduler::runDue() {
+  noInterrupts();
+  uint16_t ready = posted;
+  posted = 0;
+  interrupts();
+
+  unsigned long now = millis();
+  for (uint8_t i = 0; i < count; i++) {
+    if ((armed & bit(i)) && (long)(now - due[i]) >= 0) {
+      armed &= ~bit(i);       // de un disparo: una tarea periódica se vuelve a programar
+      ready |= bit(i);
+    }
+  }
+
+  for (uint8_t i = 0; i < count; i++) {
+    if (ready & bit(i)) tasks[i]();
+  }
+}
+
+void Scheduler::sleep() {
+  for (;;) {
+    noInterrupts();
+    if (posted || anyDue(millis())) {
+      interrupts();
+      return;
+    }
+#ifdef ARDUINO_NATIVO
+    interrupts();
+    nativoDormir(1024);        // hasta la próxima interrupción o el tick de Timer0
+#else
+    // sei + sleep: una interrupción pendiente recién despierta a la CPU ya dormida
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_enable();
+    interrupts();
+    sleep_cpu();
+    sleep_disable();
+#endif
+  }
+}
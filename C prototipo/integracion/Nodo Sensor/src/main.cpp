@@ -1,6 +1,11 @@
 #include <Arduino.h>
 #include <SPI.h>
 #include <LoRa.h>
+#include <TramaLoRa.h>
+#include "Scheduler.h"
+#include "PpmCurve.h"
+#include "Calibration.h"
+#include "ReportPolicy.h"
 
 //=======================================
 // PINES LoRa para Arduino Nano
@@ -19,25 +24,154 @@
 #define CLEAN_AIR_RATIO   9.8   // Rs/Ro en aire limpio (MQ-2)
 #define CALIB_SAMPLES     50    // Muestras para calibración
 #define CALIB_DELAY       500   // Delay entre muestras (ms)
+#define RECALIB_WARMUP    3000  // Espera antes de la primera muestra con CALIBRATE (ms)
+#define CALIB_MAX_AGE     720   // Horas de uso tras las que el Ro guardado ya no se usa
+#define CALIB_EEPROM_ADDR 0     // Dirección del registro de calibración en EEPROM
+#define REPORT_EEPROM_ADDR 16   // Dirección de la configuración de reporte en EEPROM
+#define PREHEAT_SAMPLE    200   // Período de muestreo durante el precalentamiento (ms)
+#define PREHEAT_SPREAD    4     // Máx - mín del ADC en la ventana para darlo por estable
+#define PREHEAT_TIMEOUT   180000UL  // Tope del precalentamiento (ms)
+#define HOUR_MS           3600000UL
+#define CURVE_A           574.25  // PPM = A * (Rs/Ro)^B (MQ-2, aproximada)
+#define CURVE_B           -2.222
 
 //=======================================
 // CONFIGURACIÓN
 //=======================================
-const unsigned long SEND_INTERVAL = 10000;  // Enviar datos cada 10 segundos
-const float GAS_THRESHOLD = 500.0;           // Umbral de gas en PPM
+const unsigned long SAMPLE_INTERVAL = 2000; // Medir cada 2 s; se transmite según ReportPolicy
+#define GAS_THRESHOLD     500   // Umbral de gas en PPM (por defecto, cambia con THRESHOLD:)
+#define DEADBAND          25    // Variación de ppm que fuerza un envío (DEADBAND:)
+#define HEARTBEAT         300   // Segundos sin cambios entre envíos (HEARTBEAT:)
+#define NODE_ID           1     // Identificador de este nodo en la red LoRa
+#define USE_BINARY_FRAME  1     // 0 = formato ASCII para gateways sin actualizar
+#define TX_BUFFER_SIZE    72    // respuesta más larga: NODE_INFO en trama de respuesta, ~68 bytes
+#define RX_BUFFER_SIZE    32    // comando más largo: "THRESHOLD:xxxx"
+
+// Camino rápido de alarma: entre muestras se vigila el ADC contra la lectura
+// equivalente al umbral y cada cruce sale como TRAMA_TIPO_ALARMA, repetida
+#define ALARM_WATCH       250   // Período de vigilancia del umbral (ms)
+#define ALARM_REPEATS     2     // Repeticiones de la trama de alarma
+#define ALARM_REPEAT_MS   300   // Separación de las repeticiones (ms) + hasta la mitad al azar
+
+// Potencia y SF los ajusta el gateway (ADR) con RADIO:<sf>:<dBm>. Si pasan
+// RADIO_ACK_LIMIT envíos sin ninguna bajada, el nodo vuelve solo hacia el
+// ajuste robusto: +3 dB cada RADIO_ACK_DELAY envíos y, ya al máximo, el SF
+// de la red (como ADRACKReq en LoRaWAN)
+#define RADIO_SF          7     // SF de la red: el gateway escucha sólo este
+#define RADIO_POWER_MAX   20    // dBm
+#define RADIO_POWER_MIN   2
+#define RADIO_ACK_LIMIT   24
+#define RADIO_ACK_DELAY   8
+
+// TDMA: con slot asignado por el gateway (SLOT:<n>:<época>) y su baliza a
+// la vista, las tramas de datos esperan el turno propio. Sin slot o sin
+// baliza el nodo transmite apenas tiene algo (acceso aleatorio). Las
+// alarmas y las respuestas a comandos nunca esperan.
+#define TDMA_NO_SLOT      0xFF
+#define TDMA_MISSED_MAX   3     // Balizas perdidas seguidas antes de volver a acceso aleatorio
+#define TDMA_DRIFT_MAX    2     // Desvío aceptado del período medido (%)
+
+// Corrección lenta de la deriva de Ro con el máximo de Rs de cada día
+#define BASELINE_TRACKING 1
+#define BASELINE_WINDOW   86400000UL  // Ventana de búsqueda de aire limpio (ms)
+#define BASELINE_MAX_STEP 3           // Corrección máxima por ventana (% de Ro)
 
 //=======================================
 // VARIABLES GLOBALES
 //=======================================
 float Ro = 10.0;  // Resistencia en aire limpio (kΩ)
-unsigned long lastSendTime = 0;
-float calibrateSensor();
+PpmCurve curve(CURVE_A, CURVE_B, RL_VALUE);
+Calibration calibration(CLEAN_AIR_RATIO, CALIB_SAMPLES);
+bool roValid = false;          // false hasta tener Ro (guardado o calibrado)
+bool calibrationReply = false; // responder CALIBRATION_OK al terminar
+CalibrationStore calibrationStore(CALIB_EEPROM_ADDR);
+ReportPolicy policy(REPORT_EEPROM_ADDR, GAS_THRESHOLD, DEADBAND, HEARTBEAT);
+uint16_t calibrationAge = 0;   // Horas de uso desde la última calibración
+PreheatDetector preheat(PREHEAT_SPREAD);
+bool preheated = false;        // calentador estable
+unsigned long preheatStart = 0;
+#if BASELINE_TRACKING
+BaselineTracker baseline(CLEAN_AIR_RATIO, BASELINE_WINDOW, BASELINE_MAX_STEP);
+#endif
+uint16_t txSeq = 0;  // Secuencia de tramas de datos
+uint16_t alarmRaw = 1024;      // Lectura del ADC desde la que hay alerta
+bool alertActive = false;      // TRAMA_FLAG_ALERTA de la última trama enviada
+uint8_t alarmFrame[TRAMA_LARGO_DATOS];
+uint8_t alarmRepeats = 0;
+
+// Ajuste de radio vigente; un cambio espera a que termine la transmisión
+uint8_t radioSf = RADIO_SF;
+uint8_t radioPower = RADIO_POWER_MAX;
+bool radioChanged = false;
+uint8_t uplinksSinceDownlink = 0;
+
+// Turno TDMA. Los tiempos de la baliza se escalan con el período medido
+// con millis(): el resonador del Nano puede errar un 0.5 %, 40 ms a lo
+// largo de un superciclo, más que la guarda del slot.
+uint8_t tdmaSlot = TDMA_NO_SLOT;
+uint8_t tdmaEpoch = 0;
+bool tdmaSynced = false;
+BalizaTdma beacon;              // última baliza válida
+unsigned long beaconMs = 0;     // millis() al recibirla
+unsigned long beaconPeriod = 0; // período del gateway medido con el reloj local
+bool slotPending = false;       // lectura esperando el slot
+LecturaGas slotReading;
+
+// Tareas del planificador
+Scheduler scheduler;
+uint8_t sampleTask, txDoneTask, commandTask, calibrationTask, preheatTask, ageTask;
+uint8_t watchTask, alarmTask, slotTask;
+
+// Comandos con secuencia (TRAMA_TIPO_COMANDO): las respuestas salen como
+// TRAMA_TIPO_RESPUESTA con la misma secuencia. Un comando repetido (el
+// gateway reintenta si no le llegó la respuesta) no se vuelve a ejecutar.
+bool replyFramed = false;      // el comando en curso llegó en trama
+uint16_t replySeq = 0;
+bool replySent = false;
+bool haveCommandSeq = false;
+uint16_t lastCommandSeq = 0;
+bool calibrationFramed = false; // CALIBRATION_OK va en trama de respuesta
+uint16_t calibrationSeq = 0;
+
+// Transmisión asíncrona: mientras la radio transmite, el siguiente envío
+// espera en pendingTx (si llega otro, reemplaza al anterior)
+bool txBusy = false;
+uint8_t pendingTx[TX_BUFFER_SIZE];
+uint8_t pendingTxLen = 0;
+
+// Comando recibido, copiado de la FIFO por la ISR de DIO0
+volatile uint8_t rxBuffer[RX_BUFFER_SIZE];
+volatile uint8_t rxLen = 0;
+volatile bool rxReady = false;
+volatile unsigned long rxMs = 0;   // fin de la recepción, referencia de la baliza
+
+void startCalibration(unsigned long warmupMs, bool reply);
+void applyCalibration();
+void updateAlarmLevel();
 float calculateResistance(int raw_adc);
-float readGasPPM();
-float readGasRatio();
-void readAndSendGasData();
+void readAndSendGasData(bool force);
+void sendReading(LecturaGas& reading, uint8_t type);
 void sendLoRaMessage(String message);
-void checkIncomingMessages();
+void sendLoRaFrame(const uint8_t* frame, size_t len);
+void sendLoRaBytes(const uint8_t* data, size_t len);
+void setRadio(uint8_t sf, uint8_t power);
+void applyRadio();
+void radioFallback();
+void onBeacon(const uint8_t* data, uint8_t len, unsigned long at);
+bool tdmaReady();
+unsigned long nextSlotMs(unsigned long now);
+void onLoRaReceive(int packetSize);
+void onLoRaTxDone();
+void sampleTaskRun();
+void txDoneTaskRun();
+void commandTaskRun();
+void calibrationTaskRun();
+void preheatTaskRun();
+void ageTaskRun();
+void watchTaskRun();
+void alarmTaskRun();
+void slotTaskRun();
+void saveCalibration();
 void processMessage(String message);
 
 
@@ -50,25 +184,73 @@ void setup() {
   
   Serial.println(F("=== NODO SENSOR NANO INICIANDO ==="));
 
+  // Estado de arranque. En AVR las globales ya vienen así; en el host un
+  // reinicio simulado no las vuelve a inicializar.
+  scheduler.reset();
+  calibration.cancel();
+  roValid = preheated = txBusy = calibrationReply = alertActive = false;
+  replyFramed = haveCommandSeq = calibrationFramed = false;
+  pendingTxLen = alarmRepeats = 0;
+  txSeq = 0;   // el gateway reconoce el reinicio por la secuencia en 0
+  radioSf = RADIO_SF;
+  radioPower = RADIO_POWER_MAX;
+  uplinksSinceDownlink = 0;
+  tdmaSlot = TDMA_NO_SLOT;
+  tdmaSynced = slotPending = false;
+  rxReady = false;
+
   // Inicializar LoRa
   LoRa.setPins(PIN_SS, PIN_RST, PIN_DIO0);
   if (!LoRa.begin(915E6)) {
     Serial.println(F("Error iniciando LoRa"));
     while (1);
   }
-  LoRa.setTxPower(20);
-  LoRa.setSpreadingFactor(7);
+  applyRadio();
+  LoRa.onReceive(onLoRaReceive);
+  LoRa.onTxDone(onLoRaTxDone);
   Serial.println(F("LoRa listo"));
 
-  // Calibrar sensor MQ
-  Serial.println(F("Calibrando sensor MQ..."));
-  Serial.println(F("Tiene que estar el aire limpio"));
-  delay(2000);
-  
-  Ro = calibrateSensor();
-  Serial.print(F("Calibracion completa. Ro = "));
-  Serial.print(Ro, 2);
-  Serial.println(F(" kΩ"));
+  sampleTask  = scheduler.add(sampleTaskRun);
+  txDoneTask  = scheduler.add(txDoneTaskRun);
+  commandTask = scheduler.add(commandTaskRun);
+  calibrationTask = scheduler.add(calibrationTaskRun);
+  preheatTask = scheduler.add(preheatTaskRun);
+  ageTask     = scheduler.add(ageTaskRun);
+  watchTask   = scheduler.add(watchTaskRun);
+  alarmTask   = scheduler.add(alarmTaskRun);
+  slotTask    = scheduler.add(slotTaskRun);
+
+  if (policy.load()) Serial.println(F("Configuracion de reporte restaurada"));
+
+  // Arranque en caliente: se reutiliza el Ro guardado si no es muy viejo
+  float storedRo;
+  uint16_t storedAge;
+  if (calibrationStore.load(storedRo, storedAge) && storedAge < CALIB_MAX_AGE) {
+    Ro = storedRo;
+    calibrationAge = storedAge;
+    roValid = true;
+    scheduler.runIn(ageTask, HOUR_MS);
+    Serial.print(F("Ro guardado = "));
+    Serial.print(Ro, 2);
+    Serial.print(F(" kΩ ("));
+    Serial.print(storedAge);
+    Serial.println(F(" h)"));
+  } else {
+    Serial.println(F("Sin Ro guardado: se calibra al terminar el precalentamiento"));
+    Serial.println(F("Tiene que estar el aire limpio"));
+  }
+  applyCalibration();
+
+  // El nodo transmite desde ya, con TRAMA_FLAG_PRECALENTANDO hasta que la
+  // lectura del ADC se estabilice
+  preheatStart = millis();
+  preheat.reset();
+  scheduler.runIn(preheatTask, 0);
+
+  // RX continuo: los comandos llegan por interrupción en cualquier momento
+  LoRa.receive();
+  scheduler.runIn(sampleTask, 0);
+  scheduler.runIn(watchTask, ALARM_WATCH);
   
   Serial.println(F("=== NODO SENSOR LISTO ===\n"));
 }
@@ -77,35 +259,208 @@ void setup() {
 // LOOP PRINCIPAL
 //=======================================
 void loop() {
-  // Enviar datos del sensor cada intervalo
-  if (millis() - lastSendTime > SEND_INTERVAL) {
-    readAndSendGasData();
-    lastSendTime = millis();
+  // Ejecutar lo que venció y dormir hasta el próximo plazo o interrupción
+  scheduler.runDue();
+  scheduler.sleep();
+}
+
+//=======================================
+// TAREAS
+//=======================================
+
+void sampleTaskRun() {
+  scheduler.runIn(sampleTask, SAMPLE_INTERVAL);
+  readAndSendGasData(false);
+}
+
+// Fin de transmisión: sale lo pendiente o se vuelve a escuchar
+void txDoneTaskRun() {
+  txBusy = false;
+  if (radioChanged) applyRadio();
+  if (pendingTxLen) {
+    uint8_t data[TX_BUFFER_SIZE];
+    uint8_t len = pendingTxLen;
+    memcpy(data, pendingTx, len);
+    pendingTxLen = 0;
+    sendLoRaBytes(data, len);
+  } else {
+    LoRa.receive();
   }
-  
-  // Verificar comandos recibidos
-  checkIncomingMessages();
-  
-  delay(100);
+}
+
+void commandTaskRun() {
+  uint8_t data[RX_BUFFER_SIZE + 1];
+  noInterrupts();
+  uint8_t len = rxLen;
+  for (uint8_t i = 0; i < len; i++) data[i] = rxBuffer[i];
+  unsigned long at = rxMs;
+  rxReady = false;
+  interrupts();
+
+  const char* text = (const char*)data;
+  if (tramaEsBinaria(data, len) && tramaTipo(data[0]) == TRAMA_TIPO_BALIZA) {
+    onBeacon(data, len, at);
+    return;
+  }
+  if (tramaEsBinaria(data, len)) {
+    uint8_t node;
+    uint16_t seq;
+    size_t textLen;
+    if (!tramaDecodificarTexto(data, len, TRAMA_TIPO_COMANDO, node, seq, text, textLen)) return;
+    if (node != NODE_ID) return;   // comando para otro nodo
+    uplinksSinceDownlink = 0;      // el gateway nos escucha
+
+    replyFramed = true;
+    replySeq = seq;
+    if (haveCommandSeq && seq == lastCommandSeq) {
+      // Reintento del gateway: ya se ejecutó, sólo falta confirmarlo
+      sendLoRaMessage(F("DUPLICATE"));
+      replyFramed = false;
+      return;
+    }
+    haveCommandSeq = true;
+    lastCommandSeq = seq;
+    len = (uint8_t)textLen;
+  }
+  char message[RX_BUFFER_SIZE + 1];
+  memcpy(message, text, len);
+  message[len] = '\0';
+
+  Serial.print(F(" Recibido: "));
+  Serial.println(message);
+  replySent = false;
+  processMessage(String(message));
+
+  // STATUS y CALIBRATE no responden en el momento: el gateway necesita el ACK
+  if (replyFramed && !replySent) sendLoRaMessage(F("ACK"));
+  replyFramed = false;
+}
+
+// Una muestra por paso; el resto del tiempo el MCU duerme o atiende la radio
+void calibrationTaskRun() {
+  if (!calibration.addSample(calculateResistance(analogRead(GAS_PIN)))) {
+    scheduler.runIn(calibrationTask, CALIB_DELAY);
+    return;
+  }
+
+  bool firstRo = !roValid;
+  Ro = calibration.ro();
+  applyCalibration();
+  roValid = true;
+  calibrationAge = 0;
+  saveCalibration();
+  scheduler.runIn(ageTask, HOUR_MS);
+#if BASELINE_TRACKING
+  baseline.reset(millis());
+#endif
+  Serial.print(F("Calibracion completa. Ro = "));
+  Serial.print(Ro, 2);
+  Serial.println(F(" kΩ"));
+
+  if (firstRo) scheduler.runIn(sampleTask, 0);
+  if (calibrationReply) {
+    String response = F("CALIBRATION_OK|Ro:");
+    response += String(Ro, 2);
+    replyFramed = calibrationFramed;
+    replySeq = calibrationSeq;
+    sendLoRaMessage(response);
+    replyFramed = false;
+  }
+}
+
+// Espera a que el calentador se estabilice mirando la pendiente del ADC
+void preheatTaskRun() {
+  bool stable = preheat.addSample(analogRead(GAS_PIN));
+  if (!stable && millis() - preheatStart < PREHEAT_TIMEOUT) {
+    scheduler.runIn(preheatTask, PREHEAT_SAMPLE);
+    return;
+  }
+
+  preheated = true;
+  Serial.print(F("Sensor estable en "));
+  Serial.print(millis() - preheatStart);
+  Serial.println(F(" ms"));
+
+  if (roValid) {
+    scheduler.runIn(sampleTask, 0);    // primera lectura confiable ya
+  } else {
+    startCalibration(0, false);
+  }
+}
+
+// Antigüedad del Ro en horas de uso, persistida cada hora
+void ageTaskRun() {
+  scheduler.runIn(ageTask, HOUR_MS);
+  if (calibrationAge < 0xFFFF) calibrationAge++;
+  saveCalibration();
+}
+
+// Entre muestras sólo se compara el ADC contra alarmRaw; un cruce adelanta
+// la medición completa, que manda la trama de alarma
+void watchTaskRun() {
+  scheduler.runIn(watchTask, ALARM_WATCH);
+  if (!roValid || !preheated) return;
+  bool above = (uint16_t)analogRead(GAS_PIN) >= alarmRaw;
+  if (above != alertActive) readAndSendGasData(false);
+}
+
+// Repite la última trama de alarma (misma secuencia: el gateway la reconoce)
+void alarmTaskRun() {
+  sendLoRaFrame(alarmFrame, sizeof(alarmFrame));
+  if (--alarmRepeats) scheduler.runIn(alarmTask, ALARM_REPEAT_MS + random(ALARM_REPEAT_MS / 2));
+}
+
+// Comienzo del slot propio: sale la lectura más nueva que esperaba
+void slotTaskRun() {
+  if (!slotPending) return;
+  slotPending = false;
+  sendReading(slotReading, TRAMA_TIPO_DATOS);
+}
+
+void saveCalibration() {
+  calibrationStore.save(Ro, calibrationAge);
+}
+
+//=======================================
+// INTERRUPCIONES DE LA RADIO (DIO0)
+//=======================================
+
+void onLoRaReceive(int packetSize) {
+  if (rxReady) return;   // el comando anterior todavía no se procesó
+  uint8_t len = 0;
+  while (LoRa.available() && len < RX_BUFFER_SIZE) rxBuffer[len++] = (uint8_t)LoRa.read();
+  (void)packetSize;
+  rxMs = millis();
+  rxLen = len;
+  rxReady = true;
+  scheduler.post(commandTask);
+}
+
+void onLoRaTxDone() {
+  scheduler.post(txDoneTask);
 }
 
 //=======================================
 // FUNCIONES DEL SENSOR MQ
 //=======================================
 
-float calibrateSensor() {
-  float val = 0;
-  
-  // Tomar múltiples muestras para calibración
-  for (int i = 0; i < CALIB_SAMPLES; i++) {
-    val += calculateResistance(analogRead(GAS_PIN));
-    delay(CALIB_DELAY);
-  }
-  
-  val = val / CALIB_SAMPLES;                    // Promedio
-  val = val / CLEAN_AIR_RATIO;                  // Rs/Ro = CLEAN_AIR_RATIO
-  
-  return val;
+// Reinicia la acumulación; una calibración en curso vuelve a empezar
+void startCalibration(unsigned long warmupMs, bool reply) {
+  calibration.start();
+  calibrationReply = reply;
+  calibrationFramed = reply && replyFramed;
+  calibrationSeq = replySeq;
+  scheduler.runIn(calibrationTask, warmupMs);
+}
+
+// Ro nuevo: curva y nivel de alarma
+void applyCalibration() {
+  curve.setRo(Ro);
+  updateAlarmLevel();
+}
+
+void updateAlarmLevel() {
+  alarmRaw = curve.rawAbove(policy.threshold());
 }
 
 float calculateResistance(int raw_adc) {
@@ -117,50 +472,77 @@ float calculateResistance(int raw_adc) {
   return rs;
 }
 
-float readGasPPM() {
-  float rs = calculateResistance(analogRead(GAS_PIN));
-  float ratio = rs / Ro;
-  
-  // Ecuación para MQ-2 (aproximada)
-  // PPM = A * (Rs/Ro)^B donde A=574.25, B=-2.222
-  float ppm = 574.25 * pow(ratio, -2.222);
-  
-  // Limitar valores extremos
-  if (ppm < 0) ppm = 0;
-  if (ppm > 10000) ppm = 10000;
-  
-  return ppm;
-}
-
-float readGasRatio() {
-  float rs = calculateResistance(analogRead(GAS_PIN));
-  return rs / Ro;
-}
-
 //=======================================
 // FUNCIONES PRINCIPALES
 //=======================================
 
-void readAndSendGasData() {
-  Serial.println(F("--- Leyendo sensor de gas ---"));
-  
-  // Leer sensor MQ
+// Mide siempre; transmite si ReportPolicy lo pide o si force (STATUS)
+void readAndSendGasData(bool force) {
+  // Una sola conversión del ADC: ratio y ppm corresponden a la misma muestra
   int rawValue = analogRead(GAS_PIN);
-  float voltage = ((float)rawValue / ADC_RESOLUTION) * VCC;
-  float rs = calculateResistance(rawValue);
-  float ratio = readGasRatio();
-  float ppm = readGasPPM();
+  float ratio, ppm;
+  curve.evaluate(rawValue, ratio, ppm);
+  float rs = ratio * Ro;
   
+  // Evaluar umbral (sin Ro o con el sensor frío el ppm no es confiable)
+  bool reliable = roValid && preheated;
+  bool alert = reliable && ppm > policy.threshold();
+
+#if BASELINE_TRACKING
+  if (reliable && !calibration.active() && baseline.update(rs, millis(), Ro)) {
+    applyCalibration();
+    calibrationAge = 0;
+    saveCalibration();
+    Serial.print(F("Linea base corregida. Ro = "));
+    Serial.println(Ro, 2);
+  }
+#endif
+
+  uint8_t flags = alert ? TRAMA_FLAG_ALERTA : 0;
+  if (calibration.active()) flags |= tramaFlagsCalibracion(calibration.progress());
+  if (!roValid) flags |= TRAMA_FLAG_SIN_RO;
+  if (!preheated) flags |= TRAMA_FLAG_PRECALENTANDO;
+
+  unsigned long now = millis();
+  if (!force && !policy.shouldSend(ppm, flags, now)) return;
+  policy.markSent(ppm, flags, now);
+  bool edge = alert != alertActive;
+  alertActive = alert;
+
   // Mostrar lecturas en Serial
+  Serial.println(F("--- Leyendo sensor de gas ---"));
   Serial.print(F("Raw: ")); Serial.print(rawValue);
-  Serial.print(F(" | V: ")); Serial.print(voltage, 2);
+  Serial.print(F(" | V: ")); Serial.print(rawValue * (VCC / ADC_RESOLUTION), 2);
   Serial.print(F("V | Rs: ")); Serial.print(rs, 2);
   Serial.print(F("kΩ | Ratio: ")); Serial.print(ratio, 2);
   Serial.print(F(" | PPM: ")); Serial.println(ppm, 1);
-  
-  // Evaluar umbral
-  String status = (ppm > GAS_THRESHOLD) ? F("ALERTA") : F("NORMAL");
-  
+
+#if USE_BINARY_FRAME
+  LecturaGas reading;
+  reading.nodo  = NODE_ID;
+  reading.ppm   = ppm;
+  reading.ratio = ratio;
+  reading.raw   = rawValue;
+  reading.flags = flags;
+
+  if (edge || force) {
+    // La alarma no espera el turno y deja sin efecto la lectura pendiente;
+    // STATUS responde en la ventana de contención
+    slotPending = false;
+    scheduler.cancel(slotTask);
+    sendReading(reading, edge ? TRAMA_TIPO_ALARMA : TRAMA_TIPO_DATOS);
+  } else if (tdmaReady()) {
+    // Una lectura más nueva reemplaza a la que esperaba el slot
+    slotReading = reading;
+    slotPending = true;
+    scheduler.runIn(slotTask, nextSlotMs(now) - now);
+    Serial.println(F("--- En espera del slot ---\n"));
+    return;
+  } else {
+    sendReading(reading, TRAMA_TIPO_DATOS);
+  }
+#else
+  (void)edge;
   // Crear mensaje
   String message = F("GAS_DATA|PPM:");
   message += String(ppm, 1);
@@ -169,35 +551,160 @@ void readAndSendGasData() {
   message += F("|Raw:");
   message += String(rawValue);
   message += F("|Status:");
-  message += status;
+  message += alert ? F("ALERTA") : F("NORMAL");
+  if (calibration.active()) {
+    message += F("|Calib:");
+    message += String(calibration.progress());
+  }
   
   // Enviar por LoRa
   sendLoRaMessage(message);
+#endif
   
   Serial.println(F("--- Datos enviados ---\n"));
 }
 
+// La secuencia se asigna al transmitir: una lectura reemplazada mientras
+// esperaba el slot no cuenta como perdida en el gateway
+void sendReading(LecturaGas& reading, uint8_t type) {
+  reading.seq = txSeq++;
+  uint8_t frame[TRAMA_LARGO_DATOS];
+  size_t len = tramaCodificarDatos(reading, frame, sizeof(frame), type);
+  sendLoRaFrame(frame, len);
+  radioFallback();
+  if (type == TRAMA_TIPO_ALARMA) {
+    // Una trama perdida no puede dejar al gateway sin enterarse del cruce
+    memcpy(alarmFrame, frame, sizeof(alarmFrame));
+    alarmRepeats = ALARM_REPEATS;
+    scheduler.runIn(alarmTask, ALARM_REPEAT_MS + random(ALARM_REPEAT_MS / 2));
+  }
+}
+
 void sendLoRaMessage(String message) {
-  LoRa.beginPacket();
-  LoRa.print(message);
-  LoRa.endPacket();
+  if (replyFramed) {
+    uint8_t frame[TX_BUFFER_SIZE];
+    size_t len = tramaCodificarTexto(TRAMA_TIPO_RESPUESTA, NODE_ID, replySeq,
+                                     message.c_str(), message.length(), frame, sizeof(frame));
+    sendLoRaBytes(frame, len);
+    replySent = true;
+  } else {
+    sendLoRaBytes((const uint8_t*)message.c_str(), message.length());
+  }
   
   Serial.print(F(" Enviado: "));
   Serial.println(message);
 }
 
-void checkIncomingMessages() {
-  int packetSize = LoRa.parsePacket();
-  if (packetSize) {
-    String receivedMsg = "";
-    while (LoRa.available()) {
-      receivedMsg += (char)LoRa.read();
-    }
-    
-    Serial.print(F(" Recibido: "));
-    Serial.println(receivedMsg);
-    processMessage(receivedMsg);
+void sendLoRaFrame(const uint8_t* frame, size_t len) {
+  sendLoRaBytes(frame, len);
+
+  Serial.print(F(" Enviada trama binaria de "));
+  Serial.print(len);
+  Serial.println(F(" bytes"));
+}
+
+// endPacket(true) no bloquea: el fin de la transmisión llega por DIO0
+void sendLoRaBytes(const uint8_t* data, size_t len) {
+  if (len > TX_BUFFER_SIZE) len = TX_BUFFER_SIZE;
+  if (txBusy) {
+    memcpy(pendingTx, data, len);
+    pendingTxLen = len;
+    return;
   }
+  LoRa.beginPacket();
+  LoRa.write(data, len);
+  LoRa.endPacket(true);
+  txBusy = true;
+}
+
+// Con la radio transmitiendo el cambio queda para txDoneTaskRun()
+void setRadio(uint8_t sf, uint8_t power) {
+  radioSf = sf;
+  radioPower = power;
+  radioChanged = true;
+  if (txBusy) return;
+  LoRa.idle();
+  applyRadio();
+  LoRa.receive();
+}
+
+void applyRadio() {
+  LoRa.setSpreadingFactor(radioSf);
+  LoRa.setTxPower(radioPower);
+  radioChanged = false;
+}
+
+// Un paso hacia el ajuste robusto cada RADIO_ACK_DELAY envíos, pasados
+// RADIO_ACK_LIMIT sin bajada
+void radioFallback() {
+  if (++uplinksSinceDownlink < RADIO_ACK_LIMIT) return;
+  uplinksSinceDownlink = RADIO_ACK_LIMIT - RADIO_ACK_DELAY;
+  if (radioPower < RADIO_POWER_MAX) {
+    setRadio(radioSf, min(radioPower + 3, RADIO_POWER_MAX));
+  } else if (radioSf != RADIO_SF) {
+    setRadio(RADIO_SF, RADIO_POWER_MAX);
+  } else {
+    return;
+  }
+  Serial.print(F("Sin bajadas: potencia "));
+  Serial.print(radioPower);
+  Serial.print(F(" dBm, SF"));
+  Serial.println(radioSf);
+}
+
+//=======================================
+// TDMA
+//=======================================
+
+// Baliza del gateway; at es millis() al fin de la recepción
+void onBeacon(const uint8_t* data, uint8_t len, unsigned long at) {
+  BalizaTdma b;
+  if (!tramaDecodificarBaliza(data, len, b)) return;
+
+  if (tdmaSlot != TDMA_NO_SLOT && b.epoca != tdmaEpoch) {
+    // El gateway arrancó de nuevo: el slot era de otro plan
+    tdmaSlot = TDMA_NO_SLOT;
+    Serial.println(F("TDMA: baliza de otra epoca, sin slot"));
+  }
+
+  // Período local medido sobre las balizas recibidas desde la anterior
+  uint16_t gap = b.numero - beacon.numero;
+  if (!tdmaSynced || b.periodoMs != beacon.periodoMs) beaconPeriod = b.periodoMs;
+  if (tdmaSynced && gap >= 1 && gap <= TDMA_MISSED_MAX) {
+    unsigned long measured = (at - beaconMs) / gap;
+    unsigned long tolerance = (unsigned long)b.periodoMs * TDMA_DRIFT_MAX / 100;
+    if (measured + tolerance >= b.periodoMs && measured <= b.periodoMs + tolerance) beaconPeriod = measured;
+  }
+
+  beacon = b;
+  beaconMs = at;
+  tdmaSynced = true;
+  // Una lectura que esperaba un slot ya descartado sale en la contención
+  if (slotPending) scheduler.runIn(slotTask, nextSlotMs(millis()) - millis());
+}
+
+// Con slot vigente y la baliza reciente. Un slot recién asignado rige
+// cuando la baliza ya lo cuenta entre los usados.
+bool tdmaReady() {
+  if (tdmaSlot == TDMA_NO_SLOT || !tdmaSynced || tdmaSlot >= beacon.slots) return false;
+  if (millis() - beaconMs > beaconPeriod * TDMA_MISSED_MAX + beaconPeriod / 2) {
+    tdmaSynced = false;
+    Serial.println(F("TDMA: sin baliza, acceso aleatorio"));
+    return false;
+  }
+  return true;
+}
+
+// Próximo comienzo del slot propio (más la guarda) en millis() del nodo.
+// Sin slot en el plan de la baliza, el de la ventana de contención, que
+// sigue al último slot, hasta que llegue un SLOT: nuevo.
+unsigned long nextSlotMs(unsigned long now) {
+  uint8_t slot = tdmaSlot < beacon.slots ? tdmaSlot : beacon.slots;
+  unsigned long offset = beacon.inicioMs + (unsigned long)slot * beacon.slotMs + TRAMA_TDMA_GUARDA_MS;
+  offset = offset * beaconPeriod / beacon.periodoMs;
+  unsigned long at = beaconMs + offset;
+  while ((long)(now - at) > 0) at += beaconPeriod;   // superciclos sin baliza todavía
+  return at;
 }
 
 void processMessage(String message) {
@@ -207,28 +714,22 @@ void processMessage(String message) {
   if (message == "STATUS") {
     // Enviar datos inmediatamente
     Serial.println(F("Solicitud de estado recibida"));
-    readAndSendGasData();
+    readAndSendGasData(true);
     
   } else if (message == "CALIBRATE") {
     // Re-calibrar sensor
     Serial.println(F("Re-calibrando sensor..."));
     Serial.println(F("Asegurate que este en aire limpio"));
-    delay(3000);
-    
-    Ro = calibrateSensor();
-    Serial.print(F("Nueva calibracion: Ro = "));
-    Serial.print(Ro, 2);
-    Serial.println(F(" kΩ"));
-    
-    String response = F("CALIBRATION_OK|Ro:");
-    response += String(Ro, 2);
-    sendLoRaMessage(response);
+    // Sigue midiendo con el Ro anterior; CALIBRATION_OK sale al terminar
+    startCalibration(RECALIB_WARMUP, true);
     
   } else if (message.startsWith("THRESHOLD:")) {
-    // Cambiar umbral (ejemplo: THRESHOLD:600)
-    float newThreshold = message.substring(10).toFloat();
-    if (newThreshold > 0 && newThreshold < 5000) {
-      Serial.print(F("Solicitud cambio umbral a: "));
+    // Cambiar umbral (ejemplo: THRESHOLD:600), se aplica y se guarda
+    long newThreshold = message.substring(10).toInt();
+    if (newThreshold > 0 && newThreshold < ReportPolicy::THRESHOLD_MAX &&
+        policy.setThreshold((uint16_t)newThreshold)) {
+      updateAlarmLevel();
+      Serial.print(F("Nuevo umbral: "));
       Serial.println(newThreshold);
       
       String response = F("THRESHOLD_ACK|");
@@ -238,12 +739,73 @@ void processMessage(String message) {
       sendLoRaMessage(F("THRESHOLD_ERROR|INVALID_VALUE"));
     }
     
+  } else if (message.startsWith("DEADBAND:")) {
+    // Banda muerta del reporte por excepción en ppm (ejemplo: DEADBAND:25)
+    long newDeadband = message.substring(9).toInt();
+    if (newDeadband >= 0 && newDeadband <= ReportPolicy::DEADBAND_MAX &&
+        policy.setDeadband((uint16_t)newDeadband)) {
+      String response = F("DEADBAND_ACK|");
+      response += String(newDeadband);
+      sendLoRaMessage(response);
+    } else {
+      sendLoRaMessage(F("DEADBAND_ERROR|INVALID_VALUE"));
+    }
+    
+  } else if (message.startsWith("HEARTBEAT:")) {
+    // Segundos entre envíos con el ppm estable (ejemplo: HEARTBEAT:300)
+    long newHeartbeat = message.substring(10).toInt();
+    if (newHeartbeat > 0 && newHeartbeat <= ReportPolicy::HEARTBEAT_MAX_S &&
+        policy.setHeartbeat((uint16_t)newHeartbeat)) {
+      String response = F("HEARTBEAT_ACK|");
+      response += String(newHeartbeat);
+      sendLoRaMessage(response);
+    } else {
+      sendLoRaMessage(F("HEARTBEAT_ERROR|INVALID_VALUE"));
+    }
+    
+  } else if (message.startsWith("RADIO:")) {
+    // Ajuste del ADR del gateway (ejemplo: RADIO:7:11). El ACK sale con
+    // el ajuste anterior y el nuevo se aplica al terminar la transmisión.
+    int sep = message.indexOf(':', 6);
+    long sf = message.substring(6, sep).toInt();
+    long power = sep > 0 ? message.substring(sep + 1).toInt() : 0;
+    if (sep > 0 && sf >= 7 && sf <= 12 && power >= RADIO_POWER_MIN && power <= RADIO_POWER_MAX) {
+      String response = F("RADIO_ACK|");
+      response += String(sf);
+      response += '|';
+      response += String(power);
+      sendLoRaMessage(response);
+      setRadio((uint8_t)sf, (uint8_t)power);
+    } else {
+      sendLoRaMessage(F("RADIO_ERROR|INVALID_VALUE"));
+    }
+
+  } else if (message.startsWith("SLOT:")) {
+    // Turno TDMA del gateway (ejemplo: SLOT:12:3); rige con la baliza de esa época
+    int sep = message.indexOf(':', 5);
+    long slot = message.substring(5, sep).toInt();
+    long epoch = sep > 0 ? message.substring(sep + 1).toInt() : -1;
+    if (sep > 0 && slot >= 0 && slot < TDMA_NO_SLOT && epoch >= 0 && epoch <= 255) {
+      tdmaSlot = (uint8_t)slot;
+      tdmaEpoch = (uint8_t)epoch;
+      if (tdmaSynced && beacon.epoca != tdmaEpoch) tdmaSynced = false;
+      String response = F("SLOT_ACK|");
+      response += String(slot);
+      sendLoRaMessage(response);
+    } else {
+      sendLoRaMessage(F("SLOT_ERROR|INVALID_VALUE"));
+    }
+
   } else if (message == "INFO") {
     // Enviar información del nodo
     String info = F("NODE_INFO|TYPE:SENSOR|MCU:NANO|Ro:");
     info += String(Ro, 2);
-    info += F("|THRESHOLD:");
-    info += String(GAS_THRESHOLD);
+    info += F("|TH:");
+    info += String(policy.threshold());
+    info += F("|DB:");
+    info += String(policy.deadband());
+    info += F("|HB:");
+    info += String(policy.heartbeat());
     sendLoRaMessage(info);
     
   } else if (message == "RESET") {
@@ -251,7 +813,11 @@ void processMessage(String message) {
     sendLoRaMessage(F("RESET_ACK"));
     delay(1000);
   
+#ifdef ARDUINO_NATIVO
+    nativoReiniciar();         // Simulación en el host
+#else
     asm volatile ("  jmp 0");  // Reset por software
+#endif
     
   } else {
     Serial.print(F("Comando no reconocido: "));
@@ -0,0 +1,55 @@
+#ifndef TIEMPO_EN_AIRE_H
+#define TIEMPO_EN_AIRE_H
+
+#include <stdint.h>
+#include <math.h>
+
+//=============================================
+// Tiempo en el aire de un paquete LoRa (SX127x, AN1200.13 de Semtech)
+//=============================================
+// Valores por defecto = los de la librería sandeepmistry/LoRa tras begin():
+// BW 125 kHz, CR 4/5, preámbulo de 8 símbolos, cabecera explícita, sin CRC.
+// La optimización para baja tasa (LDRO) se activa como en la librería,
+// cuando el símbolo dura más de 16 ms.
+
+struct ParametrosRadio {
+  uint8_t  sf;            // Spreading factor 6..12
+  uint32_t bw;            // Ancho de banda en Hz
+  uint8_t  cr;            // Denominador 5..8 (4/5 .. 4/8)
+  uint16_t preambulo;     // Símbolos de preámbulo
+  bool     crc;
+  bool     cabeceraImplicita;
+};
+
+static inline ParametrosRadio radioPorDefecto(uint8_t sf) {
+  ParametrosRadio p = { sf, 125000UL, 5, 8, false, false };
+  return p;
+}
+
+static inline float duracionSimboloMs(const ParametrosRadio& p) {
+  return (float)(1UL << p.sf) * 1000.0f / (float)p.bw;
+}
+
+static inline float tiempoEnAireMs(const ParametrosRadio& p, uint8_t largoPayload) {
+  float tSim = duracionSimboloMs(p);
+  int   ldro = (tSim > 16.0f) ? 1 : 0;
+
+  float tPreambulo = ((float)p.preambulo + 4.25f) * tSim;
+
+  float num = 8.0f * largoPayload - 4.0f * p.sf + 28.0f
+            + (p.crc ? 16.0f : 0.0f) - (p.cabeceraImplicita ? 20.0f : 0.0f);
+  float den = 4.0f * (p.sf - 2 * ldro);
+  float bloques = ceilf(num / den);
+  if (bloques < 0) bloques = 0;
+  float simbolosPayload = 8.0f + bloques * (float)p.cr;
+
+  return tPreambulo + simbolosPayload * tSim;
+}
+
+// SNR mínimo para demodular (hoja de datos del SX1276): -7.5 dB en SF7 y
+// 2.5 dB menos por cada SF
+static inline float snrMinimoDb(uint8_t sf) {
+  return -7.5f - 2.5f * ((float)sf - 7.0f);
+}
+
+#endif
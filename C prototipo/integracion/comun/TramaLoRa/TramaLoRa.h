@@ -0,0 +1,350 @@
+#ifndef TRAMA_LORA_H
+#define TRAMA_LORA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//=============================================
+// Trama binaria LoRa compartida Nodo Sensor <-> Nodo Central
+//=============================================
+// Formato fijo, little-endian, versión 1 (13 bytes):
+//
+//   [0]     cabecera  = (versión << 4) | tipo
+//   [1]     id de nodo
+//   [2..3]  número de secuencia
+//   [4..5]  ppm   x TRAMA_ESCALA_PPM   (saturado a 0..65535)
+//   [6..7]  ratio x TRAMA_ESCALA_RATIO (saturado a 0..65535)
+//   [8..9]  valor crudo del ADC
+//   [10]    flags de estado (TRAMA_FLAG_*)
+//   [11..12] CRC-16/CCITT-FALSE de los bytes [0..10]
+//
+// El primer byte nunca es imprimible, así que el gateway distingue la trama
+// binaria del formato ASCII "GAS_DATA|..." mirando sólo el primer byte.
+//
+// TRAMA_TIPO_ALARMA lleva la misma carga que una trama de datos pero marca
+// un cambio de TRAMA_FLAG_ALERTA: el sensor la manda apenas cruza el umbral
+// (y al volver por debajo), repetida con la misma secuencia, y el gateway
+// la atiende antes que la telemetría encolada.
+//
+// Comandos (gateway -> nodo) y respuestas (nodo -> gateway) llevan texto:
+//
+//   [0]      cabecera (TRAMA_TIPO_COMANDO o TRAMA_TIPO_RESPUESTA)
+//   [1]      nodo destino / nodo que responde
+//   [2..3]   secuencia del comando (la respuesta repite la del comando)
+//   [4..n-3] texto ASCII: "THRESHOLD:600", "THRESHOLD_ACK|600"...
+//   [n-2..n-1] CRC-16/CCITT-FALSE de los bytes anteriores
+//
+// La baliza TDMA (gateway -> todos) fija el reparto del canal. El tiempo se
+// mide desde el fin de la baliza: el nodo con slot s transmite en
+// inicio + s * slotMs, dejando TRAMA_TDMA_GUARDA_MS libres antes del inicio
+// de la trama. Después del último slot queda la ventana de contención
+// (comandos del gateway, nodos sin slot) hasta la baliza siguiente.
+//
+//   [0]      cabecera (TRAMA_TIPO_BALIZA)
+//   [1..2]   número de baliza
+//   [3..4]   período del superciclo en ms
+//   [5..6]   inicio del slot 0 en ms
+//   [7]      duración de cada slot en ms
+//   [8]      cantidad de slots en uso
+//   [9]      época del plan: cambia cuando el gateway arranca de nuevo
+//   [10..11] CRC-16/CCITT-FALSE de los bytes [0..9]
+
+#define TRAMA_VERSION          1
+#define TRAMA_TIPO_DATOS       0x1
+#define TRAMA_TIPO_ALARMA      0x2
+#define TRAMA_TIPO_COMANDO     0x3
+#define TRAMA_TIPO_RESPUESTA   0x4
+#define TRAMA_TIPO_BALIZA      0x5
+
+#define TRAMA_LARGO_DATOS      13
+#define TRAMA_LARGO_MAX        72     // Mayor paquete que aceptamos por radio
+#define TRAMA_LARGO_TEXTO_MIN  6      // trama de texto vacía: cabecera, nodo, seq y CRC
+#define TRAMA_LARGO_BALIZA     12
+
+#define TRAMA_TDMA_GUARDA_MS   10     // margen a cada lado de la trama dentro del slot
+
+#define TRAMA_ESCALA_PPM       5      // Resolución 0.2 ppm, máximo ~13107 ppm
+#define TRAMA_ESCALA_RATIO     100    // Resolución 0.01
+
+#define TRAMA_FLAG_ALERTA        0x01   // ppm por encima del umbral del nodo
+#define TRAMA_FLAG_CALIBRANDO    0x02   // calibración de Ro en curso, progreso en los bits 4..7
+#define TRAMA_FLAG_SIN_RO        0x04   // todavía no hay Ro calibrado: el ppm no es confiable
+#define TRAMA_FLAG_PRECALENTANDO 0x08   // el calentador del MQ no se estabilizó todavía
+
+// ppm utilizable para alarmas y control
+static inline bool tramaPpmConfiable(uint8_t flags) {
+  return !(flags & (TRAMA_FLAG_SIN_RO | TRAMA_FLAG_PRECALENTANDO));
+}
+
+// Progreso de la calibración en el nibble alto de flags, en pasos de 1/15
+#define TRAMA_CALIBRACION_PASOS 15
+
+static inline uint8_t tramaFlagsCalibracion(uint8_t porcentaje) {
+  if (porcentaje > 100) porcentaje = 100;
+  return (uint8_t)(TRAMA_FLAG_CALIBRANDO | (((porcentaje * TRAMA_CALIBRACION_PASOS + 50) / 100) << 4));
+}
+
+static inline uint8_t tramaProgresoCalibracion(uint8_t flags) {
+  return (uint8_t)((flags >> 4) * 100 / TRAMA_CALIBRACION_PASOS);
+}
+
+// Lectura ya decodificada, independiente del formato en el aire
+struct LecturaGas {
+  uint8_t  nodo;
+  uint16_t seq;
+  float    ppm;
+  float    ratio;
+  uint16_t raw;
+  uint8_t  flags;
+};
+
+// Reparto del canal anunciado por la baliza
+struct BalizaTdma {
+  uint16_t numero;
+  uint16_t periodoMs;
+  uint16_t inicioMs;
+  uint8_t  slotMs;
+  uint8_t  slots;
+  uint8_t  epoca;
+};
+
+// Prefijo del formato ASCII heredado: GAS_DATA|PPM:523.4|Ratio:1.23|Raw:612|Status:ALERTA
+// Mientras el nodo calibra agrega |Calib:NN (porcentaje de avance).
+#define TRAMA_ASCII_PREFIJO    "GAS_DATA|"
+
+static inline uint8_t tramaCabecera(uint8_t tipo) {
+  return (uint8_t)((TRAMA_VERSION << 4) | (tipo & 0x0F));
+}
+
+static inline uint8_t tramaVersion(uint8_t cabecera) { return cabecera >> 4; }
+static inline uint8_t tramaTipo(uint8_t cabecera)    { return cabecera & 0x0F; }
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), bit a bit para no gastar
+// RAM ni flash en una tabla en el Nano.
+static inline uint16_t crc16Ccitt(const uint8_t* datos, size_t largo) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < largo; i++) {
+    crc ^= (uint16_t)datos[i] << 8;
+    for (uint8_t b = 0; b < 8; b++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static inline void tramaPonerU16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)(v & 0xFF);
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline uint16_t tramaLeerU16(const uint8_t* p) {
+  return (uint16_t)(p[0] | ((uint16_t)p[1] << 8));
+}
+
+// Escala un valor real a entero de 16 bits con redondeo y saturación
+static inline uint16_t tramaEscalar(float valor, uint16_t escala) {
+  float v = valor * escala + 0.5f;
+  if (!(v > 0.0f)) return 0;        // también descarta NaN
+  if (v >= 65535.0f) return 65535;
+  return (uint16_t)v;
+}
+
+// true si el paquete parece una trama binaria (y no texto ASCII)
+static inline bool tramaEsBinaria(const uint8_t* buf, size_t largo) {
+  return largo > 0 && tramaVersion(buf[0]) == TRAMA_VERSION;
+}
+
+// true si es una trama de alarma (sin validar el CRC)
+static inline bool tramaEsAlarma(const uint8_t* buf, size_t largo) {
+  return largo == TRAMA_LARGO_DATOS && buf[0] == tramaCabecera(TRAMA_TIPO_ALARMA);
+}
+
+// Codifica una lectura en buf como TRAMA_TIPO_DATOS o TRAMA_TIPO_ALARMA.
+// Devuelve el largo escrito o 0 si no entra.
+static inline size_t tramaCodificarDatos(const LecturaGas& l, uint8_t* buf, size_t cap,
+                                         uint8_t tipo = TRAMA_TIPO_DATOS) {
+  if (cap < TRAMA_LARGO_DATOS) return 0;
+
+  buf[0] = tramaCabecera(tipo);
+  buf[1] = l.nodo;
+  tramaPonerU16(buf + 2, l.seq);
+  tramaPonerU16(buf + 4, tramaEscalar(l.ppm, TRAMA_ESCALA_PPM));
+  tramaPonerU16(buf + 6, tramaEscalar(l.ratio, TRAMA_ESCALA_RATIO));
+  tramaPonerU16(buf + 8, l.raw);
+  buf[10] = l.flags;
+  tramaPonerU16(buf + 11, crc16Ccitt(buf, 11));
+
+  return TRAMA_LARGO_DATOS;
+}
+
+// Decodifica una trama de datos o de alarma. Rechaza versión, tipo, largo o
+// CRC inválidos.
+static inline bool tramaDecodificarDatos(const uint8_t* buf, size_t largo, LecturaGas& l) {
+  if (largo != TRAMA_LARGO_DATOS) return false;
+  if (buf[0] != tramaCabecera(TRAMA_TIPO_DATOS) && !tramaEsAlarma(buf, largo)) return false;
+  if (tramaLeerU16(buf + 11) != crc16Ccitt(buf, 11)) return false;
+
+  l.nodo  = buf[1];
+  l.seq   = tramaLeerU16(buf + 2);
+  l.ppm   = (float)tramaLeerU16(buf + 4) / TRAMA_ESCALA_PPM;
+  l.ratio = (float)tramaLeerU16(buf + 6) / TRAMA_ESCALA_RATIO;
+  l.raw   = tramaLeerU16(buf + 8);
+  l.flags = buf[10];
+  return true;
+}
+
+// Codifica un comando o una respuesta. Devuelve el largo escrito o 0 si no entra.
+static inline size_t tramaCodificarTexto(uint8_t tipo, uint8_t nodo, uint16_t seq,
+                                         const char* texto, size_t largoTexto,
+                                         uint8_t* buf, size_t cap) {
+  size_t largo = TRAMA_LARGO_TEXTO_MIN + largoTexto;
+  if (largo > cap || largo > TRAMA_LARGO_MAX) return 0;
+
+  buf[0] = tramaCabecera(tipo);
+  buf[1] = nodo;
+  tramaPonerU16(buf + 2, seq);
+  for (size_t i = 0; i < largoTexto; i++) buf[4 + i] = (uint8_t)texto[i];
+  tramaPonerU16(buf + largo - 2, crc16Ccitt(buf, largo - 2));
+  return largo;
+}
+
+// Decodifica un comando o una respuesta del tipo indicado. El texto queda
+// apuntando dentro de buf, sin terminador.
+static inline bool tramaDecodificarTexto(const uint8_t* buf, size_t largo, uint8_t tipo,
+                                         uint8_t& nodo, uint16_t& seq,
+                                         const char*& texto, size_t& largoTexto) {
+  if (largo < TRAMA_LARGO_TEXTO_MIN || largo > TRAMA_LARGO_MAX) return false;
+  if (buf[0] != tramaCabecera(tipo)) return false;
+  if (tramaLeerU16(buf + largo - 2) != crc16Ccitt(buf, largo - 2)) return false;
+
+  nodo = buf[1];
+  seq = tramaLeerU16(buf + 2);
+  texto = (const char*)(buf + 4);
+  largoTexto = largo - TRAMA_LARGO_TEXTO_MIN;
+  return true;
+}
+
+static inline size_t tramaCodificarBaliza(const BalizaTdma& b, uint8_t* buf, size_t cap) {
+  if (cap < TRAMA_LARGO_BALIZA) return 0;
+
+  buf[0] = tramaCabecera(TRAMA_TIPO_BALIZA);
+  tramaPonerU16(buf + 1, b.numero);
+  tramaPonerU16(buf + 3, b.periodoMs);
+  tramaPonerU16(buf + 5, b.inicioMs);
+  buf[7] = b.slotMs;
+  buf[8] = b.slots;
+  buf[9] = b.epoca;
+  tramaPonerU16(buf + 10, crc16Ccitt(buf, 10));
+  return TRAMA_LARGO_BALIZA;
+}
+
+static inline bool tramaDecodificarBaliza(const uint8_t* buf, size_t largo, BalizaTdma& b) {
+  if (largo != TRAMA_LARGO_BALIZA || buf[0] != tramaCabecera(TRAMA_TIPO_BALIZA)) return false;
+  if (tramaLeerU16(buf + 10) != crc16Ccitt(buf, 10)) return false;
+
+  b.numero    = tramaLeerU16(buf + 1);
+  b.periodoMs = tramaLeerU16(buf + 3);
+  b.inicioMs  = tramaLeerU16(buf + 5);
+  b.slotMs    = buf[7];
+  b.slots     = buf[8];
+  b.epoca     = buf[9];
+  return b.periodoMs != 0 && b.slotMs != 0;
+}
+
+//=============================================
+// Formato ASCII heredado (sin heap, sin strtod)
+//=============================================
+
+// Compara el token [ini, fin) con una cadena terminada en '\0'
+static inline bool tramaTokenIgual(const char* ini, const char* fin, const char* lit) {
+  while (ini < fin && *lit && *ini == *lit) { ini++; lit++; }
+  return ini == fin && *lit == '\0';
+}
+
+// Convierte el token [ini, fin) en número decimal con signo opcional.
+// Rechaza tokens vacíos o con caracteres sobrantes.
+static inline bool tramaLeerDecimal(const char* ini, const char* fin, float& out, bool permitirDecimales) {
+  bool negativo = false;
+  if (ini < fin && (*ini == '-' || *ini == '+')) negativo = (*ini++ == '-');
+
+  uint32_t entero = 0, frac = 0, divisor = 1;
+  bool hayDigitos = false, enFraccion = false;
+  for (; ini < fin; ini++) {
+    char c = *ini;
+    if (c >= '0' && c <= '9') {
+      hayDigitos = true;
+      if (enFraccion) {
+        if (divisor < 1000000UL) { frac = frac * 10 + (uint32_t)(c - '0'); divisor *= 10; }
+      } else {
+        if (entero > 100000000UL) return false;   // fuera de rango razonable
+        entero = entero * 10 + (uint32_t)(c - '0');
+      }
+    } else if (c == '.' && permitirDecimales && !enFraccion) {
+      enFraccion = true;
+    } else {
+      return false;
+    }
+  }
+  if (!hayDigitos) return false;
+
+  out = (float)entero + (float)frac / (float)divisor;
+  if (negativo) out = -out;
+  return true;
+}
+
+// Decodifica "GAS_DATA|PPM:x|Ratio:x|Raw:x|Status:x" tokenizando en el lugar.
+// Los cuatro campos son obligatorios; el formato ASCII no lleva nodo ni secuencia.
+static inline bool tramaDecodificarAscii(const char* txt, size_t largo, LecturaGas& l) {
+  const size_t largoPrefijo = sizeof(TRAMA_ASCII_PREFIJO) - 1;
+  if (largo < largoPrefijo) return false;
+  for (size_t i = 0; i < largoPrefijo; i++) {
+    if (txt[i] != TRAMA_ASCII_PREFIJO[i]) return false;
+  }
+
+  const char* p   = txt + largoPrefijo;
+  const char* fin = txt + largo;
+  uint8_t vistos = 0;
+  float valor;
+
+  l.nodo = 0;
+  l.seq = 0;
+  l.flags = 0;
+
+  while (p < fin) {
+    const char* finCampo = p;
+    while (finCampo < fin && *finCampo != '|') finCampo++;
+
+    const char* sep = p;
+    while (sep < finCampo && *sep != ':') sep++;
+    if (sep == finCampo) return false;
+    const char* val = sep + 1;
+
+    if (tramaTokenIgual(p, sep, "PPM")) {
+      if (!tramaLeerDecimal(val, finCampo, valor, true) || valor < 0) return false;
+      l.ppm = valor;
+      vistos |= 0x01;
+    } else if (tramaTokenIgual(p, sep, "Ratio")) {
+      if (!tramaLeerDecimal(val, finCampo, valor, true) || valor < 0) return false;
+      l.ratio = valor;
+      vistos |= 0x02;
+    } else if (tramaTokenIgual(p, sep, "Raw")) {
+      if (!tramaLeerDecimal(val, finCampo, valor, false) || valor < 0 || valor > 65535) return false;
+      l.raw = (uint16_t)valor;
+      vistos |= 0x04;
+    } else if (tramaTokenIgual(p, sep, "Status")) {
+      if (tramaTokenIgual(val, finCampo, "ALERTA"))      l.flags |= TRAMA_FLAG_ALERTA;
+      else if (!tramaTokenIgual(val, finCampo, "NORMAL")) return false;
+      vistos |= 0x08;
+    } else if (tramaTokenIgual(p, sep, "Calib")) {
+      if (!tramaLeerDecimal(val, finCampo, valor, false) || valor < 0 || valor > 100) return false;
+      l.flags |= tramaFlagsCalibracion((uint8_t)valor);
+    }
+    // Campos desconocidos se ignoran para tolerar extensiones
+
+    p = (finCampo < fin) ? finCampo + 1 : fin;
+  }
+
+  return vistos == 0x0F;
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+// Capa Arduino para el host: sólo lo que usa el firmware de este proyecto
+#define ARDUINO_NATIVO 1
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <type_traits>
+
+#include "ArduinoNativo.h"
+
+typedef uint8_t byte;
+typedef bool    boolean;
+
+#define HIGH          1
+#define LOW           0
+#define INPUT         0x01
+#define OUTPUT        0x03
+#define INPUT_PULLUP  0x05
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+#define RISING        0x01
+#define FALLING       0x02
+#define CHANGE        0x03
+
+// Atributos de sección del ESP32/AVR
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+// Flash del AVR: en el host todo vive en RAM
+class __FlashStringHelper;
+#define F(s)                (reinterpret_cast<const __FlashStringHelper*>(s))
+#define PROGMEM
+#define PSTR(s)             (s)
+#define pgm_read_byte(p)    (*(const uint8_t*)(p))
+#define pgm_read_word(p)    (*(const uint16_t*)(p))
+#define pgm_read_dword(p)   (*(const uint32_t*)(p))
+#define pgm_read_float(p)   (*(const float*)(p))
+#define memcpy_P            memcpy
+#define strlen_P            strlen
+
+// Tiempo
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+// E/S
+void pinMode(uint8_t pin, uint8_t modo);
+void digitalWrite(uint8_t pin, uint8_t valor);
+int  digitalRead(uint8_t pin);
+int  analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int valor);
+
+// LEDC del ESP32 (API del core 2.x): el canal maneja la salida PWM del pin
+// asociado. El fade por hardware está en driver/ledc.h.
+double ledcSetup(uint8_t canal, double frecuencia, uint8_t bits);
+void ledcAttachPin(uint8_t pin, uint8_t canal);
+void ledcDetachPin(uint8_t pin);
+void ledcWrite(uint8_t canal, uint32_t duty);
+
+// Interrupciones externas: los fakes las disparan con nativoInterrupcion()
+#define digitalPinToInterrupt(p)  (p)
+void attachInterrupt(uint8_t pin, void (*isr)(), int modo);
+void detachInterrupt(uint8_t pin);
+void interrupts();
+void noInterrupts();
+
+// Matemática
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long semilla);
+
+template <class A, class B>
+inline typename std::common_type<A, B>::type min(A a, B b) { return (b < a) ? b : a; }
+
+template <class A, class B>
+inline typename std::common_type<A, B>::type max(A a, B b) { return (a < b) ? b : a; }
+
+template <class T, class L, class H>
+inline T constrain(T x, L bajo, H alto) {
+  return (x < (T)bajo) ? (T)bajo : ((x > (T)alto) ? (T)alto : x);
+}
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "HardwareSerial.h"
+
+// Puntos de entrada del sketch
+void setup();
+void loop();
+
+#endif
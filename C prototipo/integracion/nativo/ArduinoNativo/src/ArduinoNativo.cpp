@@ -0,0 +1,478 @@
+#include "Arduino.h"
+#include "driver/ledc.h"
+
+#include <stdarg.h>
+#include <cstddef>
+#include <new>
+#include <queue>
+#include <vector>
+#include <map>
+
+//=============================================
+// Reloj virtual y eventos programados
+//=============================================
+
+namespace {
+
+struct Evento {
+  uint64_t t;
+  uint64_t orden;                 // desempate FIFO para eventos del mismo instante
+  std::function<void()> fn;
+  bool operator>(const Evento& o) const { return t != o.t ? t > o.t : orden > o.orden; }
+};
+
+uint64_t relojUs = 0;
+uint64_t ordenEventos = 0;
+
+std::priority_queue<Evento, std::vector<Evento>, std::greater<Evento>>& eventos() {
+  static std::priority_queue<Evento, std::vector<Evento>, std::greater<Evento>> cola;
+  return cola;
+}
+
+std::map<uint8_t, int>& analogicos() {
+  static std::map<uint8_t, int> m;
+  return m;
+}
+
+std::map<uint8_t, int>& salidasPWM() {
+  static std::map<uint8_t, int> m;
+  return m;
+}
+
+std::map<uint8_t, void (*)()>& interrupciones() {
+  static std::map<uint8_t, void (*)()> m;
+  return m;
+}
+
+std::map<uint8_t, std::function<int()>>& entradasDigitales() {
+  static std::map<uint8_t, std::function<int()>> m;
+  return m;
+}
+
+std::function<int(uint8_t)> fuenteAnalogica;
+std::function<void(uint8_t, int)> alEscribirPWM;
+bool serialSilencio = false;
+unsigned long semillaRandom = 1;
+
+EstadisticasNativo estadisticas = {};
+MemoriaNativo memoria = {};
+
+void escribirSalida(uint8_t pin, int valor) {
+  salidasPWM()[pin] = valor;
+  if (alEscribirPWM) alEscribirPWM(pin, valor);
+}
+
+}  // namespace
+
+uint64_t nativoMicros() {
+  return relojUs;
+}
+
+void nativoAvanzar(uint64_t us) {
+  uint64_t destino = relojUs + us;
+  // Los eventos pueden programar otros; se procesan en orden hasta el destino
+  while (!eventos().empty() && eventos().top().t <= destino) {
+    Evento e = eventos().top();
+    eventos().pop();
+    if (e.t > relojUs) relojUs = e.t;
+    e.fn();
+  }
+  if (destino > relojUs) relojUs = destino;
+}
+
+void nativoProgramar(uint64_t enUs, std::function<void()> evento) {
+  eventos().push(Evento{relojUs + enUs, ordenEventos++, evento});
+}
+
+void nativoDormir(uint64_t maxUs) {
+  uint64_t destino = relojUs + maxUs;
+  if (!eventos().empty() && eventos().top().t < destino) {
+    destino = eventos().top().t > relojUs ? eventos().top().t : relojUs;
+  }
+  uint64_t desde = relojUs;
+  nativoAvanzar(destino - relojUs);
+  // Después de avanzar: un evento que reinicia el MCU corta el sueño
+  estadisticas.usDormido += destino - desde;
+}
+
+void nativoFijarAnalogico(uint8_t pin, int valor) {
+  analogicos()[pin] = valor;
+}
+
+void nativoFuenteAnalogica(std::function<int(uint8_t pin)> fuente) {
+  fuenteAnalogica = fuente;
+}
+
+void nativoFuenteDigital(uint8_t pin, std::function<int()> fuente) {
+  entradasDigitales()[pin] = fuente;
+}
+
+int nativoLeerPWM(uint8_t pin) {
+  auto it = salidasPWM().find(pin);
+  return it == salidasPWM().end() ? 0 : it->second;
+}
+
+void nativoAlEscribirPWM(std::function<void(uint8_t pin, int valor)> cb) {
+  alEscribirPWM = cb;
+}
+
+void nativoInterrupcion(uint8_t pin) {
+  auto it = interrupciones().find(pin);
+  if (it != interrupciones().end() && it->second) it->second();
+}
+
+void nativoSilenciarSerial(bool silencio) {
+  serialSilencio = silencio;
+}
+
+void nativoReiniciar() {
+  throw ReinicioNativo();
+}
+
+const MemoriaNativo& nativoMemoria() {
+  return memoria;
+}
+
+EstadisticasNativo& nativoEstadisticas() {
+  return estadisticas;
+}
+
+//=============================================
+// API Arduino
+//=============================================
+
+unsigned long millis() { return (unsigned long)(relojUs / 1000); }
+unsigned long micros() { return (unsigned long)relojUs; }
+void delay(unsigned long ms) { nativoAvanzar((uint64_t)ms * 1000); }
+void delayMicroseconds(unsigned int us) { nativoAvanzar(us); }
+void yield() {}
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t pin, uint8_t valor) { escribirSalida(pin, valor ? 255 : 0); }
+int digitalRead(uint8_t pin) {
+  auto it = entradasDigitales().find(pin);
+  if (it != entradasDigitales().end()) return it->second();
+  return nativoLeerPWM(pin) ? HIGH : LOW;
+}
+
+int analogRead(uint8_t pin) {
+  if (fuenteAnalogica) return fuenteAnalogica(pin);
+  auto it = analogicos().find(pin);
+  return it == analogicos().end() ? 0 : it->second;
+}
+
+void analogWrite(uint8_t pin, int valor) {
+  escribirSalida(pin, valor);
+}
+
+//=============================================
+// LEDC
+//=============================================
+// Un fade avanza de a un paso de duty, repartidos en su duración
+
+namespace {
+
+const int CANALES_LEDC = 16;
+
+struct CanalLedc {
+  int pin = -1;
+  int duty = 0;
+  uint64_t finFadeUs = 0;
+  uint32_t fadeDestino = 0;
+  int fadeMs = 0;
+};
+
+CanalLedc canalesLedc[CANALES_LEDC];
+
+void fijarDuty(int canal, int duty) {
+  canalesLedc[canal].duty = duty;
+  if (canalesLedc[canal].pin >= 0) escribirSalida((uint8_t)canalesLedc[canal].pin, duty);
+}
+
+// El driver toma el semáforo del fade: quien llama queda bloqueado
+void esperarFade(int canal) {
+  uint64_t fin = canalesLedc[canal].finFadeUs;
+  if (fin > nativoMicros()) nativoAvanzar(fin - nativoMicros());
+}
+
+int canalIdf(ledc_mode_t modo, ledc_channel_t canal) {
+  int n = (int)modo * 8 + (int)canal;
+  return (n >= 0 && n < CANALES_LEDC) ? n : -1;
+}
+
+}  // namespace
+
+double ledcSetup(uint8_t canal, double frecuencia, uint8_t) {
+  return canal < CANALES_LEDC ? frecuencia : 0;
+}
+
+void ledcAttachPin(uint8_t pin, uint8_t canal) {
+  if (canal >= CANALES_LEDC) return;
+  canalesLedc[canal].pin = pin;
+  escribirSalida(pin, canalesLedc[canal].duty);
+}
+
+// La salida queda como estaba hasta que otro la maneje
+void ledcDetachPin(uint8_t pin) {
+  for (CanalLedc& c : canalesLedc) {
+    if (c.pin == pin) c.pin = -1;
+  }
+}
+
+void ledcWrite(uint8_t canal, uint32_t duty) {
+  if (canal >= CANALES_LEDC) return;
+  esperarFade(canal);
+  fijarDuty(canal, (int)duty);
+}
+
+esp_err_t ledc_fade_func_install(int) {
+  return ESP_OK;
+}
+
+esp_err_t ledc_set_fade_with_time(ledc_mode_t modo, ledc_channel_t canal, uint32_t duty, int ms) {
+  int n = canalIdf(modo, canal);
+  if (n < 0 || ms < 0) return ESP_ERR_INVALID_ARG;
+  esperarFade(n);
+  canalesLedc[n].fadeDestino = duty;
+  canalesLedc[n].fadeMs = ms;
+  return ESP_OK;
+}
+
+esp_err_t ledc_fade_start(ledc_mode_t modo, ledc_channel_t canal, ledc_fade_mode_t espera) {
+  int n = canalIdf(modo, canal);
+  if (n < 0) return ESP_ERR_INVALID_ARG;
+  esperarFade(n);
+  CanalLedc& c = canalesLedc[n];
+  int desde = c.duty, hasta = (int)c.fadeDestino;
+  int pasos = abs(hasta - desde);
+  uint64_t duracionUs = (uint64_t)c.fadeMs * 1000;
+  if (pasos == 0 || duracionUs == 0) {
+    fijarDuty(n, hasta);
+    return ESP_OK;
+  }
+  int signo = hasta > desde ? 1 : -1;
+  for (int k = 1; k <= pasos; k++) {
+    nativoProgramar(duracionUs * k / pasos, [n, desde, signo, k]() { fijarDuty(n, desde + signo * k); });
+  }
+  c.finFadeUs = nativoMicros() + duracionUs;
+  if (espera == LEDC_FADE_WAIT_DONE) esperarFade(n);
+  return ESP_OK;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int) { interrupciones()[pin] = isr; }
+void detachInterrupt(uint8_t pin) { interrupciones().erase(pin); }
+void interrupts() {}
+void noInterrupts() {}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  if (inMax == inMin) return outMin;
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+long random(long max) {
+  if (max <= 0) return 0;
+  semillaRandom = semillaRandom * 1103515245UL + 12345UL;
+  return (long)((semillaRandom >> 16) % (unsigned long)max);
+}
+
+long random(long min, long max) {
+  return (max <= min) ? min : min + random(max - min);
+}
+
+void randomSeed(unsigned long semilla) {
+  if (semilla) semillaRandom = semilla;
+}
+
+//=============================================
+// Serial y Print
+//=============================================
+
+HardwareSerial Serial;
+
+size_t HardwareSerial::write(uint8_t b) {
+  if (!serialSilencio) fputc(b, stdout);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t n) {
+  if (!serialSilencio) fwrite(buf, 1, n, stdout);
+  return n;
+}
+
+void HardwareSerial::flush() {
+  fflush(stdout);
+}
+
+size_t Print::print(long v, int base) {
+  if (base == 10 && v < 0) {
+    return print('-') + print((unsigned long)(-v), base);
+  }
+  return print((unsigned long)v, base);
+}
+
+size_t Print::print(unsigned long v, int base) {
+  char tmp[8 * sizeof(long) + 1];
+  char* p = tmp + sizeof(tmp) - 1;
+  *p = '\0';
+  if (base < 2) base = 10;
+  do {
+    int d = (int)(v % base);
+    *--p = (char)(d < 10 ? '0' + d : 'A' + d - 10);
+    v /= base;
+  } while (v);
+  return write(p);
+}
+
+size_t Print::print(double v, int decimales) {
+  if (isnan(v)) return write("nan");
+  if (isinf(v)) return write("inf");
+  char tmp[48];
+  snprintf(tmp, sizeof(tmp), "%.*f", decimales, v);
+  return write(tmp);
+}
+
+size_t Print::printf(const char* formato, ...) {
+  char tmp[256];
+  va_list args;
+  va_start(args, formato);
+  int n = vsnprintf(tmp, sizeof(tmp), formato, args);
+  va_end(args);
+  if (n < 0) return 0;
+  return write((const uint8_t*)tmp, (size_t)n < sizeof(tmp) ? (size_t)n : sizeof(tmp) - 1);
+}
+
+//=============================================
+// String
+//=============================================
+
+static std::string enteroEnBase(unsigned long v, unsigned char base, bool negativo) {
+  char tmp[8 * sizeof(long) + 2];
+  char* p = tmp + sizeof(tmp) - 1;
+  *p = '\0';
+  if (base < 2) base = 10;
+  do {
+    int d = (int)(v % base);
+    *--p = (char)(d < 10 ? '0' + d : 'a' + d - 10);
+    v /= base;
+  } while (v);
+  if (negativo) *--p = '-';
+  return p;
+}
+
+static std::string decimalComoTexto(double v, unsigned char decimales) {
+  if (isnan(v)) return "nan";
+  if (isinf(v)) return "inf";
+  char tmp[48];
+  snprintf(tmp, sizeof(tmp), "%.*f", decimales, v);
+  return tmp;
+}
+
+String::String(unsigned char v, unsigned char base) : s_(enteroEnBase(v, base, false)) {}
+String::String(int v, unsigned char base) : String((long)v, base) {}
+String::String(unsigned int v, unsigned char base) : s_(enteroEnBase(v, base, false)) {}
+String::String(long v, unsigned char base)
+  : s_(base == 10 && v < 0 ? enteroEnBase(0UL - (unsigned long)v, base, true)
+                           : enteroEnBase((unsigned long)v, base, false)) {}
+String::String(unsigned long v, unsigned char base) : s_(enteroEnBase(v, base, false)) {}
+String::String(float v, unsigned char decimales) : s_(decimalComoTexto(v, decimales)) {}
+String::String(double v, unsigned char decimales) : s_(decimalComoTexto(v, decimales)) {}
+
+bool String::endsWith(const String& p) const {
+  return s_.size() >= p.s_.size() && s_.compare(s_.size() - p.s_.size(), p.s_.size(), p.s_) == 0;
+}
+
+int String::indexOf(char c, unsigned int desde) const {
+  size_t i = s_.find(c, desde);
+  return i == std::string::npos ? -1 : (int)i;
+}
+
+int String::indexOf(const String& s, unsigned int desde) const {
+  size_t i = s_.find(s.s_, desde);
+  return i == std::string::npos ? -1 : (int)i;
+}
+
+String String::substring(unsigned int desde) const {
+  return substring(desde, length());
+}
+
+String String::substring(unsigned int desde, unsigned int hasta) const {
+  if (desde > hasta) { unsigned int t = desde; desde = hasta; hasta = t; }
+  if (desde >= s_.size()) return String();
+  if (hasta > s_.size()) hasta = (unsigned int)s_.size();
+  return String(s_.substr(desde, hasta - desde));
+}
+
+void String::trim() {
+  size_t ini = s_.find_first_not_of(" \t\r\n");
+  if (ini == std::string::npos) { s_.clear(); return; }
+  size_t fin = s_.find_last_not_of(" \t\r\n");
+  s_ = s_.substr(ini, fin - ini + 1);
+}
+
+void String::toUpperCase() {
+  for (char& c : s_) if (c >= 'a' && c <= 'z') c = (char)(c - 'a' + 'A');
+}
+
+void String::toLowerCase() {
+  for (char& c : s_) if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+}
+
+void String::replace(const String& buscar, const String& reemplazo) {
+  if (buscar.s_.empty()) return;
+  size_t i = 0;
+  while ((i = s_.find(buscar.s_, i)) != std::string::npos) {
+    s_.replace(i, buscar.s_.size(), reemplazo.s_);
+    i += reemplazo.s_.size();
+  }
+}
+
+void String::remove(unsigned int indice, unsigned int cantidad) {
+  if (indice < s_.size()) s_.erase(indice, cantidad);
+}
+
+void String::toCharArray(char* buf, unsigned int tam, unsigned int desde) const {
+  getBytes((unsigned char*)buf, tam, desde);
+}
+
+void String::getBytes(unsigned char* buf, unsigned int tam, unsigned int desde) const {
+  if (!tam || !buf) return;
+  if (desde >= s_.size()) { buf[0] = 0; return; }
+  size_t n = s_.size() - desde;
+  if (n > tam - 1) n = tam - 1;
+  memcpy(buf, s_.data() + desde, n);
+  buf[n] = 0;
+}
+
+//=============================================
+// Contabilidad del heap (new/delete globales)
+//=============================================
+// Cada bloque lleva delante su tamaño para poder descontarlo al liberar.
+
+namespace {
+const size_t CABECERA = alignof(std::max_align_t);
+
+void* reservar(size_t n) {
+  void* p = malloc(n + CABECERA);
+  if (!p) throw std::bad_alloc();
+  *(size_t*)p = n;
+  memoria.enUso += n;
+  memoria.reservas++;
+  if (memoria.enUso > memoria.pico) memoria.pico = memoria.enUso;
+  return (char*)p + CABECERA;
+}
+
+void liberar(void* p) {
+  if (!p) return;
+  char* bloque = (char*)p - CABECERA;
+  memoria.enUso -= *(size_t*)bloque;
+  memoria.liberaciones++;
+  free(bloque);
+}
+}  // namespace
+
+void* operator new(size_t n) { return reservar(n); }
+void* operator new[](size_t n) { return reservar(n); }
+void operator delete(void* p) noexcept { liberar(p); }
+void operator delete[](void* p) noexcept { liberar(p); }
+void operator delete(void* p, size_t) noexcept { liberar(p); }
+void operator delete[](void* p, size_t) noexcept { liberar(p); }
@@ -0,0 +1,69 @@
+#ifndef ARDUINO_NATIVO_H
+#define ARDUINO_NATIVO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+//=============================================
+// Control del entorno simulado (env:native)
+//=============================================
+// El firmware ve millis()/micros() de un reloj virtual. El reloj avanza con
+// delay(), con las operaciones bloqueantes de los fakes (TX LoRa, conexión
+// MQTT) y con un tick fijo por cada iteración de loop(), así una simulación
+// de horas corre en segundos.
+
+// Reloj virtual
+uint64_t nativoMicros();
+void nativoAvanzar(uint64_t us);                        // avanza y dispara eventos vencidos
+void nativoProgramar(uint64_t enUs, std::function<void()> evento);
+
+// Modo idle del MCU (sleep_cpu() en AVR): avanza hasta el próximo evento
+// programado, que hace de interrupción, o hasta maxUs. Lo dormido se
+// acumula en nativoEstadisticas().usDormido.
+void nativoDormir(uint64_t maxUs);
+
+// Entradas y salidas
+void nativoFijarAnalogico(uint8_t pin, int valor);
+void nativoFuenteAnalogica(std::function<int(uint8_t pin)> fuente);
+void nativoFuenteDigital(uint8_t pin, std::function<int()> fuente);   // lo que lee digitalRead(pin)
+int  nativoLeerPWM(uint8_t pin);
+void nativoAlEscribirPWM(std::function<void(uint8_t pin, int valor)> cb);   // cada analogWrite()
+void nativoInterrupcion(uint8_t pin);                   // flanco en un pin con attachInterrupt()
+
+// Serial a stdout; se puede silenciar para medir sin el costo de la consola
+void nativoSilenciarSerial(bool silencio);
+
+// Reinicio por software ("jmp 0" en AVR, ESP.restart() en ESP32):
+// main_nativo lo captura y vuelve a ejecutar setup()
+struct ReinicioNativo {};
+[[noreturn]] void nativoReiniciar();
+
+// Estadísticas de la corrida
+struct MemoriaNativo {
+  size_t   enUso;
+  size_t   pico;
+  uint64_t reservas;
+  uint64_t liberaciones;
+};
+
+struct EstadisticasNativo {
+  uint64_t iteracionesLoop;
+  uint64_t usLoopMax;           // la iteración de loop() más larga, en tiempo virtual
+  uint64_t usDormido;
+  uint64_t escriturasFlash;
+  uint64_t bytesFlash;          // escritos en archivos de LittleFS
+  uint64_t loraInyectados;
+  uint64_t loraPerdidos;        // llegaron con la radio fuera de RX o pisaron otro paquete
+  uint64_t loraLeidos;
+  uint64_t loraTransmitidos;
+  uint64_t usAireTx;            // tiempo en el aire acumulado de las transmisiones
+  uint64_t mqttPublicados;
+  uint64_t mqttBytes;
+  uint64_t mqttConexiones;
+};
+
+const MemoriaNativo& nativoMemoria();
+EstadisticasNativo&  nativoEstadisticas();
+
+#endif
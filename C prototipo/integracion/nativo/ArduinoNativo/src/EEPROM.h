@@ -0,0 +1,45 @@
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include <Arduino.h>
+
+// EEPROM del ATmega328P (1 KB) en memoria. Arranca borrada (0xFF) y
+// sobrevive a nativoReiniciar(). update() y put() sólo escriben los bytes
+// que cambian, como en AVR; cada byte escrito cuenta en
+// nativoEstadisticas().escriturasFlash.
+class EEPROMClass {
+public:
+  static const uint16_t LARGO = 1024;
+
+  uint8_t read(int i) const { return celdas()[i % LARGO]; }
+  void write(int i, uint8_t v) {
+    celdas()[i % LARGO] = v;
+    nativoEstadisticas().escriturasFlash++;
+  }
+  void update(int i, uint8_t v) { if (read(i) != v) write(i, v); }
+  uint16_t length() const { return LARGO; }
+
+  template <class T> T& get(int i, T& t) const {
+    uint8_t* p = (uint8_t*)&t;
+    for (size_t n = 0; n < sizeof(T); n++) p[n] = read(i + (int)n);
+    return t;
+  }
+
+  template <class T> const T& put(int i, const T& t) {
+    const uint8_t* p = (const uint8_t*)&t;
+    for (size_t n = 0; n < sizeof(T); n++) update(i + (int)n, p[n]);
+    return t;
+  }
+
+private:
+  static uint8_t* celdas() {
+    static uint8_t c[LARGO];
+    static bool borrada = (memset(c, 0xFF, sizeof(c)), true);
+    (void)borrada;
+    return c;
+  }
+};
+
+static EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,237 @@
+#include "LittleFS.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+namespace stdfs = std::filesystem;
+
+fs::LittleFSFS LittleFS;
+
+namespace {
+
+std::string& directorioBase() {
+  static std::string d;
+  return d;
+}
+
+// Directorio temporal por defecto, borrado al terminar el proceso
+struct DirectorioTemporal {
+  std::string ruta;
+  ~DirectorioTemporal() {
+    std::error_code ec;
+    if (!ruta.empty()) stdfs::remove_all(ruta, ec);
+  }
+};
+
+const std::string& base() {
+  static DirectorioTemporal temporal;
+  if (directorioBase().empty()) {
+    char plantilla[] = "/tmp/nativo_fs_XXXXXX";
+    if (mkdtemp(plantilla)) temporal.ruta = plantilla;
+    directorioBase() = temporal.ruta;
+  }
+  return directorioBase();
+}
+
+std::string rutaHost(const char* ruta) {
+  std::string r = base();
+  if (ruta[0] != '/') r += '/';
+  return r + ruta;
+}
+
+}  // namespace
+
+void nativoDirectorioFS(const char* directorio) {
+  std::error_code ec;
+  stdfs::create_directories(directorio, ec);
+  directorioBase() = directorio;
+}
+
+const char* nativoDirectorioFS() {
+  return base().c_str();
+}
+
+namespace fs {
+
+struct ArchivoNativo {
+  std::string ruta;                       // ruta del firmware ("/spool/1.bin")
+  std::string nombre;
+  FILE* f = nullptr;
+  bool directorio = false;
+  std::vector<std::string> entradas;      // contenido del directorio
+  size_t siguiente = 0;
+
+  ~ArchivoNativo() { if (f) fclose(f); }
+};
+
+size_t File::write(const uint8_t* buf, size_t n) {
+  if (!archivo || !archivo->f) return 0;
+  size_t escritos = fwrite(buf, 1, n, archivo->f);
+  nativoEstadisticas().escriturasFlash++;
+  nativoEstadisticas().bytesFlash += escritos;
+  return escritos;
+}
+
+int File::available() {
+  if (!archivo || !archivo->f) return 0;
+  return (int)(size() - position());
+}
+
+int File::read() {
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+int File::peek() {
+  if (!archivo || !archivo->f) return -1;
+  int c = fgetc(archivo->f);
+  if (c != EOF) ungetc(c, archivo->f);
+  return c == EOF ? -1 : c;
+}
+
+size_t File::read(uint8_t* buf, size_t n) {
+  if (!archivo || !archivo->f) return 0;
+  return fread(buf, 1, n, archivo->f);
+}
+
+void File::flush() {
+  if (archivo && archivo->f) fflush(archivo->f);
+}
+
+bool File::seek(uint32_t pos, SeekMode modo) {
+  if (!archivo || !archivo->f) return false;
+  int origen = modo == SeekSet ? SEEK_SET : (modo == SeekCur ? SEEK_CUR : SEEK_END);
+  return fseek(archivo->f, (long)pos, origen) == 0;
+}
+
+size_t File::position() const {
+  if (!archivo || !archivo->f) return 0;
+  long p = ftell(archivo->f);
+  return p < 0 ? 0 : (size_t)p;
+}
+
+size_t File::size() const {
+  if (!archivo || !archivo->f) return 0;
+  long actual = ftell(archivo->f);
+  fseek(archivo->f, 0, SEEK_END);
+  long fin = ftell(archivo->f);
+  fseek(archivo->f, actual, SEEK_SET);
+  return fin < 0 ? 0 : (size_t)fin;
+}
+
+void File::close() {
+  archivo.reset();
+}
+
+File::operator bool() const {
+  return archivo && (archivo->f || archivo->directorio);
+}
+
+const char* File::path() const {
+  return archivo ? archivo->ruta.c_str() : "";
+}
+
+const char* File::name() const {
+  return archivo ? archivo->nombre.c_str() : "";
+}
+
+bool File::isDirectory() const {
+  return archivo && archivo->directorio;
+}
+
+File File::openNextFile(const char* modo) {
+  if (!isDirectory()) return File();
+  while (archivo->siguiente < archivo->entradas.size()) {
+    std::string ruta = archivo->ruta;
+    if (ruta.empty() || ruta.back() != '/') ruta += '/';
+    ruta += archivo->entradas[archivo->siguiente++];
+    File f = LittleFS.open(ruta.c_str(), modo);
+    if (f) return f;
+  }
+  return File();
+}
+
+void File::rewindDirectory() {
+  if (archivo) archivo->siguiente = 0;
+}
+
+File FS::open(const char* ruta, const char* modo, bool crear) {
+  std::string host = rutaHost(ruta);
+  auto a = std::make_shared<ArchivoNativo>();
+  a->ruta = ruta;
+  const char* barra = strrchr(ruta, '/');
+  a->nombre = barra ? barra + 1 : ruta;
+
+  std::error_code ec;
+  if (stdfs::is_directory(host, ec)) {
+    a->directorio = true;
+    for (const auto& e : stdfs::directory_iterator(host, ec)) {
+      a->entradas.push_back(e.path().filename().string());
+    }
+    std::sort(a->entradas.begin(), a->entradas.end());
+    return File(a);
+  }
+
+  if (crear) stdfs::create_directories(stdfs::path(host).parent_path(), ec);
+  std::string m = modo;
+  if (m == "r") m = "rb";
+  else if (m == "w") m = "wb";
+  else if (m == "a") m = "ab";
+  a->f = fopen(host.c_str(), m.c_str());
+  return a->f ? File(a) : File();
+}
+
+bool FS::exists(const char* ruta) {
+  std::error_code ec;
+  return stdfs::exists(rutaHost(ruta), ec);
+}
+
+bool FS::remove(const char* ruta) {
+  std::error_code ec;
+  bool ok = stdfs::is_regular_file(rutaHost(ruta), ec) && stdfs::remove(rutaHost(ruta), ec);
+  if (ok) nativoEstadisticas().escriturasFlash++;
+  return ok;
+}
+
+bool FS::rename(const char* desde, const char* hacia) {
+  std::error_code ec;
+  stdfs::rename(rutaHost(desde), rutaHost(hacia), ec);
+  if (!ec) nativoEstadisticas().escriturasFlash++;
+  return !ec;
+}
+
+bool FS::mkdir(const char* ruta) {
+  std::error_code ec;
+  stdfs::create_directories(rutaHost(ruta), ec);
+  return !ec;
+}
+
+bool FS::rmdir(const char* ruta) {
+  std::error_code ec;
+  return stdfs::remove(rutaHost(ruta), ec);
+}
+
+bool LittleFSFS::begin(bool, const char*, uint8_t, const char*) {
+  std::error_code ec;
+  stdfs::create_directories(base(), ec);
+  return !ec;
+}
+
+bool LittleFSFS::format() {
+  std::error_code ec;
+  for (const auto& e : stdfs::directory_iterator(base(), ec)) stdfs::remove_all(e.path(), ec);
+  return !ec;
+}
+
+size_t LittleFSFS::usedBytes() {
+  std::error_code ec;
+  size_t total = 0;
+  for (const auto& e : stdfs::recursive_directory_iterator(base(), ec)) {
+    if (e.is_regular_file(ec)) total += e.file_size(ec);
+  }
+  return total;
+}
+
+}  // namespace fs
@@ -0,0 +1,80 @@
+#ifndef FS_H
+#define FS_H
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+// API fs::FS/fs::File del core ESP32 sobre archivos del host. Las rutas del
+// firmware se resuelven bajo el directorio de nativoDirectorioFS(); los
+// archivos sobreviven a nativoReiniciar() como la flash real. Cada write()
+// cuenta una escritura en nativoEstadisticas().escriturasFlash.
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct ArchivoNativo;
+
+class File : public Stream {
+public:
+  File() {}
+  explicit File(std::shared_ptr<ArchivoNativo> a) : archivo(a) {}
+
+  size_t write(uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t* buf, size_t n) override;
+  using Print::write;
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t read(uint8_t* buf, size_t n);
+  void flush() override;
+
+  bool seek(uint32_t pos, SeekMode modo);
+  bool seek(uint32_t pos) { return seek(pos, SeekSet); }
+  size_t position() const;
+  size_t size() const;
+  void close();
+  operator bool() const;
+
+  const char* path() const;
+  const char* name() const;
+  bool isDirectory() const;
+  File openNextFile(const char* modo = FILE_READ);
+  void rewindDirectory();
+
+private:
+  std::shared_ptr<ArchivoNativo> archivo;
+};
+
+class FS {
+public:
+  File open(const char* ruta, const char* modo = FILE_READ, bool crear = false);
+  File open(const String& ruta, const char* modo = FILE_READ, bool crear = false) { return open(ruta.c_str(), modo, crear); }
+  bool exists(const char* ruta);
+  bool remove(const char* ruta);
+  bool rename(const char* desde, const char* hacia);
+  bool mkdir(const char* ruta);
+  bool rmdir(const char* ruta);
+};
+
+}  // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+// Directorio del host que hace de partición. Por defecto uno temporal
+// propio del proceso que se borra al salir (main_nativo --fs lo cambia).
+void nativoDirectorioFS(const char* directorio);
+const char* nativoDirectorioFS();
+
+#endif
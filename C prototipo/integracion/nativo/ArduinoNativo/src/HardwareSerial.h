@@ -0,0 +1,25 @@
+#ifndef HARDWARE_SERIAL_H
+#define HARDWARE_SERIAL_H
+
+#include "Stream.h"
+
+// Serial escribe a stdout (salvo nativoSilenciarSerial) y no recibe datos
+class HardwareSerial : public Stream {
+public:
+  void begin(unsigned long baudios) { (void)baudios; }
+  void end() {}
+  operator bool() const { return true; }
+
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  void flush() override;
+
+  size_t write(uint8_t b) override;
+  size_t write(const uint8_t* buf, size_t n) override;
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef LITTLEFS_H
+#define LITTLEFS_H
+
+#include "FS.h"
+
+namespace fs {
+
+// Partición LittleFS simulada; el tamaño coincide con la partición
+// "spiffs" de la tabla default del ESP32 (1.375 MB)
+class LittleFSFS : public FS {
+public:
+  bool begin(bool formatearSiFalla = false, const char* base = "/littlefs",
+             uint8_t maxAbiertos = 10, const char* particion = "spiffs");
+  void end() {}
+  bool format();
+  size_t totalBytes() { return 0x160000; }
+  size_t usedBytes();
+};
+
+}  // namespace fs
+
+extern fs::LittleFSFS LittleFS;
+
+#endif
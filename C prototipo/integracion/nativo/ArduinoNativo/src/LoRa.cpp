@@ -0,0 +1,195 @@
+#include "LoRa.h"
+
+#include <TiempoEnAire.h>
+
+LoRaClass LoRa;
+SPIClass SPI;
+
+int LoRaClass::begin(long f) {
+  frecuencia = f;
+  modo = STANDBY;
+  fifoListo = false;
+  rxVencioUs = 0;
+  // DIO0 mapeado a RX_DONE; con onReceive() la librería limpia la IRQ en el acto
+  nativoFuenteDigital(pinDio0, [this]() { return fifoListo && !cbRecepcion ? HIGH : LOW; });
+  return 1;
+}
+
+void LoRaClass::end() {
+  modo = DORMIDO;
+  rxVencioUs = 0;
+}
+
+//=============================================
+// Transmisión
+//=============================================
+
+int LoRaClass::beginPacket(int) {
+  if (modo == TX) return 0;       // como isTransmitting() en la librería real
+  modo = STANDBY;
+  rxVencioUs = 0;
+  txBuf.clear();
+  armandoTx = true;
+  return 1;
+}
+
+size_t LoRaClass::write(uint8_t b) {
+  return write(&b, 1);
+}
+
+size_t LoRaClass::write(const uint8_t* buf, size_t n) {
+  if (!armandoTx) return 0;
+  size_t libre = 255 - txBuf.size();
+  if (n > libre) n = libre;
+  txBuf.insert(txBuf.end(), buf, buf + n);
+  return n;
+}
+
+float LoRaClass::nativoTiempoEnAireMs(size_t largo) const {
+  ParametrosRadio p = { (uint8_t)sf, (uint32_t)bw, (uint8_t)cr, preambulo, crc, false };
+  return tiempoEnAireMs(p, (uint8_t)largo);
+}
+
+int LoRaClass::endPacket(bool async) {
+  if (!armandoTx) return 0;
+  armandoTx = false;
+  modo = TX;
+
+  uint64_t duracionUs = (uint64_t)(nativoTiempoEnAireMs(txBuf.size()) * 1000.0f);
+  nativoEstadisticas().loraTransmitidos++;
+  nativoEstadisticas().usAireTx += duracionUs;
+  if (alTransmitir) alTransmitir(txBuf.data(), txBuf.size());
+
+  if (async) {
+    nativoProgramar(duracionUs, [this]() {
+      finTransmision();
+      if (cbTxFin) cbTxFin();
+    });
+  } else {
+    nativoAvanzar(duracionUs);    // endPacket() bloquea todo el tiempo en el aire
+    finTransmision();
+  }
+  return 1;
+}
+
+void LoRaClass::finTransmision() {
+  if (modo == TX) modo = STANDBY;
+}
+
+//=============================================
+// Recepción
+//=============================================
+
+void LoRaClass::tomarFifo() {
+  actual = fifo;
+  indice = 0;
+  fifoListo = false;
+  nativoEstadisticas().loraLeidos++;
+}
+
+int LoRaClass::parsePacket(int) {
+  if (fifoListo && !(modo == RX_CONTINUO && cbRecepcion)) {
+    tomarFifo();
+    modo = STANDBY;
+    rxVencioUs = 0;
+    return (int)actual.datos.size();
+  }
+  if (modo != RX_SIMPLE && modo != TX) armarRxSimple();
+  return 0;
+}
+
+void LoRaClass::armarRxSimple() {
+  modo = RX_SIMPLE;
+  rxDesdeUs = nativoMicros();
+  rxVencioUs = 0;
+  uint32_t generacion = ++generacionRx;
+  uint64_t ventanaUs = (uint64_t)RX_SIMPLE_SIMBOLOS * ((1000000ULL << sf) / (uint64_t)bw);
+  nativoProgramar(ventanaUs, [this, generacion]() {
+    if (modo != RX_SIMPLE || generacion != generacionRx) return;
+    modo = STANDBY;
+    rxVencioUs = nativoMicros();
+  });
+}
+
+void LoRaClass::receive(int) {
+  if (modo == TX) return;
+  modo = RX_CONTINUO;
+  rxVencioUs = 0;
+}
+
+void LoRaClass::onReceive(void (*cb)(int)) {
+  cbRecepcion = cb;
+}
+
+void LoRaClass::onTxDone(void (*cb)()) {
+  cbTxFin = cb;
+}
+
+void LoRaClass::idle() {
+  if (modo != TX) modo = STANDBY;
+  rxVencioUs = 0;
+}
+
+void LoRaClass::sleep() {
+  modo = DORMIDO;
+  rxVencioUs = 0;
+}
+
+int LoRaClass::packetRssi() {
+  return actual.rssi;
+}
+
+float LoRaClass::packetSnr() {
+  return actual.snr;
+}
+
+int LoRaClass::available() {
+  return (int)(actual.datos.size() - indice);
+}
+
+int LoRaClass::read() {
+  if (indice >= actual.datos.size()) return -1;
+  return actual.datos[indice++];
+}
+
+int LoRaClass::peek() {
+  if (indice >= actual.datos.size()) return -1;
+  return actual.datos[indice];
+}
+
+void LoRaClass::nativoInyectar(const uint8_t* datos, size_t largo, int rssiPaquete, float snrPaquete) {
+  EstadisticasNativo& e = nativoEstadisticas();
+  e.loraInyectados++;
+
+  // El preámbulo llegó antes de que venciera el RX simple: la radio lo sigue
+  uint64_t aireUs = (uint64_t)(nativoTiempoEnAireMs(largo) * 1000.0f);
+  uint64_t inicioUs = nativoMicros() > aireUs ? nativoMicros() - aireUs : 0;
+  if (modo == STANDBY && rxVencioUs && inicioUs >= rxDesdeUs && inicioUs < rxVencioUs) {
+    modo = RX_SIMPLE;
+    rxVencioUs = 0;
+  }
+  if (!nativoEnRecepcion()) {
+    e.loraPerdidos++;
+    return;
+  }
+  if (fifoListo) e.loraPerdidos++;  // el anterior no se leyó y queda pisado
+
+  fifo.datos.assign(datos, datos + largo);
+  fifo.rssi = rssiPaquete;
+  fifo.snr = snrPaquete;
+  fifoListo = true;
+
+  if (modo == RX_SIMPLE || !cbRecepcion) {
+    if (modo == RX_SIMPLE) modo = STANDBY;   // RX simple termina con el primer paquete
+    // RX_DONE en DIO0 para quien atienda la radio con su propia interrupción
+    uint8_t pin = pinDio0;
+    nativoProgramar(0, [pin]() { nativoInterrupcion(pin); });
+  } else {
+    // DIO0: el callback corre como interrupción en cuanto avanza el reloj
+    nativoProgramar(0, [this]() {
+      if (!fifoListo || !cbRecepcion) return;
+      tomarFifo();
+      cbRecepcion((int)actual.datos.size());
+    });
+  }
+}
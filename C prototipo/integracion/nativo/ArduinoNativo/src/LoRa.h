@@ -0,0 +1,129 @@
+#ifndef LORA_H
+#define LORA_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <vector>
+
+#define PA_OUTPUT_RFO_PIN       0
+#define PA_OUTPUT_PA_BOOST_PIN  1
+
+#define LORA_DEFAULT_SS_PIN     10
+#define LORA_DEFAULT_RESET_PIN  9
+#define LORA_DEFAULT_DIO0_PIN   2
+
+// Fake en memoria de sandeepmistry/LoRa con el comportamiento del SX127x que
+// importa al firmware: parsePacket() arma RX simple y la radio vuelve a
+// standby al recibir; receive() deja RX continuo con callback por DIO0; un
+// paquete que llega con la radio fuera de RX, o que pisa a otro sin leer,
+// se pierde. La transmisión consume su tiempo en el aire del reloj virtual.
+// Sin onReceive(), RX_DONE levanta el pin DIO0 de setPins() y dispara lo que
+// el firmware haya registrado con attachInterrupt(); digitalRead() del pin
+// da HIGH hasta que parsePacket() toma el paquete.
+//
+// RX simple vence como en la radio: sin preámbulo en RX_SIMPLE_SIMBOLOS
+// símbolos (RegSymbTimeout por defecto; ~100 ms a SF7) pasa a standby sin
+// avisar por DIO0. Un paquete que empezó antes del vencimiento se recibe.
+class LoRaClass : public Stream {
+public:
+  int begin(long frecuencia);
+  void end();
+
+  int beginPacket(int cabeceraImplicita = false);
+  int endPacket(bool async = false);
+
+  int parsePacket(int largo = 0);
+  int packetRssi();
+  float packetSnr();
+  long packetFrequencyError() { return 0; }
+  int rssi() { return -120; }
+
+  size_t write(uint8_t b) override;
+  size_t write(const uint8_t* buf, size_t n) override;
+  using Print::write;
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  void flush() override {}
+
+  void onReceive(void (*cb)(int));
+  void onTxDone(void (*cb)());
+  void receive(int largo = 0);
+
+  void idle();
+  void sleep();
+
+  void setTxPower(int nivel, int pin = PA_OUTPUT_PA_BOOST_PIN) { (void)pin; potencia = nivel; }
+  void setFrequency(long f) { frecuencia = f; }
+  void setSpreadingFactor(int s) { sf = constrain(s, 6, 12); }
+  void setSignalBandwidth(long b) { bw = b; }
+  void setCodingRate4(int d) { cr = constrain(d, 5, 8); }
+  void setPreambleLength(long l) { preambulo = (uint16_t)l; }
+  void setSyncWord(int) {}
+  void enableCrc() { crc = true; }
+  void disableCrc() { crc = false; }
+  void enableInvertIQ() {}
+  void disableInvertIQ() {}
+  void setOCP(uint8_t) {}
+  void setGain(uint8_t) {}
+  void setPins(int ss = LORA_DEFAULT_SS_PIN, int reset = LORA_DEFAULT_RESET_PIN, int dio0 = LORA_DEFAULT_DIO0_PIN) {
+    (void)ss; (void)reset; pinDio0 = (uint8_t)dio0;
+  }
+  void setSPI(SPIClass&) {}
+  void setSPIFrequency(uint32_t) {}
+
+  // Control del simulador
+  void nativoInyectar(const uint8_t* datos, size_t largo, int rssi = -60, float snr = 9.5f);
+  void nativoAlTransmitir(std::function<void(const uint8_t* datos, size_t largo)> cb) { alTransmitir = cb; }
+  bool nativoEnRecepcion() const { return modo == RX_SIMPLE || modo == RX_CONTINUO; }
+  bool nativoTransmitiendo() const { return modo == TX; }
+  int  nativoSpreadingFactor() const { return sf; }
+  int  nativoPotencia() const { return potencia; }
+  long nativoFrecuencia() const { return frecuencia; }
+  float nativoTiempoEnAireMs(size_t largo) const;
+
+private:
+  enum Modo { DORMIDO, STANDBY, RX_SIMPLE, RX_CONTINUO, TX };
+  static const uint16_t RX_SIMPLE_SIMBOLOS = 100;
+
+  struct Paquete {
+    std::vector<uint8_t> datos;
+    int rssi;
+    float snr;
+  };
+
+  Modo modo = DORMIDO;
+  long frecuencia = 0;
+  int sf = 7;
+  long bw = 125000;
+  int cr = 5;
+  uint16_t preambulo = 8;
+  bool crc = false;
+  int potencia = 17;
+  uint8_t pinDio0 = LORA_DEFAULT_DIO0_PIN;
+
+  uint32_t generacionRx = 0;    // invalida el vencimiento de un RX simple anterior
+  uint64_t rxDesdeUs = 0;       // inicio del último RX simple
+  uint64_t rxVencioUs = 0;      // cuándo venció, si la radio sigue en standby por eso
+
+  Paquete fifo;                 // paquete recibido en la FIFO de la radio
+  bool fifoListo = false;       // equivalente a IRQ RX_DONE
+  Paquete actual;               // paquete expuesto por read()/available()
+  size_t indice = 0;
+
+  std::vector<uint8_t> txBuf;
+  bool armandoTx = false;
+
+  void (*cbRecepcion)(int) = nullptr;
+  void (*cbTxFin)() = nullptr;
+  std::function<void(const uint8_t*, size_t)> alTransmitir;
+
+  void tomarFifo();
+  void armarRxSimple();
+  void finTransmision();
+};
+
+extern LoRaClass LoRa;
+
+#endif
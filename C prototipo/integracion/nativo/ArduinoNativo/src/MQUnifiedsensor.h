@@ -0,0 +1,52 @@
+#ifndef MQ_UNIFIED_SENSOR_H
+#define MQ_UNIFIED_SENSOR_H
+
+#include <Arduino.h>
+
+// Versión reducida de MQUnifiedsensor para el host: misma API que usa
+// SensorCO2 y la curva exponencial ppm = a * (Rs/Ro)^b de la librería
+class MQUnifiedsensor {
+public:
+  MQUnifiedsensor(String placa, float vcc, int bitsAdc, int pin, String tipo)
+    : vcc(vcc), resolucion((float)((1 << bitsAdc) - 1)), pin(pin) { (void)placa; (void)tipo; }
+
+  void init() {}
+  void update() { voltaje = analogRead(pin) * vcc / resolucion; }
+  void setRegressionMethod(int) {}
+  void setA(float v) { a = v; }
+  void setB(float v) { b = v; }
+  void setR0(float v) { r0 = v; }
+  void setRL(float v) { rl = v; }
+  float getRL() { return rl; }
+  float getR0() { return r0; }
+  float getVoltage() { return voltaje; }
+
+  float calibrate(float ratioAireLimpio) {
+    float rs = resistencia();
+    float ro = rs / ratioAireLimpio;
+    return ro < 0 ? 0 : ro;
+  }
+
+  float readSensor() {
+    if (r0 <= 0) return 0;
+    float ppm = a * powf(resistencia() / r0, b);
+    return ppm < 0 ? 0 : ppm;
+  }
+
+private:
+  float vcc;
+  float resolucion;
+  int pin;
+  float voltaje = 0;
+  float rl = 10;
+  float r0 = 10;
+  float a = 574.25f;          // MQ-2, mismos coeficientes que el Nodo Sensor
+  float b = -2.222f;
+
+  float resistencia() {
+    if (voltaje <= 0) return 0;
+    return (vcc - voltaje) / voltaje * rl;
+  }
+};
+
+#endif
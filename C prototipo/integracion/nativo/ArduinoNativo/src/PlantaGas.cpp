@@ -0,0 +1,159 @@
+#include "PlantaGas.h"
+
+#include <Arduino.h>
+
+#include <math.h>
+#include <random>
+#include <vector>
+
+namespace {
+
+const uint64_t PASO_US = 100000;
+
+struct Fuga {
+  unsigned long desdeMs;
+  unsigned long hastaMs;
+  float litrosMinuto;
+  float picoPpm = 0;
+  uint64_t sobreUmbralUs = 0;
+  uint64_t bajoUmbralUs = 0;      // última vez que C bajó del umbral
+  bool sobreAlTerminar = false;   // C sobre el umbral después de hastaMs
+  bool sobreAlFinal = false;      // y al empezar la fuga siguiente o el fin
+};
+
+struct ResumenPlanta {
+  double energiaWh = 0;
+  double velocidadSegundos = 0;   // integral de la velocidad de cada salida (0-1)
+  uint64_t arranques = 0;
+  uint64_t alarmas = 0;
+  uint64_t sobreUmbralUs = 0;
+  float picoPpm = 0;
+};
+
+bool activa = false;
+ConfigPlanta config;
+std::vector<Fuga> fugas;
+ResumenPlanta resumen;
+int salidas[64] = {0};
+float concentracion = 0;      // ppm en el recinto
+float sensor = 0;             // ppm que ve el sensor, sin ruido
+bool sobreUmbral = false;
+bool enAlarma = false;
+std::minstd_rand generador(23);
+
+// Fuga en curso (la última que empezó): a ella se cargan las métricas
+Fuga* fugaActual(unsigned long ahoraMs) {
+  Fuga* actual = nullptr;
+  for (Fuga& f : fugas) {
+    if (f.desdeMs <= ahoraMs && (!actual || f.desdeMs >= actual->desdeMs)) actual = &f;
+  }
+  return actual;
+}
+
+void paso() {
+  double dt = PASO_US / 1e6;
+  unsigned long ahoraMs = millis();
+
+  double velocidad = 0, potencia = 0;
+  for (int v : salidas) {
+    if (!v) continue;
+    double u = v / 255.0;
+    velocidad += u;
+    potencia += config.potenciaW * u * u * u;
+  }
+  resumen.velocidadSegundos += velocidad * dt;
+  resumen.energiaWh += potencia * dt / 3600.0;
+
+  double g = 0;   // m3/s de gas
+  for (const Fuga& f : fugas) {
+    if (ahoraMs >= f.desdeMs && ahoraMs < f.hastaMs) g += f.litrosMinuto / 1000.0 / 60.0;
+  }
+  double q = (velocidad * config.caudalM3h + config.renovacionesHora * config.volumenM3) / 3600.0;
+  // Solución exacta del paso con G y Q constantes
+  double equilibrio = q > 0 ? g * 1e6 / q : concentracion;
+  if (q > 0) {
+    concentracion = (float)(equilibrio + (concentracion - equilibrio) * exp(-q * dt / config.volumenM3));
+  } else {
+    concentracion += (float)(g * 1e6 * dt / config.volumenM3);
+  }
+  sensor += (float)((concentracion - sensor) * (1.0 - exp(-dt / config.sensorTauS)));
+
+  Fuga* f = fugaActual(ahoraMs);
+  bool sobre = concentracion > config.umbralPpm;
+  if (sobre) resumen.sobreUmbralUs += PASO_US;
+  if (concentracion > resumen.picoPpm) resumen.picoPpm = concentracion;
+  if (f) {
+    if (concentracion > f->picoPpm) f->picoPpm = concentracion;
+    if (sobre) f->sobreUmbralUs += PASO_US;
+    if (ahoraMs >= f->hastaMs) {
+      if (sobre) f->sobreAlTerminar = true;
+      else if (sobreUmbral) f->bajoUmbralUs = nativoMicros();
+    }
+    f->sobreAlFinal = sobre;
+  }
+  sobreUmbral = sobre;
+
+  nativoProgramar(PASO_US, paso);
+}
+
+}  // namespace
+
+void plantaIniciar(const ConfigPlanta& c) {
+  config = c;
+  activa = true;
+  nativoProgramar(PASO_US, paso);
+}
+
+bool plantaActiva() {
+  return activa;
+}
+
+void plantaAgregarFuga(unsigned long desdeMs, unsigned long hastaMs, float litrosMinuto) {
+  Fuga f;
+  f.desdeMs = desdeMs;
+  f.hastaMs = hastaMs;
+  f.litrosMinuto = litrosMinuto;
+  fugas.push_back(f);
+}
+
+float plantaLectura() {
+  float ruido = std::uniform_real_distribution<float>(-1.0f, 1.0f)(generador) * config.ruidoPct / 100.0f;
+  float lectura = sensor * (1.0f + ruido);
+  return lectura < 0 ? 0 : lectura;
+}
+
+void plantaAlEscribirPWM(uint8_t pin, int valor) {
+  if (!activa || pin >= 64) return;
+  if (!salidas[pin] && valor) resumen.arranques++;
+  salidas[pin] = valor;
+}
+
+void plantaAlPublicar(const std::string& topico, const std::string& payload) {
+  if (!activa || topico != "gas/alarma") return;
+  bool alarma = payload.find("\"alarma\":true") != std::string::npos;
+  if (alarma && !enAlarma) resumen.alarmas++;
+  enAlarma = alarma;
+}
+
+void plantaReporte() {
+  if (!activa) return;
+  const ResumenPlanta& r = resumen;
+  double segundos = nativoMicros() / 1e6;
+  fprintf(stderr, "Planta:              %.0f m3, %.0f m3/h y %.0f W por extractor, %.1f renovaciones/h, sensor %.0f s, ruido +-%.0f%%\n",
+          config.volumenM3, config.caudalM3h, config.potenciaW, config.renovacionesHora, config.sensorTauS,
+          config.ruidoPct);
+  fprintf(stderr, "Planta ventilacion:  %.1f Wh, velocidad media %.1f%%, %llu arranques, %llu entradas en alarma\n",
+          r.energiaWh, segundos > 0 ? 100.0 * r.velocidadSegundos / segundos : 0.0,
+          (unsigned long long)r.arranques, (unsigned long long)r.alarmas);
+  fprintf(stderr, "Planta gas:          pico %.0f ppm, %.0f s sobre %.0f ppm\n",
+          r.picoPpm, r.sobreUmbralUs / 1e6, config.umbralPpm);
+  for (size_t i = 0; i < fugas.size(); i++) {
+    const Fuga& f = fugas[i];
+    char despeje[48];
+    if (!f.sobreAlTerminar) snprintf(despeje, sizeof(despeje), "bajo el umbral al terminar");
+    else if (f.sobreAlFinal || !f.bajoUmbralUs) snprintf(despeje, sizeof(despeje), "sin despejar");
+    else snprintf(despeje, sizeof(despeje), "despeje %.0f s", (f.bajoUmbralUs / 1e3 - f.hastaMs) / 1e3);
+    fprintf(stderr, "Planta fuga %zu:       %.1f L/min de %.0f a %.0f s: pico %.0f ppm, %.0f s sobre el umbral, %s\n",
+            i + 1, f.litrosMinuto, f.desdeMs / 1e3, f.hastaMs / 1e3, f.picoPpm, f.sobreUmbralUs / 1e6, despeje);
+  }
+}
@@ -0,0 +1,45 @@
+#ifndef PLANTA_GAS_H
+#define PLANTA_GAS_H
+
+#include <stdint.h>
+#include <string>
+
+//=============================================
+// Recinto ventilado con una fuga de gas
+//=============================================
+// Mezcla perfecta: V dC/dt = G - Q (C - 0), con G el caudal de la fuga y Q
+// el de los extractores (caudal proporcional a la velocidad, sumando todas
+// las salidas PWM) más la infiltración natural. El sensor ve C con un
+// retardo de primer orden (el MQ tarda en responder) y ruido uniforme.
+//
+// La energía de los extractores sigue la ley de afinidad: la potencia va
+// con el cubo de la velocidad. Por cada fuga informa el pico, el tiempo
+// sobre el umbral y el despeje: desde que la fuga termina hasta la última
+// vez que la concentración bajó del umbral.
+
+struct ConfigPlanta {
+  float volumenM3 = 30;
+  float caudalM3h = 900;            // por extractor, al 100%
+  float potenciaW = 150;            // por extractor, al 100%
+  float ruidoPct = 3;               // +-, en cada lectura
+  float renovacionesHora = 0.5f;    // infiltración con los extractores parados
+  float sensorTauS = 15;
+  float umbralPpm = 500;            // el umbralGas por defecto del gateway
+};
+
+void plantaIniciar(const ConfigPlanta& c);
+bool plantaActiva();
+
+// Fuga de litrosMinuto entre los ms desde y hasta
+void plantaAgregarFuga(unsigned long desdeMs, unsigned long hastaMs, float litrosMinuto);
+
+// Lo que lee un sensor ahora, en ppm
+float plantaLectura();
+
+// Desde nativoAlEscribirPWM y nativoBroker().alPublicar
+void plantaAlEscribirPWM(uint8_t pin, int valor);
+void plantaAlPublicar(const std::string& topico, const std::string& payload);
+
+void plantaReporte();
+
+#endif
@@ -0,0 +1,80 @@
+#include "Preferences.h"
+
+unsigned long nativoDemoraNvsUs = 0;
+
+static std::map<std::string, std::map<std::string, std::vector<uint8_t>>>& almacen() {
+  static std::map<std::string, std::map<std::string, std::vector<uint8_t>>> a;
+  return a;
+}
+
+bool Preferences::begin(const char* nombre, bool lectura, const char*) {
+  if (ns) return false;
+  ns = &almacen()[nombre];
+  soloLectura = lectura;
+  return true;
+}
+
+void Preferences::end() {
+  ns = nullptr;
+}
+
+bool Preferences::clear() {
+  if (!ns || soloLectura) return false;
+  ns->clear();
+  nativoEstadisticas().escriturasFlash++;
+  nativoAvanzar(nativoDemoraNvsUs);
+  return true;
+}
+
+bool Preferences::remove(const char* k) {
+  if (!ns || soloLectura) return false;
+  nativoEstadisticas().escriturasFlash++;
+  nativoAvanzar(nativoDemoraNvsUs);
+  return ns->erase(k) > 0;
+}
+
+bool Preferences::isKey(const char* k) {
+  return buscar(k) != nullptr;
+}
+
+size_t Preferences::poner(const char* k, const void* v, size_t n) {
+  if (!ns || soloLectura) return 0;
+  const uint8_t* b = (const uint8_t*)v;
+  (*ns)[k].assign(b, b + n);
+  nativoEstadisticas().escriturasFlash++;
+  nativoAvanzar(nativoDemoraNvsUs);
+  return n;
+}
+
+const std::vector<uint8_t>* Preferences::buscar(const char* k) {
+  if (!ns) return nullptr;
+  auto it = ns->find(k);
+  return it == ns->end() ? nullptr : &it->second;
+}
+
+String Preferences::getString(const char* k, String d) {
+  const std::vector<uint8_t>* v = buscar(k);
+  if (!v) return d;
+  return String(std::string(v->begin(), v->end()));
+}
+
+size_t Preferences::getString(const char* k, char* v, size_t max) {
+  const std::vector<uint8_t>* s = buscar(k);
+  if (!s || !max) return 0;
+  size_t n = s->size() < max - 1 ? s->size() : max - 1;
+  memcpy(v, s->data(), n);
+  v[n] = '\0';
+  return n + 1;
+}
+
+size_t Preferences::getBytesLength(const char* k) {
+  const std::vector<uint8_t>* v = buscar(k);
+  return v ? v->size() : 0;
+}
+
+size_t Preferences::getBytes(const char* k, void* v, size_t max) {
+  const std::vector<uint8_t>* s = buscar(k);
+  if (!s || s->size() > max) return 0;
+  memcpy(v, s->data(), s->size());
+  return s->size();
+}
@@ -0,0 +1,68 @@
+#ifndef PREFERENCES_H
+#define PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// Preferences (NVS del ESP32) en memoria. Los espacios de nombres son
+// globales al proceso y sobreviven a nativoReiniciar(), como la flash real.
+// Cada put* cuenta una escritura en nativoEstadisticas().escriturasFlash
+// y bloquea nativoDemoraNvsUs, lo que tarda la escritura con su commit.
+extern unsigned long nativoDemoraNvsUs;
+
+class Preferences {
+public:
+  bool begin(const char* nombre, bool soloLectura = false, const char* particion = nullptr);
+  void end();
+  bool clear();
+  bool remove(const char* clave);
+  bool isKey(const char* clave);
+
+  size_t putChar(const char* k, int8_t v)           { return poner(k, &v, sizeof(v)); }
+  size_t putUChar(const char* k, uint8_t v)         { return poner(k, &v, sizeof(v)); }
+  size_t putShort(const char* k, int16_t v)         { return poner(k, &v, sizeof(v)); }
+  size_t putUShort(const char* k, uint16_t v)       { return poner(k, &v, sizeof(v)); }
+  size_t putInt(const char* k, int32_t v)           { return poner(k, &v, sizeof(v)); }
+  size_t putUInt(const char* k, uint32_t v)         { return poner(k, &v, sizeof(v)); }
+  size_t putLong(const char* k, int32_t v)          { return poner(k, &v, sizeof(v)); }
+  size_t putULong(const char* k, uint32_t v)        { return poner(k, &v, sizeof(v)); }
+  size_t putFloat(const char* k, float v)           { return poner(k, &v, sizeof(v)); }
+  size_t putBool(const char* k, bool v)             { uint8_t b = v; return poner(k, &b, 1); }
+  size_t putString(const char* k, const char* v)    { return poner(k, v, strlen(v)); }
+  size_t putString(const char* k, const String& v)  { return poner(k, v.c_str(), v.length()); }
+  size_t putBytes(const char* k, const void* v, size_t n) { return poner(k, v, n); }
+
+  int8_t   getChar(const char* k, int8_t d = 0)       { return leer(k, d); }
+  uint8_t  getUChar(const char* k, uint8_t d = 0)     { return leer(k, d); }
+  int16_t  getShort(const char* k, int16_t d = 0)     { return leer(k, d); }
+  uint16_t getUShort(const char* k, uint16_t d = 0)   { return leer(k, d); }
+  int32_t  getInt(const char* k, int32_t d = 0)       { return leer(k, d); }
+  uint32_t getUInt(const char* k, uint32_t d = 0)     { return leer(k, d); }
+  int32_t  getLong(const char* k, int32_t d = 0)      { return leer(k, d); }
+  uint32_t getULong(const char* k, uint32_t d = 0)    { return leer(k, d); }
+  float    getFloat(const char* k, float d = NAN)     { return leer(k, d); }
+  bool     getBool(const char* k, bool d = false)     { return leer(k, (uint8_t)d) != 0; }
+  String   getString(const char* k, String d = String());
+  size_t   getString(const char* k, char* v, size_t max);
+  size_t   getBytesLength(const char* k);
+  size_t   getBytes(const char* k, void* v, size_t max);
+
+private:
+  std::map<std::string, std::vector<uint8_t>>* ns = nullptr;
+  bool soloLectura = false;
+
+  size_t poner(const char* k, const void* v, size_t n);
+  const std::vector<uint8_t>* buscar(const char* k);
+
+  template <class T> T leer(const char* k, T def) {
+    const std::vector<uint8_t>* v = buscar(k);
+    if (!v || v->size() != sizeof(T)) return def;
+    T r;
+    memcpy(&r, v->data(), sizeof(T));
+    return r;
+  }
+};
+
+#endif
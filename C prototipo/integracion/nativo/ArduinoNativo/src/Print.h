@@ -0,0 +1,48 @@
+#ifndef PRINT_H
+#define PRINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "WString.h"
+
+class __FlashStringHelper;
+
+// Print de Arduino: formatea números y texto sobre write()
+class Print {
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t b) = 0;
+  virtual size_t write(const uint8_t* buf, size_t n) {
+    size_t escritos = 0;
+    while (n--) escritos += write(*buf++);
+    return escritos;
+  }
+  size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+  size_t write(const char* buf, size_t n) { return write((const uint8_t*)buf, n); }
+
+  size_t print(const __FlashStringHelper* s) { return write(reinterpret_cast<const char*>(s)); }
+  size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t print(const char* s) { return write(s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char v, int base = DEC_BASE) { return print((unsigned long)v, base); }
+  size_t print(int v, int base = DEC_BASE) { return print((long)v, base); }
+  size_t print(unsigned int v, int base = DEC_BASE) { return print((unsigned long)v, base); }
+  size_t print(long v, int base = DEC_BASE);
+  size_t print(unsigned long v, int base = DEC_BASE);
+  size_t print(long long v, int base = DEC_BASE) { return print((long)v, base); }
+  size_t print(unsigned long long v, int base = DEC_BASE) { return print((unsigned long)v, base); }
+  size_t print(double v, int decimales = 2);
+
+  size_t println() { return write("\r\n"); }
+  template <class T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+  template <class T> size_t println(const T& v, int formato) { size_t n = print(v, formato); return n + println(); }
+
+  size_t printf(const char* formato, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+  static const int DEC_BASE = 10;
+};
+
+#endif
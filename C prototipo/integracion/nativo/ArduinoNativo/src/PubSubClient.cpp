@@ -0,0 +1,149 @@
+#include "PubSubClient.h"
+
+BrokerNativo& nativoBroker() {
+  static BrokerNativo broker;
+  return broker;
+}
+
+//=============================================
+// Conexión
+//=============================================
+
+bool PubSubClient::connect(const char* id) {
+  return connect(id, nullptr, nullptr, nullptr, 0, false, nullptr);
+}
+
+bool PubSubClient::connect(const char* id, const char* usuario, const char* clave) {
+  return connect(id, usuario, clave, nullptr, 0, false, nullptr);
+}
+
+bool PubSubClient::connect(const char* id, const char* willTopic, uint8_t willQos, bool willRetain, const char* willMessage) {
+  return connect(id, nullptr, nullptr, willTopic, willQos, willRetain, willMessage);
+}
+
+bool PubSubClient::connect(const char*, const char*, const char*, const char*, uint8_t, bool, const char*, bool) {
+  BrokerNativo& b = nativoBroker();
+
+  if (WiFi.status() != WL_CONNECTED) {
+    estado = MQTT_CONNECT_FAILED;
+    conectado = false;
+    return false;
+  }
+  if (!b.disponible) {
+    delay(b.timeoutConexionMs);   // el TCP connect bloquea hasta vencer
+    estado = MQTT_CONNECTION_TIMEOUT;
+    conectado = false;
+    return false;
+  }
+
+  delay(b.demoraConexionMs);
+  conectado = true;
+  estado = MQTT_CONNECTED;
+  suscripciones.clear();
+  nativoEstadisticas().mqttConexiones++;
+  return true;
+}
+
+void PubSubClient::disconnect() {
+  conectado = false;
+  estado = MQTT_DISCONNECTED;
+}
+
+bool PubSubClient::connected() {
+  if (conectado && (!nativoBroker().disponible || WiFi.status() != WL_CONNECTED)) {
+    conectado = false;
+    estado = MQTT_CONNECTION_LOST;
+  }
+  return conectado;
+}
+
+//=============================================
+// Publicación
+//=============================================
+
+bool PubSubClient::entregar(const MensajeNativo& m) {
+  if (!connected()) return false;
+  delay(nativoBroker().demoraPublicacionMs);
+  EstadisticasNativo& e = nativoEstadisticas();
+  e.mqttPublicados++;
+  e.mqttBytes += m.payload.size();
+  if (nativoBroker().alPublicar) nativoBroker().alPublicar(m);
+  return true;
+}
+
+bool PubSubClient::publish(const char* topico, const char* payload, bool retenido) {
+  return publish(topico, (const uint8_t*)payload, payload ? (unsigned int)strlen(payload) : 0, retenido);
+}
+
+bool PubSubClient::publish(const char* topico, const uint8_t* payload, unsigned int largo, bool retenido) {
+  // Igual que la librería: el paquete completo tiene que entrar en el buffer
+  if (largo + strlen(topico) + 7 > tamBuffer) return false;
+  return entregar(MensajeNativo{topico, std::string((const char*)payload, largo), retenido});
+}
+
+bool PubSubClient::beginPublish(const char* topico, unsigned int largo, bool retenido) {
+  if (!connected()) return false;
+  publicando = true;
+  enCurso = MensajeNativo{topico, std::string(), retenido};
+  enCurso.payload.reserve(largo);
+  return true;
+}
+
+size_t PubSubClient::write(uint8_t b) {
+  return write(&b, 1);
+}
+
+size_t PubSubClient::write(const uint8_t* buf, size_t n) {
+  if (!publicando) return 0;
+  enCurso.payload.append((const char*)buf, n);
+  return n;
+}
+
+int PubSubClient::endPublish() {
+  if (!publicando) return 0;
+  publicando = false;
+  return entregar(enCurso) ? 1 : 0;
+}
+
+//=============================================
+// Suscripciones
+//=============================================
+
+bool PubSubClient::subscribe(const char* topico, uint8_t) {
+  if (!connected()) return false;
+  suscripciones.push_back(topico);
+  return true;
+}
+
+bool PubSubClient::unsubscribe(const char* topico) {
+  for (size_t i = 0; i < suscripciones.size(); i++) {
+    if (suscripciones[i] == topico) {
+      suscripciones.erase(suscripciones.begin() + i);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PubSubClient::suscripto(const std::string& topico) const {
+  for (const std::string& s : suscripciones) {
+    if (s == topico) return true;
+    if (!s.empty() && s.back() == '#' && topico.compare(0, s.size() - 1, s, 0, s.size() - 1) == 0) return true;
+  }
+  return false;
+}
+
+bool PubSubClient::loop() {
+  if (!connected()) return false;
+
+  std::deque<MensajeNativo>& cola = nativoBroker().entrantes;
+  while (!cola.empty()) {
+    MensajeNativo m = cola.front();
+    cola.pop_front();
+    if (!callback || !suscripto(m.topico)) continue;
+    std::vector<char> topico(m.topico.begin(), m.topico.end());
+    topico.push_back('\0');
+    callback(topico.data(), (uint8_t*)&m.payload[0], (unsigned int)m.payload.size());
+  }
+  return true;
+}
@@ -0,0 +1,94 @@
+#ifndef PUBSUBCLIENT_H
+#define PUBSUBCLIENT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#define MQTT_CONNECTION_TIMEOUT  -4
+#define MQTT_CONNECTION_LOST     -3
+#define MQTT_CONNECT_FAILED      -2
+#define MQTT_DISCONNECTED        -1
+#define MQTT_CONNECTED            0
+
+struct MensajeNativo {
+  std::string topico;
+  std::string payload;
+  bool retenido;
+};
+
+// Broker simulado compartido por todos los clientes del proceso
+struct BrokerNativo {
+  bool disponible = true;
+  unsigned long demoraConexionMs = 50;      // handshake con el broker arriba
+  unsigned long timeoutConexionMs = 3000;   // lo que bloquea connect() sin broker
+  unsigned long demoraPublicacionMs = 0;    // lo que bloquea cada publish (socket lento)
+  std::function<void(const MensajeNativo&)> alPublicar;
+  std::deque<MensajeNativo> entrantes;      // se entregan en loop() a los suscriptos
+
+  void enviar(const char* topico, const char* payload) {
+    entrantes.push_back(MensajeNativo{topico, payload, false});
+  }
+};
+
+BrokerNativo& nativoBroker();
+
+// Fake de knolleary/PubSubClient: connect() bloquea el reloj virtual igual
+// que el cliente real y publish() falla si el broker no está disponible
+class PubSubClient : public Print {
+public:
+  typedef std::function<void(char*, uint8_t*, unsigned int)> Callback;
+
+  PubSubClient() {}
+  explicit PubSubClient(WiFiClient&) {}
+
+  PubSubClient& setServer(const char*, uint16_t) { return *this; }
+  PubSubClient& setCallback(Callback cb) { callback = cb; return *this; }
+  PubSubClient& setClient(WiFiClient&) { return *this; }
+  PubSubClient& setKeepAlive(uint16_t) { return *this; }
+  PubSubClient& setSocketTimeout(uint16_t) { return *this; }
+  bool setBufferSize(uint16_t tam) { tamBuffer = tam; return true; }
+  uint16_t getBufferSize() { return tamBuffer; }
+
+  bool connect(const char* id);
+  bool connect(const char* id, const char* usuario, const char* clave);
+  bool connect(const char* id, const char* willTopic, uint8_t willQos, bool willRetain, const char* willMessage);
+  bool connect(const char* id, const char* usuario, const char* clave,
+               const char* willTopic, uint8_t willQos, bool willRetain, const char* willMessage, bool limpia = true);
+  void disconnect();
+
+  bool publish(const char* topico, const char* payload) { return publish(topico, payload, false); }
+  bool publish(const char* topico, const char* payload, bool retenido);
+  bool publish(const char* topico, const uint8_t* payload, unsigned int largo) { return publish(topico, payload, largo, false); }
+  bool publish(const char* topico, const uint8_t* payload, unsigned int largo, bool retenido);
+
+  bool beginPublish(const char* topico, unsigned int largo, bool retenido);
+  size_t write(uint8_t b) override;
+  size_t write(const uint8_t* buf, size_t n) override;
+  using Print::write;
+  int endPublish();
+
+  bool subscribe(const char* topico, uint8_t qos = 0);
+  bool unsubscribe(const char* topico);
+
+  bool loop();
+  bool connected();
+  int state() { return estado; }
+
+private:
+  Callback callback;
+  uint16_t tamBuffer = 256;
+  bool conectado = false;
+  int estado = MQTT_DISCONNECTED;
+  std::vector<std::string> suscripciones;
+
+  bool publicando = false;
+  MensajeNativo enCurso;
+
+  bool suscripto(const std::string& topico) const;
+  bool entregar(const MensajeNativo& m);
+};
+
+#endif
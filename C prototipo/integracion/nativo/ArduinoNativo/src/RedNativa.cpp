@@ -0,0 +1,465 @@
+#include "RedNativa.h"
+
+#include <Arduino.h>
+#include <LoRa.h>
+#include <TramaLoRa.h>
+#include <TiempoEnAire.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+const uint64_t PROCESO_US = 20000;       // el nodo procesa un comando antes de contestar
+const int BALIZAS_PERDIDAS_MAX = 3;
+const uint8_t SIN_SLOT = 0xFF;
+const int IDS_MAX = 254;
+
+enum Perdida { NINGUNA, COLISION, GATEWAY_TX };
+
+struct Transmision {
+  uint64_t inicioUs;
+  uint64_t finUs;
+  float rssi;
+  size_t nodo;                // 0: el gateway; si no, índice + 1
+  Perdida perdida;
+  bool enSlot;
+};
+
+struct NodoRed {
+  size_t indice;
+  uint8_t id;
+  float perdidaDb;            // trayecto y sombreado hasta el gateway
+  int potencia;               // dBm
+  uint8_t slot;
+  uint8_t epoca;
+  bool sincronizado;
+  BalizaTdma baliza;
+  uint64_t balizaUs;
+  uint64_t ocupadoHastaUs;    // fin de su transmisión en curso
+  bool enEspera;              // lectura esperando el slot
+  uint64_t generadaUs;
+  uint32_t turno;             // invalida el envío en slot ya programado
+  bool hayComando;
+  uint16_t ultimoComando;
+};
+
+struct ResumenRed {
+  uint64_t generadas = 0;
+  uint64_t reemplazadas = 0;
+  uint64_t datos = 0;         // tramas de datos transmitidas
+  uint64_t enSlot = 0;
+  uint64_t respuestas = 0;
+  uint64_t entregadas = 0;
+  uint64_t colisiones = 0;
+  uint64_t perdidasEnSlot = 0;   // por cualquier causa
+  uint64_t gatewayTx = 0;     // llegaron con el gateway transmitiendo
+  uint64_t sinCobertura = 0;  // bajo el SNR mínimo del SF
+  uint64_t publicadas = 0;    // en gas/datos, con latencia medida
+  uint64_t loopUs = 0;        // tiempo virtual bloqueado dentro de loop()
+  uint64_t hostNs = 0;        // tiempo del host dentro de loop()
+  uint64_t balizas = 0;       // balizas transmitidas por el gateway
+  uint64_t balizasOidas = 0;  // suma sobre los nodos
+  uint64_t comandos = 0;
+  uint64_t sumaEsperaUs = 0;
+  uint64_t maxEsperaUs = 0;
+};
+
+// Cortes del CSV: los totales al empezar el intervalo
+struct Corte {
+  ResumenRed resumen;
+  size_t latencias = 0;
+  uint64_t us = 0;
+};
+
+ConfigRed config;
+std::vector<NodoRed> nodos;
+std::vector<std::shared_ptr<Transmision>> aire;
+ResumenRed resumen;
+std::vector<float> latencias;                     // ms, lectura -> gas/datos
+std::unordered_map<uint16_t, uint64_t> enCamino;  // clave en raw -> lectura tomada
+uint16_t seqPorId[256];
+uint16_t proximaClave = 0;
+FILE* csv = nullptr;
+Corte corte;
+std::minstd_rand generador(23);
+
+float azar(float desde, float hasta) {
+  return std::uniform_real_distribution<float>(desde, hasta)(generador);
+}
+
+float sfRed() {
+  return (float)LoRa.nativoSpreadingFactor();
+}
+
+uint64_t aireNodoUs(size_t largo) {
+  float ms = config.modelo.tiempoEnAireMs ? config.modelo.tiempoEnAireMs(largo) : LoRa.nativoTiempoEnAireMs(largo);
+  return (uint64_t)(ms * 1000.0f);
+}
+
+// Nivel de una trama en el otro extremo, con el desvanecimiento de esa trama
+float rssiTrama(int potencia, const NodoRed& n) {
+  float d = config.modelo.desvanecimientoDb;
+  return (float)potencia - n.perdidaDb + (d > 0 ? azar(-d, d) : 0.0f);
+}
+
+bool demodula(float rssi) {
+  return rssi - config.modelo.ruidoDbm >= snrMinimoDb((uint8_t)sfRed());
+}
+
+NodoRed* buscarNodo(uint8_t id) {
+  if (id < 1 || id > nodos.size()) return nullptr;
+  return &nodos[id - 1];
+}
+
+// Ocupa el canal [ahora, ahora + duración]; devuelve la transmisión para
+// marcarla si otra la pisa mientras dura
+std::shared_ptr<Transmision> ocuparCanal(size_t nodo, float rssi, uint64_t duracionUs, bool enSlot) {
+  uint64_t ahora = nativoMicros();
+  aire.erase(std::remove_if(aire.begin(), aire.end(),
+                            [ahora](const std::shared_ptr<Transmision>& t) { return t->finUs <= ahora; }),
+             aire.end());
+
+  const float captura = config.modelo.capturaDb;
+  auto t = std::make_shared<Transmision>(Transmision{ahora, ahora + duracionUs, rssi, nodo, NINGUNA, enSlot});
+  for (auto& o : aire) {
+    if (nodo == 0 || o->nodo == 0) {
+      // Half-duplex: lo que el gateway tenía o empieza a tener en el aire no se recibe
+      Transmision& del = (nodo == 0) ? *o : *t;
+      if (del.perdida == NINGUNA) del.perdida = GATEWAY_TX;
+      continue;
+    }
+    if (t->rssi >= o->rssi + captura) {
+      if (o->perdida == NINGUNA) o->perdida = COLISION;
+    } else if (o->rssi >= t->rssi + captura) {
+      if (t->perdida == NINGUNA) t->perdida = COLISION;
+    } else {
+      if (o->perdida == NINGUNA) o->perdida = COLISION;
+      if (t->perdida == NINGUNA) t->perdida = COLISION;
+    }
+  }
+  aire.push_back(t);
+  return t;
+}
+
+// Bajo el mínimo el gateway ni siquiera engancha el preámbulo: la trama
+// no ocupa su demodulador. El SX1276 no informa SNR por encima de ~+12 dB.
+void transmitirNodo(NodoRed& n, const std::vector<uint8_t>& datos, bool enSlot = false) {
+  float rssi = rssiTrama(n.potencia, n);
+  uint64_t duracion = aireNodoUs(datos.size());
+  if (!demodula(rssi)) {
+    n.ocupadoHastaUs = nativoMicros() + duracion;
+    resumen.sinCobertura++;
+    if (enSlot) resumen.perdidasEnSlot++;
+    return;
+  }
+  std::shared_ptr<Transmision> t = ocuparCanal(n.indice + 1, rssi, duracion, enSlot);
+  n.ocupadoHastaUs = t->finUs;
+  float snr = std::min(rssi - config.modelo.ruidoDbm, 12.0f);
+  nativoProgramar(t->finUs - t->inicioUs, [t, datos, snr]() {
+    if (t->perdida != NINGUNA && t->enSlot) resumen.perdidasEnSlot++;
+    if (t->perdida == COLISION) resumen.colisiones++;
+    else if (t->perdida == GATEWAY_TX) resumen.gatewayTx++;
+    else {
+      resumen.entregadas++;
+      LoRa.nativoInyectar(datos.data(), datos.size(), (int)lroundf(t->rssi), snr);
+    }
+  });
+}
+
+void enviarDatos(NodoRed& n, bool enSlot) {
+  LecturaGas l;
+  l.nodo  = n.id;
+  l.seq   = seqPorId[n.id]++;
+  l.ppm   = 100.0f + n.id;
+  l.ratio = 2.0f;
+  l.raw   = proximaClave++;
+  l.flags = 0;
+  enCamino[l.raw] = n.generadaUs;
+  std::vector<uint8_t> buf(TRAMA_LARGO_DATOS);
+  tramaCodificarDatos(l, buf.data(), buf.size());
+
+  uint64_t espera = nativoMicros() - n.generadaUs;
+  resumen.sumaEsperaUs += espera;
+  resumen.maxEsperaUs = std::max(resumen.maxEsperaUs, espera);
+  resumen.datos++;
+  if (enSlot) resumen.enSlot++;
+  n.enEspera = false;
+  transmitirNodo(n, buf, enSlot);
+}
+
+bool tdmaListo(const NodoRed& n) {
+  if (n.slot == SIN_SLOT || !n.sincronizado || n.slot >= n.baliza.slots) return false;
+  uint64_t vigenciaUs = (uint64_t)n.baliza.periodoMs * 1000 * BALIZAS_PERDIDAS_MAX + n.baliza.periodoMs * 500;
+  return nativoMicros() - n.balizaUs <= vigenciaUs;
+}
+
+uint64_t proximoSlotUs(const NodoRed& n) {
+  uint64_t periodo = (uint64_t)n.baliza.periodoMs * 1000;
+  uint64_t t = n.balizaUs +
+               ((uint64_t)n.baliza.inicioMs + (uint64_t)n.slot * n.baliza.slotMs + TRAMA_TDMA_GUARDA_MS) * 1000;
+  while (t < nativoMicros()) t += periodo;
+  return t;
+}
+
+void programarSlot(NodoRed& n) {
+  uint32_t turno = ++n.turno;
+  size_t i = n.indice;
+  nativoProgramar(proximoSlotUs(n) - nativoMicros(), [i, turno]() {
+    NodoRed& p = nodos[i];
+    if (p.enEspera && p.turno == turno) enviarDatos(p, true);
+  });
+}
+
+void generar(size_t i) {
+  NodoRed& n = nodos[i];
+  resumen.generadas++;
+  if (n.enEspera) resumen.reemplazadas++;
+  n.generadaUs = nativoMicros();
+  n.enEspera = true;
+  if (tdmaListo(n)) programarSlot(n);
+  else if (nativoMicros() >= n.ocupadoHastaUs) enviarDatos(n, false);
+  else {
+    uint32_t turno = ++n.turno;
+    nativoProgramar(n.ocupadoHastaUs - nativoMicros(), [i, turno]() {
+      NodoRed& p = nodos[i];
+      if (p.enEspera && p.turno == turno) enviarDatos(p, false);
+    });
+  }
+
+  uint64_t periodoUs = (uint64_t)config.periodoMs * 1000;
+  nativoProgramar((uint64_t)(periodoUs * azar(0.9f, 1.1f)), [i]() { generar(i); });
+}
+
+void oirBaliza(NodoRed& n, const BalizaTdma& b, uint64_t finUs) {
+  resumen.balizasOidas++;
+  if (n.slot != SIN_SLOT && b.epoca != n.epoca) n.slot = SIN_SLOT;
+  n.baliza = b;
+  n.balizaUs = finUs;
+  n.sincronizado = true;
+  if (n.enEspera && tdmaListo(n)) programarSlot(n);
+}
+
+void responder(NodoRed& n, uint16_t seq, const std::string& texto) {
+  std::vector<uint8_t> buf(TRAMA_LARGO_MAX);
+  size_t largo = tramaCodificarTexto(TRAMA_TIPO_RESPUESTA, n.id, seq, texto.data(), texto.size(),
+                                     buf.data(), buf.size());
+  buf.resize(largo);
+  size_t i = n.indice;
+  nativoProgramar(PROCESO_US, [i, buf]() {
+    NodoRed& p = nodos[i];
+    if (nativoMicros() < p.ocupadoHastaUs) return;   // ocupado: el gateway reintenta
+    resumen.respuestas++;
+    transmitirNodo(p, buf);
+  });
+}
+
+void oirComando(NodoRed& n, uint16_t seq, const std::string& texto) {
+  resumen.comandos++;
+  if (n.hayComando && n.ultimoComando == seq) {
+    responder(n, seq, "DUPLICATE");
+    return;
+  }
+  n.hayComando = true;
+  n.ultimoComando = seq;
+  int slot, epoca, sf, dbm;
+  if (sscanf(texto.c_str(), "RADIO:%d:%d", &sf, &dbm) == 2) {
+    n.potencia = dbm;
+    responder(n, seq, texto + "_ACK");
+  } else if (sscanf(texto.c_str(), "SLOT:%d:%d", &slot, &epoca) == 2) {
+    n.slot = (uint8_t)slot;
+    n.epoca = (uint8_t)epoca;
+    if (n.sincronizado && n.baliza.epoca != n.epoca) n.sincronizado = false;
+    responder(n, seq, "SLOT_ACK|" + std::to_string(slot));
+  } else {
+    responder(n, seq, texto + "_ACK");
+  }
+}
+
+// Percentil por rango más cercano sobre un vector ordenado
+float percentil(const std::vector<float>& ordenado, float p) {
+  if (ordenado.empty()) return 0;
+  size_t i = (size_t)ceilf(p / 100.0f * ordenado.size());
+  return ordenado[i ? i - 1 : 0];
+}
+
+// Una fila con lo ocurrido desde el corte: "intervalo" o "total"
+void escribirFila(const char* fila, const Corte& desde) {
+  auto d = [&desde](uint64_t ResumenRed::*campo) {
+    return (unsigned long long)(resumen.*campo - desde.resumen.*campo);
+  };
+  std::vector<float> lat(latencias.begin() + desde.latencias, latencias.end());
+  std::sort(lat.begin(), lat.end());
+  uint64_t us = nativoMicros() - desde.us;
+  unsigned long long datos = d(&ResumenRed::datos), publicadas = d(&ResumenRed::publicadas);
+
+  fprintf(csv, "%s,%.1f,%zu,%lu,%d,%.0f,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%.4f,%.1f,%.1f,%.1f,%.1f,%.3f,%.1f\n",
+          fila, nativoMicros() / 1e6, nodos.size(), config.periodoMs, LoRa.nativoSpreadingFactor(), config.radioM,
+          d(&ResumenRed::generadas), datos, d(&ResumenRed::enSlot), d(&ResumenRed::entregadas),
+          d(&ResumenRed::colisiones), d(&ResumenRed::sinCobertura), d(&ResumenRed::gatewayTx), publicadas,
+          datos ? (double)publicadas / datos : 0.0, percentil(lat, 50), percentil(lat, 90), percentil(lat, 99),
+          lat.empty() ? 0.0f : lat.back(), us ? 100.0 * d(&ResumenRed::loopUs) / us : 0.0,
+          publicadas ? d(&ResumenRed::hostNs) / 1000.0 / publicadas : 0.0);
+  fflush(csv);
+}
+
+void programarFilaCsv() {
+  nativoProgramar((uint64_t)config.csvCadaMs * 1000, []() {
+    escribirFila("intervalo", corte);
+    corte.resumen = resumen;
+    corte.latencias = latencias.size();
+    corte.us = nativoMicros();
+    programarFilaCsv();
+  });
+}
+
+// Valor numérico de "campo":N en un JSON plano, o -1
+long campoJson(const std::string& json, const char* campo) {
+  std::string clave = std::string("\"") + campo + "\":";
+  size_t i = json.find(clave);
+  return i == std::string::npos ? -1 : strtol(json.c_str() + i + clave.size(), nullptr, 10);
+}
+
+}  // namespace
+
+ModeloRadio modeloLogDistancia(float pl0Db, float d0M, float n) {
+  ModeloRadio m;
+  m.perdidaDb = [pl0Db, d0M, n](float distanciaM) {
+    return pl0Db + 10.0f * n * log10f(std::max(distanciaM, 1.0f) / d0M);
+  };
+  return m;
+}
+
+ModeloRadio modeloEspacioLibre() {
+  ModeloRadio m;
+  m.perdidaDb = [](float distanciaM) {
+    return 20.0f * log10f(std::max(distanciaM, 1.0f)) + 20.0f * log10f((float)LoRa.nativoFrecuencia()) - 147.55f;
+  };
+  m.sombraDb = 0;
+  return m;
+}
+
+void redNativaIniciar(const ConfigRed& c) {
+  config = c;
+  nodos.assign(c.nodos, NodoRed{});
+  memset(seqPorId, 0, sizeof(seqPorId));
+  std::normal_distribution<float> sombra(0.0f, c.modelo.sombraDb > 0 ? c.modelo.sombraDb : 1.0f);
+  for (int i = 0; i < c.nodos; i++) {
+    NodoRed& n = nodos[i];
+    n.indice = (size_t)i;
+    n.id = (uint8_t)(1 + i % IDS_MAX);
+    n.slot = SIN_SLOT;
+    n.potencia = c.potenciaDbm;
+    // Uniforme en el área del círculo
+    float distancia = c.radioM * sqrtf(azar(0.0f, 1.0f));
+    n.perdidaDb = c.modelo.perdidaDb(distancia) + (c.modelo.sombraDb > 0 ? sombra(generador) : 0.0f);
+    size_t indice = n.indice;
+    nativoProgramar((uint64_t)(azar(0.0f, 1.0f) * c.periodoMs * 1000), [indice]() { generar(indice); });
+  }
+
+  if (!c.csv.empty() && c.nodos > 0) {
+    csv = fopen(c.csv.c_str(), "a");
+    if (!csv) {
+      fprintf(stderr, "[nativo] no se pudo abrir %s\n", c.csv.c_str());
+      return;
+    }
+    // Encabezado sólo en un archivo nuevo: varias corridas se acumulan
+    fseek(csv, 0, SEEK_END);
+    if (ftell(csv) == 0) {
+      fprintf(csv, "fila,t_s,nodos,periodo_ms,sf,radio_m,generadas,transmitidas,en_slot,entregadas,colisiones,"
+                   "sin_cobertura,gateway_tx,publicadas,pdr,lat_p50_ms,lat_p90_ms,lat_p99_ms,lat_max_ms,"
+                   "loop_ocupado_pct,host_us_trama\n");
+    }
+    if (c.csvCadaMs) programarFilaCsv();
+  }
+}
+
+bool redNativaActiva() {
+  return !nodos.empty();
+}
+
+void redNativaAlTransmitirGateway(const uint8_t* datos, size_t largo) {
+  uint64_t duracion = (uint64_t)(LoRa.nativoTiempoEnAireMs(largo) * 1000.0f);
+  std::shared_ptr<Transmision> t = ocuparCanal(0, 0, duracion, false);
+  uint64_t inicio = t->inicioUs, fin = t->finUs;
+  // El nodo oye todo lo que transmitió entero mientras él escuchaba, si le
+  // llega sobre el mínimo
+  std::vector<uint8_t> copia(datos, datos + largo);
+  int potencia = LoRa.nativoPotencia();
+  nativoProgramar(fin - inicio, [copia, inicio, fin, potencia]() {
+    auto oye = [inicio, potencia](const NodoRed& n) {
+      return n.ocupadoHastaUs <= inicio && demodula(rssiTrama(potencia, n));
+    };
+    BalizaTdma b;
+    if (tramaDecodificarBaliza(copia.data(), copia.size(), b)) {
+      resumen.balizas++;
+      for (NodoRed& n : nodos) {
+        if (oye(n)) oirBaliza(n, b, fin);
+      }
+      return;
+    }
+    uint8_t nodo;
+    uint16_t seq;
+    const char* texto;
+    size_t largoTexto;
+    if (!tramaDecodificarTexto(copia.data(), copia.size(), TRAMA_TIPO_COMANDO, nodo, seq, texto, largoTexto)) return;
+    NodoRed* n = buscarNodo(nodo);
+    if (n && oye(*n)) oirComando(*n, seq, std::string(texto, largoTexto));
+  });
+}
+
+void redNativaAlPublicar(const std::string& topico, const std::string& payload) {
+  if (nodos.empty() || topico != "gas/datos") return;
+  long clave = campoJson(payload, "raw");
+  auto it = enCamino.find((uint16_t)clave);
+  if (clave < 0 || it == enCamino.end()) return;
+  latencias.push_back((nativoMicros() - it->second) / 1000.0f);
+  enCamino.erase(it);
+  resumen.publicadas++;
+}
+
+void redNativaMedirLoop(uint64_t usVirtuales, uint64_t nsHost) {
+  resumen.loopUs += usVirtuales;
+  resumen.hostNs += nsHost;
+}
+
+void redNativaReporte() {
+  if (nodos.empty()) return;
+  const ResumenRed& r = resumen;
+  uint64_t enAire = r.datos + r.respuestas;
+  int conSlot = 0;
+  for (const NodoRed& n : nodos) conSlot += n.slot != SIN_SLOT;
+  std::vector<float> lat(latencias);
+  std::sort(lat.begin(), lat.end());
+
+  fprintf(stderr, "Red:                 %zu nodos cada %lu ms en %.0f m, %llu lecturas, %llu reemplazadas esperando el slot\n",
+          nodos.size(), config.periodoMs, config.radioM, (unsigned long long)r.generadas,
+          (unsigned long long)r.reemplazadas);
+  fprintf(stderr, "Red TX:              %llu datos (%llu en slot, %llu de ellos perdidos), %llu respuestas\n",
+          (unsigned long long)r.datos, (unsigned long long)r.enSlot, (unsigned long long)r.perdidasEnSlot,
+          (unsigned long long)r.respuestas);
+  fprintf(stderr, "Red canal:           %llu entregadas, %llu colisiones (%.2f%%), %llu con el gateway en TX (%.2f%%), %llu bajo la sensibilidad (%.2f%%)\n",
+          (unsigned long long)r.entregadas, (unsigned long long)r.colisiones,
+          enAire ? 100.0 * r.colisiones / enAire : 0.0, (unsigned long long)r.gatewayTx,
+          enAire ? 100.0 * r.gatewayTx / enAire : 0.0, (unsigned long long)r.sinCobertura,
+          enAire ? 100.0 * r.sinCobertura / enAire : 0.0);
+  fprintf(stderr, "Red TDMA:            %d/%zu nodos con slot, %llu balizas (%.1f%% oidas), %llu comandos oidos, espera media %.0f ms, max %.0f ms\n",
+          conSlot, nodos.size(), (unsigned long long)r.balizas,
+          r.balizas ? 100.0 * r.balizasOidas / (r.balizas * nodos.size()) : 0.0, (unsigned long long)r.comandos,
+          r.datos ? r.sumaEsperaUs / 1000.0 / r.datos : 0.0, r.maxEsperaUs / 1000.0);
+  fprintf(stderr, "Red entrega:         %llu publicadas en gas/datos (%.2f%% de los datos), latencia p50 %.0f ms, p90 %.0f ms, p99 %.0f ms, max %.0f ms\n",
+          (unsigned long long)r.publicadas, r.datos ? 100.0 * r.publicadas / r.datos : 0.0, percentil(lat, 50),
+          percentil(lat, 90), percentil(lat, 99), lat.empty() ? 0.0f : lat.back());
+  fprintf(stderr, "Red gateway:         loop() bloqueado %.2f%% del tiempo, %.1f us del host por trama publicada\n",
+          nativoMicros() ? 100.0 * r.loopUs / nativoMicros() : 0.0,
+          r.publicadas ? r.hostNs / 1000.0 / r.publicadas : 0.0);
+
+  if (csv) {
+    escribirFila("total", Corte());
+    fclose(csv);
+    csv = nullptr;
+  }
+}
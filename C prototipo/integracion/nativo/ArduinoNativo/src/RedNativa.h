@@ -0,0 +1,81 @@
+#ifndef RED_NATIVA_H
+#define RED_NATIVA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <string>
+
+//=============================================
+// Modelo de radio del canal
+//=============================================
+// Cuánto dura una trama y con qué nivel llega al otro extremo. Las dos
+// funciones se pueden reemplazar (pérdidas medidas en el sitio, otra
+// radio) sin tocar la red; el resto son parámetros. Una trama cuyo SNR
+// queda bajo el mínimo del SF de la red no se demodula.
+struct ModeloRadio {
+  std::function<float(float distanciaM)> perdidaDb;   // pérdida de trayecto
+  std::function<float(size_t largo)> tiempoEnAireMs;  // vacía: la de la radio del gateway
+  float sombraDb = 3.57f;          // desvío del sombreado log-normal, fijo por enlace
+  float desvanecimientoDb = 2.0f;  // +-, en cada trama
+  float ruidoDbm = -117.0f;        // -174 + 10 log10(125 kHz) + 6 dB de figura de ruido
+  float capturaDb = 6.0f;          // en un choque sobrevive la que llega este margen más fuerte
+};
+
+// Log-distancia: pl0Db a d0M metros y exponente n. Por defecto, el
+// entorno urbano medido por Bor et al. (LoRaSim)
+ModeloRadio modeloLogDistancia(float pl0Db = 127.41f, float d0M = 40.0f, float n = 2.08f);
+
+// Espacio libre a la frecuencia de la radio del gateway, sin sombreado:
+// cota optimista del alcance
+ModeloRadio modeloEspacioLibre();
+
+//=============================================
+// Red de nodos sensores sintéticos sobre un canal compartido
+//=============================================
+// Los nodos quedan al azar en un círculo de radioM con el gateway al
+// centro. Cada uno manda una trama de datos cada periodoMs, con fase
+// inicial al azar y +-10% de variación por ciclo (el timer de cada Nano
+// deriva por su lado). El canal respeta el tiempo en el aire: una trama que
+// se solapa con otra se pierde salvo por captura, y el gateway no recibe
+// nada mientras transmite.
+//
+// Los nodos oyen lo que transmite el gateway si les llega sobre el mínimo:
+// con un SLOT:<n>:<época> confirmado y una baliza TDMA reciente mandan los
+// datos en su slot (como el Nano, la lectura más nueva reemplaza a la que
+// esperaba); si no, por acceso aleatorio. Un nodo que transmite no oye la
+// baliza ni los comandos. Contestan los comandos por el mismo canal y
+// aplican la potencia de los RADIO: del ADR.
+//
+// El id de la trama es de 8 bits: con más de 254 nodos, los que comparten
+// id comparten también la secuencia y el gateway los ve como un solo nodo
+// que transmite más seguido. Las bajadas para ese id las recibe el primero.
+//
+// Cada trama lleva en raw una clave propia; al publicarse en gas/datos se
+// mide la latencia desde que el nodo tomó la lectura.
+
+struct ConfigRed {
+  int nodos = 0;
+  unsigned long periodoMs = 30000;
+  float radioM = 200;
+  int potenciaDbm = 20;              // hasta el primer RADIO: del ADR
+  ModeloRadio modelo = modeloLogDistancia();
+  std::string csv;                   // archivo: una fila por intervalo y una de total
+  unsigned long csvCadaMs = 60000;
+};
+
+void redNativaIniciar(const ConfigRed& c);
+bool redNativaActiva();
+
+// Cada transmisión del gateway (desde LoRa.nativoAlTransmitir)
+void redNativaAlTransmitirGateway(const uint8_t* datos, size_t largo);
+
+// Cada publicación del gateway (desde nativoBroker().alPublicar)
+void redNativaAlPublicar(const std::string& topico, const std::string& payload);
+
+// Cada iteración de loop(): tiempo virtual que bloqueó y tiempo del host
+void redNativaMedirLoop(uint64_t usVirtuales, uint64_t nsHost);
+
+void redNativaReporte();
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef SPI_H
+#define SPI_H
+
+// El fake de LoRa no usa SPI; alcanza con que el include exista
+class SPIClass {
+public:
+  void begin() {}
+  void end() {}
+};
+
+extern SPIClass SPI;
+
+#endif
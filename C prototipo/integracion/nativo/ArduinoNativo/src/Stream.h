@@ -0,0 +1,31 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "Print.h"
+
+// Stream de Arduino. En el host no hay esperas: timedRead() no bloquea.
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() {}
+
+  void setTimeout(unsigned long ms) { timeout = ms; }
+
+  size_t readBytes(uint8_t* buf, size_t largo) {
+    size_t n = 0;
+    while (n < largo) {
+      int c = read();
+      if (c < 0) break;
+      buf[n++] = (uint8_t)c;
+    }
+    return n;
+  }
+  size_t readBytes(char* buf, size_t largo) { return readBytes((uint8_t*)buf, largo); }
+
+protected:
+  unsigned long timeout = 1000;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef WSTRING_H
+#define WSTRING_H
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string>
+
+class __FlashStringHelper;
+
+// String de Arduino sobre std::string. Reserva en el heap igual que la
+// original, así que las mediciones de memoria del host son representativas.
+class String {
+public:
+  String() {}
+  String(const char* s) : s_(s ? s : "") {}
+  String(const __FlashStringHelper* s) : s_(reinterpret_cast<const char*>(s)) {}
+  String(const std::string& s) : s_(s) {}
+  explicit String(char c) : s_(1, c) {}
+  explicit String(unsigned char v, unsigned char base = 10);
+  explicit String(int v, unsigned char base = 10);
+  explicit String(unsigned int v, unsigned char base = 10);
+  explicit String(long v, unsigned char base = 10);
+  explicit String(unsigned long v, unsigned char base = 10);
+  explicit String(float v, unsigned char decimales = 2);
+  explicit String(double v, unsigned char decimales = 2);
+
+  // Acceso
+  unsigned int length() const { return (unsigned int)s_.size(); }
+  const char* c_str() const { return s_.c_str(); }
+  char charAt(unsigned int i) const { return i < s_.size() ? s_[i] : 0; }
+  char operator[](unsigned int i) const { return charAt(i); }
+  char& operator[](unsigned int i) { return s_[i]; }
+  bool reserve(unsigned int n) { s_.reserve(n); return true; }
+  bool isEmpty() const { return s_.empty(); }
+
+  // Concatenación
+  String& concat(const String& o) { s_ += o.s_; return *this; }
+  String& operator+=(const String& o) { return concat(o); }
+  String& operator+=(const char* o) { s_ += (o ? o : ""); return *this; }
+  String& operator+=(const __FlashStringHelper* o) { return *this += reinterpret_cast<const char*>(o); }
+  String& operator+=(char c) { s_ += c; return *this; }
+  String& operator+=(unsigned char v) { return concat(String(v)); }
+  String& operator+=(int v) { return concat(String(v)); }
+  String& operator+=(unsigned int v) { return concat(String(v)); }
+  String& operator+=(long v) { return concat(String(v)); }
+  String& operator+=(unsigned long v) { return concat(String(v)); }
+  String& operator+=(float v) { return concat(String(v)); }
+  String& operator+=(double v) { return concat(String(v)); }
+
+  friend String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+  friend String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+  friend String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+  friend String operator+(const String& a, char b) { String r(a); r += b; return r; }
+
+  // Comparación
+  bool equals(const String& o) const { return s_ == o.s_; }
+  bool operator==(const String& o) const { return s_ == o.s_; }
+  bool operator==(const char* o) const { return s_ == (o ? o : ""); }
+  bool operator!=(const String& o) const { return !(*this == o); }
+  bool operator!=(const char* o) const { return !(*this == o); }
+  bool startsWith(const String& p) const { return s_.compare(0, p.s_.size(), p.s_) == 0; }
+  bool endsWith(const String& p) const;
+
+  // Búsqueda y recorte
+  int indexOf(char c, unsigned int desde = 0) const;
+  int indexOf(const String& s, unsigned int desde = 0) const;
+  String substring(unsigned int desde) const;
+  String substring(unsigned int desde, unsigned int hasta) const;
+  void trim();
+  void toUpperCase();
+  void toLowerCase();
+  void replace(const String& buscar, const String& reemplazo);
+  void remove(unsigned int indice, unsigned int cantidad = (unsigned int)-1);
+
+  // Conversión
+  long toInt() const { return atol(s_.c_str()); }
+  float toFloat() const { return (float)atof(s_.c_str()); }
+  double toDouble() const { return atof(s_.c_str()); }
+  void toCharArray(char* buf, unsigned int tam, unsigned int desde = 0) const;
+  void getBytes(unsigned char* buf, unsigned int tam, unsigned int desde = 0) const;
+
+private:
+  std::string s_;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#include "WiFi.h"
+
+WiFiClass WiFi;
+
+RedNativo& nativoRed() {
+  static RedNativo red;
+  return red;
+}
+
+wl_status_t WiFiClass::begin(const char*, const char*) {
+  iniciado = true;
+  inicioMs = millis();
+  return WL_DISCONNECTED;
+}
+
+wl_status_t WiFiClass::status() {
+  if (!iniciado) return WL_IDLE_STATUS;
+  if (!nativoRed().disponible) {
+    // El driver reintenta solo; al volver el AP la demora cuenta desde ahí
+    if (autoReconectar) inicioMs = millis();
+    return WL_DISCONNECTED;
+  }
+  if (millis() - inicioMs < nativoRed().demoraConexionMs) return WL_DISCONNECTED;
+  return WL_CONNECTED;
+}
+
+bool WiFiClass::disconnect(bool) {
+  iniciado = false;
+  return true;
+}
+
+bool WiFiClass::reconnect() {
+  iniciado = true;
+  inicioMs = millis();
+  return true;
+}
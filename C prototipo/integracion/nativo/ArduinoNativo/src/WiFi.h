@@ -0,0 +1,69 @@
+#ifndef WIFI_H
+#define WIFI_H
+
+#include <Arduino.h>
+#include <functional>
+
+typedef enum {
+  WL_IDLE_STATUS     = 0,
+  WL_NO_SSID_AVAIL   = 1,
+  WL_CONNECTED       = 3,
+  WL_CONNECT_FAILED  = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED    = 6
+} wl_status_t;
+
+typedef enum {
+  WIFI_OFF = 0,
+  WIFI_STA = 1,
+  WIFI_AP  = 2,
+  WIFI_AP_STA = 3
+} wifi_mode_t;
+
+class IPAddress {
+public:
+  IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : o{a, b, c, d} {}
+  String toString() const {
+    return String((int)o[0]) + "." + String((int)o[1]) + "." + String((int)o[2]) + "." + String((int)o[3]);
+  }
+private:
+  uint8_t o[4];
+};
+
+// Cliente TCP: el fake de PubSubClient no lo usa
+class WiFiClient {
+public:
+  bool connected() { return true; }
+};
+
+// Estado de la red simulada
+struct RedNativo {
+  bool disponible = true;             // AP alcanzable
+  unsigned long demoraConexionMs = 1500;
+};
+
+RedNativo& nativoRed();
+
+// WiFi con la misma semántica que el driver de ESP32: begin() no bloquea y
+// status() pasa a WL_CONNECTED cuando transcurre la demora de asociación
+class WiFiClass {
+public:
+  wl_status_t begin(const char* ssid, const char* pass = nullptr);
+  wl_status_t status();
+  bool disconnect(bool apagar = false);
+  bool reconnect();
+  bool mode(wifi_mode_t) { return true; }
+  bool setAutoReconnect(bool v) { autoReconectar = v; return true; }
+  bool isConnected() { return status() == WL_CONNECTED; }
+  IPAddress localIP() { return isConnected() ? IPAddress(192, 168, 0, 50) : IPAddress(); }
+  int8_t RSSI() { return isConnected() ? -55 : 0; }
+
+private:
+  bool iniciado = false;
+  bool autoReconectar = true;
+  unsigned long inicioMs = 0;
+};
+
+extern WiFiClass WiFi;
+
+#endif
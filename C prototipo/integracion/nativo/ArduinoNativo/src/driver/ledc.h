@@ -0,0 +1,26 @@
+#ifndef DRIVER_LEDC_H
+#define DRIVER_LEDC_H
+
+#include <stdint.h>
+
+//=============================================
+// Driver LEDC de ESP-IDF 4.4 (el del core Arduino 2.x), sólo el fade
+//=============================================
+// El canal n del core es el canal n % 8 del grupo n / 8. Como en IDF 4.4,
+// un fade no se puede interrumpir: un fade nuevo o un ledcWrite() sobre el
+// mismo canal esperan a que termine.
+
+typedef int esp_err_t;
+#define ESP_OK                 0
+#define ESP_ERR_INVALID_ARG    0x102
+#define ESP_ERR_INVALID_STATE  0x103
+
+typedef enum { LEDC_HIGH_SPEED_MODE = 0, LEDC_LOW_SPEED_MODE, LEDC_SPEED_MODE_MAX } ledc_mode_t;
+typedef enum { LEDC_CHANNEL_0 = 0, LEDC_CHANNEL_MAX = 8 } ledc_channel_t;
+typedef enum { LEDC_FADE_NO_WAIT = 0, LEDC_FADE_WAIT_DONE } ledc_fade_mode_t;
+
+esp_err_t ledc_fade_func_install(int intr_alloc_flags);
+esp_err_t ledc_set_fade_with_time(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t target_duty, int max_fade_time_ms);
+esp_err_t ledc_fade_start(ledc_mode_t speed_mode, ledc_channel_t channel, ledc_fade_mode_t fade_mode);
+
+#endif
@@ -0,0 +1,1038 @@
+// Con pio test (PIO_UNIT_TESTING) el main() lo pone el runner de Unity
+#ifndef PIO_UNIT_TESTING
+
+#include <Arduino.h>
+#include <LoRa.h>
+#include <PubSubClient.h>
+#include <WiFi.h>
+#include <FS.h>
+#include <Preferences.h>
+#include <TramaLoRa.h>
+#include <TiempoEnAire.h>
+#include "RedNativa.h"
+#include "PlantaGas.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+//=============================================
+// Punto de entrada del firmware en el host
+//=============================================
+// Ejecuta setup() y loop() sobre el reloj virtual. Opciones:
+//
+//   --ms N            duración simulada en ms (60000)
+//   --tick-us N       tiempo virtual que consume cada iteración de loop() (1000)
+//   --silencio        descarta la salida de Serial
+//   --adc V           lectura fija de todas las entradas analógicas (300)
+//   --precalentamiento MS  la lectura arranca en ADC_FRIO y llega a V con
+//                     constante de tiempo MS (calentador del MQ en frío)
+//   --adc-ruido N     suma ruido uniforme de +-N cuentas a la lectura
+//   --adc-evento A:B:V  lectura V entre los ms A y B (fuga de gas); mide la
+//                     latencia hasta la primera trama con TRAMA_FLAG_ALERTA
+//   --lora-alarma A:B  inyecta una trama de alarma en el ms A y la de fin de
+//                     alarma en B; mide la latencia hasta el PWM al máximo y
+//                     hasta la publicación en gas/alarma
+//   --alarma-max MS   termina con código 1 si alguna latencia de alarma
+//                     supera MS
+//   --lora-cada MS    inyecta un paquete LoRa cada MS ms de reloj virtual
+//   --lora-nodos N    nodos que alternan en las tramas generadas (1)
+//   --lora-ppm P      ppm medio de las tramas generadas; oscila +-70% (500)
+//   --planta V[:Q[:W[:R]]]  las tramas generadas leen un recinto de V m3
+//                     con una fuga (PlantaGas.h): Q m3/h y W vatios por
+//                     extractor al 100%, ruido +-R% (30:900:150:3)
+//   --fuga A:B:LPM    fuga de LPM litros por minuto entre los ms A y B; se
+//                     puede repetir (implica --planta)
+//   --lora-banda P    las tramas generadas siguen el reporte por excepción
+//                     del nodo: sólo salen si la ppm se movió más de P desde
+//                     la última enviada o pasaron 300 s
+//   --grabar FILE     escribe en FILE cada lectura generada que se inyecta,
+//                     una por línea: ms,nodo,ppm
+//   --reproducir FILE  inyecta las lecturas de FILE (ms,nodo,ppm) como
+//                     tramas de datos; mide cuánto antes de cada cruce de
+//                     500 ppm ya andaba el extractor
+//   --lora-subida-perdida P  no inyecta el P% de las tramas generadas (la
+//                     secuencia avanza igual)
+//   --lora-duplicar P  inyecta dos veces el P% de las tramas generadas;
+//                     compara lo generado con lo publicado en gas/enlace
+//   --lora-canal S:P  canal por nodo para las tramas generadas: SNR medio S a
+//                     20 dBm para el nodo 1 y P dB menos por cada nodo
+//                     siguiente, con desvanecimiento de +-2 dB; bajo el
+//                     mínimo de SF7 la trama se pierde. Con --lora-eco los
+//                     nodos aplican los RADIO:<sf>:<dBm> que reciben. Informa
+//                     pérdidas y energía de transmisión de los nodos
+//   --lora-texto TXT  inyecta TXT en lugar de tramas de datos generadas
+//   --lora-comando N  manda --lora-texto como trama de comando para el nodo N;
+//                     cada secuencia sale dos veces (reintento tras perder el
+//                     ACK) y se cuentan las respuestas DUPLICATE
+//   --lora-respuesta P  mide la latencia desde cada inyección hasta la primera
+//                     transmisión que empiece con P (cualquiera si se omite)
+//   --lora-eco        simula los nodos del otro lado de la bajada: cada
+//                     trama de comando recibe "<CMD>_ACK", o DUPLICATE si
+//                     repite la secuencia, como trama de respuesta
+//   --lora-perdida P  pierde el P% de los comandos y de las respuestas de eco
+//   --red N:MS        N nodos sintéticos (ids 1..N, hasta 254) que mandan una trama cada
+//                     MS ms sobre un canal con tiempo en el aire, colisiones
+//                     y captura; siguen la baliza TDMA y los SLOT: del
+//                     gateway y contestan sus comandos (RedNativa.h)
+//   --red-radio M     radio del círculo donde quedan los nodos (200)
+//   --red-potencia DBM  potencia inicial de los nodos (20)
+//   --red-modelo M    pérdida de trayecto: log[:PL0:D0:N] (log-distancia,
+//                     LoRaSim por defecto) o libre (espacio libre)
+//   --csv FILE        agrega a FILE una fila por intervalo y una de total:
+//                     entrega, latencia hasta gas/datos y loop() ocupado
+//   --csv-cada MS     duración de cada intervalo del CSV (60000)
+//   --rampa CADA:PCT  fija la rampa del extractor en PCT %/s (set_rampa) y
+//                     alterna extractor_on / extractor_off cada CADA ms; mide
+//                     la duración de cada rampa y cuánto se aparta la salida
+//                     PWM de la rampa lineal ideal, muestreada cada ms
+//   --bloqueo-loop CADA:MS  bloquea loop() MS ms cada CADA ms, como una
+//                     reconexión bloqueante (las interrupciones siguen)
+//   --mqtt-comando-cada MS  manda "nodo:<n>:STATUS" a gas/control cada MS ms,
+//                     alternando entre los --lora-nodos; mide entrega,
+//                     latencia e intentos según lo publicado en gas/comandos
+//   --mqtt-control TXT  manda TXT a gas/control al arrancar (set_adr:0...)
+//   --mqtt-control-en MS:TXT  manda TXT a gas/control en el ms MS
+//   --mqtt-caida A:B  broker inalcanzable entre los ms A y B
+//   --mqtt-demora MS  cada publish bloquea MS ms
+//   --wifi-caida A:B  AP inalcanzable entre los ms A y B
+//   --nvs-demora US   cada escritura en Preferences bloquea US us
+//   --fs DIR          directorio del host para LittleFS (temporal si se omite)
+//   --reinicio MS     reinicio por software en el ms MS (se puede repetir)
+//
+// Al terminar imprime en stderr iteraciones, velocidad respecto del tiempo
+// real, tráfico LoRa/MQTT, escrituras en flash y uso del heap. Si el
+// firmware transmite tramas de datos, también el tiempo desde cada
+// arranque hasta la primera lectura confiable (sin TRAMA_FLAG_SIN_RO ni
+// TRAMA_FLAG_PRECALENTANDO).
+
+namespace {
+
+struct Opciones {
+  uint64_t ms = 60000;
+  uint64_t tickUs = 1000;
+  bool silencio = false;
+  int adc = 300;
+  unsigned long precalentamientoMs = 0;
+  int adcRuido = 0;
+  struct Evento { unsigned long desde, hasta; int adc; };
+  std::vector<Evento> eventosAdc;
+  std::vector<Evento> alarmasLora;   // sólo A:B
+  unsigned long alarmaMaxMs = 0;
+  unsigned long mqttDemoraMs = 0;
+  unsigned long nvsDemoraUs = 0;
+  unsigned long loraCadaMs = 0;
+  int loraNodos = 1;
+  float loraPpm = 500;
+  bool planta = false;
+  ConfigPlanta configPlanta;
+  struct Fuga { unsigned long desde, hasta; float litros; };
+  std::vector<Fuga> fugas;
+  float loraBanda = 0;
+  std::string grabar;
+  std::string reproducir;
+  int loraSubidaPerdida = 0;
+  int loraDuplicar = 0;
+  float canalSnr = 0, canalPaso = 0;
+  bool canal = false;
+  std::vector<std::string> mqttControl;
+  std::vector<std::pair<unsigned long, std::string>> mqttControlEn;
+  std::string loraTexto;
+  int loraComando = 0;
+  std::string loraRespuesta;
+  bool loraEco = false;
+  int loraPerdida = 0;
+  ConfigRed red;
+  unsigned long mqttComandoCadaMs = 0;
+  unsigned long rampa[2] = {0, 40};   // cada ms, % por segundo
+  unsigned long bloqueoLoop[2] = {0, 0};
+  unsigned long mqttCaida[2] = {0, 0};
+  unsigned long wifiCaida[2] = {0, 0};
+  std::vector<unsigned long> reinicios;
+};
+
+const int ADC_FRIO = 900;   // MQ con el calentador frío: Rs bajo, lectura alta
+
+// "A:B" -> intervalo [A, B) en ms
+void leerIntervalo(const char* texto, unsigned long* intervalo) {
+  char* fin;
+  intervalo[0] = strtoul(texto, &fin, 10);
+  intervalo[1] = (*fin == ':') ? strtoul(fin + 1, nullptr, 10) : intervalo[0];
+}
+
+// "A:B:V" -> lectura V en [A, B)
+Opciones::Evento leerEvento(const char* texto) {
+  Opciones::Evento e;
+  char* fin;
+  e.desde = strtoul(texto, &fin, 10);
+  e.hasta = (*fin == ':') ? strtoul(fin + 1, &fin, 10) : e.desde;
+  e.adc = (*fin == ':') ? atoi(fin + 1) : 0;
+  return e;
+}
+
+// "libre" o "log[:PL0:D0:N]"
+ModeloRadio leerModelo(const char* texto) {
+  if (strcmp(texto, "libre") == 0) return modeloEspacioLibre();
+  float pl0 = 127.41f, d0 = 40.0f, n = 2.08f;
+  if (strncmp(texto, "log", 3) != 0 || (texto[3] && sscanf(texto + 3, ":%f:%f:%f", &pl0, &d0, &n) != 3)) {
+    fprintf(stderr, "Modelo desconocido: %s (log-distancia por defecto)\n", texto);
+    return modeloLogDistancia();
+  }
+  return modeloLogDistancia(pl0, d0, n);
+}
+
+Opciones leerOpciones(int argc, char** argv) {
+  Opciones o;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    bool hayValor = i + 1 < argc;
+    if (a == "--ms" && hayValor)               o.ms = strtoull(argv[++i], nullptr, 10);
+    else if (a == "--tick-us" && hayValor)     o.tickUs = strtoull(argv[++i], nullptr, 10);
+    else if (a == "--silencio")                o.silencio = true;
+    else if (a == "--adc" && hayValor)         o.adc = atoi(argv[++i]);
+    else if (a == "--precalentamiento" && hayValor) o.precalentamientoMs = strtoul(argv[++i], nullptr, 10);
+    else if (a == "--adc-ruido" && hayValor)   o.adcRuido = atoi(argv[++i]);
+    else if (a == "--adc-evento" && hayValor)  o.eventosAdc.push_back(leerEvento(argv[++i]));
+    else if (a == "--lora-alarma" && hayValor) o.alarmasLora.push_back(leerEvento(argv[++i]));
+    else if (a == "--alarma-max" && hayValor)  o.alarmaMaxMs = strtoul(argv[++i], nullptr, 10);
+    else if (a == "--mqtt-demora" && hayValor) o.mqttDemoraMs = strtoul(argv[++i], nullptr, 10);
+    else if (a == "--nvs-demora" && hayValor) o.nvsDemoraUs = strtoul(argv[++i], nullptr, 10);
+    else if (a == "--lora-cada" && hayValor)   o.loraCadaMs = strtoul(argv[++i], nullptr, 10);
+    else if (a == "--lora-nodos" && hayValor)  o.loraNodos = atoi(argv[++i]);
+    else if (a == "--lora-ppm" && hayValor)    o.loraPpm = (float)atof(argv[++i]);
+    else if (a == "--planta" && hayValor) {
+      ConfigPlanta& p = o.configPlanta;
+      o.planta = true;
+      sscanf(argv[++i], "%f:%f:%f:%f", &p.volumenM3, &p.caudalM3h, &p.potenciaW, &p.ruidoPct);
+    }
+    else if (a == "--fuga" && hayValor) {
+      Opciones::Fuga f = {0, 0, 0};
+      o.planta = true;
+      sscanf(argv[++i], "%lu:%lu:%f", &f.desde, &f.hasta, &f.litros);
+      o.fugas.push_back(f);
+    }
+    else if (a == "--lora-banda" && hayValor)  o.loraBanda = (float)atof(argv[++i]);
+    else if (a == "--grabar" && hayValor)      o.grabar = argv[++i];
+    else if (a == "--reproducir" && hayValor)  o.reproducir = argv[++i];
+    else if (a == "--lora-subida-perdida" && hayValor) o.loraSubidaPerdida = atoi(argv[++i]);
+    else if (a == "--lora-duplicar" && hayValor) o.loraDuplicar = atoi(argv[++i]);
+    else if (a == "--lora-canal" && hayValor) {
+      char* fin;
+      o.canal = true;
+      o.canalSnr = strtof(argv[++i], &fin);
+      o.canalPaso = (*fin == ':') ? strtof(fin + 1, nullptr) : 0;
+    }
+    else if (a == "--mqtt-control" && hayValor) o.mqttControl.push_back(argv[++i]);
+    else if (a == "--mqtt-control-en" && hayValor) {
+      char* fin;
+      unsigned long ms = strtoul(argv[++i], &fin, 10);
+      o.mqttControlEn.push_back({ms, *fin == ':' ? fin + 1 : fin});
+    }
+    else if (a == "--lora-texto" && hayValor)  o.loraTexto = argv[++i];
+    else if (a == "--lora-comando" && hayValor) o.loraComando = atoi(argv[++i]);
+    else if (a == "--lora-respuesta" && hayValor) o.loraRespuesta = argv[++i];
+    else if (a == "--lora-eco")                o.loraEco = true;
+    else if (a == "--lora-perdida" && hayValor) o.loraPerdida = atoi(argv[++i]);
+    else if (a == "--red" && hayValor) {
+      char* fin;
+      o.red.nodos = (int)strtol(argv[++i], &fin, 10);
+      if (*fin == ':') o.red.periodoMs = strtoul(fin + 1, nullptr, 10);
+    }
+    else if (a == "--red-radio" && hayValor)   o.red.radioM = (float)atof(argv[++i]);
+    else if (a == "--red-potencia" && hayValor) o.red.potenciaDbm = atoi(argv[++i]);
+    else if (a == "--red-modelo" && hayValor)  o.red.modelo = leerModelo(argv[++i]);
+    else if (a == "--csv" && hayValor)         o.red.csv = argv[++i];
+    else if (a == "--csv-cada" && hayValor)    o.red.csvCadaMs = strtoul(argv[++i], nullptr, 10);
+    else if (a == "--rampa" && hayValor)       leerIntervalo(argv[++i], o.rampa);
+    else if (a == "--bloqueo-loop" && hayValor) leerIntervalo(argv[++i], o.bloqueoLoop);
+    else if (a == "--mqtt-comando-cada" && hayValor) o.mqttComandoCadaMs = strtoul(argv[++i], nullptr, 10);
+    else if (a == "--mqtt-caida" && hayValor)  leerIntervalo(argv[++i], o.mqttCaida);
+    else if (a == "--wifi-caida" && hayValor)  leerIntervalo(argv[++i], o.wifiCaida);
+    else if (a == "--fs" && hayValor)          nativoDirectorioFS(argv[++i]);
+    else if (a == "--reinicio" && hayValor)    o.reinicios.push_back(strtoul(argv[++i], nullptr, 10));
+    else fprintf(stderr, "Opcion desconocida: %s\n", a.c_str());
+  }
+  if (o.loraNodos < 1) o.loraNodos = 1;
+  return o;
+}
+
+// Intervalo medido sobre el reloj virtual: empezar() ... terminar()
+struct Medicion {
+  uint64_t desdeUs = 0;
+  bool pendiente = false;
+  uint64_t muestras = 0;
+  uint64_t sumaUs = 0;
+  uint64_t maxUs = 0;
+
+  void empezar() {
+    desdeUs = nativoMicros();
+    pendiente = true;
+  }
+  void terminar() {
+    uint64_t us = nativoMicros() - desdeUs;
+    pendiente = false;
+    muestras++;
+    sumaUs += us;
+    if (us > maxUs) maxUs = us;
+  }
+  double mediaMs() const { return muestras ? sumaUs / 1000.0 / muestras : 0.0; }
+  double maxMs() const { return maxUs / 1000.0; }
+};
+
+Medicion latencias;       // inyección -> inicio de la transmisión que responde
+Medicion primeraLectura;  // arranque -> primera trama de datos con ppm confiable
+Medicion alarmas;         // inicio de una fuga simulada -> primera trama con alerta
+Medicion alarmaPwm;       // trama de alarma inyectada -> PWM al máximo
+Medicion alarmaMqtt;      // trama de alarma inyectada -> publicación en gas/alarma
+
+// Rampas del extractor frente a la rampa lineal ideal a la pendiente pedida
+struct SeguimientoRampa {
+  int pin = -1;               // el del último analogWrite()
+  bool activa = false;
+  uint64_t desdeUs = 0;
+  int desde = 0;
+  int hasta = 0;
+  float pwmPorSegundo = 0;
+  Medicion duracion;          // orden -> PWM en el objetivo
+  double esperadaMs = 0;
+  double sumaEsperadaMs = 0;  // de las terminadas
+  uint64_t incompletas = 0;
+  int errorMax = 0;           // PWM
+  double sumaError = 0;
+  uint64_t muestras = 0;
+  uint64_t bloqueos = 0;
+} rampa;
+
+// Arranques de las salidas PWM (de 0 a más): con varios extractores, cuánto
+// se separan y cuántos andan a la vez
+struct ArranquesPwm {
+  int valor[64] = {0};
+  uint64_t pines = 0;         // bit por pin usado
+  uint64_t arranques = 0;
+  uint64_t ultimoUs = 0;
+  int ultimoPin = -1;
+  uint64_t separacionMinUs = UINT64_MAX;  // entre arranques de pines distintos
+  int enMarcha = 0;
+  int enMarchaMax = 0;
+} arranquesPwm;
+
+// Comandos de bajada según los estados publicados en gas/comandos
+struct ResumenComandos {
+  uint64_t pedidos = 0;      // mandados por MQTT
+  uint64_t encolados = 0;
+  uint64_t entregados = 0;
+  uint64_t fallidos = 0;
+  uint64_t rechazados = 0;
+  uint64_t duplicados = 0;   // confirmados con DUPLICATE: se perdió un ACK
+  uint64_t intentos = 0;     // suma sobre los entregados
+  uint64_t sumaLatenciaMs = 0;
+  uint64_t maxLatenciaMs = 0;
+  uint64_t bajadas = 0;      // tramas de comando transmitidas
+  uint64_t bajadasPerdidas = 0;
+  uint64_t respuestasPerdidas = 0;
+  uint64_t respuestasNodo = 0;        // --lora-comando: tramas de respuesta del nodo
+  uint64_t duplicadosNodo = 0;        // ... de ellas, DUPLICATE
+} comandosLora;
+
+// Tramas generadas frente a lo que informa el gateway en gas/enlace
+struct ResumenEnlace {
+  uint64_t generadas = 0;
+  uint64_t perdidas = 0;
+  uint64_t duplicadas = 0;
+  uint64_t reportes = 0;
+  uint64_t recibidasReportadas = 0;
+  uint64_t perdidasReportadas = 0;
+  uint64_t duplicadasReportadas = 0;
+} enlaceLora;
+
+// Resultados que publica el gateway en gas/resultado, por valor de "resultado"
+std::map<std::string, uint64_t> resultadosControl;
+
+// Reporte por excepción de los nodos generados (--lora-banda), como
+// ReportPolicy del Nodo Sensor
+struct ExcepcionNodo {
+  float ppm = 0;
+  unsigned long ms = 0;
+  uint16_t seq = 0;
+  bool enviada = false;
+};
+const unsigned long HEARTBEAT_MS = 300000;
+ExcepcionNodo excepcionNodos[256];
+uint64_t lecturasSuprimidas = 0;
+FILE* grabacion = nullptr;
+
+// Lecturas de --reproducir frente al extractor: cuánto antes de cada cruce
+// del umbral (la mayor ppm reproducida lo supera) ya andaba
+struct Reproduccion {
+  uint64_t lecturas = 0;
+  uint64_t nodos = 0;             // bit por nodo, hasta 64
+  float ppm[256] = {0};
+  bool sobre = false;
+  uint64_t cruces = 0;
+  uint64_t sinExtractor = 0;      // cruces con el extractor parado
+  double sumaAnticipacionS = 0;
+  double minAnticipacionS = 0;
+  uint64_t encendidoDesdeUs = 0;
+  bool encendido = false;
+  uint64_t encendidoUs = 0;       // total, hasta el último cambio
+} reproduccion;
+
+void extractorReproducido(bool encendido) {
+  Reproduccion& r = reproduccion;
+  if (encendido == r.encendido) return;
+  if (encendido) r.encendidoDesdeUs = nativoMicros();
+  else r.encendidoUs += nativoMicros() - r.encendidoDesdeUs;
+  r.encendido = encendido;
+}
+
+// Nodos generados con --lora-canal: potencia que aplicó cada uno
+struct CanalNodos {
+  std::map<uint8_t, int> potencia;    // dBm; 20 hasta el primer RADIO:
+  uint64_t tramas = 0;
+  uint64_t perdidas = 0;              // SNR bajo el mínimo del SF
+  uint64_t sumaPotencia = 0;
+  uint64_t ajustes = 0;               // RADIO: aplicados
+  double energiaMj = 0;
+
+  int potenciaDe(uint8_t nodo) {
+    auto it = potencia.find(nodo);
+    return it == potencia.end() ? 20 : it->second;
+  }
+} canalNodos;
+
+// Generador propio: la pérdida no altera la secuencia de random() del firmware
+bool perder(int porcentaje) {
+  static std::minstd_rand generador(7);
+  return porcentaje > 0 && std::uniform_int_distribution<int>(0, 99)(generador) < porcentaje;
+}
+
+// Valor numérico de "campo":N en un JSON plano, o 0
+unsigned long campoJson(const std::string& json, const char* campo) {
+  std::string clave = std::string("\"") + campo + "\":";
+  size_t i = json.find(clave);
+  return i == std::string::npos ? 0 : strtoul(json.c_str() + i + clave.size(), nullptr, 10);
+}
+
+// El nodo contesta al terminar de recibir, tras procesar el comando
+void responderComando(const uint8_t* datos, size_t largo, int perdida) {
+  static std::map<uint8_t, uint16_t> ultimoSeq;
+  uint8_t nodo;
+  uint16_t seq;
+  const char* texto;
+  size_t largoTexto;
+  if (!tramaDecodificarTexto(datos, largo, TRAMA_TIPO_COMANDO, nodo, seq, texto, largoTexto)) return;
+  comandosLora.bajadas++;
+  if (perder(perdida)) {
+    comandosLora.bajadasPerdidas++;
+    return;
+  }
+  std::string respuesta;
+  auto it = ultimoSeq.find(nodo);
+  if (it != ultimoSeq.end() && it->second == seq) {
+    respuesta = "DUPLICATE";
+  } else {
+    ultimoSeq[nodo] = seq;
+    respuesta = std::string(texto, largoTexto) + "_ACK";
+    int sf, dbm;
+    if (sscanf(respuesta.c_str(), "RADIO:%d:%d", &sf, &dbm) == 2) {
+      canalNodos.potencia[nodo] = dbm;
+      canalNodos.ajustes++;
+    }
+  }
+  if (perder(perdida)) {
+    comandosLora.respuestasPerdidas++;
+    return;
+  }
+  std::vector<uint8_t> buf(TRAMA_LARGO_MAX);
+  size_t n = tramaCodificarTexto(TRAMA_TIPO_RESPUESTA, nodo, seq, respuesta.data(), respuesta.size(),
+                                 buf.data(), buf.size());
+  buf.resize(n);
+  uint64_t enUs = (uint64_t)(LoRa.nativoTiempoEnAireMs(largo) * 1000.0f) + 60000;
+  nativoProgramar(enUs, [buf]() { LoRa.nativoInyectar(buf.data(), buf.size()); });
+}
+
+// Suma todas las apariciones de "campo":N
+uint64_t sumarCampoJson(const std::string& json, const char* campo) {
+  std::string clave = std::string("\"") + campo + "\":";
+  uint64_t suma = 0;
+  for (size_t i = json.find(clave); i != std::string::npos; i = json.find(clave, i + 1)) {
+    suma += strtoul(json.c_str() + i + clave.size(), nullptr, 10);
+  }
+  return suma;
+}
+
+void medirEnlace(const MensajeNativo& m) {
+  if (m.topico != "gas/enlace") return;
+  enlaceLora.reportes++;
+  enlaceLora.recibidasReportadas += sumarCampoJson(m.payload, "recibidas");
+  enlaceLora.perdidasReportadas += sumarCampoJson(m.payload, "perdidas");
+  enlaceLora.duplicadasReportadas += sumarCampoJson(m.payload, "duplicadas");
+}
+
+void medirResultados(const MensajeNativo& m) {
+  if (m.topico != "gas/resultado") return;
+  const std::string clave = "\"resultado\":\"";
+  size_t i = m.payload.find(clave);
+  if (i == std::string::npos) return;
+  i += clave.size();
+  resultadosControl[m.payload.substr(i, m.payload.find('"', i) - i)]++;
+}
+
+void medirComandos(const MensajeNativo& m) {
+  if (m.topico != "gas/comandos") return;
+  ResumenComandos& r = comandosLora;
+  if (m.payload.find("\"estado\":\"encolado\"") != std::string::npos) r.encolados++;
+  else if (m.payload.find("\"estado\":\"rechazado\"") != std::string::npos) r.rechazados++;
+  else if (m.payload.find("\"estado\":\"fallido\"") != std::string::npos) r.fallidos++;
+  else if (m.payload.find("\"estado\":\"entregado\"") != std::string::npos) {
+    r.entregados++;
+    r.intentos += campoJson(m.payload, "intentos");
+    unsigned long ms = campoJson(m.payload, "latenciaMs");
+    r.sumaLatenciaMs += ms;
+    if (ms > r.maxLatenciaMs) r.maxLatenciaMs = ms;
+    if (m.payload.find("\"respuesta\":\"DUPLICATE\"") != std::string::npos) r.duplicados++;
+  }
+}
+
+void programarComandosMqtt(const Opciones& o) {
+  static uint32_t enviados = 0;
+  nativoProgramar((uint64_t)o.mqttComandoCadaMs * 1000, [o]() {
+    char msg[32];
+    snprintf(msg, sizeof(msg), "nodo:%d:STATUS", 1 + (int)(enviados++ % o.loraNodos));
+    nativoBroker().enviar("gas/control", msg);
+    comandosLora.pedidos++;
+    programarComandosMqtt(o);
+  });
+}
+
+void medirRespuestas(const Opciones& o) {
+  std::string prefijo = o.loraRespuesta;
+  bool medirLatencia = !o.loraTexto.empty();
+  bool eco = o.loraEco;
+  int perdida = o.loraPerdida;
+  LoRa.nativoAlTransmitir([prefijo, medirLatencia, eco, perdida](const uint8_t* datos, size_t largo) {
+    // Los nodos de --red contestan por el canal compartido
+    if (redNativaActiva()) redNativaAlTransmitirGateway(datos, largo);
+    else if (eco) responderComando(datos, largo, perdida);
+    // Respuesta enmarcada: el prefijo se busca en el texto
+    uint8_t nodo;
+    uint16_t seq;
+    const char* texto;
+    size_t largoTexto;
+    if (tramaDecodificarTexto(datos, largo, TRAMA_TIPO_RESPUESTA, nodo, seq, texto, largoTexto)) {
+      comandosLora.respuestasNodo++;
+      if (largoTexto == 9 && memcmp(texto, "DUPLICATE", 9) == 0) comandosLora.duplicadosNodo++;
+      datos = (const uint8_t*)texto;
+      largo = largoTexto;
+    }
+    LecturaGas l;
+    bool esDatos = tramaDecodificarDatos(datos, largo, l);
+    if (primeraLectura.pendiente && esDatos && tramaPpmConfiable(l.flags)) primeraLectura.terminar();
+    if (alarmas.pendiente && esDatos && (l.flags & TRAMA_FLAG_ALERTA)) alarmas.terminar();
+
+    if (!medirLatencia || !latencias.pendiente) return;
+    if (largo < prefijo.size() || memcmp(datos, prefijo.data(), prefijo.size()) != 0) return;
+    latencias.terminar();
+  });
+
+  nativoAlEscribirPWM([](uint8_t pin, int valor) {
+    rampa.pin = pin;
+    plantaAlEscribirPWM(pin, valor);
+    ArranquesPwm& ap = arranquesPwm;
+    if (pin < 64) {
+      ap.pines |= 1ULL << pin;
+      if (!ap.valor[pin] && valor) {
+        uint64_t ahora = nativoMicros();
+        if (ap.ultimoPin >= 0 && ap.ultimoPin != pin && ahora - ap.ultimoUs < ap.separacionMinUs) {
+          ap.separacionMinUs = ahora - ap.ultimoUs;
+        }
+        ap.arranques++;
+        ap.ultimoUs = ahora;
+        ap.ultimoPin = pin;
+        if (++ap.enMarcha > ap.enMarchaMax) ap.enMarchaMax = ap.enMarcha;
+      } else if (ap.valor[pin] && !valor) {
+        ap.enMarcha--;
+      }
+      ap.valor[pin] = valor;
+      extractorReproducido(ap.enMarcha > 0);
+    }
+    if (alarmaPwm.pendiente && valor >= 255) alarmaPwm.terminar();
+  });
+  nativoBroker().alPublicar = [](const MensajeNativo& m) {
+    redNativaAlPublicar(m.topico, m.payload);
+    plantaAlPublicar(m.topico, m.payload);
+    medirComandos(m);
+    medirEnlace(m);
+    medirResultados(m);
+    if (alarmaMqtt.pendiente && m.topico == "gas/alarma" && m.retenido &&
+        m.payload.find("\"alarma\":true") != std::string::npos) {
+      alarmaMqtt.terminar();
+    }
+  };
+}
+
+void muestrearRampa() {
+  SeguimientoRampa& r = rampa;
+  if (!r.activa) return;
+  int pwm = r.pin >= 0 ? nativoLeerPWM((uint8_t)r.pin) : 0;
+  float avance = r.pwmPorSegundo * (nativoMicros() - r.desdeUs) / 1e6f;
+  float ideal = r.hasta > r.desde ? std::min((float)r.hasta, r.desde + avance)
+                                  : std::max((float)r.hasta, r.desde - avance);
+  int error = (int)lroundf(fabsf(pwm - ideal));
+  r.errorMax = std::max(r.errorMax, error);
+  r.sumaError += error;
+  r.muestras++;
+  if (pwm == r.hasta) {
+    r.duracion.terminar();
+    r.sumaEsperadaMs += r.esperadaMs;
+    r.activa = false;
+    return;
+  }
+  nativoProgramar(1000, muestrearRampa);
+}
+
+// extractor_on lleva el extractor al 80%: PWM 204
+void programarRampas(const Opciones& o) {
+  static bool encender = true;
+  nativoProgramar((uint64_t)o.rampa[0] * 1000, [o]() {
+    SeguimientoRampa& r = rampa;
+    if (r.activa) r.incompletas++;
+    r.desde = r.pin >= 0 ? nativoLeerPWM((uint8_t)r.pin) : 0;
+    r.hasta = encender ? (int)map(80, 0, 100, 0, 255) : 0;
+    r.pwmPorSegundo = o.rampa[1] * 255.0f / 100.0f;
+    r.desdeUs = nativoMicros();
+    r.esperadaMs = abs(r.hasta - r.desde) * 1000.0 / r.pwmPorSegundo;
+    r.duracion.empezar();
+    bool seguir = !r.activa;
+    r.activa = true;
+    nativoBroker().enviar("gas/control", encender ? "extractor_on" : "extractor_off");
+    encender = !encender;
+    if (seguir) nativoProgramar(1000, muestrearRampa);
+    programarRampas(o);
+  });
+}
+
+// Sólo el arranque en frío calienta el sensor: tras un reinicio por
+// software el calentador sigue encendido
+int lecturaAnalogica(const Opciones& o) {
+  int v = o.adc;
+  for (const Opciones::Evento& e : o.eventosAdc) {
+    if (millis() >= e.desde && millis() < e.hasta) v = e.adc;
+  }
+  if (o.precalentamientoMs) {
+    float t = (float)millis() / (float)o.precalentamientoMs;
+    v += (int)lroundf((ADC_FRIO - v) * expf(-t));
+  }
+  // Generador propio: no altera la secuencia de random() del firmware
+  static std::minstd_rand generador(1);
+  if (o.adcRuido > 0) v += std::uniform_int_distribution<int>(-o.adcRuido, o.adcRuido)(generador);
+  return constrain(v, 0, 1023);
+}
+
+void programarEventosAdc(const Opciones& o) {
+  for (const Opciones::Evento& e : o.eventosAdc) {
+    nativoProgramar((uint64_t)e.desde * 1000, []() { alarmas.empezar(); });
+  }
+}
+
+// Cruce de umbral de un nodo que no está en el tráfico generado: trama de
+// alarma con ALERTA en A y trama de alarma de vuelta a normal en B
+void inyectarAlarma(bool alerta) {
+  static uint16_t seq = 0;
+  LecturaGas l;
+  l.nodo  = 200;
+  l.seq   = seq++;
+  l.ppm   = alerta ? 1500.0f : 100.0f;
+  l.ratio = alerta ? 0.3f : 2.5f;
+  l.raw   = alerta ? 900 : 300;
+  l.flags = alerta ? TRAMA_FLAG_ALERTA : 0;
+  uint8_t buf[TRAMA_LARGO_MAX];
+  size_t n = tramaCodificarDatos(l, buf, sizeof(buf), TRAMA_TIPO_ALARMA);
+  uint64_t perdidosAntes = nativoEstadisticas().loraPerdidos;
+  LoRa.nativoInyectar(buf, n);
+  if (alerta && nativoEstadisticas().loraPerdidos == perdidosAntes) {
+    alarmaPwm.empezar();
+    alarmaMqtt.empezar();
+  }
+}
+
+void programarAlarmasLora(const Opciones& o) {
+  for (const Opciones::Evento& e : o.alarmasLora) {
+    nativoProgramar((uint64_t)e.desde * 1000, []() { inyectarAlarma(true); });
+    if (e.hasta > e.desde) nativoProgramar((uint64_t)e.hasta * 1000, []() { inyectarAlarma(false); });
+  }
+}
+
+// Lectura del nodo al que le toca la trama número generada. Con --lora-banda
+// devuelve false si el nodo no la transmitiría
+bool generarLectura(const Opciones& o, uint32_t generada, LecturaGas& l) {
+  l.nodo  = (uint8_t)(1 + generada % o.loraNodos);
+  l.seq   = (uint16_t)(generada / o.loraNodos);
+  l.ppm   = plantaActiva() ? plantaLectura() : o.loraPpm * (1.0f + 0.7f * sinf((float)millis() / 20000.0f));
+  l.ratio = 1.0f;
+  l.raw   = 400;
+  l.flags = 0;
+  if (o.loraBanda <= 0) return true;
+
+  ExcepcionNodo& x = excepcionNodos[l.nodo];
+  if (x.enviada && fabsf(l.ppm - x.ppm) <= o.loraBanda && millis() - x.ms < HEARTBEAT_MS) {
+    lecturasSuprimidas++;
+    return false;
+  }
+  x.ppm = l.ppm;
+  x.ms = millis();
+  x.enviada = true;
+  l.seq = x.seq++;
+  return true;
+}
+
+// Tráfico LoRa sintético: tramas de datos con ppm oscilando +-70% alrededor
+// de loraPpm (entre ~150 y ~850 por defecto)
+void programarTrafico(const Opciones& o) {
+  static uint32_t enviados = 0;
+  nativoProgramar((uint64_t)o.loraCadaMs * 1000, [o]() {
+    LecturaGas l;
+    if (!o.loraTexto.empty()) {
+      uint64_t perdidosAntes = nativoEstadisticas().loraPerdidos;
+      if (o.loraComando > 0) {
+        uint8_t buf[TRAMA_LARGO_MAX];
+        size_t n = tramaCodificarTexto(TRAMA_TIPO_COMANDO, (uint8_t)o.loraComando, (uint16_t)(enviados / 2),
+                                       o.loraTexto.data(), o.loraTexto.size(), buf, sizeof(buf));
+        LoRa.nativoInyectar(buf, n);
+      } else {
+        LoRa.nativoInyectar((const uint8_t*)o.loraTexto.data(), o.loraTexto.size());
+      }
+      // Un reintento de comando sólo recibe DUPLICATE: no se mide
+      bool reintento = o.loraComando > 0 && enviados % 2;
+      if (!latencias.pendiente && !reintento && nativoEstadisticas().loraPerdidos == perdidosAntes) latencias.empezar();
+    } else if (generarLectura(o, enviados, l)) {
+      uint8_t buf[TRAMA_LARGO_MAX];
+      size_t n = tramaCodificarDatos(l, buf, sizeof(buf));
+      enlaceLora.generadas++;
+      int rssi = -80 - (int)(l.nodo * 5);
+      float snr = 7.5f - l.nodo;
+      bool perdida = perder(o.loraSubidaPerdida);
+      if (o.canal) {
+        // El SX1276 no informa SNR por encima de ~+12 dB
+        static std::minstd_rand generador(11);
+        int dbm = canalNodos.potenciaDe(l.nodo);
+        snr = o.canalSnr - o.canalPaso * (l.nodo - 1) - (20 - dbm) +
+              std::uniform_real_distribution<float>(-2.0f, 2.0f)(generador);
+        rssi = (int)lroundf(-117.0f + snr);
+        canalNodos.tramas++;
+        canalNodos.sumaPotencia += dbm;
+        canalNodos.energiaMj += powf(10.0f, dbm / 10.0f) * LoRa.nativoTiempoEnAireMs(n) / 1000.0;
+        if (snr < snrMinimoDb(7)) {
+          canalNodos.perdidas++;
+          perdida = true;
+        }
+        snr = std::min(snr, 12.0f);
+      }
+      if (perdida) {
+        enlaceLora.perdidas++;
+      } else {
+        LoRa.nativoInyectar(buf, n, rssi, snr);
+        if (grabacion) fprintf(grabacion, "%lu,%u,%.1f\n", millis(), l.nodo, l.ppm);
+        if (perder(o.loraDuplicar)) {
+          // Copia que llega después de que el gateway leyó la original
+          enlaceLora.duplicadas++;
+          std::vector<uint8_t> copia(buf, buf + n);
+          nativoProgramar(30000, [copia]() { LoRa.nativoInyectar(copia.data(), copia.size()); });
+        }
+      }
+    }
+    enviados++;
+    programarTrafico(o);
+  });
+}
+
+// Lecturas grabadas (con --grabar, o un registro de gas/datos: timestamp,
+// nodoId y ppm), cada una inyectada a su hora
+struct LecturaGrabada {
+  unsigned long ms;
+  unsigned nodo;
+  float ppm;
+};
+std::vector<LecturaGrabada> grabadas;
+
+void inyectarGrabada(size_t i, float umbral) {
+  static uint16_t seq[256] = {0};
+  const LecturaGrabada& g = grabadas[i];
+  LecturaGas l;
+  l.nodo  = (uint8_t)g.nodo;
+  l.seq   = seq[l.nodo]++;
+  l.ppm   = g.ppm;
+  l.ratio = 1.0f;
+  l.raw   = 400;
+  l.flags = 0;
+  uint8_t buf[TRAMA_LARGO_MAX];
+  LoRa.nativoInyectar(buf, tramaCodificarDatos(l, buf, sizeof(buf)));
+
+  // El gateway todavía no vio esta lectura: cuenta lo que hizo antes
+  Reproduccion& r = reproduccion;
+  r.lecturas++;
+  if (l.nodo < 64) r.nodos |= 1ULL << l.nodo;
+  r.ppm[l.nodo] = g.ppm;
+  bool sobre = *std::max_element(r.ppm, r.ppm + 256) > umbral;
+  if (sobre && !r.sobre) {
+    r.cruces++;
+    if (!r.encendido) {
+      r.sinExtractor++;
+    } else {
+      double s = (nativoMicros() - r.encendidoDesdeUs) / 1e6;
+      if (r.cruces - r.sinExtractor == 1 || s < r.minAnticipacionS) r.minAnticipacionS = s;
+      r.sumaAnticipacionS += s;
+    }
+  }
+  r.sobre = sobre;
+
+  if (++i >= grabadas.size()) return;
+  uint64_t us = (uint64_t)grabadas[i].ms * 1000;
+  nativoProgramar(us > nativoMicros() ? us - nativoMicros() : 0, [i, umbral]() { inyectarGrabada(i, umbral); });
+}
+
+void programarReproduccion(const Opciones& o) {
+  FILE* f = fopen(o.reproducir.c_str(), "r");
+  if (!f) {
+    fprintf(stderr, "No se pudo abrir %s\n", o.reproducir.c_str());
+    return;
+  }
+  char linea[128];
+  while (fgets(linea, sizeof(linea), f)) {
+    LecturaGrabada g;
+    // Salta encabezados y líneas que no son lecturas
+    if (sscanf(linea, "%lu,%u,%f", &g.ms, &g.nodo, &g.ppm) == 3 && g.nodo < 256) grabadas.push_back(g);
+  }
+  fclose(f);
+  if (grabadas.empty()) return;
+  float umbral = o.configPlanta.umbralPpm;
+  nativoProgramar((uint64_t)grabadas[0].ms * 1000, [umbral]() { inyectarGrabada(0, umbral); });
+}
+
+// Caídas programadas de la red
+void programarCaida(const unsigned long* intervalo, bool* disponible, const char* nombre) {
+  if (intervalo[1] <= intervalo[0]) return;
+  nativoProgramar((uint64_t)intervalo[0] * 1000, [=]() {
+    *disponible = false;
+    fprintf(stderr, "[nativo] %s caido en t=%lu ms\n", nombre, millis());
+  });
+  nativoProgramar((uint64_t)intervalo[1] * 1000, [=]() {
+    *disponible = true;
+    fprintf(stderr, "[nativo] %s restablecido en t=%lu ms\n", nombre, millis());
+  });
+}
+
+// Devuelve false si alguna latencia de alarma superó o.alarmaMaxMs
+bool reporte(const Opciones& o, double segundosReales) {
+  const EstadisticasNativo& e = nativoEstadisticas();
+  const MemoriaNativo& m = nativoMemoria();
+  double segundosVirtuales = nativoMicros() / 1e6;
+
+  fprintf(stderr, "\n=== Resumen simulación nativa ===\n");
+  fprintf(stderr, "Tiempo virtual:      %.1f s (%.0fx tiempo real)\n",
+          segundosVirtuales, segundosReales > 0 ? segundosVirtuales / segundosReales : 0.0);
+  fprintf(stderr, "Iteraciones loop():  %llu (%.0f/s reales), la mas larga %.1f ms\n",
+          (unsigned long long)e.iteracionesLoop, segundosReales > 0 ? e.iteracionesLoop / segundosReales : 0.0,
+          e.usLoopMax / 1e3);
+  fprintf(stderr, "CPU despierta:       %.2f%% (%.1f s en idle)\n",
+          nativoMicros() ? 100.0 * (nativoMicros() - e.usDormido) / nativoMicros() : 0.0, e.usDormido / 1e6);
+  fprintf(stderr, "LoRa RX:             %llu inyectados, %llu leidos, %llu perdidos\n",
+          (unsigned long long)e.loraInyectados, (unsigned long long)e.loraLeidos, (unsigned long long)e.loraPerdidos);
+  fprintf(stderr, "LoRa TX:             %llu paquetes, %.2f s en el aire (%.3f%% del tiempo)\n",
+          (unsigned long long)e.loraTransmitidos, e.usAireTx / 1e6,
+          nativoMicros() ? 100.0 * e.usAireTx / nativoMicros() : 0.0);
+  if (alarmas.muestras) {
+    fprintf(stderr, "Alarma:              %llu eventos, media %.1f ms, max %.1f ms hasta la trama con alerta\n",
+            (unsigned long long)alarmas.muestras, alarmas.mediaMs(), alarmas.maxMs());
+  }
+  if (alarmaPwm.muestras || alarmaPwm.pendiente) {
+    fprintf(stderr, "Alarma extractor:    %llu eventos, media %.1f ms, max %.1f ms hasta el PWM al maximo%s\n",
+            (unsigned long long)alarmaPwm.muestras, alarmaPwm.mediaMs(), alarmaPwm.maxMs(),
+            alarmaPwm.pendiente ? " (una sin respuesta)" : "");
+  }
+  if (alarmaMqtt.muestras) {
+    fprintf(stderr, "Alarma MQTT:         %llu eventos, media %.1f ms, max %.1f ms hasta gas/alarma\n",
+            (unsigned long long)alarmaMqtt.muestras, alarmaMqtt.mediaMs(), alarmaMqtt.maxMs());
+  }
+  if (primeraLectura.muestras) {
+    fprintf(stderr, "Primera lectura:     %llu arranques, media %.1f ms, max %.1f ms hasta ppm confiable\n",
+            (unsigned long long)primeraLectura.muestras, primeraLectura.mediaMs(), primeraLectura.maxMs());
+  }
+  if (latencias.muestras) {
+    fprintf(stderr, "Respuesta LoRa:      %llu respuestas, media %.1f ms, max %.1f ms\n",
+            (unsigned long long)latencias.muestras, latencias.mediaMs(), latencias.maxMs());
+  }
+  const ResumenComandos& c = comandosLora;
+  if (c.pedidos) {
+    fprintf(stderr, "Comandos:            %llu pedidos, %llu encolados, %llu rechazados, %llu entregados (%.1f%%), %llu fallidos\n",
+            (unsigned long long)c.pedidos, (unsigned long long)c.encolados, (unsigned long long)c.rechazados,
+            (unsigned long long)c.entregados, c.encolados ? 100.0 * c.entregados / c.encolados : 0.0,
+            (unsigned long long)c.fallidos);
+    if (c.entregados) {
+      fprintf(stderr, "Comandos entregados: media %.1f ms, max %llu ms, %.2f intentos, %llu confirmados por DUPLICATE\n",
+              (double)c.sumaLatenciaMs / c.entregados, (unsigned long long)c.maxLatenciaMs,
+              (double)c.intentos / c.entregados, (unsigned long long)c.duplicados);
+    }
+    fprintf(stderr, "Bajada LoRa:         %llu tramas de comando, %llu perdidas, %llu respuestas perdidas\n",
+            (unsigned long long)c.bajadas, (unsigned long long)c.bajadasPerdidas,
+            (unsigned long long)c.respuestasPerdidas);
+  }
+  const SeguimientoRampa& ra = rampa;
+  if (ra.duracion.muestras) {
+    fprintf(stderr, "Rampa extractor:     %llu rampas (%llu sin terminar), media %.1f ms (ideal %.1f ms), max %.1f ms\n",
+            (unsigned long long)ra.duracion.muestras, (unsigned long long)ra.incompletas, ra.duracion.mediaMs(),
+            ra.sumaEsperadaMs / ra.duracion.muestras, ra.duracion.maxMs());
+    fprintf(stderr, "Rampa seguimiento:   error medio %.2f PWM, max %d PWM respecto de la rampa lineal; %llu bloqueos de loop()\n",
+            ra.muestras ? ra.sumaError / ra.muestras : 0.0, ra.errorMax, (unsigned long long)ra.bloqueos);
+  }
+  const ArranquesPwm& ap = arranquesPwm;
+  if (__builtin_popcountll(ap.pines) > 1) {
+    fprintf(stderr, "Arranques PWM:       %llu en %d salidas, separacion minima %.1f ms, hasta %d en marcha\n",
+            (unsigned long long)ap.arranques, __builtin_popcountll(ap.pines),
+            ap.separacionMinUs == UINT64_MAX ? 0.0 : ap.separacionMinUs / 1000.0, ap.enMarchaMax);
+  }
+  const CanalNodos& cn = canalNodos;
+  if (cn.tramas) {
+    fprintf(stderr, "Canal:               %llu tramas, %llu perdidas por SNR (%.1f%%), %llu ajustes RADIO\n",
+            (unsigned long long)cn.tramas, (unsigned long long)cn.perdidas, 100.0 * cn.perdidas / cn.tramas,
+            (unsigned long long)cn.ajustes);
+    fprintf(stderr, "Energia TX nodos:    %.1f mJ, potencia media %.1f dBm\n",
+            cn.energiaMj, (double)cn.sumaPotencia / cn.tramas);
+  }
+  const ResumenEnlace& en = enlaceLora;
+  if (en.reportes) {
+    fprintf(stderr, "Enlace generado:     %llu tramas, %llu perdidas, %llu duplicadas\n",
+            (unsigned long long)en.generadas, (unsigned long long)en.perdidas, (unsigned long long)en.duplicadas);
+    fprintf(stderr, "Enlace reportado:    %llu mensajes, %llu recibidas, %llu perdidas, %llu duplicadas\n",
+            (unsigned long long)en.reportes, (unsigned long long)en.recibidasReportadas,
+            (unsigned long long)en.perdidasReportadas, (unsigned long long)en.duplicadasReportadas);
+  }
+  if (!resultadosControl.empty()) {
+    fprintf(stderr, "Resultados control: ");
+    for (const auto& r : resultadosControl) fprintf(stderr, " %llu %s", (unsigned long long)r.second, r.first.c_str());
+    fprintf(stderr, "\n");
+  }
+  if (c.respuestasNodo) {
+    fprintf(stderr, "Respuestas del nodo: %llu tramas, %llu DUPLICATE\n",
+            (unsigned long long)c.respuestasNodo, (unsigned long long)c.duplicadosNodo);
+  }
+  if (o.loraBanda > 0) {
+    fprintf(stderr, "Reporte excepcion:   %llu lecturas generadas sin transmitir (banda %.0f ppm)\n",
+            (unsigned long long)lecturasSuprimidas, o.loraBanda);
+  }
+  const Reproduccion& rp = reproduccion;
+  if (rp.lecturas) {
+    double enMarchaS = (rp.encendidoUs + (rp.encendido ? nativoMicros() - rp.encendidoDesdeUs : 0)) / 1e6;
+    uint64_t anticipados = rp.cruces - rp.sinExtractor;
+    fprintf(stderr, "Reproduccion:        %llu lecturas de %d nodos, %llu cruces de %.0f ppm, extractor %.0f s en marcha\n",
+            (unsigned long long)rp.lecturas, __builtin_popcountll(rp.nodos), (unsigned long long)rp.cruces,
+            o.configPlanta.umbralPpm, enMarchaS);
+    fprintf(stderr, "Reproduccion cruces: %llu con el extractor en marcha desde %.1f s antes (media, min %.1f s), %llu parado\n",
+            (unsigned long long)anticipados, anticipados ? rp.sumaAnticipacionS / anticipados : 0.0,
+            rp.minAnticipacionS, (unsigned long long)rp.sinExtractor);
+  }
+  redNativaReporte();
+  plantaReporte();
+  fprintf(stderr, "MQTT:                %llu publicados (%llu bytes), %llu conexiones\n",
+          (unsigned long long)e.mqttPublicados, (unsigned long long)e.mqttBytes, (unsigned long long)e.mqttConexiones);
+  fprintf(stderr, "Flash:               %llu escrituras (%llu bytes en archivos)\n",
+          (unsigned long long)e.escriturasFlash, (unsigned long long)e.bytesFlash);
+  fprintf(stderr, "Heap:                %zu bytes en uso, pico %zu, %llu reservas\n",
+          m.enUso, m.pico, (unsigned long long)m.reservas);
+
+  if (!o.alarmaMaxMs) return true;
+  double peor = std::max(alarmas.maxMs(), alarmaPwm.maxMs());
+  bool ok = peor <= o.alarmaMaxMs && !alarmaPwm.pendiente;
+  fprintf(stderr, "Limite de alarma:    %s (peor %.1f ms, limite %lu ms)\n",
+          ok ? "cumplido" : "EXCEDIDO", peor, o.alarmaMaxMs);
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Opciones o = leerOpciones(argc, argv);
+  nativoSilenciarSerial(o.silencio);
+  nativoFuenteAnalogica([o](uint8_t) { return lecturaAnalogica(o); });
+  if (o.loraCadaMs) programarTrafico(o);
+  if (!o.grabar.empty()) grabacion = fopen(o.grabar.c_str(), "w");
+  if (!o.reproducir.empty()) programarReproduccion(o);
+  if (o.red.nodos > 0) redNativaIniciar(o.red);
+  if (o.planta) {
+    plantaIniciar(o.configPlanta);
+    for (const Opciones::Fuga& f : o.fugas) plantaAgregarFuga(f.desde, f.hasta, f.litros);
+  }
+  if (o.mqttComandoCadaMs) programarComandosMqtt(o);
+  if (o.rampa[0]) {
+    std::string pendiente = "set_rampa:" + std::to_string(o.rampa[1]);
+    nativoProgramar(500000, [pendiente]() { nativoBroker().enviar("gas/control", pendiente.c_str()); });
+    programarRampas(o);
+  }
+  for (const std::string& m : o.mqttControl) {
+    nativoProgramar(1000, [m]() { nativoBroker().enviar("gas/control", m.c_str()); });
+  }
+  for (const auto& m : o.mqttControlEn) {
+    std::string texto = m.second;
+    nativoProgramar((uint64_t)m.first * 1000, [texto]() { nativoBroker().enviar("gas/control", texto.c_str()); });
+  }
+  medirRespuestas(o);
+  programarEventosAdc(o);
+  programarAlarmasLora(o);
+  nativoBroker().demoraPublicacionMs = o.mqttDemoraMs;
+  nativoDemoraNvsUs = o.nvsDemoraUs;
+  for (unsigned long ms : o.reinicios) {
+    nativoProgramar((uint64_t)ms * 1000, []() { nativoReiniciar(); });
+  }
+  programarCaida(o.mqttCaida, &nativoBroker().disponible, "broker MQTT");
+  programarCaida(o.wifiCaida, &nativoRed().disponible, "WiFi");
+
+  uint64_t finUs = o.ms * 1000;
+  auto inicio = std::chrono::steady_clock::now();
+
+  bool arrancar = true;
+  while (nativoMicros() < finUs) {
+    try {
+      if (arrancar) {
+        arrancar = false;
+        primeraLectura.empezar();
+        setup();
+      }
+      bool medirLoop = redNativaActiva();
+      uint64_t proximoBloqueoUs = (uint64_t)o.bloqueoLoop[0] * 1000;
+      while (nativoMicros() < finUs) {
+        if (o.bloqueoLoop[0] && nativoMicros() >= proximoBloqueoUs) {
+          // Lo que haga loop() a continuación llega tarde
+          nativoAvanzar((uint64_t)o.bloqueoLoop[1] * 1000);
+          proximoBloqueoUs += (uint64_t)o.bloqueoLoop[0] * 1000;
+          rampa.bloqueos++;
+        }
+        uint64_t antesUs = nativoMicros();
+        if (medirLoop) {
+          auto antes = std::chrono::steady_clock::now();
+          loop();
+          auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - antes);
+          redNativaMedirLoop(nativoMicros() - antesUs, (uint64_t)ns.count());
+        } else {
+          loop();
+        }
+        uint64_t loopUs = nativoMicros() - antesUs;
+        if (loopUs > nativoEstadisticas().usLoopMax) nativoEstadisticas().usLoopMax = loopUs;
+        nativoEstadisticas().iteracionesLoop++;
+        nativoAvanzar(o.tickUs);
+      }
+    } catch (const ReinicioNativo&) {
+      fprintf(stderr, "[nativo] reinicio por software en t=%lu ms\n", millis());
+      arrancar = true;
+    }
+  }
+
+  double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+  fflush(stdout);
+  if (grabacion) fclose(grabacion);
+  return reporte(o, segundos) ? 0 : 1;
+}
+
+#endif  // PIO_UNIT_TESTING